@@ -53,6 +53,7 @@
 #include "utils/path.h"
 #include "utils/str.h"
 #include "utils/utils.h"
+#include "utils/wakeup.h"
 #include "cmd_completion.h"
 #include "status.h"
 
@@ -589,6 +590,9 @@ append_error_msg(bg_job_t *job, const char err_msg[])
 	(void)strappend(&job->errors, &job->errors_len, err_msg);
 	(void)strappend(&job->new_errors, &job->new_errors_len, err_msg);
 	pthread_spin_unlock(&job->errors_lock);
+
+	/* Let main thread display the message. */
+	wakeup_notify();
 }
 
 pid_t
@@ -1027,6 +1031,8 @@ background_task_bootstrap(void *arg)
 
 	free(task_args);
 
+	wakeup_notify();
+
 	return NULL;
 }
 
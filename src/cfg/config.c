@@ -24,6 +24,8 @@
 #define MYVIFMRC_EV "MYVIFMRC"
 #define TRASH "Trash"
 #define LOG "log"
+#define FINGERPRINTS "fingerprints"
+#define DIRSIZES "dirsizes"
 #define VIFMRC "vifmrc"
 
 #ifndef __APPLE__
@@ -111,6 +113,7 @@ cfg_init(void)
 	cfg.auto_execute = 0;
 	cfg.time_format = strdup("%m/%d %H:%M");
 	cfg.wrap_quick_view = 1;
+	cfg.preview_cache_size = 4096;
 	cfg.undo_levels = 100;
 	cfg.sort_numbers = 0;
 	cfg.follow_links = 1;
@@ -206,6 +209,7 @@ cfg_init(void)
 	cfg.name_dec_count = 0;
 
 	cfg.fast_file_cloning = 0;
+	cfg.io_threads = 4;
 	cfg.cvoptions = 0;
 
 	cfg.case_override = 0;
@@ -546,6 +550,10 @@ store_config_paths(void)
 			cfg.config_dir);
 	snprintf(cfg.trash_dir, sizeof(cfg.trash_dir), trash_dir_fmt, trash_base);
 	snprintf(cfg.log_file, sizeof(cfg.log_file), "%s/" LOG, base);
+	snprintf(cfg.fingerprints_file, sizeof(cfg.fingerprints_file),
+			"%s/" FINGERPRINTS, base);
+	snprintf(cfg.dirsizes_file, sizeof(cfg.dirsizes_file), "%s/" DIRSIZES,
+			base);
 
 	fuse_home = format_str("%s/fuse/", base);
 	(void)cfg_set_fuse_home(fuse_home);
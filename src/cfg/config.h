@@ -129,7 +129,8 @@ enum
 	VINFO_PHISTORY  = 1 << 13, /* Prompt history. */
 	VINFO_SHISTORY  = 1 << 14, /* Search history. */
 	VINFO_SAVEDIRS  = 1 << 15, /* Restore last used directories on startup. */
-	NUM_VINFO       = 16,      /* Number of VINFO_* constants. */
+	VINFO_DIRSIZES  = 1 << 16, /* Sizes of directories (in a separate file). */
+	NUM_VINFO       = 17,      /* Number of VINFO_* constants. */
 };
 
 /* When cursor position should be adjusted according to directory history. */
@@ -162,6 +163,10 @@ typedef struct config_t
 	/* This one should be set using set_trash_dir() function. */
 	char trash_dir[PATH_MAX + 1];
 	char log_file[PATH_MAX + 1];
+	/* Where fingerprints of files compared by contents are cached. */
+	char fingerprints_file[PATH_MAX + 16];
+	/* Where sizes of directories are stored between sessions. */
+	char dirsizes_file[PATH_MAX + 16];
 	char *vi_command;
 	int vi_cmd_bg;
 	char *vi_x_command;
@@ -176,6 +181,8 @@ typedef struct config_t
 
 	int auto_execute;
 	int wrap_quick_view;
+	/* Amount of memory for previews of files that aren't displayed (in KiB). */
+	int preview_cache_size;
 	char *time_format;
 	/* This one should be set using cfg_set_fuse_home() function. */
 	char *fuse_home;
@@ -293,6 +300,9 @@ typedef struct config_t
 	/* Controls use of fast file cloning for file systems that support it. */
 	int fast_file_cloning;
 
+	/* Maximum number of threads used to query metadata of files. */
+	int io_threads;
+
 	/* Whether various things should be reset on entering/leaving custom views. */
 	int cvoptions;
 
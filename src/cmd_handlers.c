@@ -2420,6 +2420,8 @@ static int
 find_cmd(const cmd_info_t *cmd_info)
 {
 	static char *last_args;
+	static char **last_argv;
+	static int last_argc;
 	static int last_dir;
 
 	if(cmd_info->argc > 0)
@@ -2431,6 +2433,10 @@ find_cmd(const cmd_info_t *cmd_info)
 		else
 			last_dir = 0;
 		(void)replace_string(&last_args, cmd_info->args);
+
+		free_string_array(last_argv, last_argc);
+		last_argv = copy_string_array(cmd_info->argv, cmd_info->argc);
+		last_argc = (last_argv == NULL) ? 0 : cmd_info->argc;
 	}
 	else if(last_args == NULL)
 	{
@@ -2438,7 +2444,8 @@ find_cmd(const cmd_info_t *cmd_info)
 		return 1;
 	}
 
-	return show_find_menu(curr_view, last_dir, last_args) != 0;
+	return show_find_menu(curr_view, last_dir, last_args, last_argc,
+			last_argv) != 0;
 }
 
 static int
@@ -20,11 +20,12 @@
 
 #include <assert.h> /* assert() */
 #include <stddef.h> /* size_t */
-#include <stdint.h> /* INTPTR_MAX INT64_MAX */
-#include <stdio.h> /* FILE fclose() feof() fopen() fread() */
-#include <stdlib.h> /* free() malloc() */
+#include <stdint.h> /* INTPTR_MAX INT64_MAX uint64_t */
+#include <stdio.h> /* FILE fclose() feof() fread() setvbuf() snprintf() */
+#include <stdlib.h> /* calloc() free() malloc() */
 #include <string.h> /* memcmp() */
 
+#include "cfg/config.h"
 #include "compat/fs_limits.h"
 #include "compat/os.h"
 #include "compat/reallocarray.h"
@@ -32,10 +33,13 @@
 #include "ui/cancellation.h"
 #include "ui/statusbar.h"
 #include "ui/ui.h"
+#include "utils/cancellation.h"
 #include "utils/dynarray.h"
+#include "utils/fcache.h"
 #include "utils/fs.h"
 #include "utils/fsdata.h"
 #include "utils/macros.h"
+#include "utils/parallel.h"
 #include "utils/path.h"
 #include "utils/str.h"
 #include "utils/string_array.h"
@@ -56,38 +60,96 @@
 /* Amount of data to hash for coarse comparison. */
 #define PREFIX_SIZE (256*1024)
 
-/* Entry in singly-bounded list of files that have matched fingerprints. */
-typedef struct compare_record_t
+/* Amount of data to read at once when checking files for equality. */
+#define CMP_BLOCK_SIZE (1024*1024)
+
+/* Number of files per thread to fingerprint between progress updates. */
+#define HASH_BATCH_SIZE 16
+
+/* Maximum number of records kept in persistent cache. */
+#define MAX_CACHED_FINGERPRINTS 500000
+
+/* Entry of a trie that maps fingerprints to ids. */
+typedef struct
 {
-	char *path;                    /* Full path to file with sample content. */
-	int id;                        /* Chosen id. */
-	struct compare_record_t *next; /* Next entry in the list. */
+	int id; /* Chosen id. */
 }
 compare_record_t;
 
+/* Batch of files to be fingerprinted in parallel. */
+typedef struct
+{
+	const dir_entry_t **entries;     /* Entries of files to process. */
+	char **fingerprints;             /* Output aligned with entries. */
+	CompareType ct;                  /* Type of fingerprints to compute. */
+	fcache_t *cache;                 /* Cache of fingerprints or NULL. */
+	const unsigned long long *sizes; /* Sorted sizes of all files. */
+	int nsizes;                      /* Number of elements in sizes. */
+}
+fingerprint_batch_t;
+
+/* File whose fingerprint is checked for collisions with other files. */
+typedef struct
+{
+	const char *fingerprint; /* Fingerprint of the file. */
+	int index;               /* Index of the file among all files. */
+	int cls;                 /* Index of the first file with identical contents or
+	                            -1 if it's not yet known. */
+}
+candidate_t;
+
+/* Batch of files to be compared against files of identical fingerprints in
+ * parallel. */
+typedef struct
+{
+	const dir_entry_t **entries; /* Entries of all files. */
+	candidate_t *candidates;     /* Candidates sorted by fingerprint. */
+	const int *todo;             /* Positions of candidates to process. */
+	const int *pivots;           /* Positions of candidates to compare with. */
+	fcache_t *cache;             /* Cache of comparison results or NULL. */
+}
+collision_batch_t;
+
 static void make_unique_lists(entries_t curr, entries_t other);
 static void leave_only_dups(entries_t *curr, entries_t *other);
 static int is_not_duplicate(view_t *view, const dir_entry_t *entry, void *arg);
 static void fill_side_by_side(entries_t curr, entries_t other, int group_paths);
 static int id_sorter(const void *first, const void *second);
 static void put_or_free(view_t *view, dir_entry_t *entry, int id, int take);
-static entries_t make_diff_list(trie_t *trie, view_t *view, int *next_id,
-		CompareType ct, int skip_empty, int dups_only);
+static entries_t list_diff_files(view_t *view, int skip_empty);
+static char ** make_fingerprints(const entries_t lists[], int nlists,
+		CompareType ct);
+static int size_sorter(const void *first, const void *second);
+static void fingerprint_file(int index, void *arg);
+static fcache_t * get_cache(CompareType ct);
+static int resolve_collisions(const dir_entry_t *entries[],
+		char *fingerprints[], int total, int nthreads, fcache_t *cache);
+static int candidate_sorter(const void *first, const void *second);
+static void compare_candidate(int index, void *arg);
+static int compare_with_cache(const char a[], const char b[],
+		fcache_t *cache);
+static int size_is_unique(const unsigned long long sizes[], int count,
+		unsigned long long size);
+static void assign_ids(trie_t *trie, view_t *view, entries_t *list,
+		char *fingerprints[], int *next_id, int dups_only);
 static void list_view_entries(const view_t *view, strlist_t *list);
 static int append_valid_nodes(const char name[], int valid,
 		const void *parent_data, void *data, void *arg);
 static void list_files_recursively(const char path[], int skip_dot_files,
 		strlist_t *list);
 static char * get_file_fingerprint(const char path[], const dir_entry_t *entry,
-		CompareType ct);
+		CompareType ct, fcache_t *cache);
 static char * get_contents_fingerprint(const char path[],
-		const dir_entry_t *entry);
-static int get_file_id(trie_t *trie, const char path[],
-		const char fingerprint[], int *id, CompareType ct);
-static int files_are_identical(const char a[], const char b[]);
-static void put_file_id(trie_t *trie, const char path[],
-		const char fingerprint[], int id, CompareType ct);
-static void free_compare_records(void *ptr);
+		const dir_entry_t *entry, fcache_t *cache);
+static int get_file_id(trie_t *trie, const char fingerprint[], int *id);
+static int files_are_identical(const char a[], const char b[],
+		const cancellation_t *cancellation);
+static void put_file_id(trie_t *trie, const char fingerprint[], int id);
+
+/* Persistent cache of fingerprints and results of comparisons between files.
+ * It's loaded on first use, flushed after every comparison and saved on
+ * exit. */
+static fcache_t *persistent_cache;
 
 int
 compare_two_panes(CompareType ct, ListType lt, int group_paths, int skip_empty)
@@ -108,14 +170,24 @@ compare_two_panes(CompareType ct, ListType lt, int group_paths, int skip_empty)
 	ui_cancellation_reset();
 	ui_cancellation_enable();
 
-	curr = make_diff_list(trie, curr_view, &next_id, ct, skip_empty, 0);
-	other = make_diff_list(trie, other_view, &next_id, ct, skip_empty,
+	entries_t lists[2];
+	lists[0] = list_diff_files(curr_view, skip_empty);
+	lists[1] = list_diff_files(other_view, skip_empty);
+
+	char **const fingerprints = make_fingerprints(lists, 2, ct);
+	const int nfingerprints = lists[0].nentries + lists[1].nentries;
+	assign_ids(trie, curr_view, &lists[0], fingerprints, &next_id, 0);
+	assign_ids(trie, other_view, &lists[1],
+			fingerprints == NULL ? NULL : fingerprints + lists[0].nentries, &next_id,
 			lt == LT_DUPS);
+	curr = lists[0];
+	other = lists[1];
 
 	ui_cancellation_disable();
-	trie_free_with_data(trie, &free_compare_records);
+	trie_free_with_data(trie, &free);
+	free_string_array(fingerprints, nfingerprints);
 
-	/* Clear progress message displayed by make_diff_list(). */
+	/* Clear progress message displayed by make_fingerprints(). */
 	ui_sb_quick_msg_clear();
 
 	if(ui_cancellation_requested())
@@ -129,7 +201,7 @@ compare_two_panes(CompareType ct, ListType lt, int group_paths, int skip_empty)
 	if(!group_paths || lt != LT_ALL)
 	{
 		/* Sort both lists according to unique file numbers to group identical files
-		 * (sorting is stable, tags are set in make_diff_list()). */
+		 * (sorting is stable, tags are set in list_diff_files()). */
 		safe_qsort(curr.entries, curr.nentries, sizeof(*curr.entries), &id_sorter);
 		safe_qsort(other.entries, other.nentries, sizeof(*other.entries),
 				&id_sorter);
@@ -390,12 +462,16 @@ compare_one_pane(view_t *view, CompareType ct, ListType lt, int skip_empty)
 	ui_cancellation_reset();
 	ui_cancellation_enable();
 
-	curr = make_diff_list(trie, view, &next_id, ct, skip_empty, 0);
+	curr = list_diff_files(view, skip_empty);
+	char **const fingerprints = make_fingerprints(&curr, 1, ct);
+	const int nfingerprints = curr.nentries;
+	assign_ids(trie, view, &curr, fingerprints, &next_id, 0);
 
 	ui_cancellation_disable();
-	trie_free_with_data(trie, &free_compare_records);
+	trie_free_with_data(trie, &free);
+	free_string_array(fingerprints, nfingerprints);
 
-	/* Clear progress message displayed by make_diff_list(). */
+	/* Clear progress message displayed by make_fingerprints(). */
 	ui_sb_quick_msg_clear();
 
 	if(ui_cancellation_requested())
@@ -489,17 +565,14 @@ put_or_free(view_t *view, dir_entry_t *entry, int id, int take)
 	}
 }
 
-/* Makes sorted by path list of entries that.  The trie is used to keep track of
- * identical files.  With non-zero dups_only, new files aren't added to the
- * trie. */
+/* Makes list of entries of files to be compared sorted by path.  Entries are
+ * tagged with their position in the list. */
 static entries_t
-make_diff_list(trie_t *trie, view_t *view, int *next_id, CompareType ct,
-		int skip_empty, int dups_only)
+list_diff_files(view_t *view, int skip_empty)
 {
 	int i;
 	strlist_t files = {};
 	entries_t r = {};
-	int last_progress = 0;
 
 	show_progress("Listing...", 0);
 	if(flist_custom_active(view) &&
@@ -512,15 +585,14 @@ make_diff_list(trie_t *trie, view_t *view, int *next_id, CompareType ct,
 		list_files_recursively(flist_get_dir(view), view->hide_dot, &files);
 	}
 
-	show_progress("Querying...", 0);
 	for(i = 0; i < files.nitems && !ui_cancellation_requested(); ++i)
 	{
-		int progress;
-		int existing_id;
-		char *fingerprint;
-		const char *const path = files.items[i];
 		dir_entry_t *const entry = entry_list_add(view, &r.entries, &r.nentries,
-				path);
+				files.items[i]);
+		if(entry == NULL)
+		{
+			continue;
+		}
 
 		if(skip_empty && entry->size == 0)
 		{
@@ -529,19 +601,398 @@ make_diff_list(trie_t *trie, view_t *view, int *next_id, CompareType ct,
 			continue;
 		}
 
-		fingerprint = get_file_fingerprint(path, entry, ct);
+		entry->tag = i;
+	}
+
+	free_string_array(files.items, files.nitems);
+	return r;
+}
+
+/* Computes fingerprints of files of all lists using several threads when
+ * comparing by contents.  Files whose size is unique among all lists aren't
+ * read as they can't match any other file.  Fingerprints of contents are made
+ * equal only for files with identical contents.  Returns array of fingerprints
+ * aligned with concatenation of the lists, its elements are NULL or empty for
+ * files that should be ignored.  Returns NULL on error. */
+static char **
+make_fingerprints(const entries_t lists[], int nlists, CompareType ct)
+{
+	int i, j;
+	int total = 0;
+	int last_progress = 0;
+
+	for(i = 0; i < nlists; ++i)
+	{
+		total += lists[i].nentries;
+	}
+
+	char **fingerprints = calloc(total, sizeof(*fingerprints));
+	const dir_entry_t **const entries = reallocarray(NULL, total,
+			sizeof(*entries));
+	unsigned long long *const sizes = reallocarray(NULL, total, sizeof(*sizes));
+	if(total != 0 && (fingerprints == NULL || entries == NULL || sizes == NULL))
+	{
+		free(fingerprints);
+		free(entries);
+		free(sizes);
+		return NULL;
+	}
+
+	total = 0;
+	for(i = 0; i < nlists; ++i)
+	{
+		for(j = 0; j < lists[i].nentries; ++j)
+		{
+			entries[total] = &lists[i].entries[j];
+			sizes[total] = lists[i].entries[j].size;
+			++total;
+		}
+	}
+	safe_qsort(sizes, total, sizeof(*sizes), &size_sorter);
+
+	fingerprint_batch_t batch = {
+		.ct = ct,
+		.sizes = sizes,
+		.nsizes = total,
+	};
+
+	/* Cache makes repeated comparison of the same files cheap. */
+	batch.cache = get_cache(ct);
+
+	/* Reading file contents is the only case when multiple threads help.
+	 * Fingerprints are computed in batches to be able to report progress and
+	 * react on cancellation requests in between. */
+	const int nthreads = (ct == CT_CONTENTS ? cfg.io_threads : 1);
+	const int batch_size = HASH_BATCH_SIZE*MAX(nthreads, 1);
+
+	show_progress("Querying...", 0);
+	for(i = 0; i < total && !ui_cancellation_requested(); i += batch_size)
+	{
+		batch.entries = &entries[i];
+		batch.fingerprints = &fingerprints[i];
+		parallel_for(MIN(batch_size, total - i), nthreads, &fingerprint_file,
+				&batch);
+
+		const int progress = (i*100)/total;
+		if(progress != last_progress)
+		{
+			char progress_msg[128];
+
+			last_progress = progress;
+			snprintf(progress_msg, sizeof(progress_msg), "Querying... %d (% 2d%%)", i,
+					progress);
+			show_progress(progress_msg, -1);
+		}
+	}
+
+	if(ct == CT_CONTENTS && !ui_cancellation_requested() &&
+			resolve_collisions(entries, fingerprints, total, nthreads,
+				batch.cache) != 0)
+	{
+		free_string_array(fingerprints, total);
+		fingerprints = NULL;
+	}
+
+	if(batch.cache != NULL)
+	{
+		/* Appending new records is much cheaper than rewriting the file. */
+		(void)fcache_flush(batch.cache);
+	}
+
+	free(entries);
+	free(sizes);
+	return fingerprints;
+}
+
+/* qsort() comparer that sorts sizes in ascending order.  Returns standard -1,
+ * 0, 1 for comparisons. */
+static int
+size_sorter(const void *first, const void *second)
+{
+	const unsigned long long a = *(const unsigned long long *)first;
+	const unsigned long long b = *(const unsigned long long *)second;
+	return (a > b) - (a < b);
+}
+
+/* Computes fingerprint of a single file of a batch.  Implements
+ * parallel_func. */
+static void
+fingerprint_file(int index, void *arg)
+{
+	fingerprint_batch_t *const batch = arg;
+	const dir_entry_t *const entry = batch->entries[index];
+
+	char path[PATH_MAX + 1];
+	get_full_path_of(entry, sizeof(path), path);
+
+	if(batch->ct == CT_CONTENTS &&
+			size_is_unique(batch->sizes, batch->nsizes, entry->size))
+	{
+		/* Reading the file is pointless, but unreadable files must be ignored in
+		 * the same way as when its contents is hashed. */
+		batch->fingerprints[index] = (os_access(path, R_OK) == 0)
+		                           ? format_str("%" PRINTF_ULL "|",
+		                                        (unsigned long long)entry->size)
+		                           : strdup("");
+		return;
+	}
+
+	batch->fingerprints[index] = get_file_fingerprint(path, entry, batch->ct,
+			batch->cache);
+}
+
+/* Retrieves persistent cache for comparison of the specified type loading it
+ * if necessary.  Returns the cache or NULL if it's not used or on error. */
+static fcache_t *
+get_cache(CompareType ct)
+{
+	if(ct != CT_CONTENTS || cfg.fingerprints_file[0] == '\0')
+	{
+		return NULL;
+	}
+
+	if(persistent_cache == NULL)
+	{
+		persistent_cache = fcache_load(cfg.fingerprints_file,
+				MAX_CACHED_FINGERPRINTS);
+	}
+	return persistent_cache;
+}
+
+/* Makes sure that fingerprints of files match only if contents of the files
+ * is identical by comparing files with matching fingerprints.  Files are
+ * compared in rounds, each round picks a pivot among unresolved files of every
+ * group of matching fingerprints and compares the rest of such files with it
+ * using several threads.  The cache can be NULL, otherwise results of
+ * comparisons are looked up in it and stored there.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+resolve_collisions(const dir_entry_t *entries[], char *fingerprints[],
+		int total, int nthreads, fcache_t *cache)
+{
+	int i, j;
+	int ncandidates = 0;
+	int ncompared = 0;
+
+	candidate_t *const candidates = reallocarray(NULL, total,
+			sizeof(*candidates));
+	int *const todo = reallocarray(NULL, total, sizeof(*todo));
+	int *const pivots = reallocarray(NULL, total, sizeof(*pivots));
+	if(total != 0 && (candidates == NULL || todo == NULL || pivots == NULL))
+	{
+		free(candidates);
+		free(todo);
+		free(pivots);
+		return 1;
+	}
+
+	for(i = 0; i < total; ++i)
+	{
+		if(!is_null_or_empty(fingerprints[i]))
+		{
+			candidates[ncandidates++] = (candidate_t){
+				.fingerprint = fingerprints[i],
+				.index = i,
+				.cls = -1,
+			};
+		}
+	}
+	safe_qsort(candidates, ncandidates, sizeof(*candidates), &candidate_sorter);
+
+	collision_batch_t batch = {
+		.entries = entries,
+		.candidates = candidates,
+		.todo = todo,
+		.pivots = pivots,
+		.cache = cache,
+	};
+	const int batch_size = HASH_BATCH_SIZE*MAX(nthreads, 1);
+
+	while(!ui_cancellation_requested())
+	{
+		int ntodo = 0;
+		for(i = 0; i < ncandidates; i = j)
+		{
+			int pivot = -1;
+			for(j = i; j < ncandidates; ++j)
+			{
+				candidate_t *const candidate = &candidates[j];
+				if(strcmp(candidate->fingerprint, candidates[i].fingerprint) != 0)
+				{
+					break;
+				}
+
+				if(candidate->cls != -1)
+				{
+					continue;
+				}
+
+				if(pivot == -1)
+				{
+					pivot = j;
+					candidate->cls = candidate->index;
+					continue;
+				}
+
+				pivots[j] = pivot;
+				todo[ntodo++] = j;
+			}
+		}
+
+		if(ntodo == 0)
+		{
+			break;
+		}
+
+		/* Files are compared in batches to be able to report progress and react
+		 * on cancellation requests in between. */
+		for(i = 0; i < ntodo && !ui_cancellation_requested(); i += batch_size)
+		{
+			char progress_msg[128];
+
+			batch.todo = &todo[i];
+			parallel_for(MIN(batch_size, ntodo - i), nthreads, &compare_candidate,
+					&batch);
+
+			ncompared += MIN(batch_size, ntodo - i);
+			snprintf(progress_msg, sizeof(progress_msg), "Comparing... %d",
+					ncompared);
+			show_progress(progress_msg, -1);
+		}
+	}
+
+	/* Make fingerprints of files with different contents distinct. */
+	int error = 0;
+	for(i = 0; i < ncandidates && !error; ++i)
+	{
+		const int index = candidates[i].index;
+		char *const fingerprint = format_str("%s|%d", fingerprints[index],
+				candidates[i].cls);
+		error = (fingerprint == NULL);
+		free(fingerprints[index]);
+		fingerprints[index] = fingerprint;
+	}
+
+	free(candidates);
+	free(todo);
+	free(pivots);
+	return error;
+}
+
+/* qsort() comparer that groups candidates by fingerprints keeping them in
+ * their original order within a group.  Returns standard -1, 0, 1 for
+ * comparisons. */
+static int
+candidate_sorter(const void *first, const void *second)
+{
+	const candidate_t *const a = first;
+	const candidate_t *const b = second;
+	const int result = strcmp(a->fingerprint, b->fingerprint);
+	return (result != 0) ? result : (a->index > b->index) - (a->index < b->index);
+}
+
+/* Compares a single file of a batch against its pivot and joins class of the
+ * pivot on match.  Implements parallel_func. */
+static void
+compare_candidate(int index, void *arg)
+{
+	collision_batch_t *const batch = arg;
+	const int pos = batch->todo[index];
+	candidate_t *const candidate = &batch->candidates[pos];
+	const candidate_t *const pivot = &batch->candidates[batch->pivots[pos]];
+
+	char path[PATH_MAX + 1], pivot_path[PATH_MAX + 1];
+	get_full_path_of(batch->entries[candidate->index], sizeof(path), path);
+	get_full_path_of(batch->entries[pivot->index], sizeof(pivot_path),
+			pivot_path);
+
+	if(compare_with_cache(path, pivot_path, batch->cache))
+	{
+		candidate->cls = pivot->cls;
+	}
+}
+
+/* Checks whether two files hold identical content consulting the cache, which
+ * can be NULL, before reading the files and updating it afterwards.  Returns
+ * non-zero if so, otherwise zero is returned. */
+static int
+compare_with_cache(const char a[], const char b[], fcache_t *cache)
+{
+	fcache_key_t a_key, b_key, key;
+	const int use_cache = (cache != NULL && fcache_key(a, &a_key) == 0 &&
+			fcache_key(b, &b_key) == 0);
+
+	uint64_t identical;
+	if(use_cache)
+	{
+		fcache_pair_key(&a_key, &b_key, &key);
+		if(fcache_get(cache, &key, &identical))
+		{
+			return (identical != 0U);
+		}
+	}
+
+	identical = files_are_identical(a, b, &ui_cancellation_info);
+	/* Result of interrupted comparison is meaningless. */
+	if(use_cache && !ui_cancellation_requested())
+	{
+		fcache_put(cache, &key, identical);
+	}
+	return (identical != 0U);
+}
+
+/* Checks whether the size occurs only once in a sorted array of sizes.
+ * Returns non-zero if so, otherwise zero is returned. */
+static int
+size_is_unique(const unsigned long long sizes[], int count,
+		unsigned long long size)
+{
+	/* Find the first element that is not less than the size. */
+	int l = 0, r = count;
+	while(l < r)
+	{
+		const int m = l + (r - l)/2;
+		if(sizes[m] < size)
+		{
+			l = m + 1;
+		}
+		else
+		{
+			r = m;
+		}
+	}
+
+	return (l + 1 >= count || sizes[l + 1] != size);
+}
+
+/* Assigns ids to entries of the list according to their fingerprints.  The
+ * trie is used to keep track of identical files.  With non-zero dups_only, new
+ * files aren't added to the trie.  Entries without fingerprint are removed
+ * from the list. */
+static void
+assign_ids(trie_t *trie, view_t *view, entries_t *list, char *fingerprints[],
+		int *next_id, int dups_only)
+{
+	int i, j;
+
+	j = 0;
+	for(i = 0; i < list->nentries; ++i)
+	{
+		int existing_id;
+		dir_entry_t *const entry = &list->entries[i];
+		const char *const fingerprint = (fingerprints == NULL ? NULL
+		                                                      : fingerprints[i]);
+
 		/* In case we couldn't obtain fingerprint (e.g., comparing by contents and
-		 * files isn't readable), ignore the file and keep going. */
-		if(is_null_or_empty(fingerprint))
+		 * files isn't readable), ignore the file and keep going.  Same for the
+		 * rest of files if operation was cancelled. */
+		if(is_null_or_empty(fingerprint) || ui_cancellation_requested())
 		{
-			free(fingerprint);
 			fentry_free(view, entry);
-			--r.nentries;
 			continue;
 		}
 
-		entry->tag = i;
-		if(get_file_id(trie, path, fingerprint, &existing_id, ct))
+		if(get_file_id(trie, fingerprint, &existing_id))
 		{
 			entry->id = existing_id;
 		}
@@ -553,25 +1004,12 @@ make_diff_list(trie_t *trie, view_t *view, int *next_id, CompareType ct,
 		{
 			entry->id = *next_id;
 			++*next_id;
-			put_file_id(trie, path, fingerprint, entry->id, ct);
+			put_file_id(trie, fingerprint, entry->id);
 		}
 
-		free(fingerprint);
-
-		progress = (i*100)/files.nitems;
-		if(progress != last_progress)
-		{
-			char progress_msg[128];
-
-			last_progress = progress;
-			snprintf(progress_msg, sizeof(progress_msg), "Querying... %d (% 2d%%)", i,
-					progress);
-			show_progress(progress_msg, -1);
-		}
+		list->entries[j++] = *entry;
 	}
-
-	free_string_array(files.items, files.nitems);
-	return r;
+	list->nentries = j;
 }
 
 /* Fills the list with entries of the view in hierarchical order (pre-order tree
@@ -674,11 +1112,12 @@ list_files_recursively(const char path[], int skip_dot_files, strlist_t *list)
 }
 
 /* Computes fingerprint of the file specified by path and entry.  Type of the
- * fingerprint is determined by ct parameter.  Returns newly allocated string
- * with the fingerprint, which is empty or NULL on error. */
+ * fingerprint is determined by ct parameter.  The cache of contents
+ * fingerprints can be NULL.  Returns newly allocated string with the
+ * fingerprint, which is empty or NULL on error. */
 static char *
 get_file_fingerprint(const char path[], const dir_entry_t *entry,
-		CompareType ct)
+		CompareType ct, fcache_t *cache)
 {
 	switch(ct)
 	{
@@ -694,16 +1133,19 @@ get_file_fingerprint(const char path[], const dir_entry_t *entry,
 		case CT_SIZE:
 			return format_str("%" PRINTF_ULL, (unsigned long long)entry->size);
 		case CT_CONTENTS:
-			return get_contents_fingerprint(path, entry);
+			return get_contents_fingerprint(path, entry, cache);
 	}
 	assert(0 && "Unexpected diffing type.");
 	return strdup("");
 }
 
-/* Makes fingerprint of file contents (all or part of it of fixed size).
- * Returns the fingerprint as a string, which is empty or NULL on error. */
+/* Makes fingerprint of file contents (all or part of it of fixed size).  The
+ * cache can be NULL, otherwise it's consulted before reading the file and
+ * updated afterwards.  Returns the fingerprint as a string, which is empty or
+ * NULL on error. */
 static char *
-get_contents_fingerprint(const char path[], const dir_entry_t *entry)
+get_contents_fingerprint(const char path[], const dir_entry_t *entry,
+		fcache_t *cache)
 {
 #if INTPTR_MAX == INT64_MAX
 #define XX_BITS 64
@@ -714,6 +1156,15 @@ get_contents_fingerprint(const char path[], const dir_entry_t *entry)
 #define XX_(name, bits) XX__(name, bits)
 #define XX(name) XX_(name, XX_BITS)
 
+	uint64_t digest;
+	fcache_key_t key;
+	const int use_cache = (cache != NULL && fcache_key(path, &key) == 0);
+	if(use_cache && fcache_get(cache, &key, &digest))
+	{
+		return format_str("%" PRINTF_ULL "|%" PRINTF_ULL,
+				(unsigned long long)entry->size, (unsigned long long)digest);
+	}
+
 	XX(state_t) st;
 	char block[BLOCK_SIZE];
 	size_t to_read = PREFIX_SIZE;
@@ -738,8 +1189,14 @@ get_contents_fingerprint(const char path[], const dir_entry_t *entry)
 	}
 	fclose(in);
 
+	digest = XX(digest)(&st);
+	if(use_cache)
+	{
+		fcache_put(cache, &key, digest);
+	}
+
 	return format_str("%" PRINTF_ULL "|%" PRINTF_ULL,
-			(unsigned long long)entry->size, (unsigned long long)XX(digest)(&st));
+			(unsigned long long)entry->size, (unsigned long long)digest);
 
 #undef XX_BITS
 #undef XX__
@@ -750,125 +1207,87 @@ get_contents_fingerprint(const char path[], const dir_entry_t *entry)
 /* Retrieves file from the trie by its fingerprint.  Returns non-zero if it was
  * in the trie and sets *id, otherwise zero is returned. */
 static int
-get_file_id(trie_t *trie, const char path[], const char fingerprint[], int *id,
-		CompareType ct)
+get_file_id(trie_t *trie, const char fingerprint[], int *id)
 {
 	void *data;
-	compare_record_t *record;
 	if(trie_get(trie, fingerprint, &data) != 0)
 	{
 		return 0;
 	}
-	record = data;
 
-	/* Comparison by contents is the only one when we need to resolve fingerprint
-	 * conflicts. */
-	if(ct != CT_CONTENTS)
-	{
-		*id = record->id;
-		return 1;
-	}
-
-	/* Fingerprint does not guarantee a match, go through files and find file with
-	 * identical content. */
-	do
-	{
-		if(files_are_identical(path, record->path))
-		{
-			*id = record->id;
-			return 1;
-		}
-		record = record->next;
-	}
-	while(record != NULL);
-
-	return 0;
+	const compare_record_t *const record = data;
+	*id = record->id;
+	return 1;
 }
 
 /* Checks whether two files specified by their names hold identical content.
  * Returns non-zero if so, otherwise zero is returned. */
 static int
-files_are_identical(const char a[], const char b[])
+files_are_identical(const char a[], const char b[],
+		const cancellation_t *cancellation)
 {
-	char a_block[BLOCK_SIZE], b_block[BLOCK_SIZE];
-	FILE *const a_file = fopen(a, "rb");
-	FILE *const b_file = fopen(b, "rb");
-
-	if(a_file == NULL || b_file == NULL)
+	int identical = 0;
+	/* Big buffers reduce number of system calls and seeks between files. */
+	char *const a_block = malloc(CMP_BLOCK_SIZE);
+	char *const b_block = malloc(CMP_BLOCK_SIZE);
+	FILE *const a_file = os_fopen(a, "rb");
+	FILE *const b_file = os_fopen(b, "rb");
+
+	if(a_block != NULL && b_block != NULL && a_file != NULL && b_file != NULL)
 	{
-		if(a_file != NULL)
-		{
-			fclose(a_file);
-		}
-		if(b_file != NULL)
-		{
-			fclose(b_file);
-		}
-		return 0;
-	}
+		/* Buffering of streams is useless for reads of this size. */
+		(void)setvbuf(a_file, NULL, _IONBF, 0);
+		(void)setvbuf(b_file, NULL, _IONBF, 0);
 
-	while(1)
-	{
-		const size_t a_read = fread(&a_block, 1, sizeof(a_block), a_file);
-		const size_t b_read = fread(&b_block, 1, sizeof(b_block), b_file);
-		if(a_read == 0U && b_read == 0U && feof(a_file) && feof(b_file))
+		while(!cancellation_requested(cancellation))
 		{
-			/* Ends of both files are reached. */
-			break;
-		}
+			const size_t a_read = fread(a_block, 1, CMP_BLOCK_SIZE, a_file);
+			const size_t b_read = fread(b_block, 1, CMP_BLOCK_SIZE, b_file);
+			if(a_read == 0U && b_read == 0U && feof(a_file) && feof(b_file))
+			{
+				/* Ends of both files are reached. */
+				identical = 1;
+				break;
+			}
 
-		if(a_read == 0 || b_read == 0U || a_read != b_read ||
-				memcmp(a_block, b_block, a_read) != 0)
-		{
-			fclose(a_file);
-			fclose(b_file);
-			return 0;
+			if(a_read == 0 || b_read == 0U || a_read != b_read ||
+					memcmp(a_block, b_block, a_read) != 0)
+			{
+				break;
+			}
 		}
 	}
 
-	fclose(a_file);
-	fclose(b_file);
-	return 1;
+	if(a_file != NULL)
+	{
+		fclose(a_file);
+	}
+	if(b_file != NULL)
+	{
+		fclose(b_file);
+	}
+	free(a_block);
+	free(b_block);
+	return identical;
 }
 
 /* Stores id of a file with given fingerprint in the trie. */
 static void
-put_file_id(trie_t *trie, const char path[], const char fingerprint[], int id,
-		CompareType ct)
+put_file_id(trie_t *trie, const char fingerprint[], int id)
 {
 	compare_record_t *const record = malloc(sizeof(*record));
-	void *data = NULL;
-	(void)trie_get(trie, fingerprint, &data);
+	if(record == NULL)
+	{
+		return;
+	}
 
 	record->id = id;
-	record->next = data;
-
-	/* Comparison by contents is the only one when we need to resolve fingerprint
-	 * conflicts. */
-	record->path = (ct == CT_CONTENTS ? strdup(path) : NULL);
-
 	if(trie_set(trie, fingerprint, record) < 0)
 	{
-		free(record->path);
 		free(record);
 	}
 }
 
-/* Frees list of compare entries.  Implements data free function for
- * trie_free_with_data(). */
-static void
-free_compare_records(void *ptr)
-{
-	compare_record_t *record = ptr;
-	while(record != NULL)
-	{
-		compare_record_t *const current = record;
-		record = record->next;
-		free(current->path);
-		free(current);
-	}
-}
-
 int
 compare_move(view_t *from, view_t *to)
 {
@@ -937,15 +1356,15 @@ compare_move(view_t *from, view_t *to)
 	/* Try to update id of the other entry by computing fingerprint of both files
 	 * and checking if they match. */
 
-	from_fingerprint = get_file_fingerprint(from_path, curr, ct);
-	to_fingerprint = get_file_fingerprint(to_path, other, ct);
+	from_fingerprint = get_file_fingerprint(from_path, curr, ct, NULL);
+	to_fingerprint = get_file_fingerprint(to_path, other, ct, NULL);
 
 	if(!is_null_or_empty(from_fingerprint) && !is_null_or_empty(to_fingerprint))
 	{
 		int match = (strcmp(from_fingerprint, to_fingerprint) == 0);
 		if(match && ct == CT_CONTENTS)
 		{
-			match = files_are_identical(from_path, to_path);
+			match = files_are_identical(from_path, to_path, &no_cancellation);
 		}
 		if(match)
 		{
@@ -959,5 +1378,16 @@ compare_move(view_t *from, view_t *to)
 	return 0;
 }
 
+void
+compare_save_cache(void)
+{
+	if(persistent_cache != NULL)
+	{
+		(void)fcache_save(persistent_cache);
+		fcache_free(persistent_cache);
+		persistent_cache = NULL;
+	}
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
@@ -44,6 +44,10 @@ int compare_one_pane(view_t *view, CompareType ct, ListType lt, int skip_empty);
  * bar message should be preserved. */
 int compare_move(view_t *from, view_t *to);
 
+/* Writes persistent cache of comparison results to its file, if the cache was
+ * used, and frees it. */
+void compare_save_cache(void);
+
 #endif /* VIFM__DIFF_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -0,0 +1 @@
+const char GIT_INFO[] = "3ae1ea040971-dirty";
@@ -22,6 +22,10 @@
 #include <curses.h>
 #include <unistd.h>
 
+#ifndef _WIN32
+# include <poll.h> /* POLLIN poll() pollfd */
+#endif
+
 #include <assert.h> /* assert() */
 #include <signal.h> /* signal() */
 #include <stddef.h> /* NULL size_t wchar_t */
@@ -36,6 +40,7 @@
 #include "engine/mode.h"
 #include "modes/dialogs/msg_dialog.h"
 #include "modes/modes.h"
+#include "modes/view.h"
 #include "modes/wk.h"
 #include "ui/fileview.h"
 #include "ui/quickview.h"
@@ -47,6 +52,7 @@
 #include "utils/test_helpers.h"
 #include "utils/utf8.h"
 #include "utils/utils.h"
+#include "utils/wakeup.h"
 #include "background.h"
 #include "bracket_notation.h"
 #include "filelist.h"
@@ -57,6 +63,13 @@
 
 static int ensure_term_is_ready(void);
 static int get_char_async_loop(WINDOW *win, wint_t *c, int timeout);
+static int preprocess_input(int result, wint_t *c);
+#ifndef _WIN32
+static void wait_for_events(int timeout, int check_views);
+static int add_view_fds(view_t *view, struct pollfd fds[], int *nfds);
+static int add_fd(struct pollfd fds[], int *nfds, int fd);
+static void count_idle_wakeup(void);
+#endif
 static void process_scheduled_updates(void);
 TSTATIC int process_scheduled_updates_of_view(view_t *view);
 static void update_hardware_cursor(void);
@@ -80,6 +93,15 @@ static const size_t *curr_input_buf_pos;
 /* Whether suggestion box is active. */
 static int suggestions_are_visible;
 
+#ifndef _WIN32
+/* Number of wake ups without user input since the start of current period. */
+static int idle_wakeups;
+/* Start of the current period of counting wake ups in milliseconds. */
+static long long idle_period_start;
+#endif
+/* Number of idle wake ups per minute during the last complete period or -1. */
+static int idle_wakeups_per_minute = -1;
+
 void
 event_loop(const int *quit)
 {
@@ -122,9 +144,16 @@ event_loop(const int *quit)
 		 * waiting for the next key after timeout. */
 		do
 		{
-			const int actual_timeout = wait_for_suggestion
-			                         ? MIN(timeout, cfg.sug.delay)
-			                         : timeout;
+			/* There is nothing to time out if input isn't pending. */
+			int actual_timeout = (input_buf_pos == 0 || last_result == KEYS_WAIT)
+			                   ? -1
+			                   : timeout;
+			if(wait_for_suggestion)
+			{
+				actual_timeout = (actual_timeout < 0)
+				               ? cfg.sug.delay
+				               : MIN(actual_timeout, cfg.sug.delay);
+			}
 
 			if(!ensure_term_is_ready())
 			{
@@ -132,10 +161,6 @@ event_loop(const int *quit)
 				continue;
 			}
 
-			modes_periodic();
-
-			bg_check();
-
 			got_input = (get_char_async_loop(status_bar, &c, actual_timeout) != ERR);
 
 			/* If suggestion delay timed out, reset it and wait the rest of the
@@ -331,14 +356,81 @@ ensure_term_is_ready(void)
  * performing the following tasks while waiting for input:
  *  - checks for new IPC messages;
  *  - checks whether contents of displayed directories changed;
+ *  - processes finished background jobs;
  *  - redraws UI if requested.
- * Returns KEY_CODE_YES for functional keys (preprocesses *c in this case), OK
- * for wide character and ERR otherwise (e.g. after timeout). */
+ * Negative timeout means waiting for input indefinitely.  Returns KEY_CODE_YES
+ * for functional keys (preprocesses *c in this case), OK for wide character
+ * and ERR otherwise (e.g. after timeout). */
 static int
 get_char_async_loop(WINDOW *win, wint_t *c, int timeout)
 {
+#ifndef _WIN32
+	const long long deadline = (timeout < 0) ? -1 : get_time_ms() + timeout;
+
+	while(1)
+	{
+		int result;
+		long long now;
+		const int check_views = should_check_views_for_changes();
+
+		modes_periodic();
+
+		bg_check();
+
+		if(check_views)
+		{
+			check_view_for_changes(curr_view);
+			check_view_for_changes(other_view);
+		}
+
+		while(ipc_check(curr_stats.ipc))
+		{
+			/* Messages can be buffered, so process all of them. */
+		}
+
+		process_scheduled_updates();
+
+		if(suggestions_are_visible)
+		{
+			/* Redraw suggestion box as it might have been hidden due to other
+			 * redraws. */
+			display_suggestion_box(curr_input_buf);
+		}
+
+		/* Update cursor before waiting for input.  Modes set cursor correctly
+		 * within corresponding windows, but we need to call refresh on one of
+		 * them to make it active. */
+		update_hardware_cursor();
+
+		/* Curses might have buffered input, so query it without blocking before
+		 * waiting on the terminal. */
+		wtimeout(win, 0);
+		result = compat_wget_wch(win, c);
+		if(result != ERR)
+		{
+			return preprocess_input(result, c);
+		}
+
+		now = get_time_ms();
+		if(deadline >= 0 && now >= deadline)
+		{
+			return ERR;
+		}
+
+		wait_for_events(deadline < 0 ? -1 : (int)(deadline - now), check_views);
+	}
+#else
 	const int IPC_F = ipc_enabled() ? 10 : 1;
 
+	if(timeout < 0)
+	{
+		timeout = cfg.timeout_len;
+	}
+
+	modes_periodic();
+
+	bg_check();
+
 	do
 	{
 		int i;
@@ -380,15 +472,7 @@ get_char_async_loop(WINDOW *win, wint_t *c, int timeout)
 			result = compat_wget_wch(win, c);
 			if(result != ERR)
 			{
-				if(result == KEY_CODE_YES)
-				{
-					*c = K(*c);
-				}
-				else if(*c == L'\0')
-				{
-					*c = WC_C_SPACE;
-				}
-				return result;
+				return preprocess_input(result, c);
 			}
 
 			process_scheduled_updates();
@@ -397,6 +481,147 @@ get_char_async_loop(WINDOW *win, wint_t *c, int timeout)
 	while(timeout > 0);
 
 	return ERR;
+#endif
+}
+
+/* Converts result of reading input into form expected by the rest of the code.
+ * Returns the result. */
+static int
+preprocess_input(int result, wint_t *c)
+{
+	if(result == KEY_CODE_YES)
+	{
+		*c = K(*c);
+	}
+	else if(*c == L'\0')
+	{
+		*c = WC_C_SPACE;
+	}
+	return result;
+}
+
+#ifndef _WIN32
+
+/* Sleeps until there is something to process: input, changes in file system,
+ * IPC messages, activity of background jobs or end of the timeout (negative
+ * value means no timeout).  check_views specifies whether changes of views are
+ * of interest. */
+static void
+wait_for_events(int timeout, int check_views)
+{
+	struct pollfd fds[3 + 2*FLIST_MAX_WATCH_FDS];
+	int nfds = 0;
+	int need_polling = view_needs_periodic_checks() || bg_has_active_jobs();
+
+	(void)add_fd(fds, &nfds, STDIN_FILENO);
+	need_polling |= add_fd(fds, &nfds, wakeup_get_fd());
+	if(curr_stats.ipc != NULL)
+	{
+		need_polling |= add_fd(fds, &nfds, ipc_get_fd(curr_stats.ipc));
+	}
+
+	if(check_views)
+	{
+		need_polling |= add_view_fds(curr_view, fds, &nfds);
+		need_polling |= add_view_fds(other_view, fds, &nfds);
+	}
+
+	if(need_polling)
+	{
+		timeout = (timeout < 0)
+		        ? cfg.min_timeout_len
+		        : MIN(timeout, cfg.min_timeout_len);
+	}
+
+	const int qv_delay = qv_get_check_delay();
+	if(qv_delay >= 0)
+	{
+		timeout = (timeout < 0) ? qv_delay : MIN(timeout, qv_delay);
+	}
+
+	if(poll(fds, nfds, timeout) <= 0 || !(fds[0].revents & POLLIN))
+	{
+		count_idle_wakeup();
+	}
+
+	wakeup_drain();
+}
+
+/* Appends descriptors that signal changes of the view to the array.  Returns
+ * non-zero if the view needs to be polled, otherwise zero is returned. */
+static int
+add_view_fds(view_t *view, struct pollfd fds[], int *nfds)
+{
+	int view_fds[FLIST_MAX_WATCH_FDS];
+	int i, n;
+
+	if(!window_shows_dirlist(view))
+	{
+		return 0;
+	}
+
+	n = flist_get_watch_fds(view, view_fds);
+	if(n < 0)
+	{
+		return 1;
+	}
+
+	for(i = 0; i < n; ++i)
+	{
+		(void)add_fd(fds, nfds, view_fds[i]);
+	}
+	return 0;
+}
+
+/* Appends descriptor to the array to wait for it to become readable.  Returns
+ * non-zero if the descriptor is invalid, otherwise zero is returned. */
+static int
+add_fd(struct pollfd fds[], int *nfds, int fd)
+{
+	if(fd == -1)
+	{
+		return 1;
+	}
+
+	fds[*nfds].fd = fd;
+	fds[*nfds].events = POLLIN;
+	fds[*nfds].revents = 0;
+	++*nfds;
+	return 0;
+}
+
+/* Accounts for a wake up that didn't bring any input.  Rate of such wake ups is
+ * computed and logged once a minute. */
+static void
+count_idle_wakeup(void)
+{
+	enum { PERIOD_MS = 60*1000 };
+
+	const long long now = get_time_ms();
+	if(idle_period_start == 0)
+	{
+		idle_period_start = now;
+	}
+
+	++idle_wakeups;
+
+	if(now - idle_period_start >= PERIOD_MS)
+	{
+		idle_wakeups_per_minute = idle_wakeups*(long long)PERIOD_MS/
+			(now - idle_period_start);
+		LOG_INFO_MSG("Idle wake ups per minute: %d", idle_wakeups_per_minute);
+
+		idle_wakeups = 0;
+		idle_period_start = now;
+	}
+}
+
+#endif
+
+int
+event_loop_idle_wakeups(void)
+{
+	return idle_wakeups_per_minute;
 }
 
 /* Updates TUI or its elements if something is scheduled. */
@@ -31,6 +31,11 @@ void update_input_buf(void);
 
 int is_input_buf_empty(void);
 
+/* Retrieves rate of wake ups while waiting for input that didn't bring any
+ * input, which is measured over periods of at least a minute.  Returns number
+ * of such wake ups per minute or -1 if it's not known yet. */
+int event_loop_idle_wakeups(void);
+
 TSTATIC_DEFS(
 	struct view_t;
 	int process_scheduled_updates_of_view(struct view_t *view);
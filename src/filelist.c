@@ -43,6 +43,7 @@
 #include "cfg/config.h"
 #include "compat/fs_limits.h"
 #include "compat/os.h"
+#include "compat/reallocarray.h"
 #include "engine/autocmds.h"
 #include "engine/mode.h"
 #include "int/fuse.h"
@@ -56,6 +57,7 @@
 #include "ui/statusline.h"
 #include "ui/tabs.h"
 #include "ui/ui.h"
+#include "utils/dirreader.h"
 #include "utils/dynarray.h"
 #include "utils/env.h"
 #include "utils/fs.h"
@@ -64,6 +66,7 @@
 #include "utils/log.h"
 #include "utils/macros.h"
 #include "utils/matcher.h"
+#include "utils/parallel.h"
 #include "utils/path.h"
 #include "utils/regexp.h"
 #include "utils/str.h"
@@ -85,6 +88,40 @@
 #include "status.h"
 #include "types.h"
 
+/* Maximum time in milliseconds to wait for asynchronous reading of directory to
+ * complete before displaying partial list. */
+#define DIR_READER_WAIT_MS 100
+
+/* Maximum number of entries whose metadata is queried at once by
+ * fill_entries(). */
+#define FILL_CHUNK_SIZE 256
+
+#ifndef _WIN32
+
+/* Argument for stat_entry(). */
+typedef struct
+{
+	const dir_entry_t *list; /* List of entries. */
+	const int *indexes;      /* Indexes of entries to query. */
+	struct stat *stats;      /* Results of lstat(). */
+	int *errors;             /* Zero or error code for each entry. */
+}
+stat_chunk_t;
+
+#endif
+
+/* Changes of a single entry of current directory collected from events of
+ * directory watcher. */
+typedef struct
+{
+	const char *name;  /* Name of the entry (owned by the event). */
+	int existed;       /* Whether the entry existed before the changes. */
+	int deleted;       /* Whether the last event reports removal of the entry. */
+	int in_list;       /* Whether entry field holds previous entry of the list. */
+	dir_entry_t entry; /* Previous entry of the list. */
+}
+entry_patch_t;
+
 static void init_flist(view_t *view);
 static void reset_view(view_t *view);
 static void init_view_history(view_t *view);
@@ -94,12 +131,16 @@ static int fill_dir_entry_by_path(dir_entry_t *entry, const char path[]);
 #ifndef _WIN32
 static int fill_dir_entry(dir_entry_t *entry, const char path[],
 		const struct dirent *d);
+static int fill_dir_entry_by_stat(dir_entry_t *entry, const char path[],
+		const struct stat *s, const struct dirent *d);
+static void stat_entry(int index, void *arg);
 static int data_is_dir_entry(const struct dirent *d, const char path[]);
 #else
 static int fill_dir_entry(dir_entry_t *entry, const char path[],
 		const WIN32_FIND_DATAW *ffd);
 static int data_is_dir_entry(const WIN32_FIND_DATAW *ffd, const char path[]);
 #endif
+static void fill_entries(view_t *view, dir_entry_t *list, int *count);
 static int flist_custom_finish_internal(view_t *view, CVType type, int reload,
 		const char dir[], int allow_empty);
 static void on_location_change(view_t *view, int force);
@@ -120,13 +161,18 @@ static void zap_compare_view(view_t *view, view_t *other, zap_filter filter,
 		void *arg);
 static int find_separator(view_t *view, int idx);
 static void update_dir_watcher(view_t *view);
+static void watch_custom_list(view_t *view);
 static int custom_list_is_incomplete(const view_t *view);
 static int is_dead_or_filtered(view_t *view, const dir_entry_t *entry,
 		void *arg);
 static void update_entries_data(view_t *view);
 static int is_dir_big(const char path[]);
 static void free_view_entries(view_t *view);
+static void start_dir_reader(view_t *view);
+static void stop_dir_reader(view_t *view);
+static void check_dir_reader(view_t *view);
 static int update_dir_list(view_t *view, int reload);
+static int add_dir_reader_entries(view_t *view);
 static void start_dir_list_change(view_t *view, dir_entry_t **entries, int *len,
 		int reload);
 static void finish_dir_list_change(view_t *view, dir_entry_t *entries, int len);
@@ -143,7 +189,20 @@ static int correct_pos(view_t *view, int pos, int dist, int closest);
 static int rescue_from_empty_filelist(view_t *view);
 static void add_parent_entry(view_t *view, dir_entry_t **entries, int *count);
 static void init_dir_entry(view_t *view, dir_entry_t *entry, const char name[]);
+static dir_entry_t * add_unfilled_entry(view_t *view, dir_entry_t **list,
+		int *list_size, const char path[]);
 static dir_entry_t * alloc_dir_entry(dir_entry_t **list, int list_size);
+static int add_cache_fd(const cached_entries_t *cache, int fds[], int *nfds);
+static int add_watch_fd(const fswatch_t *watch, int fds[], int *nfds);
+static int patch_dir_list(view_t *view, const fswatch_event_t events[],
+		int nevents);
+static int collect_patches(view_t *view, const fswatch_event_t events[],
+		int nevents, entry_patch_t patches[]);
+static int apply_patch(view_t *view, entry_patch_t *patch, dir_entry_t *entry);
+static void drop_entry(view_t *view, dir_entry_t *entry);
+static void check_custom_list(view_t *view);
+static int custom_list_is_affected(view_t *view,
+		const fswatch_event_t events[], int nevents);
 static int tree_has_changed(const dir_entry_t *entries, size_t nchildren);
 static void find_dir_in_cdpath(const char base_dir[], const char dst[],
 		char buf[], size_t buf_size);
@@ -290,6 +349,8 @@ flist_free_view(view_t *view)
 	fswatch_free(view->watch);
 	view->watch = NULL;
 
+	stop_dir_reader(view);
+
 	flist_free_cache(view, &view->left_column);
 	flist_free_cache(view, &view->right_column);
 
@@ -317,6 +378,7 @@ flist_free_view(view_t *view)
 	view->vi = NULL;
 
 	regfree(&view->primary_group);
+	sort_free_view_data(view);
 }
 
 void
@@ -485,6 +547,8 @@ navigate_to_file(view_t *view, const char dir[], const char file[],
 
 	if(paths_are_equal(view->curr_dir, dir))
 	{
+		/* The file can be missing from a partially loaded list. */
+		flist_finish_reading(view);
 		(void)fpos_ensure_selected(view, file);
 	}
 }
@@ -836,6 +900,28 @@ flist_custom_add(view_t *view, const char path[])
 			canonic_path);
 }
 
+void
+flist_custom_add_deferred(view_t *view, const char path[])
+{
+#ifndef _WIN32
+	char canonic_path[PATH_MAX + 1];
+	to_canonic_path(path, flist_get_dir(view), canonic_path,
+			sizeof(canonic_path));
+
+	/* Don't add duplicates. */
+	if(trie_put(view->custom.paths_cache, canonic_path) != 0)
+	{
+		return;
+	}
+
+	(void)add_unfilled_entry(view, &view->custom.entries,
+			&view->custom.entry_count, canonic_path);
+#else
+	/* Metadata is obtained in a different way here, no point in deferring. */
+	(void)flist_custom_add(view, path);
+#endif
+}
+
 dir_entry_t *
 flist_custom_put(view_t *view, dir_entry_t *entry)
 {
@@ -895,7 +981,17 @@ fill_dir_entry(dir_entry_t *entry, const char path[], const struct dirent *d)
 		return 1;
 	}
 
-	entry->type = get_type_from_mode(s.st_mode);
+	return fill_dir_entry_by_stat(entry, path, &s, d);
+}
+
+/* Fills fields of the entry from already obtained lstat() information of the
+ * file specified by its path.  d is optional source of file type.  Returns zero
+ * on success, otherwise non-zero is returned. */
+static int
+fill_dir_entry_by_stat(dir_entry_t *entry, const char path[],
+		const struct stat *s, const struct dirent *d)
+{
+	entry->type = get_type_from_mode(s->st_mode);
 	if(entry->type == FT_UNK)
 	{
 		entry->type = (d == NULL) ? FT_UNK : type_from_dir_entry(d, path);
@@ -906,15 +1002,15 @@ fill_dir_entry(dir_entry_t *entry, const char path[], const struct dirent *d)
 		return 1;
 	}
 
-	entry->size = (uintmax_t)s.st_size;
-	entry->uid = s.st_uid;
-	entry->gid = s.st_gid;
-	entry->mode = s.st_mode;
-	entry->inode = s.st_ino;
-	entry->mtime = s.st_mtime;
-	entry->atime = s.st_atime;
-	entry->ctime = s.st_ctime;
-	entry->nlinks = s.st_nlink;
+	entry->size = (uintmax_t)s->st_size;
+	entry->uid = s->st_uid;
+	entry->gid = s->st_gid;
+	entry->mode = s->st_mode;
+	entry->inode = s->st_ino;
+	entry->mtime = s->st_mtime;
+	entry->atime = s->st_atime;
+	entry->ctime = s->st_ctime;
+	entry->nlinks = s->st_nlink;
 
 	if(entry->type == FT_LINK)
 	{
@@ -933,6 +1029,95 @@ fill_dir_entry(dir_entry_t *entry, const char path[], const struct dirent *d)
 	return 0;
 }
 
+/* Queries metadata of entries of the list which were added without it (their
+ * type is unknown) using several threads and fills them in.  Entries for which
+ * this fails are removed from the list. */
+static void
+fill_entries(view_t *view, dir_entry_t *list, int *count)
+{
+	int indexes[FILL_CHUNK_SIZE];
+	struct stat stats[FILL_CHUNK_SIZE];
+	int errors[FILL_CHUNK_SIZE];
+	stat_chunk_t chunk = {
+		.list = list, .indexes = indexes, .stats = stats, .errors = errors
+	};
+	int i, j;
+	int nfailed = 0;
+
+	/* Threads are started once for all the chunks. */
+	parallel_pool_t pool;
+	parallel_pool_start(&pool, cfg.io_threads);
+
+	i = 0;
+	while(i < *count)
+	{
+		int n = 0;
+		for(; i < *count && n < FILL_CHUNK_SIZE; ++i)
+		{
+			if(list[i].type == FT_UNK && !fentry_is_fake(&list[i]))
+			{
+				indexes[n++] = i;
+			}
+		}
+
+		/* Only lstat() calls are parallelized as the rest of the processing isn't
+		 * thread-safe. */
+		parallel_pool_for(&pool, n, &stat_entry, &chunk);
+
+		for(j = 0; j < n; ++j)
+		{
+			dir_entry_t *const entry = &list[indexes[j]];
+			char full_path[PATH_MAX + 1];
+			get_full_path_of(entry, sizeof(full_path), full_path);
+
+			if(errors[j] != 0)
+			{
+				LOG_SERROR_MSG(errors[j], "Can't lstat() \"%s\"", full_path);
+			}
+
+			if(errors[j] != 0 ||
+					fill_dir_entry_by_stat(entry, full_path, &stats[j], NULL) != 0)
+			{
+				fentry_free(view, entry);
+				++nfailed;
+			}
+		}
+	}
+
+	parallel_pool_stop(&pool);
+
+	if(nfailed == 0)
+	{
+		return;
+	}
+
+	/* Drop entries that were freed above. */
+	j = 0;
+	for(i = 0; i < *count; ++i)
+	{
+		if(list[i].name != NULL)
+		{
+			list[j++] = list[i];
+		}
+	}
+	*count = j;
+}
+
+/* parallel_pool_for() callback that queries metadata of a single entry of a
+ * chunk. */
+static void
+stat_entry(int index, void *arg)
+{
+	stat_chunk_t *const chunk = arg;
+	const dir_entry_t *const entry = &chunk->list[chunk->indexes[index]];
+	char full_path[PATH_MAX + 1];
+
+	get_full_path_of(entry, sizeof(full_path), full_path);
+	chunk->errors[index] = (os_lstat(full_path, &chunk->stats[index]) == 0)
+	                     ? 0
+	                     : errno;
+}
+
 /* Checks whether file is a directory.  Returns non-zero if so, otherwise zero
  * is returned. */
 static int
@@ -1007,6 +1192,13 @@ fill_dir_entry(dir_entry_t *entry, const char path[],
 	return 0;
 }
 
+/* Queries metadata of entries of the list which were added without it.  Does
+ * nothing here as entries are always filled on addition. */
+static void
+fill_entries(view_t *view, dir_entry_t *list, int *count)
+{
+}
+
 /* Checks whether file is a directory.  Returns non-zero if so, otherwise zero
  * is returned. */
 static int
@@ -1020,8 +1212,14 @@ data_is_dir_entry(const WIN32_FIND_DATAW *ffd, const char path[])
 int
 flist_custom_finish(view_t *view, CVType type, int allow_empty)
 {
-	return flist_custom_finish_internal(view, type, 0, flist_get_dir(view),
-			allow_empty);
+	if(flist_custom_finish_internal(view, type, 0, flist_get_dir(view),
+				allow_empty) != 0)
+	{
+		return 1;
+	}
+
+	watch_custom_list(view);
+	return 0;
 }
 
 /* Finishes file list population, handles empty resulting list corner case.
@@ -1033,6 +1231,9 @@ flist_custom_finish_internal(view_t *view, CVType type, int reload,
 		const char dir[], int allow_empty)
 {
 	enum { NORMAL, CUSTOM, UNSORTED } previous;
+
+	fill_entries(view, view->custom.entries, &view->custom.entry_count);
+
 	const int empty_view = (view->custom.entry_count == 0);
 
 	trie_free(view->custom.paths_cache);
@@ -1387,6 +1588,8 @@ flist_custom_clone(view_t *to, const view_t *from, int as_tree)
 	{
 		disable_view_sorting(to);
 	}
+
+	watch_custom_list(to);
 }
 
 void
@@ -1651,6 +1854,7 @@ populate_dir_list_internal(view_t *view, int reload)
 
 	if(flist_custom_active(view))
 	{
+		stop_dir_reader(view);
 		return populate_custom_view(view, reload);
 	}
 
@@ -1660,6 +1864,8 @@ populate_dir_list_internal(view_t *view, int reload)
 		{
 			ui_sb_quick_msgf("%s", "Reading directory...");
 		}
+
+		start_dir_reader(view);
 	}
 
 	if(curr_stats.load_stage < 2)
@@ -1731,6 +1937,7 @@ populate_dir_list_internal(view_t *view, int reload)
 	{
 		/* XXX: why cursor is positioned in code that loads the list? */
 		flist_hist_lookup(view, view);
+		view->dir_reader_hist_pos = view->list_pos;
 	}
 
 	if(view->location_changed)
@@ -1834,6 +2041,9 @@ populate_custom_view(view_t *view, int reload)
 	update_entries_data(view);
 	sort_dir_list(!reload, view);
 	fview_list_updated(view);
+
+	/* Some of the directories might have disappeared from the list. */
+	watch_custom_list(view);
 	return 0;
 }
 
@@ -1941,10 +2151,12 @@ update_dir_watcher(view_t *view)
 {
 	const char *const curr_dir = flist_get_dir(view);
 
-	if(view->watch == NULL || stroscmp(view->watched_dir, curr_dir) != 0)
+	if(view->watch == NULL || view->watch_is_custom ||
+			stroscmp(view->watched_dir, curr_dir) != 0)
 	{
 		fswatch_free(view->watch);
 		view->watch = fswatch_create(curr_dir);
+		view->watch_is_custom = 0;
 
 		/* Failure to create a watch is bad, but there isn't much we can do here and
 		 * this doesn't feel like a reason to block anything else. */
@@ -1955,6 +2167,80 @@ update_dir_watcher(view_t *view)
 	}
 }
 
+/* Makes watcher of the view cover directories of its custom list: all
+ * directories of a tree or directories that contain entries for other kinds of
+ * lists.  Watcher of the same list is updated to add and remove only watches
+ * that changed.  Falls back to watching only directory of the list if watches
+ * can't be added. */
+static void
+watch_custom_list(view_t *view)
+{
+	int i;
+	const char *prev_origin = NULL;
+	const char *const dir = flist_get_dir(view);
+
+	if(view->watch == NULL || !view->watch_is_custom ||
+			stroscmp(view->watched_dir, dir) != 0)
+	{
+		fswatch_free(view->watch);
+		view->watch = fswatch_create(dir);
+		if(view->watch == NULL)
+		{
+			return;
+		}
+
+		view->watch_is_custom = 1;
+		copy_str(view->watched_dir, sizeof(view->watched_dir), dir);
+	}
+
+	fswatch_mark_unused(view->watch);
+	(void)fswatch_add(view->watch, dir);
+
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		char path[PATH_MAX + 1];
+		const dir_entry_t *const entry = &view->dir_entry[i];
+
+		if(fentry_is_fake(entry))
+		{
+			continue;
+		}
+
+		if(view->custom.type == CV_TREE)
+		{
+			if(entry->type != FT_DIR || is_parent_dir(entry->name))
+			{
+				continue;
+			}
+			get_full_path_of(entry, sizeof(path), path);
+		}
+		else
+		{
+			/* Neighbouring entries usually share origin. */
+			if(prev_origin != NULL && strcmp(prev_origin, entry->origin) == 0)
+			{
+				continue;
+			}
+			prev_origin = entry->origin;
+			copy_str(path, sizeof(path), entry->origin);
+		}
+
+		/* Directories that can't be watched because they have disappeared or
+		 * aren't readable are skipped, other errors are mostly about reaching
+		 * limit on number of watches. */
+		if(fswatch_add(view->watch, path) != 0 &&
+				!ONE_OF(errno, ENOENT, EACCES, ENOTDIR))
+		{
+			fswatch_free(view->watch);
+			view->watch = NULL;
+			update_dir_watcher(view);
+			return;
+		}
+	}
+
+	fswatch_drop_unused(view->watch);
+}
+
 /* Checks whether currently loaded custom list of files is missing some files
  * compared to the original custom list.  Returns non-zero if so, otherwise zero
  * is returned. */
@@ -2173,6 +2459,116 @@ free_view_entries(view_t *view)
 	free_dir_entries(view, &view->dir_entry, &view->list_rows);
 }
 
+/* Starts asynchronous reading of current directory of the view if it's
+ * possible.  Gives the reader some time to finish to not show incomplete list
+ * for directories that can be read fast enough. */
+static void
+start_dir_reader(view_t *view)
+{
+	/* Without TUI there is no event loop to finish loading the list. */
+	if(curr_stats.load_stage < 2)
+	{
+		return;
+	}
+
+	stop_dir_reader(view);
+
+	view->dir_reader = dirreader_start(view->curr_dir, cfg.io_threads);
+	if(view->dir_reader != NULL)
+	{
+		(void)dirreader_wait(view->dir_reader, DIR_READER_WAIT_MS);
+		view->dir_reader_shown = 0;
+		view->dir_reader_hist_pos = -1;
+	}
+}
+
+/* Aborts asynchronous reading of directory if it's in progress. */
+static void
+stop_dir_reader(view_t *view)
+{
+	dirreader_free(view->dir_reader);
+	view->dir_reader = NULL;
+}
+
+void
+flist_finish_reading(view_t *view)
+{
+	int i;
+
+	if(view->dir_reader == NULL)
+	{
+		return;
+	}
+
+	/* Reloading drops marks, so remember marked entries by their names. */
+	trie_t *const marked = trie_create();
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		if(view->dir_entry[i].marked)
+		{
+			(void)trie_put(marked, view->dir_entry[i].name);
+		}
+	}
+
+	(void)dirreader_wait(view->dir_reader, -1);
+	load_saving_pos(view);
+
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		void *data;
+		dir_entry_t *const entry = &view->dir_entry[i];
+		entry->marked = (trie_get(marked, entry->name, &data) == 0);
+	}
+	trie_free(marked);
+}
+
+/* Checks progress of asynchronous reading of directory and updates the list if
+ * enough new entries are available.  Number of entries between updates grows
+ * geometrically to keep amount of work on merging linear. */
+static void
+check_dir_reader(view_t *view)
+{
+	int count;
+	const int done = dirreader_sync(view->dir_reader);
+	(void)dirreader_get(view->dir_reader, &count);
+
+	if(view == curr_view)
+	{
+		if(done)
+		{
+			ui_sb_quick_msg_clear();
+		}
+		else if(!curr_stats.save_msg)
+		{
+			ui_sb_quick_msgf("Reading directory... %d", count);
+		}
+	}
+
+	if(!done && count < view->dir_reader_shown*2 &&
+			(view->dir_reader_shown >= view->window_cells ||
+			 count == view->dir_reader_shown))
+	{
+		return;
+	}
+
+	/* Position from history might refer to a file that wasn't read before, try
+	 * again unless cursor was moved. */
+	const int retry_hist = (view->dir_reader_hist_pos == view->list_pos);
+
+	load_saving_pos(view);
+
+	if(retry_hist)
+	{
+		flist_hist_lookup(view, view);
+		view->dir_reader_hist_pos = view->list_pos;
+		fview_cursor_redraw(view);
+	}
+	else
+	{
+		view->dir_reader_hist_pos = -1;
+	}
+}
+
 /* Updates file list with files from current directory.  Returns zero on
  * success, otherwise non-zero is returned. */
 static int
@@ -2180,15 +2576,38 @@ update_dir_list(view_t *view, int reload)
 {
 	dir_entry_t *prev_dir_entries;
 	int prev_list_rows;
+	int read_all = 1;
+
+	if(view->dir_reader != NULL &&
+			stroscmp(dirreader_get_path(view->dir_reader), view->curr_dir) != 0)
+	{
+		stop_dir_reader(view);
+	}
 
 	start_dir_list_change(view, &prev_dir_entries, &prev_list_rows, reload);
 
-	if(enum_dir_content(view->curr_dir, &add_file_entry_to_view, view) != 0)
+	if(view->dir_reader != NULL)
+	{
+		read_all = dirreader_sync(view->dir_reader);
+		if(dirreader_failed(view->dir_reader) ||
+				add_dir_reader_entries(view) != 0)
+		{
+			LOG_ERROR_MSG("Can't read \"%s\"", view->curr_dir);
+			stop_dir_reader(view);
+			free_dir_entries(view, &prev_dir_entries, &prev_list_rows);
+			return 1;
+		}
+	}
+	else if(enum_dir_content(view->curr_dir, &add_file_entry_to_view, view) != 0)
 	{
 		LOG_SERROR_MSG(errno, "Can't opendir() \"%s\"", view->curr_dir);
 		free_dir_entries(view, &prev_dir_entries, &prev_list_rows);
 		return 1;
 	}
+	else
+	{
+		fill_entries(view, view->dir_entry, &view->list_rows);
+	}
 
 	if(cfg_parent_dir_is_visible(is_root_dir(view->curr_dir)) ||
 			view->list_rows == 0)
@@ -2202,9 +2621,73 @@ update_dir_list(view_t *view, int reload)
 	 * (sorting doesn't preserve it). */
 	finish_dir_list_change(view, prev_dir_entries, prev_list_rows);
 
+	if(read_all)
+	{
+		stop_dir_reader(view);
+	}
+
 	return 0;
 }
 
+/* Fills file list with entries obtained by asynchronous reader so far.  Returns
+ * zero on success, otherwise non-zero is returned. */
+static int
+add_dir_reader_entries(view_t *view)
+{
+#ifndef _WIN32
+	int i, count;
+	const dirreader_entry_t *const entries = dirreader_get(view->dir_reader,
+			&count);
+
+	for(i = 0; i < count; ++i)
+	{
+		const dirreader_entry_t *const e = &entries[i];
+		char full_path[PATH_MAX + 1];
+		dir_entry_t *entry;
+		int is_dir = S_ISDIR(e->s.st_mode);
+
+		if(S_ISLNK(e->s.st_mode))
+		{
+			/* Symbolic link with too long path can't be resolved and thus can't be
+			 * treated as a directory. */
+			const int len = snprintf(full_path, sizeof(full_path), "%s/%s",
+					view->curr_dir, e->name);
+			is_dir = (len < (int)sizeof(full_path) &&
+					get_symlink_type(full_path) != SLT_UNKNOWN);
+		}
+
+		if(!file_is_visible(view, e->name, is_dir, NULL, 1))
+		{
+			++view->filtered;
+			continue;
+		}
+
+		entry = alloc_dir_entry(&view->dir_entry, view->list_rows);
+		if(entry == NULL)
+		{
+			show_error_msg("Memory Error", "Unable to allocate enough memory");
+			return 1;
+		}
+
+		init_dir_entry(view, entry, e->name);
+
+		if(fill_dir_entry_by_stat(entry, entry->name, &e->s, NULL) == 0)
+		{
+			++view->list_rows;
+		}
+		else
+		{
+			fentry_free(view, entry);
+		}
+	}
+
+	view->dir_reader_shown = count;
+	return 0;
+#else
+	return 1;
+#endif
+}
+
 /* Starts file list update, saving previous list for future reference if
  * necessary. */
 static void
@@ -2273,6 +2756,10 @@ add_file_entry_to_view(const char name[], const void *data, void *param)
 
 	init_dir_entry(view, entry, name);
 
+#ifndef _WIN32
+	/* Metadata of all files is queried at once by fill_entries(). */
+	++view->list_rows;
+#else
 	if(fill_dir_entry(entry, entry->name, data) == 0)
 	{
 		++view->list_rows;
@@ -2281,6 +2768,7 @@ add_file_entry_to_view(const char name[], const void *data, void *param)
 	{
 		fentry_free(view, entry);
 	}
+#endif
 
 	return 0;
 }
@@ -2649,23 +3137,40 @@ dir_entry_t *
 entry_list_add(view_t *view, dir_entry_t **list, int *list_size,
 		const char path[])
 {
-	dir_entry_t *const dir_entry = alloc_dir_entry(list, *list_size);
+	dir_entry_t *const dir_entry = add_unfilled_entry(view, list, list_size,
+			path);
 	if(dir_entry == NULL)
 	{
 		return NULL;
 	}
 
-	init_dir_entry(view, dir_entry, get_last_path_component(path));
-
-	dir_entry->origin = strdup(path);
-	remove_last_path_component(dir_entry->origin);
-
 	if(fill_dir_entry_by_path(dir_entry, path) != 0)
 	{
 		fentry_free(view, dir_entry);
+		--*list_size;
+		return NULL;
+	}
+
+	return dir_entry;
+}
+
+/* Appends entry for the path to the list without querying its metadata.
+ * Returns pointer to new entry or NULL on failure. */
+static dir_entry_t *
+add_unfilled_entry(view_t *view, dir_entry_t **list, int *list_size,
+		const char path[])
+{
+	dir_entry_t *const dir_entry = alloc_dir_entry(list, *list_size);
+	if(dir_entry == NULL)
+	{
 		return NULL;
 	}
 
+	init_dir_entry(view, dir_entry, get_last_path_component(path));
+
+	dir_entry->origin = strdup(path);
+	remove_last_path_component(dir_entry->origin);
+
 	++*list_size;
 	return dir_entry;
 }
@@ -2688,13 +3193,28 @@ alloc_dir_entry(dir_entry_t **list, int list_size)
 void
 check_if_filelist_has_changed(view_t *view)
 {
-	int failed, changed;
+	int failed;
+	FsWatchState state;
+	const fswatch_event_t *events;
+	int nevents;
 	const char *const curr_dir = flist_get_dir(view);
 
-	if(view->on_slow_fs ||
-			(flist_custom_active(view) && !cv_tree(view->custom.type)) ||
-			is_unc_root(curr_dir))
+	if(view->dir_reader != NULL)
 	{
+		/* Changes will be picked up by the reader or on the next check after it's
+		 * done. */
+		check_dir_reader(view);
+		return;
+	}
+
+	if(view->on_slow_fs || is_unc_root(curr_dir))
+	{
+		return;
+	}
+
+	if(flist_custom_active(view) && !cv_tree(view->custom.type))
+	{
+		check_custom_list(view);
 		return;
 	}
 
@@ -2704,11 +3224,11 @@ check_if_filelist_has_changed(view_t *view)
 
 		update_dir_watcher(view);
 		failed = 0;
-		changed = (view->watch != NULL);
+		state = (view->watch != NULL) ? FSWS_CHANGED : FSWS_UNCHANGED;
 	}
 	else
 	{
-		changed = fswatch_changed(view->watch, &failed);
+		state = fswatch_poll(view->watch, &failed, &events, &nevents);
 	}
 
 	/* Check if we still have permission to visit this directory. */
@@ -2728,14 +3248,25 @@ check_if_filelist_has_changed(view_t *view)
 		return;
 	}
 
-	if(changed)
+	if(state == FSWS_EVENTS && patch_dir_list(view, events, nevents) == 0)
+	{
+		ui_view_schedule_redraw(view);
+	}
+	else if(state == FSWS_EVENTS && flist_custom_active(view) &&
+			view->custom.type == CV_CUSTOM_TREE &&
+			!custom_list_is_affected(view, events, nevents))
+	{
+		/* Files that aren't part of custom tree have changed. */
+	}
+	else if(state != FSWS_UNCHANGED)
 	{
 		ui_view_schedule_reload(view);
 	}
 	else if(flist_custom_active(view) && cv_tree(view->custom.type))
 	{
-		/* Custom trees don't track file-system changes. */
-		if(view->custom.type == CV_TREE &&
+		/* Directories of a tree are polled only if they can't be watched.  Custom
+		 * trees don't track file-system changes this way. */
+		if(view->custom.type == CV_TREE && !view->watch_is_custom &&
 				tree_has_changed(view->dir_entry, view->list_rows))
 		{
 			ui_view_schedule_reload(view);
@@ -2751,6 +3282,383 @@ check_if_filelist_has_changed(view_t *view)
 	}
 }
 
+int
+flist_get_watch_fds(const view_t *view, int fds[])
+{
+	int nfds = 0;
+
+	if(view->dir_reader != NULL)
+	{
+		/* Completion of reading isn't signaled via a descriptor. */
+		return -1;
+	}
+
+	if(view->on_slow_fs || is_unc_root(flist_get_dir(view)))
+	{
+		return 0;
+	}
+
+	if(flist_custom_active(view) && !cv_tree(view->custom.type))
+	{
+		/* Custom lists which can't be watched aren't checked. */
+		if(view->watch != NULL && add_watch_fd(view->watch, fds, &nfds) != 0)
+		{
+			return -1;
+		}
+		return nfds;
+	}
+
+	/* Missing watcher is recreated on the next check. */
+	if(view->watch == NULL || add_watch_fd(view->watch, fds, &nfds) != 0)
+	{
+		return -1;
+	}
+
+	if(flist_custom_active(view))
+	{
+		/* Directories of a tree are polled if they can't be watched. */
+		return (view->custom.type == CV_TREE && !view->watch_is_custom) ? -1 : nfds;
+	}
+
+	if(add_cache_fd(&view->left_column, fds, &nfds) != 0 ||
+			add_cache_fd(&view->right_column, fds, &nfds) != 0)
+	{
+		return -1;
+	}
+
+	return nfds;
+}
+
+/* Appends descriptor of the cache's watcher to the array if the cache is in
+ * use.  Returns zero on success and non-zero if the cache needs polling. */
+static int
+add_cache_fd(const cached_entries_t *cache, int fds[], int *nfds)
+{
+	if(cache->dir == NULL)
+	{
+		return 0;
+	}
+	return (cache->watch == NULL || add_watch_fd(cache->watch, fds, nfds) != 0);
+}
+
+/* Appends descriptor of the watcher to the array.  Returns zero on success and
+ * non-zero if the watcher can't be waited on. */
+static int
+add_watch_fd(const fswatch_t *watch, int fds[], int *nfds)
+{
+	const int fd = fswatch_get_fd(watch);
+	if(fd == -1)
+	{
+		return 1;
+	}
+
+	fds[(*nfds)++] = fd;
+	return 0;
+}
+
+/* Applies changes of entries of current directory to the file list without
+ * rereading the directory: affected entries are removed, queried anew and
+ * inserted at their sorted positions.  Returns zero on success and non-zero if
+ * the list needs to be reloaded instead. */
+static int
+patch_dir_list(view_t *view, const fswatch_event_t events[], int nevents)
+{
+	int i, npatches, nnew;
+	char *saved_cwd;
+	char curr_name[NAME_MAX + 1];
+
+	/* Lists that aren't a plain listing of a directory or whose entries are
+	 * referenced by position can't be patched. */
+	if(flist_custom_active(view) || view->local_filter.in_progress ||
+			vle_mode_is(VISUAL_MODE) || view->list_rows == 0)
+	{
+		return 1;
+	}
+
+	/* Parent directory might be there only because the list was empty. */
+	if(view->list_rows == 1 && is_parent_dir(view->dir_entry[0].name))
+	{
+		return 1;
+	}
+
+	entry_patch_t *const patches = reallocarray(NULL, nevents, sizeof(*patches));
+	dir_entry_t *const new_entries = reallocarray(NULL, nevents,
+			sizeof(*new_entries));
+	if(patches == NULL || new_entries == NULL)
+	{
+		free(patches);
+		free(new_entries);
+		return 1;
+	}
+
+	copy_str(curr_name, sizeof(curr_name), get_current_file_name(view));
+
+	npatches = collect_patches(view, events, nevents, patches);
+	if(npatches < 0)
+	{
+		free(patches);
+		free(new_entries);
+		return 1;
+	}
+
+	/* This is needed for querying targets of symbolic links by relative
+	 * paths. */
+	saved_cwd = save_cwd();
+	(void)vifm_chdir(view->curr_dir);
+
+	nnew = 0;
+	for(i = 0; i < npatches; ++i)
+	{
+		if(apply_patch(view, &patches[i], &new_entries[nnew]) == 0)
+		{
+			++nnew;
+		}
+	}
+
+	restore_cwd(saved_cwd);
+	free(patches);
+
+	if(sort_view_insert(view, new_entries, nnew) != 0)
+	{
+		for(i = 0; i < nnew; ++i)
+		{
+			drop_entry(view, &new_entries[i]);
+		}
+		nnew = -1;
+	}
+	free(new_entries);
+
+	/* List is never empty.  Full reload is still scheduled in this case, because
+	 * directory itself might be gone. */
+	if(view->list_rows == 0)
+	{
+		add_parent_dir(view);
+		nnew = -1;
+	}
+
+	/* Keep cursor on the same file, if it's still there. */
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		if(strcmp(view->dir_entry[i].name, curr_name) == 0)
+		{
+			view->list_pos = i;
+			break;
+		}
+	}
+	if(view->list_pos >= view->list_rows)
+	{
+		view->list_pos = MAX(0, view->list_rows - 1);
+	}
+
+	if(nnew < 0)
+	{
+		return 1;
+	}
+
+	fview_list_updated(view);
+	return 0;
+}
+
+/* Collapses events into a patch per changed entry and takes affected entries
+ * out of the list.  Returns number of patches or -1 on error. */
+static int
+collect_patches(view_t *view, const fswatch_event_t events[], int nevents,
+		entry_patch_t patches[])
+{
+	int i, j;
+	int npatches = 0;
+
+	trie_t *const names = trie_create();
+	if(names == NULL)
+	{
+		return -1;
+	}
+
+	for(i = 0; i < nevents; ++i)
+	{
+		void *data;
+		entry_patch_t *patch;
+
+		if(trie_get(names, events[i].name, &data) == 0)
+		{
+			patch = data;
+		}
+		else
+		{
+			patch = &patches[npatches];
+			if(trie_set(names, events[i].name, patch) != 0)
+			{
+				trie_free(names);
+				return -1;
+			}
+
+			++npatches;
+			patch->name = events[i].name;
+			patch->existed = (events[i].type != FSWE_CREATED);
+			patch->in_list = 0;
+		}
+
+		patch->deleted = (events[i].type == FSWE_DELETED);
+	}
+
+	/* Single pass over the list extracts all entries that are about to change
+	 * while preserving order of the rest. */
+	j = 0;
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		void *data;
+		dir_entry_t *const entry = &view->dir_entry[i];
+		if(trie_get(names, entry->name, &data) == 0)
+		{
+			entry_patch_t *const patch = data;
+			patch->entry = *entry;
+			patch->existed = 1;
+			patch->in_list = 1;
+			continue;
+		}
+
+		view->dir_entry[j++] = *entry;
+	}
+	view->list_rows = j;
+	/* Otherwise the array would grow on every insertion of patched entries. */
+	dynarray_truncate(view->dir_entry, j*sizeof(*view->dir_entry));
+
+	trie_free(names);
+	return npatches;
+}
+
+/* Makes an up-to-date entry for the patch reusing previous entry of the list,
+ * if any, to retain its state.  Returns zero if the entry should be added to
+ * the list, otherwise non-zero is returned. */
+static int
+apply_patch(view_t *view, entry_patch_t *patch, dir_entry_t *entry)
+{
+	char full_path[PATH_MAX + 1];
+	const int was_filtered = (patch->existed && !patch->in_list);
+	int is_filtered = 0;
+	int skip = 1;
+
+	if(patch->in_list)
+	{
+		*entry = patch->entry;
+	}
+	else
+	{
+		init_dir_entry(view, entry, patch->name);
+		if(entry->name == NULL)
+		{
+			return 1;
+		}
+	}
+
+	/* Entry whose path doesn't fit can't be queried, so it's dropped like a
+	 * deleted one. */
+	const int len = snprintf(full_path, sizeof(full_path), "%s/%s",
+			view->curr_dir, patch->name);
+
+	const FileType prev_type = entry->type;
+	entry->dir_link = 0;
+	if(!patch->deleted && len < (int)sizeof(full_path) &&
+			fill_dir_entry_by_path(entry, full_path) == 0)
+	{
+		is_filtered = !file_is_visible(view, patch->name, fentry_is_dir(entry),
+				NULL, 1);
+		skip = is_filtered;
+
+		if(entry->type != prev_type)
+		{
+			entry->hi_num = -1;
+			entry->name_dec_num = -1;
+		}
+	}
+
+	view->filtered += is_filtered - was_filtered;
+	if(view->filtered < 0)
+	{
+		view->filtered = 0;
+	}
+
+	if(skip)
+	{
+		drop_entry(view, entry);
+	}
+	return skip;
+}
+
+/* Frees an entry which is no longer part of the list updating counters of the
+ * view. */
+static void
+drop_entry(view_t *view, dir_entry_t *entry)
+{
+	view->selected_files -= (entry->selected != 0);
+	view->matches -= (entry->search_match != 0);
+	fentry_free(view, entry);
+}
+
+/* Checks whether entries of flat custom list have changed and schedules its
+ * reload if so. */
+static void
+check_custom_list(view_t *view)
+{
+	int error;
+	FsWatchState state;
+	const fswatch_event_t *events;
+	int nevents;
+
+	/* Custom lists which can't be watched aren't checked. */
+	if(view->watch == NULL)
+	{
+		return;
+	}
+
+	state = fswatch_poll(view->watch, &error, &events, &nevents);
+	if(error || state == FSWS_CHANGED ||
+			(state == FSWS_EVENTS && custom_list_is_affected(view, events, nevents)))
+	{
+		ui_view_schedule_reload(view);
+	}
+}
+
+/* Checks whether any of the events is about an entry of custom list.  Returns
+ * non-zero if so, otherwise zero is returned. */
+static int
+custom_list_is_affected(view_t *view, const fswatch_event_t events[],
+		int nevents)
+{
+	int i;
+	int affected = 0;
+	char path[PATH_MAX + 1];
+
+	trie_t *const paths = trie_create();
+	if(paths == NULL)
+	{
+		return 1;
+	}
+
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		if(!fentry_is_fake(&view->dir_entry[i]))
+		{
+			get_full_path_of(&view->dir_entry[i], sizeof(path), path);
+			if(trie_put(paths, path) < 0)
+			{
+				affected = 1;
+				break;
+			}
+		}
+	}
+
+	for(i = 0; i < nevents && !affected; ++i)
+	{
+		void *data;
+		build_path(path, sizeof(path), events[i].dir, events[i].name);
+		affected = (trie_get(paths, path, &data) == 0);
+	}
+
+	trie_free(paths);
+	return affected;
+}
+
 /* Checks whether tree-view needs a reload (any of subdirectories were changed).
  * Returns non-zero if so, otherwise zero is returned. */
 static int
@@ -3458,6 +4366,7 @@ check_marking(view_t *view, int count, const int indexes[])
 	{
 		clear_marking(view);
 		get_current_entry(view)->marked = 1;
+		flist_finish_reading(view);
 	}
 }
 
@@ -3472,6 +4381,8 @@ mark_files_at(view_t *view, int count, const int indexes[])
 	{
 		view->dir_entry[indexes[i]].marked = 1;
 	}
+
+	flist_finish_reading(view);
 }
 
 int
@@ -3487,6 +4398,8 @@ mark_selected(view_t *view)
 			++nmarked;
 		}
 	}
+
+	flist_finish_reading(view);
 	return nmarked;
 }
 
@@ -3498,6 +4411,7 @@ mark_selection_or_current(view_t *view)
 	{
 		clear_marking(view);
 		curr->marked = 1;
+		flist_finish_reading(view);
 		return 1;
 	}
 	return mark_selected(view);
@@ -3542,7 +4456,7 @@ flist_custom_add_spec(view_t *view, const char line[])
 	char *const path = parse_line_for_path(line, flist_get_dir(view));
 	if(path != NULL)
 	{
-		flist_custom_add(view, path);
+		flist_custom_add_deferred(view, path);
 		free(path);
 	}
 }
@@ -3759,6 +4673,7 @@ make_tree(view_t *view, const char path[], int reload, trie_t *excluded_paths)
 
 	replace_string(&view->custom.orig_dir, canonic_path);
 
+	watch_custom_list(view);
 	return 0;
 }
 
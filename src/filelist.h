@@ -36,6 +36,10 @@ typedef int (*zap_filter)(view_t *view, const dir_entry_t *entry, void *arg);
  * if particular property holds and zero otherwise. */
 typedef int (*entry_predicate)(const dir_entry_t *entry);
 
+/* Maximum number of descriptors reported by flist_get_watch_fds(): one for the
+ * list and two for caches of miller columns. */
+enum { FLIST_MAX_WATCH_FDS = 3 };
+
 /* Initialization/termination functions. */
 
 /* Prepares views for the first time. */
@@ -121,6 +125,10 @@ void flist_custom_start(view_t *view, const char title[]);
 /* Adds an entry to custom list of files.  Returns pointer to just added entry
  * or NULL on error. */
 dir_entry_t * flist_custom_add(view_t *view, const char path[]);
+/* Adds an entry to custom list of files postponing querying its metadata until
+ * flist_custom_finish(), which does it for all such entries at once and drops
+ * those that don't exist. */
+void flist_custom_add_deferred(view_t *view, const char path[]);
 /* Puts an entry to custom list of files, contents of the entry gets stolen.
  * Returns pointer to just added entry or NULL on error. */
 dir_entry_t * flist_custom_put(view_t *view, dir_entry_t *entry);
@@ -175,6 +183,15 @@ dir_entry_t * get_current_entry(const view_t *view);
 /* Checks whether content in the current directory of the view changed and
  * reloads the view if so. */
 void check_if_filelist_has_changed(view_t *view);
+/* Waits for asynchronous reading of current directory of the view to finish if
+ * it's in progress and reloads the list to make it complete.  Selection and
+ * marking of entries are preserved. */
+void flist_finish_reading(view_t *view);
+/* Collects descriptors that become readable when
+ * check_if_filelist_has_changed() has something to detect, fds should have
+ * room for FLIST_MAX_WATCH_FDS items.  Returns number of descriptors or -1 if
+ * the view needs to be checked periodically instead. */
+int flist_get_watch_fds(const view_t *view, int fds[]);
 /* Checks whether cd'ing into path is possible. Shows cd errors to a user.
  * Returns non-zero if it's possible, zero otherwise. */
 int cd_is_possible(const char path[]);
@@ -220,11 +237,14 @@ void get_full_path_of(const dir_entry_t *entry, size_t buf_len, char buf[]);
 void get_short_path_of(const view_t *view, const dir_entry_t *entry,
 		NameFormat fmt, int drop_prefix, size_t buf_len, char buf[]);
 /* Ensures that either entries at specified positions, selected entries or file
- * under cursor is marked. */
+ * under cursor is marked.  Also finishes reading of the list, so that it won't
+ * change while marked files are processed. */
 void check_marking(view_t *view, int count, const int indexes[]);
-/* Marks files at positions specified in the indexes array of size count. */
+/* Marks files at positions specified in the indexes array of size count and
+ * finishes reading of the list. */
 void mark_files_at(view_t *view, int count, const int indexes[]);
-/* Marks selected files of the view.  Returns number of marked files. */
+/* Marks selected files of the view and finishes reading of the list.  Returns
+ * number of marked files. */
 int mark_selected(view_t *view);
 /* Same as mark_selected() function, but when selection is absent current file
  * is marked.  Returns number of marked files. */
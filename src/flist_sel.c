@@ -130,6 +130,9 @@ void
 flist_sel_invert(view_t *view)
 {
 	int i;
+
+	flist_finish_reading(view);
+
 	view->selected_files = 0;
 	for(i = 0; i < view->list_rows; ++i)
 	{
@@ -158,6 +161,7 @@ flist_sel_restore(view_t *view, reg_t *reg)
 	int i;
 	trie_t *const selection_trie = trie_create();
 
+	flist_finish_reading(view);
 	flist_sel_drop(view);
 
 	if(reg == NULL)
@@ -265,6 +269,8 @@ flist_sel_by_filter(view_t *view, const char cmd[], int erase_old, int select)
 	}
 	free(expanded_cmd);
 
+	flist_finish_reading(view);
+
 	/* Append to previous selection unless ! is specified. */
 	if(select && erase_old)
 	{
@@ -334,6 +340,8 @@ flist_sel_by_pattern(view_t *view, const char pattern[], int erase_old,
 
 	select = (select != 0);
 
+	flist_finish_reading(view);
+
 	/* Append to previous selection unless ! is specified. */
 	if(select && erase_old)
 	{
@@ -21,16 +21,19 @@
 
 #include <sys/types.h> /* gid_t uid_t */
 
-#include <string.h> /* strdup() strlen() */
+#include <stdlib.h> /* free() */
+#include <string.h> /* memcpy() strdup() strlen() */
 
 #include "cfg/config.h"
 #include "compat/os.h"
+#include "compat/pthread.h"
 #include "modes/dialogs/msg_dialog.h"
 #include "ui/cancellation.h"
 #include "ui/fileview.h"
 #include "ui/statusbar.h"
 #include "ui/ui.h"
 #include "utils/cancellation.h"
+#include "utils/dirsize.h"
 #include "utils/fs.h"
 #include "utils/path.h"
 #include "utils/str.h"
@@ -43,6 +46,7 @@
 #include "flist_sel.h"
 #include "fops_common.h"
 #include "registers.h"
+#include "status.h"
 #include "trash.h"
 #include "undo.h"
 
@@ -54,6 +58,25 @@ typedef struct
 }
 dir_size_args_t;
 
+/* Minimal interval between redraws caused by partial results of directory size
+ * calculation. */
+#define DIR_SIZE_REDRAW_INTERVAL_MS 250
+
+/* Number of sizes of directories that are put into dcache at once. */
+#define DIR_SIZE_BATCH 64
+
+/* State of directory size calculation. */
+typedef struct
+{
+	int force;                 /* Whether cached values should be ignored. */
+	int progress;              /* Whether to redraw on partial results. */
+	pthread_mutex_t lock;      /* Protects fields below. */
+	long long last_redraw;     /* Time of last redraw in milliseconds. */
+	dcache_size_t pending[DIR_SIZE_BATCH]; /* Sizes yet to be put in dcache. */
+	int npending;              /* Number of elements in pending. */
+}
+dir_size_state_t;
+
 static int delete_file(dir_entry_t *entry, ops_t *ops, int reg, int use_trash,
 		int nested);
 static const char * get_top_dir(const view_t *view);
@@ -73,6 +96,11 @@ static void start_dir_size_calc(const char path[], int force);
 static void dir_size_bg(bg_op_t *bg_op, void *arg);
 static void dir_size(bg_op_t *bg_op, char path[], int force);
 static int bg_cancellation_hook(void *arg);
+static uint64_t calc_dir_size(const char path[], int force, int progress,
+		const cancellation_t *cancellation);
+static int lookup_dir_size(const char path[], uint64_t *size, void *arg);
+static void store_dir_size(const char path[], uint64_t size, void *arg);
+static void put_dir_sizes(dcache_size_t sizes[], int count);
 static void redraw_after_path_change(view_t *view, const char path[]);
 #ifndef _WIN32
 static void change_owner_cb(const char new_owner[]);
@@ -1158,7 +1186,9 @@ dir_size(bg_op_t *bg_op, char path[], int force)
 		.hook = &bg_cancellation_hook,
 	};
 
-	(void)fops_dir_size(path, force, &bg_cancellation_info);
+	(void)calc_dir_size(path, force, 1, &bg_cancellation_info);
+	/* Let other instances benefit from the results right away. */
+	dcache_flush();
 
 	remove_last_path_component(path);
 
@@ -1187,55 +1217,111 @@ uint64_t
 fops_dir_size(const char path[], int force_update,
 		const cancellation_t *cancellation)
 {
-	struct dirent *dentry;
-	const char *slash;
-	uint64_t size;
+	return calc_dir_size(path, force_update, 0, cancellation);
+}
 
-	DIR *dir = os_opendir(path);
-	if(dir == NULL)
+/* Calculates size of a directory using several threads storing sizes of it
+ * and its subdirectories in dcache.  Non-zero progress enables redrawing views
+ * as sizes of subdirectories become known.  Returns size of a directory or zero
+ * on error. */
+static uint64_t
+calc_dir_size(const char path[], int force, int progress,
+		const cancellation_t *cancellation)
+{
+	/* Paths of subdirectories are made from the root, so resolving it once
+	 * makes all of them canonical. */
+	char real_path[PATH_MAX + 1];
+	if(os_realpath(path, real_path) != real_path)
 	{
 		return 0U;
 	}
 
-	slash = (ends_with_slash(path) ? "" : "/");
-	size = 0U;
-	while((dentry = os_readdir(dir)) != NULL)
+	dir_size_state_t state = { .force = force, .progress = progress };
+	pthread_mutex_init(&state.lock, NULL);
+
+	const uint64_t size = dirsize_calc(real_path, cfg.io_threads,
+			&lookup_dir_size, &store_dir_size, &state, cancellation);
+	put_dir_sizes(state.pending, state.npending);
+
+	pthread_mutex_destroy(&state.lock);
+	return size;
+}
+
+/* dirsize_calc() callback that looks up size of a directory in dcache.  Only
+ * sizes that are in memory are used to keep traversal cheap.  Returns zero if
+ * size is known, otherwise non-zero is returned. */
+static int
+lookup_dir_size(const char path[], uint64_t *size, void *arg)
+{
+	const dir_size_state_t *const state = arg;
+	if(state->force)
 	{
-		char full_path[PATH_MAX + 1];
+		return 1;
+	}
 
-		if(is_builtin_dir(dentry->d_name))
-		{
-			continue;
-		}
+	dcache_get_size_real(path, size);
+	return (*size == DCACHE_UNKNOWN);
+}
 
-		snprintf(full_path, sizeof(full_path), "%s%s%s", path, slash,
-				dentry->d_name);
-		if(fops_is_dir_entry(full_path, dentry))
-		{
-			uint64_t dir_size;
-			dcache_get_at(full_path, &dir_size, NULL);
-			if(dir_size == DCACHE_UNKNOWN || force_update)
-			{
-				dir_size = fops_dir_size(full_path, force_update, cancellation);
-			}
-			size += dir_size;
-		}
-		else
-		{
-			size += get_file_size(full_path);
-		}
+/* dirsize_calc() callback that puts size of a directory into dcache in
+ * batches and schedules redraw of views from time to time so that they show
+ * partial results. */
+static void
+store_dir_size(const char path[], uint64_t size, void *arg)
+{
+	dir_size_state_t *const state = arg;
+	dcache_size_t batch[DIR_SIZE_BATCH];
+	int nbatch = 0;
+	int redraw = 0;
 
-		if(cancellation_requested(cancellation))
-		{
-			os_closedir(dir);
-			return 0U;
-		}
+	char *const path_copy = strdup(path);
+	const long long now = (state->progress ? get_time_ms() : 0);
+
+	pthread_mutex_lock(&state->lock);
+	if(path_copy != NULL)
+	{
+		state->pending[state->npending].real_path = path_copy;
+		state->pending[state->npending].size = size;
+		++state->npending;
+	}
+	if(state->progress && now - state->last_redraw >= DIR_SIZE_REDRAW_INTERVAL_MS)
+	{
+		state->last_redraw = now;
+		redraw = 1;
+	}
+	if(state->npending == DIR_SIZE_BATCH || redraw)
+	{
+		nbatch = state->npending;
+		memcpy(batch, state->pending, sizeof(*batch)*nbatch);
+		state->npending = 0;
 	}
+	pthread_mutex_unlock(&state->lock);
 
-	os_closedir(dir);
+	/* Views need to be redrawn only after new sizes are in place. */
+	put_dir_sizes(batch, nbatch);
 
-	(void)dcache_set_at(path, size, DCACHE_UNKNOWN);
-	return size;
+	if(redraw)
+	{
+		char parent[PATH_MAX + 1];
+		copy_str(parent, sizeof(parent), path);
+		remove_last_path_component(parent);
+
+		redraw_after_path_change(&lwin, parent);
+		redraw_after_path_change(&rwin, parent);
+	}
+}
+
+/* Puts sizes of directories into dcache and frees their paths. */
+static void
+put_dir_sizes(dcache_size_t sizes[], int count)
+{
+	int i;
+
+	dcache_set_sizes(sizes, count);
+	for(i = 0; i < count; ++i)
+	{
+		free(sizes[i].real_path);
+	}
 }
 
 #ifndef _WIN32
@@ -114,6 +114,12 @@ struct io_args_t
 	}
 	arg4;
 
+	/* Maximum number of threads for processing files of a subtree.  Additional
+	 * threads are used only in absence of confirmation and error callbacks,
+	 * because those might interact with a user.  Values less than two mean
+	 * sequential processing. */
+	int nthreads;
+
 	/* Provides means for cancellation checking. */
 	io_cancellation_t cancellation;
 
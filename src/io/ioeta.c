@@ -23,6 +23,7 @@
 #include <stdint.h> /* uint64_t */
 #include <stdlib.h> /* calloc() free() */
 
+#include "../compat/pthread.h"
 #include "private/ioc.h"
 #include "private/ioeta.h"
 #include "private/traverser.h"
@@ -36,6 +37,7 @@ ioeta_alloc(void *param, io_cancellation_t cancellation)
 	ioeta_estim_t *const estim = calloc(1U, sizeof(*estim));
 	estim->param = param;
 	estim->cancellation = cancellation;
+	pthread_mutex_init(&estim->lock, NULL);
 	return estim;
 }
 
@@ -45,6 +47,7 @@ ioeta_free(ioeta_estim_t *estim)
 	if(estim != NULL)
 	{
 		ioeta_release(estim);
+		pthread_mutex_destroy(&estim->lock);
 		free(estim);
 	}
 }
@@ -22,6 +22,7 @@
 #include <stddef.h> /* size_t */
 #include <stdint.h> /* uint64_t */
 
+#include "../compat/pthread.h"
 #include "ioc.h"
 
 /* ioeta - Input/Output estimation */
@@ -44,12 +45,20 @@ typedef struct ioeta_estim_t
 	/* Number of already processed bytes of all files. */
 	uint64_t current_byte;
 
-	/* Size of current file. */
+	/* Size of current file.  When several files are processed at once, this and
+	 * the next field describe the one whose progress was updated last. */
 	uint64_t total_file_bytes;
 
 	/* Number of already processed bytes of current file. */
 	uint64_t current_file_byte;
 
+	/* Progress of files that are being processed right now, one per thread of an
+	 * operation. */
+	struct ioeta_file_t *files;
+
+	/* Number of elements in the files array. */
+	size_t nfiles;
+
 	/* Number of inspected items. */
 	size_t inspected_items;
 
@@ -60,14 +69,15 @@ typedef struct ioeta_estim_t
 	 * removal). */
 	char *target;
 
-	/* Progress reported while this flag is on is ignored. */
-	int silent;
-
 	/* Custom parameter for notification callbacks. */
 	void *param;
 
 	/* Provides means for cancellation checking. */
 	io_cancellation_t cancellation;
+
+	/* Protects the estimation from concurrent updates by threads of an
+	 * operation. */
+	pthread_mutex_t lock;
 }
 ioeta_estim_t;
 
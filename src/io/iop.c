@@ -27,17 +27,23 @@
 #ifndef _WIN32
 #include <sys/ioctl.h> /* ioctl() */
 #endif
+#ifdef __linux__
+#include <sys/sendfile.h> /* sendfile() */
+#include <sys/syscall.h> /* SYS_copy_file_range */
+#endif
 #include <sys/stat.h> /* stat */
 #include <sys/types.h> /* mode_t */
-#include <unistd.h> /* rmdir() symlink() unlink() */
+#include <unistd.h> /* SEEK_DATA SEEK_HOLE ftruncate() lseek() rmdir() ssize_t
+                       symlink() syscall() unlink() */
 
 #include <assert.h> /* assert() */
 #include <errno.h> /* EEXIST ENOENT EISDIR errno */
 #include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* UINT64_MAX uint64_t */
 #include <stdio.h> /* FILE fpos_t fclose() fgetpos() fflush() fread() fseek()
-                      fsetpos() fwrite() snprintf() */
-#include <stdlib.h> /* free() */
-#include <string.h> /* strchr() */
+                      fseeko() fsetpos() ftello() fwrite() snprintf() */
+#include <stdlib.h> /* free() malloc() */
+#include <string.h> /* memcmp() strchr() */
 
 #include "../compat/fs_limits.h"
 #include "../compat/os.h"
@@ -53,17 +59,39 @@
 #include "private/ioeta.h"
 #include "ioc.h"
 
-/* Amount of data to transfer at once. */
-#define BLOCK_SIZE 32*1024
+/* Amount of data to transfer at once through user space. */
+#define BLOCK_SIZE (1024*1024)
+
+/* Amount of data to transfer at once inside the kernel.  Bounds delay of
+ * progress updates and reaction on cancellation. */
+#define KERNEL_BLOCK_SIZE (8*1024*1024)
 
 /* Type of io function used by retry_wrapper(). */
 typedef int (*iop_func)(io_args_t *args);
 
+/* Ways of copying file data from the fastest to the slowest one. */
+typedef enum
+{
+	CM_COPY_FILE_RANGE, /* copy_file_range() system call. */
+	CM_SENDFILE,        /* sendfile() system call. */
+	CM_READ_WRITE,      /* Reading and writing through a buffer. */
+}
+CopyMethod;
+
 static int iop_mkfile_internal(io_args_t *args);
 static int iop_mkdir_internal(io_args_t *args);
 static int iop_rmfile_internal(io_args_t *args);
 static int iop_rmdir_internal(io_args_t *args);
 static int iop_cp_internal(io_args_t *args);
+static int is_sparse(const struct stat *st);
+static int copy_sparse(io_args_t *args, FILE *in, FILE *out, uint64_t size);
+static int copy_contents(io_args_t *args, FILE *in, FILE *out,
+		int in_kernel, uint64_t limit);
+static ssize_t kernel_copy(CopyMethod method, int in_fd, int out_fd,
+		size_t count);
+static int copy_by_blocks(io_args_t *args, FILE *in, FILE *out,
+		uint64_t limit, int skip_zeros);
+static int is_all_zeros(const char block[], size_t len);
 static int clone_file(int dst_fd, int src_fd);
 #ifdef _WIN32
 static DWORD CALLBACK win_progress_cb(LARGE_INTEGER total,
@@ -290,10 +318,7 @@ iop_cp_internal(io_args_t *args)
 	const io_confirm confirm = args->confirm;
 	struct stat st;
 
-	char block[BLOCK_SIZE];
 	FILE *in, *out;
-	/* Suppress possible false-positive compiler warning. */
-	size_t nread = (size_t)-1;
 	int error;
 	int cloned;
 	struct stat src_st;
@@ -541,42 +566,18 @@ iop_cp_internal(io_args_t *args)
 		}
 	}
 
-	/* TODO: use sendfile() if platform supports it. */
-
 	if(!error && !cloned)
 	{
-		while((nread = fread(&block, 1, sizeof(block), in)) != 0U)
+		if(crs != IO_CRS_APPEND_TO_FILES && is_sparse(&st))
 		{
-			if(io_cancelled(args))
-			{
-				error = 1;
-				break;
-			}
-
-			if(fwrite(&block, 1, nread, out) != nread)
-			{
-				(void)ioe_errlst_append(&args->result.errors, dst, errno,
-						"Write to destination file failed");
-				error = 1;
-				break;
-			}
-
-			ioeta_update(args->estim, NULL, NULL, 0, nread);
+			error = copy_sparse(args, in, out, st.st_size);
 		}
-
-		if(nread == 0U && !feof(in) && ferror(in))
-		{
-			(void)ioe_errlst_append(&args->result.errors, src, errno,
-					"Read from destination file failed");
-		}
-
-		/* fwrite() does caching, so we need to force flush to catch output errors
-		 * before fclose() (which also does fflush() internally). */
-		if(fflush(out) != 0)
+		else
 		{
-			(void)ioe_errlst_append(&args->result.errors, dst, errno,
-					"Write to destination file failed");
-			error = 1;
+			/* Size of special files (like those in /proc) doesn't reflect their
+			 * contents and the kernel might refuse to copy them. */
+			const int in_kernel = (S_ISREG(st.st_mode) && st.st_size > 0);
+			error = copy_contents(args, in, out, in_kernel, UINT64_MAX);
 		}
 	}
 
@@ -629,17 +630,296 @@ iop_cp_internal(io_args_t *args)
 	return error;
 }
 
-/* Try to clone file fast on btrfs.  Returns 0 on success, otherwise non-zero is
+/* Checks whether regular file has holes, that is occupies less space on disk
+ * than its size.  Returns non-zero if so, otherwise zero is returned. */
+static int
+is_sparse(const struct stat *st)
+{
+#ifndef _WIN32
+	/* st_blocks is measured in 512-byte units. */
+	return S_ISREG(st->st_mode) && (uint64_t)st->st_blocks*512U <
+		(uint64_t)st->st_size;
+#else
+	(void)st;
+	return 0;
+#endif
+}
+
+/* Copies sparse file of the specified size without filling its holes.  Holes
+ * are found via SEEK_DATA/SEEK_HOLE and if that's not supported by blocks of
+ * zeroes.  Returns zero on success, otherwise non-zero is returned. */
+static int
+copy_sparse(io_args_t *args, FILE *in, FILE *out, uint64_t size)
+{
+#ifndef _WIN32
+	const int in_fd = fileno(in);
+	int error = 0;
+	int holes_known = 0;
+	off_t end = size;
+
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+	const off_t first_data = lseek(in_fd, 0, SEEK_DATA);
+	if(first_data < 0)
+	{
+		/* ENXIO means that there is no data, only a hole. */
+		holes_known = (errno == ENXIO);
+	}
+	else
+	{
+		const off_t first_hole = lseek(in_fd, first_data, SEEK_HOLE);
+		/* When the whole file is reported as data, fewer blocks than needed for
+		 * its size is likely due to compression, so the file is copied in a
+		 * single range in kernel instead of being scanned for zeroes. */
+		holes_known = (first_hole >= 0);
+	}
+
+	off_t pos = 0;
+	while(holes_known && !error && (uint64_t)pos < size)
+	{
+		off_t data = lseek(in_fd, pos, SEEK_DATA);
+		off_t hole = size;
+		if(data < 0 && errno == ENXIO)
+		{
+			data = size;
+		}
+		else if(data >= 0 && (uint64_t)data < size)
+		{
+			hole = lseek(in_fd, data, SEEK_HOLE);
+		}
+
+		if(data < 0 || hole < 0)
+		{
+			(void)ioe_errlst_append(&args->result.errors, args->arg1.src, errno,
+					"Failed to find data in source file");
+			error = 1;
+			break;
+		}
+
+		/* Skipped hole counts as processed data. */
+		ioeta_update(args->estim, NULL, NULL, 0, data - pos);
+
+		if(data < hole)
+		{
+			if(fseeko(in, data, SEEK_SET) != 0 || fseeko(out, data, SEEK_SET) != 0)
+			{
+				(void)ioe_errlst_append(&args->result.errors, args->arg2.dst, errno,
+						"Failed to seek in file");
+				error = 1;
+				break;
+			}
+			error = copy_contents(args, in, out, 1, hole - data);
+		}
+
+		pos = hole;
+	}
+#endif
+
+	if(!holes_known)
+	{
+		error = copy_by_blocks(args, in, out, UINT64_MAX, 1);
+		end = ftello(out);
+	}
+
+	/* Create trailing hole if there is one. */
+	if(!error &&
+			(end < 0 || fflush(out) != 0 || ftruncate(fileno(out), end) != 0))
+	{
+		(void)ioe_errlst_append(&args->result.errors, args->arg2.dst, errno,
+				"Failed to set size of destination file");
+		error = 1;
+	}
+
+	return error;
+#else
+	return copy_contents(args, in, out, 0, UINT64_MAX);
+#endif
+}
+
+/* Copies at most limit bytes from current position of input file to output
+ * file.  With non-zero in_kernel tries to avoid passing data through user
+ * space.  Returns zero on success, otherwise non-zero is returned. */
+static int
+copy_contents(io_args_t *args, FILE *in, FILE *out, int in_kernel,
+		uint64_t limit)
+{
+	CopyMethod method = (in_kernel ? CM_COPY_FILE_RANGE : CM_READ_WRITE);
+	uint64_t copied = 0U;
+
+	while(method != CM_READ_WRITE)
+	{
+		if(io_cancelled(args))
+		{
+			return 1;
+		}
+
+		if(limit == 0U)
+		{
+			return 0;
+		}
+
+		const ssize_t n = kernel_copy(method, fileno(in), fileno(out),
+				MIN(limit, (uint64_t)KERNEL_BLOCK_SIZE));
+		if(n > 0)
+		{
+			copied += n;
+			limit -= n;
+			ioeta_update(args->estim, NULL, NULL, 0, n);
+			continue;
+		}
+
+		if(copied != 0U)
+		{
+			if(n == 0)
+			{
+				return 0;
+			}
+
+			(void)ioe_errlst_append(&args->result.errors, args->arg2.dst, errno,
+					"Failed to copy file data");
+			return 1;
+		}
+
+		/* Nothing was copied, so this method isn't supported for these files,
+		 * fall back to the next one.  File positions weren't changed. */
+		method = (CopyMethod)(method + 1);
+	}
+
+	return copy_by_blocks(args, in, out, limit, 0);
+}
+
+/* Makes the kernel copy at most count bytes of data between files using
+ * specified method.  Returns number of copied bytes, zero at the end of input
+ * or -1 on error with errno set. */
+static ssize_t
+kernel_copy(CopyMethod method, int in_fd, int out_fd, size_t count)
+{
+#ifdef __linux__
+	switch(method)
+	{
+#ifdef SYS_copy_file_range
+		case CM_COPY_FILE_RANGE:
+			/* Using system call directly as wrapper might not be provided by libc.
+			 * This also makes a reflink copy on file systems that support it. */
+			return syscall(SYS_copy_file_range, in_fd, NULL, out_fd, NULL, count,
+					0U);
+#endif
+		case CM_SENDFILE:
+			return sendfile(out_fd, in_fd, NULL, count);
+
+		default:
+			break;
+	}
+#else
+	(void)method;
+	(void)in_fd;
+	(void)out_fd;
+	(void)count;
+#endif
+
+	errno = ENOSYS;
+	return -1;
+}
+
+/* Copies at most limit bytes between files by reading them into a buffer and
+ * writing them out.  With non-zero skip_zeros blocks of zeroes are skipped
+ * instead of being written, which leaves holes in the output file if it's
+ * extended afterwards.  Returns zero on success, otherwise non-zero is
  * returned. */
 static int
+copy_by_blocks(io_args_t *args, FILE *in, FILE *out, uint64_t limit,
+		int skip_zeros)
+{
+	const char *const src = args->arg1.src;
+	const char *const dst = args->arg2.dst;
+
+	/* Suppress possible false-positive compiler warning. */
+	size_t nread = (size_t)-1;
+	int error = 0;
+
+	/* Large allocations are page-aligned, which suits direct transfers. */
+	char *const block = malloc(BLOCK_SIZE);
+	if(block == NULL)
+	{
+		(void)ioe_errlst_append(&args->result.errors, src, ENOMEM,
+				"Failed to allocate buffer");
+		return 1;
+	}
+
+	while(limit != 0U &&
+			(nread = fread(block, 1, MIN(limit, (uint64_t)BLOCK_SIZE), in)) != 0U)
+	{
+		if(io_cancelled(args))
+		{
+			error = 1;
+			break;
+		}
+
+		limit -= nread;
+
+		if(skip_zeros && is_all_zeros(block, nread))
+		{
+			if(fseek(out, nread, SEEK_CUR) != 0)
+			{
+				(void)ioe_errlst_append(&args->result.errors, dst, errno,
+						"Failed to seek in destination file");
+				error = 1;
+				break;
+			}
+		}
+		else if(fwrite(block, 1, nread, out) != nread)
+		{
+			(void)ioe_errlst_append(&args->result.errors, dst, errno,
+					"Write to destination file failed");
+			error = 1;
+			break;
+		}
+
+		ioeta_update(args->estim, NULL, NULL, 0, nread);
+	}
+
+	if(nread == 0U && !feof(in) && ferror(in))
+	{
+		(void)ioe_errlst_append(&args->result.errors, src, errno,
+				"Read from destination file failed");
+	}
+
+	/* fwrite() does caching, so we need to force flush to catch output errors
+	 * before fclose() (which also does fflush() internally). */
+	if(fflush(out) != 0)
+	{
+		(void)ioe_errlst_append(&args->result.errors, dst, errno,
+				"Write to destination file failed");
+		error = 1;
+	}
+
+	free(block);
+	return error;
+}
+
+/* Checks whether block of data consists of zero bytes only.  Returns non-zero
+ * if so, otherwise zero is returned. */
+static int
+is_all_zeros(const char block[], size_t len)
+{
+	/* Comparing block with itself shifted by one byte checks that all bytes are
+	 * equal to the first one. */
+	return len == 0U
+	    || (block[0] == '\0' && memcmp(block, block + 1, len - 1U) == 0);
+}
+
+/* Tries to make a copy-on-write clone of a file on file systems that support
+ * it.  Returns 0 on success, otherwise non-zero is returned. */
+static int
 clone_file(int dst_fd, int src_fd)
 {
 #ifdef __linux__
-#undef BTRFS_IOCTL_MAGIC
-#define BTRFS_IOCTL_MAGIC 0x94
-#undef BTRFS_IOC_CLONE
-#define BTRFS_IOC_CLONE _IOW(BTRFS_IOCTL_MAGIC, 9, int)
-	return ioctl(dst_fd, BTRFS_IOC_CLONE, src_fd);
+	/* FICLONE from <linux/fs.h> is a generalization of BTRFS_IOC_CLONE (has the
+	 * same value) supported by several file systems.  It's defined here to not
+	 * depend on version of kernel headers. */
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+	return ioctl(dst_fd, FICLONE, src_fd);
 #else
 	(void)dst_fd;
 	(void)src_fd;
@@ -831,8 +1111,7 @@ retry_wrapper(iop_func func, io_args_t *args)
 				{
 					/* When we ignore a file, in order to make progress look nice pretend
 					 * that this file was processed in full. */
-					ioeta_update(args->estim, args->estim->item, args->estim->target, 1,
-							args->estim->total_file_bytes - args->estim->current_file_byte);
+					ioeta_skip_file(args->estim);
 				}
 				ioe_errlst_splice(&orig_errlist, &args->result.errors);
 				break;
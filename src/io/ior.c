@@ -29,6 +29,7 @@
 
 #include "../compat/fs_limits.h"
 #include "../compat/os.h"
+#include "../compat/pthread.h"
 #include "../utils/fs.h"
 #include "../utils/log.h"
 #include "../utils/path.h"
@@ -42,6 +43,19 @@
 #include "ioc.h"
 #include "iop.h"
 
+/* Data for parallel_visitor(). */
+typedef struct
+{
+	subtree_visitor visitor; /* Visitor that does the actual work. */
+	io_args_t *args;         /* Arguments of the operation. */
+	pthread_mutex_t lock;    /* Serializes merging of results of visitors. */
+}
+parallel_visitor_data_t;
+
+static int traverse_tree(const char path[], subtree_visitor visitor,
+		io_args_t *args);
+static VisitResult parallel_visitor(const char full_path[], VisitAction action,
+		void *param);
 static VisitResult rm_visitor(const char full_path[], VisitAction action,
 		void *param);
 static VisitResult cp_visitor(const char full_path[], VisitAction action,
@@ -56,7 +70,48 @@ int
 ior_rm(io_args_t *args)
 {
 	const char *const path = args->arg1.path;
-	return traverse(path, &rm_visitor, args);
+	return traverse_tree(path, &rm_visitor, args);
+}
+
+/* Traverses subtree using several threads if that's possible.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+traverse_tree(const char path[], subtree_visitor visitor, io_args_t *args)
+{
+	if(args->nthreads < 2 || args->confirm != NULL ||
+			args->result.errors_cb != NULL)
+	{
+		return traverse(path, visitor, args);
+	}
+
+	parallel_visitor_data_t data = { .visitor = visitor, .args = args };
+	pthread_mutex_init(&data.lock, NULL);
+	const int result = traverse_parallel(path, &parallel_visitor, &data,
+			args->nthreads);
+	pthread_mutex_destroy(&data.lock);
+	return result;
+}
+
+/* Thread-safe wrapper of a visitor.  Runs the visitor on a private copy of
+ * arguments and merges its errors into the list of the operation.  Returns
+ * result of the visitor. */
+static VisitResult
+parallel_visitor(const char full_path[], VisitAction action, void *param)
+{
+	parallel_visitor_data_t *const data = param;
+
+	io_args_t args = *data->args;
+	ioe_errlst_t errors = { .active = args.result.errors.active };
+	args.result.errors = errors;
+
+	const VisitResult result = data->visitor(full_path, action, &args);
+
+	pthread_mutex_lock(&data->lock);
+	ioe_errlst_splice(&data->args->result.errors, &args.result.errors);
+	pthread_mutex_unlock(&data->lock);
+
+	ioe_errlst_free(&args.result.errors);
+	return result;
 }
 
 /* Implementation of traverse() visitor for subtree removal.  Returns 0 on
@@ -131,6 +186,7 @@ ior_cp(io_args_t *args)
 		io_args_t rm_args = {
 			.arg1.path = dst,
 
+			.nthreads = args->nthreads,
 			.cancellation = args->cancellation,
 			.estim = args->estim,
 
@@ -150,7 +206,7 @@ ior_cp(io_args_t *args)
 		}
 	}
 
-	return traverse(src, &cp_visitor, args);
+	return traverse_tree(src, &cp_visitor, args);
 }
 
 /* Implementation of traverse() visitor for subtree copying.  Returns 0 on
@@ -227,20 +283,21 @@ ior_mv(io_args_t *args)
 				 * might be missing at the destination. */
 				if(result == 0 && args->result.errors.error_count == 0)
 				{
+					/* Progress isn't reported for this "secondary" operation.  Estimation
+					 * is shared with other threads of the operation, so this is done by
+					 * omitting it rather than by changing its state. */
 					io_args_t rm_args = {
 						.arg1.path = src,
 
+						.nthreads = args->nthreads,
 						.cancellation = args->cancellation,
-						.estim = args->estim,
+						.estim = NULL,
 
 						.result = args->result,
 					};
 
-					/* Disable progress reporting for this "secondary" operation. */
-					const int silent = ioeta_silent_on(rm_args.estim);
 					result = ior_rm(&rm_args);
 					args->result = rm_args.result;
-					ioeta_silent_set(rm_args.estim, silent);
 				}
 				return result;
 			}
@@ -258,6 +315,7 @@ ior_mv(io_args_t *args)
 				io_args_t rm_args = {
 					.arg1.path = dst,
 
+					.nthreads = args->nthreads,
 					.cancellation = args->cancellation,
 					.estim = args->estim,
 
@@ -317,7 +375,7 @@ ior_mv(io_args_t *args)
 					}
 				}
 
-				return traverse(src, &mv_visitor, args);
+				return traverse_tree(src, &mv_visitor, args);
 			}
 			/* Break is intentionally omitted. */
 
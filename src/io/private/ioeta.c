@@ -20,19 +20,36 @@
 
 #include <stddef.h> /* NULL */
 #include <stdint.h> /* uint64_t */
-#include <stdlib.h> /* free() */
+#include <stdlib.h> /* free() realloc() */
 #include <string.h> /* strdup() */
 
+#include "../../compat/pthread.h"
 #include "../../utils/fs.h"
 #include "../../utils/str.h"
 #include "../ioeta.h"
 #include "ionotif.h"
 
+/* Progress of a file that is being processed by one of the threads. */
+typedef struct ioeta_file_t
+{
+	pthread_t thread;           /* Thread that processes the file. */
+	int active;                 /* Whether this entry is in use. */
+	uint64_t total_file_bytes;  /* Size of the file. */
+	uint64_t current_file_byte; /* Number of already processed bytes. */
+}
+ioeta_file_t;
+
+static void update(ioeta_estim_t *estim, const char path[],
+		const char target[], int finished, uint64_t bytes);
+static ioeta_file_t * find_file(ioeta_estim_t *estim);
+static ioeta_file_t * start_file(ioeta_estim_t *estim);
+
 void
 ioeta_release(ioeta_estim_t *estim)
 {
 	free(estim->item);
 	free(estim->target);
+	free(estim->files);
 }
 
 void
@@ -73,19 +90,60 @@ void
 ioeta_update(ioeta_estim_t *estim, const char path[], const char target[],
 		int finished, uint64_t bytes)
 {
-	if(estim == NULL || estim->silent)
+	if(estim == NULL)
 	{
 		return;
 	}
 
+	pthread_mutex_lock(&estim->lock);
+	update(estim, path, target, finished, bytes);
+	pthread_mutex_unlock(&estim->lock);
+}
+
+void
+ioeta_skip_file(ioeta_estim_t *estim)
+{
+	pthread_mutex_lock(&estim->lock);
+
+	const ioeta_file_t *const file = find_file(estim);
+	const uint64_t left = (file == NULL)
+	                    ? 0U
+	                    : file->total_file_bytes - file->current_file_byte;
+	update(estim, NULL, NULL, 1, left);
+
+	pthread_mutex_unlock(&estim->lock);
+}
+
+/* Implementation of ioeta_update() that expects estimation to be locked. */
+static void
+update(ioeta_estim_t *estim, const char path[], const char target[],
+		int finished, uint64_t bytes)
+{
 	estim->current_byte += bytes;
-	estim->current_file_byte += bytes;
 	if(estim->current_byte > estim->total_bytes)
 	{
 		/* Estimations are out of date, update them. */
 		estim->total_bytes = estim->current_byte;
 	}
 
+	ioeta_file_t *file = find_file(estim);
+	if(file == NULL && !finished)
+	{
+		file = start_file(estim);
+		if(file != NULL)
+		{
+			++estim->inspected_items;
+			file->total_file_bytes = get_file_size(path);
+		}
+	}
+
+	if(file != NULL)
+	{
+		file->current_file_byte += bytes;
+		estim->total_file_bytes = file->total_file_bytes;
+		estim->current_file_byte = file->current_file_byte;
+	}
+
 	if(finished)
 	{
 		++estim->current_item;
@@ -94,14 +152,14 @@ ioeta_update(ioeta_estim_t *estim, const char path[], const char target[],
 			/* Estimations are out of date, update them. */
 			estim->total_items = estim->current_item;
 		}
+
+		if(file != NULL)
+		{
+			file->active = 0;
+		}
 		estim->current_file_byte = 0U;
 		estim->total_file_bytes = 0U;
 	}
-	else if(estim->inspected_items != estim->current_item + 1)
-	{
-		estim->inspected_items = estim->current_item + 1;
-		estim->total_file_bytes = get_file_size(path);
-	}
 
 	if(path != NULL)
 	{
@@ -116,36 +174,71 @@ ioeta_update(ioeta_estim_t *estim, const char path[], const char target[],
 	ionotif_notify(IO_PS_IN_PROGRESS, estim);
 }
 
-int
-ioeta_silent_on(ioeta_estim_t *estim)
+/* Looks up file processed by the calling thread.  Returns the entry or NULL if
+ * the thread isn't processing any file. */
+static ioeta_file_t *
+find_file(ioeta_estim_t *estim)
 {
-	int silent;
+	const pthread_t self = pthread_self();
 
-	if(estim == NULL)
+	size_t i;
+	for(i = 0U; i < estim->nfiles; ++i)
 	{
-		return 0;
+		ioeta_file_t *const file = &estim->files[i];
+		if(file->active && pthread_equal(file->thread, self))
+		{
+			return file;
+		}
 	}
-
-	silent = estim->silent;
-	estim->silent = 1;
-	return silent;
+	return NULL;
 }
 
-void
-ioeta_silent_set(ioeta_estim_t *estim, int silent)
+/* Makes an entry for a file processed by the calling thread.  Returns the entry
+ * or NULL on memory allocation error. */
+static ioeta_file_t *
+start_file(ioeta_estim_t *estim)
 {
-	if(estim != NULL)
+	size_t i;
+	for(i = 0U; i < estim->nfiles; ++i)
 	{
-		estim->silent = silent;
+		if(!estim->files[i].active)
+		{
+			break;
+		}
+	}
+
+	if(i == estim->nfiles)
+	{
+		ioeta_file_t *const files = realloc(estim->files,
+				sizeof(*files)*(estim->nfiles + 1U));
+		if(files == NULL)
+		{
+			return NULL;
+		}
+		estim->files = files;
+		++estim->nfiles;
 	}
+
+	ioeta_file_t *const file = &estim->files[i];
+	file->thread = pthread_self();
+	file->active = 1;
+	file->total_file_bytes = 0U;
+	file->current_file_byte = 0U;
+	return file;
 }
 
 ioeta_estim_t
-ioeta_save(const ioeta_estim_t *estim)
+ioeta_save(ioeta_estim_t *estim)
 {
+	pthread_mutex_lock(&estim->lock);
 	ioeta_estim_t copy = *estim;
+	pthread_mutex_unlock(&estim->lock);
+
 	copy.item = (copy.item == NULL ? NULL : strdup(copy.item));
 	copy.target = (copy.target == NULL ? NULL : strdup(copy.target));
+	/* Files in progress belong to the estimation and aren't restored. */
+	copy.files = NULL;
+	copy.nfiles = 0U;
 
 	return copy;
 }
@@ -153,20 +246,26 @@ ioeta_save(const ioeta_estim_t *estim)
 void
 ioeta_restore(ioeta_estim_t *estim, const ioeta_estim_t *save)
 {
-	char *item = estim->item;
-	char *target = estim->target;
+	pthread_mutex_lock(&estim->lock);
 
-	if(estim->silent)
+	ioeta_file_t *const file = find_file(estim);
+	if(file != NULL)
 	{
-		return;
+		/* The file is going to be processed anew. */
+		file->active = 0;
 	}
 
-	update_string(&item, save->item);
-	update_string(&target, save->target);
+	estim->total_items = save->total_items;
+	estim->current_item = save->current_item;
+	estim->total_bytes = save->total_bytes;
+	estim->current_byte = save->current_byte;
+	estim->total_file_bytes = save->total_file_bytes;
+	estim->current_file_byte = save->current_file_byte;
+	estim->inspected_items = save->inspected_items;
+	update_string(&estim->item, save->item);
+	update_string(&estim->target, save->target);
 
-	*estim = *save;
-	estim->item = item;
-	estim->target = target;
+	pthread_mutex_unlock(&estim->lock);
 }
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -25,6 +25,9 @@
 
 /* ioeta - private functions of Input/Output estimation */
 
+/* Functions that update or save state of estimation during an operation are
+ * safe to be called from several threads at once. */
+
 /* Frees resources of estimation, but not the structure itself.  estim can't be
  * NULL. */
 void ioeta_release(ioeta_estim_t *estim);
@@ -48,19 +51,17 @@ void ioeta_add_dir(ioeta_estim_t *estim, const char path[]);
 void ioeta_update(ioeta_estim_t *estim, const char path[], const char target[],
 		int finished, uint64_t bytes);
 
-/* Silence future progress reports.  Returns previous state to be passed to
- * ioeta_silent_set() later.  If estim is NULL, returns zero. */
-int ioeta_silent_on(ioeta_estim_t *estim);
-
-/* Sets silence flag for the estimation.  Does nothing if estim is NULL. */
-void ioeta_silent_set(ioeta_estim_t *estim, int silent);
+/* Marks file processed by the calling thread as finished counting its remaining
+ * bytes as processed.  Does nothing to bytes if there is no such file. */
+void ioeta_skip_file(ioeta_estim_t *estim);
 
 /* Makes restoration point for state of the estimation.  Returns the restoration
  * point to be passed to ioeta_restore.  It can be used to restore state
  * multiple times and needs to be freed with ioeta_release() after last use. */
-ioeta_estim_t ioeta_save(const ioeta_estim_t *estim);
+ioeta_estim_t ioeta_save(ioeta_estim_t *estim);
 
-/* Restores estimation to its previous state. */
+/* Restores estimation to its previous state.  File processed by the calling
+ * thread is forgotten. */
 void ioeta_restore(ioeta_estim_t *estim, const ioeta_estim_t *save);
 
 #endif /* VIFM__IO__PRIVATE__IOETA_H__ */
@@ -18,16 +18,97 @@
 
 #include "traverser.h"
 
-#include <stddef.h> /* NULL */
-#include <stdlib.h> /* free() */
+#ifndef _WIN32
+#include <fcntl.h> /* AT_FDCWD AT_SYMLINK_NOFOLLOW O_* openat() */
+#include <sys/stat.h> /* S_ISDIR fstatat() stat */
+#include <unistd.h> /* close() */
+#endif
+
+#include <dirent.h> /* DIR dirent dirfd() fdopendir() */
+#include <stddef.h> /* NULL size_t */
+#include <stdlib.h> /* calloc() free() malloc() realloc() */
+#include <string.h> /* memcpy() strdup() strlen() */
 
 #include "../../compat/os.h"
+#include "../../compat/pthread.h"
 #include "../../utils/fs.h"
+#include "../../utils/macros.h"
+#include "../../utils/parallel.h"
 #include "../../utils/path.h"
 #include "../../utils/str.h"
 
-static int traverse_subtree(const char path[], subtree_visitor visitor,
-		void *param);
+#if !defined(_WIN32) && defined(AT_FDCWD)
+/* Directories are opened and entries are inspected relative to file descriptor
+ * of their parent, which saves resolving the whole path each time. */
+#define FD_RELATIVE_WALK
+#endif
+
+/* Maximum number of files waiting to be visited.  Bounds memory usage when
+ * walking directories is faster than processing files. */
+#define QUEUE_SIZE 1024
+
+/* Path that grows and shrinks as traversal goes down and up the tree, which
+ * saves allocating a string per entry. */
+typedef struct
+{
+	char *data;      /* Null-terminated path. */
+	size_t len;      /* Length of the path. */
+	size_t capacity; /* Size of the buffer. */
+}
+path_buf_t;
+
+/* Directory whose VA_DIR_LEAVE is postponed until all its entries are done. */
+typedef struct dir_node_t
+{
+	char *path;                /* Path to the directory. */
+	struct dir_node_t *parent; /* Parent directory or NULL for the root. */
+	int pending;               /* Number of unfinished entries (+1 while the
+	                              directory is being read). */
+	int leave;                 /* Whether VA_DIR_LEAVE should be visited. */
+}
+dir_node_t;
+
+/* File waiting to be visited. */
+typedef struct
+{
+	char *path;      /* Path to the file. */
+	dir_node_t *dir; /* Directory that contains the file. */
+}
+task_t;
+
+/* State of parallel traversal shared among threads. */
+typedef struct
+{
+	subtree_visitor visitor;  /* Visitor provided by the user. */
+	void *param;              /* Parameter for the visitor. */
+
+	pthread_mutex_t lock;     /* Protects all fields below. */
+	pthread_cond_t not_empty; /* Signaled on adding a task and on finishing. */
+	pthread_cond_t not_full;  /* Signaled on taking a task from the queue. */
+	task_t *queue;            /* Circular buffer of tasks. */
+	int head;                 /* Index of the first task in the queue. */
+	int count;                /* Number of tasks in the queue. */
+	int finished;             /* No more tasks will be added. */
+	int result;               /* First error or zero. */
+}
+pool_t;
+
+static int traverse_subtree(DIR *dir, path_buf_t *path,
+		subtree_visitor visitor, void *param);
+static void walk_subtree(pool_t *pool, DIR *dir, path_buf_t *path,
+		dir_node_t *parent);
+static dir_node_t * enter_dir(pool_t *pool, const char path[],
+		dir_node_t *parent);
+static void add_task(pool_t *pool, const char path[], dir_node_t *dir);
+static void worker(int index, void *arg);
+static void finish_entry(pool_t *pool, dir_node_t *dir);
+static void set_result(pool_t *pool, int result);
+static int has_failed(pool_t *pool);
+static DIR * open_dir(DIR *parent, const char name[], const char path[]);
+static int is_subdir(DIR *dir, const struct dirent *d, const char path[]);
+static int path_init(path_buf_t *path, const char root[]);
+static size_t path_push(path_buf_t *path, const char name[]);
+static void path_pop(path_buf_t *path, size_t len);
 
 int
 traverse(const char path[], subtree_visitor visitor, void *param)
@@ -42,7 +123,19 @@ traverse(const char path[], subtree_visitor visitor, void *param)
 	}
 	else if(is_dir(path))
 	{
-		return traverse_subtree(path, visitor, param);
+		path_buf_t buf;
+		if(path_init(&buf, path) != 0)
+		{
+			return 1;
+		}
+
+		DIR *const dir = open_dir(NULL, path, path);
+		const int result = (dir == NULL)
+		                 ? 1
+		                 : traverse_subtree(dir, &buf, visitor, param);
+
+		free(buf.data);
+		return result;
 	}
 	else
 	{
@@ -50,23 +143,18 @@ traverse(const char path[], subtree_visitor visitor, void *param)
 	}
 }
 
-/* A generic subtree traversing.  Returns zero on success, otherwise non-zero is
+/* A generic subtree traversing.  The dir is opened directory at the path, it's
+ * closed by this function.  Returns zero on success, otherwise non-zero is
  * returned. */
 static int
-traverse_subtree(const char path[], subtree_visitor visitor, void *param)
+traverse_subtree(DIR *dir, path_buf_t *path, subtree_visitor visitor,
+		void *param)
 {
-	DIR *dir;
 	struct dirent *d;
 	int result;
 	VisitResult enter_result;
 
-	dir = os_opendir(path);
-	if(dir == NULL)
-	{
-		return 1;
-	}
-
-	enter_result = visitor(path, VA_DIR_ENTER, param);
+	enter_result = visitor(path->data, VA_DIR_ENTER, param);
 	if(enter_result == VR_ERROR)
 	{
 		(void)os_closedir(dir);
@@ -76,28 +164,32 @@ traverse_subtree(const char path[], subtree_visitor visitor, void *param)
 	result = 0;
 	while((d = os_readdir(dir)) != NULL)
 	{
-		char *full_path;
-
 		if(is_builtin_dir(d->d_name))
 		{
 			continue;
 		}
 
-		full_path = join_paths(path, d->d_name);
-		if(entry_is_link(full_path, d))
+		const size_t len = path_push(path, d->d_name);
+		if(len == (size_t)-1)
 		{
-			/* Treat symbolic links to directories as files as well. */
-			result = visitor(full_path, VA_FILE, param);
+			result = 1;
+			break;
 		}
-		else if(entry_is_dir(full_path, d))
+
+		/* Symbolic links to directories are treated as files as well. */
+		if(is_subdir(dir, d, path->data))
 		{
-			result = traverse_subtree(full_path, visitor, param);
+			DIR *const subdir = open_dir(dir, d->d_name, path->data);
+			result = (subdir == NULL)
+			       ? 1
+			       : traverse_subtree(subdir, path, visitor, param);
 		}
 		else
 		{
-			result = visitor(full_path, VA_FILE, param);
+			result = visitor(path->data, VA_FILE, param);
 		}
-		free(full_path);
+
+		path_pop(path, len);
 
 		if(result != 0)
 		{
@@ -109,11 +201,416 @@ traverse_subtree(const char path[], subtree_visitor visitor, void *param)
 	if(result == 0 && enter_result != VR_SKIP_DIR_LEAVE &&
 			enter_result != VR_CANCELLED)
 	{
-		result = visitor(path, VA_DIR_LEAVE, param);
+		result = visitor(path->data, VA_DIR_LEAVE, param);
 	}
 
 	return result;
 }
 
+int
+traverse_parallel(const char path[], subtree_visitor visitor, void *param,
+		int nthreads)
+{
+	parallel_team_t team;
+
+	if(nthreads < 2 || is_symlink(path) || !is_dir(path))
+	{
+		return traverse(path, visitor, param);
+	}
+
+	path_buf_t buf;
+	if(path_init(&buf, path) != 0)
+	{
+		return 1;
+	}
+
+	pool_t pool = {
+		.visitor = visitor,
+		.param = param,
+		.queue = malloc(sizeof(task_t)*QUEUE_SIZE),
+	};
+	if(pool.queue == NULL)
+	{
+		free(buf.data);
+		return traverse(path, visitor, param);
+	}
+
+	pthread_mutex_init(&pool.lock, NULL);
+	pthread_cond_init(&pool.not_empty, NULL);
+	pthread_cond_init(&pool.not_full, NULL);
+
+	if(parallel_team_start(&team, nthreads, &worker, &pool) == 0)
+	{
+		pool.result = traverse(path, visitor, param);
+	}
+	else
+	{
+		DIR *const dir = open_dir(NULL, path, path);
+		if(dir == NULL)
+		{
+			set_result(&pool, 1);
+		}
+		else
+		{
+			walk_subtree(&pool, dir, &buf, NULL);
+		}
+
+		pthread_mutex_lock(&pool.lock);
+		pool.finished = 1;
+		pthread_cond_broadcast(&pool.not_empty);
+		pthread_mutex_unlock(&pool.lock);
+
+		parallel_team_join(&team);
+	}
+
+	pthread_cond_destroy(&pool.not_full);
+	pthread_cond_destroy(&pool.not_empty);
+	pthread_mutex_destroy(&pool.lock);
+	free(pool.queue);
+	free(buf.data);
+
+	return pool.result;
+}
+
+/* Walks directory recursively queueing its files to be visited by workers.
+ * Directories are entered right away.  The dir is opened directory at the
+ * path, it's closed by this function. */
+static void
+walk_subtree(pool_t *pool, DIR *dir, path_buf_t *path, dir_node_t *parent)
+{
+	struct dirent *d;
+
+	dir_node_t *const node = enter_dir(pool, path->data, parent);
+	if(node == NULL)
+	{
+		(void)os_closedir(dir);
+		return;
+	}
+
+	while(!has_failed(pool) && (d = os_readdir(dir)) != NULL)
+	{
+		if(is_builtin_dir(d->d_name))
+		{
+			continue;
+		}
+
+		const size_t len = path_push(path, d->d_name);
+		if(len == (size_t)-1)
+		{
+			set_result(pool, 1);
+			break;
+		}
+
+		/* Symbolic links to directories are treated as files as well. */
+		if(is_subdir(dir, d, path->data))
+		{
+			DIR *const subdir = open_dir(dir, d->d_name, path->data);
+			if(subdir == NULL)
+			{
+				set_result(pool, 1);
+			}
+			else
+			{
+				walk_subtree(pool, subdir, path, node);
+			}
+		}
+		else
+		{
+			add_task(pool, path->data, node);
+		}
+
+		path_pop(path, len);
+	}
+	(void)os_closedir(dir);
+
+	/* The directory is completely read. */
+	finish_entry(pool, node);
+}
+
+/* Visits directory on entering it and makes node that tracks its entries.
+ * Returns the node or NULL on error. */
+static dir_node_t *
+enter_dir(pool_t *pool, const char path[], dir_node_t *parent)
+{
+	const VisitResult enter_result = pool->visitor(path, VA_DIR_ENTER,
+			pool->param);
+	if(enter_result == VR_ERROR || enter_result == VR_CANCELLED)
+	{
+		set_result(pool, enter_result);
+		return NULL;
+	}
+
+	dir_node_t *const node = calloc(1, sizeof(*node));
+	if(node == NULL || (node->path = strdup(path)) == NULL)
+	{
+		free(node);
+		set_result(pool, VR_ERROR);
+		return NULL;
+	}
+
+	node->parent = parent;
+	node->pending = 1;
+	node->leave = (enter_result != VR_SKIP_DIR_LEAVE);
+
+	if(parent != NULL)
+	{
+		pthread_mutex_lock(&pool->lock);
+		++parent->pending;
+		pthread_mutex_unlock(&pool->lock);
+	}
+
+	return node;
+}
+
+/* Puts file into the queue waiting for a free slot if necessary. */
+static void
+add_task(pool_t *pool, const char path[], dir_node_t *dir)
+{
+	char *const path_copy = strdup(path);
+	if(path_copy == NULL)
+	{
+		set_result(pool, VR_ERROR);
+		return;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	while(pool->count == QUEUE_SIZE)
+	{
+		pthread_cond_wait(&pool->not_full, &pool->lock);
+	}
+
+	const task_t task = { .path = path_copy, .dir = dir };
+	pool->queue[(pool->head + pool->count)%QUEUE_SIZE] = task;
+	++pool->count;
+	++dir->pending;
+
+	pthread_cond_signal(&pool->not_empty);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/* Body of worker threads, which visit queued files until traversal is
+ * over. */
+static void
+worker(int index, void *arg)
+{
+	pool_t *const pool = arg;
+
+	while(1)
+	{
+		pthread_mutex_lock(&pool->lock);
+		while(pool->count == 0 && !pool->finished)
+		{
+			pthread_cond_wait(&pool->not_empty, &pool->lock);
+		}
+		if(pool->count == 0)
+		{
+			pthread_mutex_unlock(&pool->lock);
+			break;
+		}
+
+		const task_t task = pool->queue[pool->head];
+		pool->head = (pool->head + 1)%QUEUE_SIZE;
+		--pool->count;
+		const int failed = (pool->result != 0);
+
+		pthread_cond_signal(&pool->not_full);
+		pthread_mutex_unlock(&pool->lock);
+
+		/* After a failure remaining tasks are just discarded. */
+		if(!failed)
+		{
+			const VisitResult result = pool->visitor(task.path, VA_FILE,
+					pool->param);
+			if(result != VR_OK)
+			{
+				set_result(pool, result);
+			}
+		}
+
+		free(task.path);
+		finish_entry(pool, task.dir);
+	}
+}
+
+/* Marks one entry of the directory as processed.  Visits VA_DIR_LEAVE for
+ * directories that have no unfinished entries left, which in turn finishes
+ * entries of their parents. */
+static void
+finish_entry(pool_t *pool, dir_node_t *dir)
+{
+	while(dir != NULL)
+	{
+		pthread_mutex_lock(&pool->lock);
+		const int done = (--dir->pending == 0);
+		const int failed = (pool->result != 0);
+		pthread_mutex_unlock(&pool->lock);
+
+		if(!done)
+		{
+			break;
+		}
+
+		if(dir->leave && !failed)
+		{
+			const VisitResult result = pool->visitor(dir->path, VA_DIR_LEAVE,
+					pool->param);
+			if(result != VR_OK)
+			{
+				set_result(pool, result);
+			}
+		}
+
+		dir_node_t *const parent = dir->parent;
+		free(dir->path);
+		free(dir);
+		dir = parent;
+	}
+}
+
+/* Remembers result of traversal unless an error was already recorded. */
+static void
+set_result(pool_t *pool, int result)
+{
+	pthread_mutex_lock(&pool->lock);
+	if(pool->result == 0)
+	{
+		pool->result = result;
+	}
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/* Checks whether traversal has failed.  Returns non-zero if so, otherwise zero
+ * is returned. */
+static int
+has_failed(pool_t *pool)
+{
+	pthread_mutex_lock(&pool->lock);
+	const int failed = (pool->result != 0);
+	pthread_mutex_unlock(&pool->lock);
+	return failed;
+}
+
+/* Opens directory for reading.  Parent is NULL for the root of traversal.
+ * Returns the directory or NULL on error. */
+static DIR *
+open_dir(DIR *parent, const char name[], const char path[])
+{
+#ifdef FD_RELATIVE_WALK
+	(void)path;
+
+	int flags = O_RDONLY;
+#ifdef O_DIRECTORY
+	flags |= O_DIRECTORY;
+#endif
+#ifdef O_CLOEXEC
+	flags |= O_CLOEXEC;
+#endif
+#ifdef O_NOFOLLOW
+	/* Entries of directories are checked to not be symbolic links, but they
+	 * could have been replaced since then. */
+	if(parent != NULL)
+	{
+		flags |= O_NOFOLLOW;
+	}
+#endif
+
+	const int fd = openat(parent == NULL ? AT_FDCWD : dirfd(parent), name, flags);
+	if(fd == -1)
+	{
+		return NULL;
+	}
+
+	DIR *const dir = fdopendir(fd);
+	if(dir == NULL)
+	{
+		(void)close(fd);
+	}
+	return dir;
+#else
+	(void)parent;
+	(void)name;
+	return os_opendir(path);
+#endif
+}
+
+/* Checks whether entry of the directory is a directory, but not a symbolic
+ * link to one.  Type of entry is usually available without querying file
+ * system.  Returns non-zero if so, otherwise zero is returned. */
+static int
+is_subdir(DIR *dir, const struct dirent *d, const char path[])
+{
+#ifdef FD_RELATIVE_WALK
+	struct stat st;
+	(void)path;
+
+#if defined(HAVE_STRUCT_DIRENT_D_TYPE) && HAVE_STRUCT_DIRENT_D_TYPE
+	if(d->d_type != DT_UNKNOWN)
+	{
+		return (d->d_type == DT_DIR);
+	}
+#endif
+	return fstatat(dirfd(dir), d->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0
+	    && S_ISDIR(st.st_mode);
+#else
+	(void)dir;
+	return !entry_is_link(path, d) && entry_is_dir(path, d);
+#endif
+}
+
+/* Initializes path buffer with path to the root of traversal.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+path_init(path_buf_t *path, const char root[])
+{
+	path->len = strlen(root);
+	path->capacity = MAX(path->len + 1U, 256U);
+	path->data = malloc(path->capacity);
+	if(path->data == NULL)
+	{
+		return 1;
+	}
+	memcpy(path->data, root, path->len + 1U);
+	return 0;
+}
+
+/* Appends name of an entry to the path.  Returns previous length of the path
+ * to be passed to path_pop() or (size_t)-1 on error. */
+static size_t
+path_push(path_buf_t *path, const char name[])
+{
+	const size_t old_len = path->len;
+	const int add_slash = (old_len == 0U || path->data[old_len - 1U] != '/');
+	const size_t name_len = strlen(name);
+	const size_t new_len = old_len + add_slash + name_len;
+
+	if(new_len + 1U > path->capacity)
+	{
+		const size_t capacity = MAX(new_len + 1U, path->capacity*2U);
+		char *const data = realloc(path->data, capacity);
+		if(data == NULL)
+		{
+			return (size_t)-1;
+		}
+		path->data = data;
+		path->capacity = capacity;
+	}
+
+	if(add_slash)
+	{
+		path->data[old_len] = '/';
+	}
+	memcpy(path->data + old_len + add_slash, name, name_len + 1U);
+	path->len = new_len;
+	return old_len;
+}
+
+/* Restores path to the state before corresponding path_push(). */
+static void
+path_pop(path_buf_t *path, size_t len)
+{
+	path->len = len;
+	path->data[len] = '\0';
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -47,6 +47,16 @@ typedef VisitResult (*subtree_visitor)(const char full_path[],
  * success, otherwise non-zero is returned. */
 int traverse(const char path[], subtree_visitor visitor, void *param);
 
+/* Same as traverse(), but visits files using nthreads additional threads while
+ * the calling thread walks directories.  VA_DIR_ENTER is visited before any of
+ * the directory's entries and VA_DIR_LEAVE after all of them, but the order of
+ * visiting entries is unspecified.  The visitor must be thread-safe for VA_FILE
+ * and VA_DIR_LEAVE actions.  Falls back to traverse() if nthreads is less than
+ * two or threads can't be created.  Returns zero on success, otherwise
+ * non-zero is returned. */
+int traverse_parallel(const char path[], subtree_visitor visitor, void *param,
+		int nthreads);
+
 #endif // VIFM__IO__PRIVATE__TRAVERSER_H__
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -49,7 +49,8 @@
 
 #include <errno.h> /* EACCES EEXIST EDQUOT ENOSPC ENXIO errno */
 #include <stddef.h> /* NULL size_t ssize_t */
-#include <stdio.h> /* FILE fclose() fdopen() fread() fwrite() */
+#include <stdio.h> /* FILE clearerr() fclose() fdopen() feof() fileno() fread()
+                      fwrite() */
 #include <stdlib.h> /* free() malloc() snprintf() */
 #include <string.h> /* strcmp() strcpy() strlen() */
 
@@ -129,6 +130,12 @@ struct ipc_t
 	char pipe_path[PATH_MAX + 1];
 	/* Opened file of the pipe. */
 	read_pipe_t pipe_file;
+#ifndef WIN32_PIPE_READ
+	/* Write end of our own pipe, which is kept open to not see end-of-file when
+	 * the last writer goes away.  Otherwise waiting for the pipe becoming
+	 * readable wouldn't block.  Can be -1. */
+	int write_fd;
+#endif
 	/* Holds result of expression evaluation or NULL on evaluation error. */
 	char *eval_result;
 };
@@ -194,6 +201,14 @@ ipc_init(const char name[], ipc_args_cb args_cb, ipc_eval_cb eval_cb)
 		return NULL;
 	}
 
+#ifndef WIN32_PIPE_READ
+	ipc->write_fd = open(ipc->pipe_path, O_WRONLY | O_NONBLOCK);
+	if(ipc->write_fd != -1)
+	{
+		(void)fcntl(ipc->write_fd, F_SETFD, FD_CLOEXEC);
+	}
+#endif
+
 	return ipc;
 }
 
@@ -206,6 +221,10 @@ ipc_free(ipc_t *ipc)
 	}
 
 #ifndef WIN32_PIPE_READ
+	if(ipc->write_fd != -1)
+	{
+		close(ipc->write_fd);
+	}
 	fclose(ipc->pipe_file);
 	unlink(ipc->pipe_path);
 #else
@@ -241,6 +260,20 @@ ipc_check(ipc_t *ipc)
 	return 0;
 }
 
+int
+ipc_get_fd(const ipc_t *ipc)
+{
+#ifndef WIN32_PIPE_READ
+	/* Messages aren't read while the instance is locked, so readiness of the
+	 * pipe isn't a reason to wake up. */
+	if(ipc != NULL && !ipc->locked && ipc->write_fd != -1)
+	{
+		return fileno(ipc->pipe_file);
+	}
+#endif
+	return -1;
+}
+
 /* Receives message addressed to this instance.  Returns NULL if there was no
  * message or on failure to read it, otherwise newly allocated string is
  * returned. */
@@ -254,7 +287,7 @@ receive_pkg(ipc_t *ipc, int *len)
 
 	fd_set ready;
 	int max_fd;
-	struct timeval ts = { .tv_sec = 0, .tv_usec = 10000 };
+	struct timeval ts;
 
 	/* At least on OS X pipe might get into EOF state, so reset it.  This will
 	 * also reset any errors, which is fine with us. */
@@ -274,23 +307,37 @@ receive_pkg(ipc_t *ipc, int *len)
 	}
 
 	max_fd = fileno(ipc->pipe_file);
-	FD_ZERO(&ready);
-	FD_SET(max_fd, &ready);
 
 	p = pkg;
-	while(size != 0U && select(max_fd + 1, &ready, NULL, NULL, &ts) > 0)
+	while(size != 0U)
 	{
-		const size_t nread = fread(p, 1U, size, ipc->pipe_file);
+		size_t nread;
+
+		/* The packet is likely to be buffered already, so read before waiting for
+		 * the descriptor, which doesn't account for buffered data. */
+		clearerr(ipc->pipe_file);
+		nread = fread(p, 1U, size, ipc->pipe_file);
 		size -= nread;
 		p += nread;
 
-		if(nread == 0U)
+		if(nread != 0U)
+		{
+			continue;
+		}
+
+		if(feof(ipc->pipe_file))
 		{
 			break;
 		}
 
+		FD_ZERO(&ready);
+		FD_SET(max_fd, &ready);
 		ts.tv_sec = 0;
 		ts.tv_usec = 10000;
+		if(select(max_fd + 1, &ready, NULL, NULL, &ts) <= 0)
+		{
+			break;
+		}
 	}
 
 	if(size != 0U)
@@ -939,6 +986,12 @@ ipc_check(ipc_t *ipc)
 	return 0;
 }
 
+int
+ipc_get_fd(const ipc_t *ipc)
+{
+	return -1;
+}
+
 int
 ipc_send(ipc_t *ipc, const char whom[], char *data[])
 {
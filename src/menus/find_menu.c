@@ -19,29 +19,64 @@
 
 #include "find_menu.h"
 
-#include <stdlib.h> /* free() */
-#include <string.h> /* strdup() */
+#include <stdint.h> /* int64_t */
+#include <stdlib.h> /* free() strtoll() */
+#include <string.h> /* strcmp() strdup() strlen() strncmp() */
+#include <time.h> /* time() time_t */
 
 #include "../cfg/config.h"
+#include "../compat/fs_limits.h"
+#include "../compat/reallocarray.h"
 #include "../modes/dialogs/msg_dialog.h"
 #include "../ui/statusbar.h"
 #include "../ui/ui.h"
+#include "../utils/finder.h"
 #include "../utils/macros.h"
+#include "../utils/matchers.h"
 #include "../utils/path.h"
 #include "../utils/str.h"
+#include "../utils/string_array.h"
+#include "../filelist.h"
 #include "../macros.h"
 #include "menus.h"
 
 #ifdef _WIN32
 #define DEFAULT_PREDICATE "-iname"
+#define CASE_SENSITIVE_BY_DEFAULT 0
 #else
 #define DEFAULT_PREDICATE "-name"
+#define CASE_SENSITIVE_BY_DEFAULT 1
 #endif
 
+/* State of built-in search which fills the menu. */
+typedef struct
+{
+	finder_t *finder;           /* Search in progress or NULL. */
+	finder_criteria_t criteria; /* Criteria of the search. */
+	matchers_t *matchers;       /* Patterns referenced by criteria or NULL. */
+	char *real_root;            /* Single absolute root or NULL. */
+	char *shown_root;           /* How real_root is displayed or NULL. */
+}
+search_t;
+
+static int run_builtin_find(view_t *view, int with_path, int argc,
+		char *argv[], menu_data_t *m);
+static int parse_args(view_t *view, int with_path, int argc, char *argv[],
+		char ***roots, int *nroots);
+static int parse_size(const char arg[]);
+static int parse_mtime(const char arg[]);
+static char ** get_roots(view_t *view, int *nroots);
+static int update_find_menu(menu_data_t *m);
+static void stop_find_menu(menu_data_t *m);
+static void reset_search(void);
 static int execute_find_cb(view_t *view, menu_data_t *m);
 
+/* Built-in search that fills the menu. */
+static search_t search;
+
 int
-show_find_menu(view_t *view, int with_path, const char args[])
+show_find_menu(view_t *view, int with_path, const char args[], int argc,
+		char *argv[])
 {
 	enum { M_s, M_a, M_A, M_p, M_u, M_U, };
 
@@ -105,6 +140,14 @@ show_find_menu(view_t *view, int with_path, const char args[])
 	m.execute_handler = &execute_find_cb;
 	m.key_handler = &menus_def_khandler;
 
+	if(cfg.find_prg[0] == '\0')
+	{
+		free(targets);
+		free(escaped_args);
+		free(custom_args);
+		return run_builtin_find(view, with_path, argc, argv, &m);
+	}
+
 	cmd = ma_expand_custom(cfg.find_prg, ARRAY_LEN(macros), macros);
 
 	free(targets);
@@ -119,6 +162,340 @@ show_find_menu(view_t *view, int with_path, const char args[])
 	return save_msg;
 }
 
+/* Searches for files without external tools filling the menu in the background
+ * after it's displayed.  Returns non-zero if status bar message should be
+ * saved. */
+static int
+run_builtin_find(view_t *view, int with_path, int argc, char *argv[],
+		menu_data_t *m)
+{
+	char **roots;
+	int nroots;
+
+	reset_search();
+	search.criteria = (finder_criteria_t){
+		.kind = FK_ANY,
+		.min_size = -1, .max_size = -1,
+		.min_mtime = -1, .max_mtime = -1,
+	};
+
+	if(parse_args(view, with_path, argc, argv, &roots, &nroots) != 0)
+	{
+		reset_search();
+		menus_reset_data(m);
+		return 1;
+	}
+
+	search.finder = finder_start(roots, nroots, &search.criteria,
+			cfg.io_threads);
+	free_string_array(roots, nroots);
+	if(search.finder == NULL)
+	{
+		reset_search();
+		show_error_msg("Find", "Failed to start search.");
+		menus_reset_data(m);
+		return 0;
+	}
+
+	m->update_handler = &update_find_menu;
+	m->stop_handler = &stop_find_menu;
+
+	/* Menu is displayed right away, even if it's empty, results arrive while
+	 * it's active and leaving the menu stops the search. */
+	(void)update_find_menu(m);
+	return menus_enter(m->state, view);
+}
+
+/* Parses arguments of built-in :find, which are a pattern and find-like
+ * predicates, into search.criteria.  Returns zero on success, otherwise
+ * non-zero is returned and error is displayed. */
+static int
+parse_args(view_t *view, int with_path, int argc, char *argv[], char ***roots,
+		int *nroots)
+{
+	const char *pattern = NULL;
+	const char *root = NULL;
+	int error = 0;
+	int i;
+
+	*roots = NULL;
+	*nroots = 0;
+
+	for(i = 0; i < argc && !error; ++i)
+	{
+		const char *const arg = argv[i];
+
+		if(with_path && root == NULL)
+		{
+			root = arg;
+			continue;
+		}
+
+		if(arg[0] != '-')
+		{
+			if(pattern != NULL)
+			{
+				show_error_msgf("Find", "Unexpected argument: %s", arg);
+				error = 1;
+			}
+			pattern = arg;
+			continue;
+		}
+
+		const char *const value = (i + 1 < argc) ? argv[++i] : NULL;
+		if(value == NULL)
+		{
+			show_error_msgf("Find", "Missing value of %s", arg);
+			error = 1;
+		}
+		else if(strcmp(arg, "-type") == 0 && strcmp(value, "f") == 0)
+		{
+			search.criteria.kind = FK_FILE;
+		}
+		else if(strcmp(arg, "-type") == 0 && strcmp(value, "d") == 0)
+		{
+			search.criteria.kind = FK_DIR;
+		}
+		else if(strcmp(arg, "-size") == 0 && parse_size(value) == 0)
+		{
+			/* Already parsed. */
+		}
+		else if(strcmp(arg, "-mtime") == 0 && parse_mtime(value) == 0)
+		{
+			/* Already parsed. */
+		}
+		else
+		{
+			show_error_msgf("Find", "Unsupported predicate: %s %s", arg, value);
+			error = 1;
+		}
+	}
+
+	if(!error && pattern != NULL)
+	{
+		char *err;
+		search.matchers = matchers_alloc(pattern, CASE_SENSITIVE_BY_DEFAULT, 1, "",
+				&err);
+		if(search.matchers == NULL)
+		{
+			show_error_msgf("Find", "Pattern error: %s", err);
+			free(err);
+			error = 1;
+		}
+		search.criteria.matchers = search.matchers;
+	}
+
+	if(!error && root != NULL)
+	{
+		char real_root[PATH_MAX + 1];
+		to_canonic_path(root, flist_get_dir(view), real_root, sizeof(real_root));
+		search.real_root = strdup(real_root);
+		search.shown_root = strdup(root);
+		*nroots = add_to_string_array(roots, 0, 1, real_root);
+	}
+	else if(!error)
+	{
+		*roots = get_roots(view, nroots);
+	}
+
+	return (error || *nroots == 0);
+}
+
+/* Parses find-like size specification ([+-]N[ckMG], bytes by default) into
+ * search.criteria.  Returns zero on success, otherwise non-zero is returned. */
+static int
+parse_size(const char arg[])
+{
+	char *end;
+	const char sign = (arg[0] == '+' || arg[0] == '-') ? arg[0] : '\0';
+	const int64_t n = strtoll(sign == '\0' ? arg : arg + 1, &end, 10);
+	int64_t unit;
+
+	switch(*end)
+	{
+		case '\0':
+		case 'c': unit = 1; break;
+		case 'k': unit = 1024; break;
+		case 'M': unit = 1024*1024; break;
+		case 'G': unit = 1024*1024*1024; break;
+
+		default:
+			return 1;
+	}
+
+	if(n < 0 || (*end != '\0' && end[1] != '\0'))
+	{
+		return 1;
+	}
+
+	/* Sizes are rounded up to units like find does. */
+	if(sign == '+')
+	{
+		search.criteria.min_size = n*unit + 1;
+	}
+	else if(sign == '-')
+	{
+		search.criteria.max_size = (n == 0 ? 0 : (n - 1)*unit);
+	}
+	else
+	{
+		search.criteria.min_size = (n == 0 ? 0 : (n - 1)*unit + 1);
+		search.criteria.max_size = n*unit;
+	}
+	return 0;
+}
+
+/* Parses find-like modification time specification ([+-]N in days) into
+ * search.criteria.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+parse_mtime(const char arg[])
+{
+	enum { DAY = 24*60*60 };
+
+	char *end;
+	const char sign = (arg[0] == '+' || arg[0] == '-') ? arg[0] : '\0';
+	const int64_t n = strtoll(sign == '\0' ? arg : arg + 1, &end, 10);
+	const time_t now = time(NULL);
+
+	if(n < 0 || *end != '\0')
+	{
+		return 1;
+	}
+
+	/* Age of a file is rounded down to days like find does. */
+	if(sign == '+')
+	{
+		search.criteria.max_mtime = now - (n + 1)*DAY;
+	}
+	else if(sign == '-')
+	{
+		search.criteria.min_mtime = now - n*DAY;
+	}
+	else
+	{
+		search.criteria.min_mtime = now - (n + 1)*DAY;
+		search.criteria.max_mtime = now - n*DAY;
+	}
+	return 0;
+}
+
+/* Lists roots of search, which are either selected files or directory of the
+ * view.  Returns the list of length *nroots. */
+static char **
+get_roots(view_t *view, int *nroots)
+{
+	char **roots = NULL;
+	dir_entry_t *entry = NULL;
+
+	*nroots = 0;
+
+	if(view->selected_files > 0)
+	{
+		while(iter_selected_entries(view, &entry))
+		{
+			char full_path[PATH_MAX + 1];
+			get_full_path_of(entry, sizeof(full_path), full_path);
+			*nroots = add_to_string_array(&roots, *nroots, 1, full_path);
+		}
+		return roots;
+	}
+
+	/* Paths are displayed relative to the directory like with external tool. */
+	search.real_root = strdup(flist_get_dir(view));
+	search.shown_root = strdup(".");
+	*nroots = add_to_string_array(&roots, 0, 1, flist_get_dir(view));
+	return roots;
+}
+
+/* Moves found paths into the menu.  Returns non-zero if menu has changed. */
+static int
+update_find_menu(menu_data_t *m)
+{
+	char **paths;
+	int i;
+
+	if(search.finder == NULL)
+	{
+		return 0;
+	}
+
+	const int done = finder_is_done(search.finder);
+	const int npaths = finder_take(search.finder, &paths);
+
+	char **const items = reallocarray(m->items, m->len + npaths,
+			sizeof(*m->items));
+	if(items != NULL)
+	{
+		m->items = items;
+	}
+
+	const size_t real_len = (search.real_root == NULL)
+	                      ? 0U
+	                      : strlen(search.real_root);
+	for(i = 0; i < npaths; ++i)
+	{
+		char *item = paths[i];
+		if(items != NULL && search.real_root != NULL &&
+				strncmp(item, search.real_root, real_len) == 0)
+		{
+			const int add_slash = ends_with_slash(search.real_root)
+			                   && !ends_with_slash(search.shown_root);
+			item = format_str("%s%s%s", search.shown_root, add_slash ? "/" : "",
+					paths[i] + real_len);
+			free(paths[i]);
+		}
+
+		if(items != NULL && item != NULL)
+		{
+			m->items[m->len++] = item;
+		}
+		else
+		{
+			free(item);
+		}
+	}
+	free(paths);
+
+	if(done)
+	{
+		/* Results that were taken above are the last ones. */
+		reset_search();
+		m->update_handler = NULL;
+		m->stop_handler = NULL;
+	}
+
+	return (npaths != 0);
+}
+
+/* Stops search that fills the menu. */
+static void
+stop_find_menu(menu_data_t *m)
+{
+	if(search.finder != NULL && !finder_is_done(search.finder))
+	{
+		char *const title = format_str("%s (cancelled)", m->title);
+		if(title != NULL)
+		{
+			free(m->title);
+			m->title = title;
+		}
+	}
+
+	reset_search();
+}
+
+/* Stops search if it's running and frees its resources. */
+static void
+reset_search(void)
+{
+	finder_free(search.finder);
+	matchers_free(search.matchers);
+	free(search.real_root);
+	free(search.shown_root);
+	search = (search_t){ .finder = NULL };
+}
+
 /* Callback that is called when menu item is selected.  Should return non-zero
  * to stay in menu mode. */
 static int
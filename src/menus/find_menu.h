@@ -22,8 +22,11 @@
 
 struct view_t;
 
-/* Returns non-zero if status bar message should be saved. */
-int show_find_menu(struct view_t *view, int with_path, const char args[]);
+/* External tool receives args as is, built-in search uses the same arguments
+ * split into argv array of argc elements.  Returns non-zero if status bar
+ * message should be saved. */
+int show_find_menu(struct view_t *view, int with_path, const char args[],
+		int argc, char *argv[]);
 
 #endif /* VIFM__MENUS__FIND_MENU_H__ */
 
@@ -19,21 +19,51 @@
 
 #include "grep_menu.h"
 
+#include <regex.h> /* REG_ICASE */
 #include <stdlib.h> /* free() */
-#include <string.h> /* strdup() */
+#include <string.h> /* strcspn() strdup() strlen() strncmp() strspn() */
 
 #include "../cfg/config.h"
+#include "../compat/fs_limits.h"
+#include "../compat/reallocarray.h"
 #include "../modes/dialogs/msg_dialog.h"
+#include "../ui/cancellation.h"
 #include "../ui/statusbar.h"
 #include "../ui/ui.h"
+#include "../utils/grepper.h"
 #include "../utils/macros.h"
 #include "../utils/path.h"
 #include "../utils/str.h"
+#include "../utils/string_array.h"
+#include "../filelist.h"
 #include "../macros.h"
 #include "menus.h"
 
+/* How often waiting for the first results checks for cancellation (in
+ * milliseconds). */
+#define WAIT_SLICE_MS 100
+
+/* State of built-in search which fills the menu. */
+typedef struct
+{
+	grepper_t *grepper; /* Search in progress or NULL. */
+	char *real_prefix;  /* Directory of the view with trailing slash or NULL. */
+	char *shown_prefix; /* What replaces real_prefix in menu items or NULL. */
+}
+search_t;
+
+static int run_builtin_grep(view_t *view, const char args[], int invert,
+		menu_data_t *m);
+static int parse_args(const char args[], grepper_criteria_t *criteria);
+static char ** get_roots(view_t *view, int *nroots);
+static int update_grep_menu(menu_data_t *m);
+static void stop_grep_menu(menu_data_t *m);
+static void reset_search(void);
 static int execute_grep_cb(view_t *view, menu_data_t *m);
 
+/* Built-in search that fills the menu. */
+static search_t search;
+
 int
 show_grep_menu(view_t *view, const char args[], int invert)
 {
@@ -56,6 +86,18 @@ show_grep_menu(view_t *view, const char args[], int invert)
 
 	static menu_data_t m;
 
+	if(cfg.grep_prg[0] == '\0')
+	{
+		menus_init_data(&m, view, format_str("Grep %s", args),
+				format_str("No matches found: %s", args));
+
+		m.stashable = 1;
+		m.execute_handler = &execute_grep_cb;
+		m.key_handler = &menus_def_khandler;
+
+		return run_builtin_grep(view, args, invert, &m);
+	}
+
 	targets = menus_get_targets(view);
 	if(targets == NULL)
 	{
@@ -93,6 +135,217 @@ show_grep_menu(view_t *view, const char args[], int invert)
 	return save_msg;
 }
 
+/* Searches in files without external tools filling the menu in the background
+ * after it's displayed.  Returns non-zero if status bar message should be
+ * saved. */
+static int
+run_builtin_grep(view_t *view, const char args[], int invert, menu_data_t *m)
+{
+	grepper_criteria_t criteria = { .invert = invert };
+	char **roots;
+	int nroots;
+	char *error = NULL;
+
+	reset_search();
+
+	if(parse_args(args, &criteria) != 0)
+	{
+		menus_reset_data(m);
+		return 1;
+	}
+
+	roots = get_roots(view, &nroots);
+	search.grepper = grepper_start(roots, nroots, &criteria, cfg.io_threads,
+			&error);
+	free_string_array(roots, nroots);
+	if(search.grepper == NULL)
+	{
+		reset_search();
+		show_error_msgf("Grep", "Failed to start search: %s",
+				(error == NULL) ? "unknown error" : error);
+		free(error);
+		menus_reset_data(m);
+		return 0;
+	}
+
+	m->update_handler = &update_grep_menu;
+	m->stop_handler = &stop_grep_menu;
+
+	/* Wait for something to show, the rest arrives while menu is displayed. */
+	ui_sb_msg("grep...");
+	ui_cancellation_reset();
+	ui_cancellation_enable();
+	while(!grepper_wait(search.grepper, WAIT_SLICE_MS))
+	{
+		if(ui_cancellation_requested())
+		{
+			grepper_cancel(search.grepper);
+			(void)replace_string(&m->empty_msg, "Search was cancelled");
+			break;
+		}
+	}
+	ui_cancellation_disable();
+
+	(void)update_grep_menu(m);
+	return menus_enter(m->state, view);
+}
+
+/* Parses arguments of built-in :grep, which are optional -i (ignore case) and
+ * -F (fixed string) flags followed by a pattern.  Returns zero on success,
+ * otherwise non-zero is returned and error is displayed. */
+static int
+parse_args(const char args[], grepper_criteria_t *criteria)
+{
+	criteria->cflags = 0;
+	criteria->fixed = 0;
+
+	while(args[0] == '-')
+	{
+		const size_t len = strcspn(args, " ");
+		if(len == 2U && strncmp(args, "--", len) == 0)
+		{
+			args += len;
+			args += strspn(args, " ");
+			break;
+		}
+
+		size_t i;
+		for(i = 1U; i < len; ++i)
+		{
+			switch(args[i])
+			{
+				case 'i': criteria->cflags |= REG_ICASE; break;
+				case 'F': criteria->fixed = 1; break;
+
+				default:
+					show_error_msgf("Grep", "Unsupported option: %.*s", (int)len, args);
+					return 1;
+			}
+		}
+
+		args += len;
+		args += strspn(args, " ");
+	}
+
+	criteria->pattern = args;
+	return 0;
+}
+
+/* Lists roots of search, which are either selected files or directory of the
+ * view.  Returns the list of length *nroots. */
+static char **
+get_roots(view_t *view, int *nroots)
+{
+	char **roots = NULL;
+	dir_entry_t *entry = NULL;
+
+	*nroots = 0;
+
+	/* Paths are displayed relative to the directory like with external tool. */
+	search.real_prefix = format_str("%s%s", flist_get_dir(view),
+			ends_with_slash(flist_get_dir(view)) ? "" : "/");
+
+	if(view->selected_files > 0)
+	{
+		search.shown_prefix = strdup("");
+		while(iter_selected_entries(view, &entry))
+		{
+			char full_path[PATH_MAX + 1];
+			get_full_path_of(entry, sizeof(full_path), full_path);
+			*nroots = add_to_string_array(&roots, *nroots, 1, full_path);
+		}
+		return roots;
+	}
+
+	search.shown_prefix = strdup("./");
+	*nroots = add_to_string_array(&roots, 0, 1, flist_get_dir(view));
+	return roots;
+}
+
+/* Moves found lines into the menu.  Returns non-zero if menu has changed. */
+static int
+update_grep_menu(menu_data_t *m)
+{
+	char **lines;
+	int i;
+
+	if(search.grepper == NULL)
+	{
+		return 0;
+	}
+
+	const int done = grepper_is_done(search.grepper);
+	const int nlines = grepper_take(search.grepper, &lines);
+
+	char **const items = reallocarray(m->items, m->len + nlines,
+			sizeof(*m->items));
+	if(items != NULL)
+	{
+		m->items = items;
+	}
+
+	const size_t prefix_len = (search.real_prefix == NULL)
+	                        ? 0U
+	                        : strlen(search.real_prefix);
+	for(i = 0; i < nlines; ++i)
+	{
+		char *item = lines[i];
+		if(items != NULL && prefix_len != 0U && search.shown_prefix != NULL &&
+				strncmp(item, search.real_prefix, prefix_len) == 0)
+		{
+			item = format_str("%s%s", search.shown_prefix, lines[i] + prefix_len);
+			free(lines[i]);
+		}
+
+		if(items != NULL && item != NULL)
+		{
+			m->items[m->len++] = item;
+		}
+		else
+		{
+			free(item);
+		}
+	}
+	free(lines);
+
+	if(done)
+	{
+		/* Results that were taken above are the last ones. */
+		reset_search();
+		m->update_handler = NULL;
+		m->stop_handler = NULL;
+	}
+
+	return (nlines != 0);
+}
+
+/* Stops search that fills the menu. */
+static void
+stop_grep_menu(menu_data_t *m)
+{
+	if(search.grepper != NULL && !grepper_is_done(search.grepper))
+	{
+		char *const title = format_str("%s (cancelled)", m->title);
+		if(title != NULL)
+		{
+			free(m->title);
+			m->title = title;
+		}
+	}
+
+	reset_search();
+}
+
+/* Stops search if it's running and frees its resources. */
+static void
+reset_search(void)
+{
+	grepper_free(search.grepper);
+	free(search.real_prefix);
+	free(search.shown_prefix);
+	search = (search_t){ .grepper = NULL };
+}
+
 /* Callback that is called when menu item is selected.  Should return non-zero
  * to stay in menu mode. */
 static int
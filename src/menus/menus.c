@@ -147,6 +147,11 @@ menus_remove_current(menu_state_t *ms)
 void
 menus_erase_current(menu_state_t *m)
 {
+	if(m->d->len == 0)
+	{
+		return;
+	}
+
 	draw_menu_item(m, m->d->pos, m->current, 1);
 }
 
@@ -175,6 +180,8 @@ menus_init_data(menu_data_t *m, view_t *view, char title[], char empty_msg[])
 	m->key_handler = NULL;
 	m->extra_data = 0;
 	m->execute_handler = NULL;
+	m->update_handler = NULL;
+	m->stop_handler = NULL;
 	m->empty_msg = empty_msg;
 	m->cwd = strdup(flist_get_dir(view));
 	m->state = &menu_state;
@@ -189,6 +196,13 @@ menus_reset_data(menu_data_t *m)
 		return;
 	}
 
+	if(m->stop_handler != NULL)
+	{
+		m->stop_handler(m);
+		m->stop_handler = NULL;
+	}
+	m->update_handler = NULL;
+
 	/* On releasing of non-empty stashable menu, but not the stash. */
 	if(m->stashable && m->len > 0 && m != &menu_data_stash)
 	{
@@ -222,6 +236,29 @@ menus_reset_data(menu_data_t *m)
 	reset_menu_state(m->state);
 }
 
+int
+menus_check_for_updates(void)
+{
+	menu_data_t *const m = menu_state.d;
+	if(m == NULL || !m->initialized || m->state == NULL ||
+			m->update_handler == NULL)
+	{
+		return 0;
+	}
+
+	if(!m->update_handler(m))
+	{
+		return 0;
+	}
+
+	/* Search results don't cover new items, drop them to have search redone on
+	 * its next repetition. */
+	free(menu_state.matches);
+	menu_state.matches = NULL;
+	menu_state.matching_entries = 0;
+	return 1;
+}
+
 /* Frees resources associated with menu mode.  ms can be NULL. */
 static void
 reset_menu_state(menu_state_t *ms)
@@ -650,7 +687,8 @@ expand_tabulation_a(const char line[], size_t tab_stops)
 int
 menus_enter(menu_state_t *m, view_t *view)
 {
-	if(m->d->len < 1)
+	/* Menu that's being filled in the background can be empty for a while. */
+	if(m->d->len < 1 && m->d->update_handler == NULL)
 	{
 		ui_sb_msg(m->d->empty_msg);
 		menus_reset_data(m->d);
@@ -774,7 +812,7 @@ menus_to_custom_view(menu_state_t *m, view_t *view, int very)
 			continue;
 		}
 
-		flist_custom_add(view, path);
+		flist_custom_add_deferred(view, path);
 
 		/* Use either exact position or the next path. */
 		if(i == m->d->pos || (current == NULL && i > m->d->pos))
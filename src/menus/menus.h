@@ -65,8 +65,19 @@ typedef struct menu_data_t
 	 * to stay in menu mode. */
 	int (*execute_handler)(struct view_t *view, struct menu_data_t *m);
 
-	/* Text displayed by menus_enter() function in case menu is empty, it can be
-	 * NULL if this cannot happen. */
+	/* Callback that appends items which became available since the last call
+	 * for menus that are filled in the background, can be NULL.  Called
+	 * periodically while the menu is active.  Should return non-zero if the menu
+	 * has changed. */
+	int (*update_handler)(struct menu_data_t *m);
+
+	/* Callback that stops filling the menu in the background, can be NULL.
+	 * Called once when the menu is released or stashed. */
+	void (*stop_handler)(struct menu_data_t *m);
+
+	/* Text displayed by menus_enter() function in case menu is empty or when
+	 * menu that is filled in the background ends up being empty, it can be NULL
+	 * if this cannot happen. */
 	char *empty_msg;
 
 	/* Base for relative paths for navigation. */
@@ -98,6 +109,10 @@ void menus_replace_data(menu_data_t *m);
 /* Frees resources associated with the menu and clears menu window. */
 void menus_reset_data(menu_data_t *m);
 
+/* Lets active menu that is filled in the background to add new items.  Returns
+ * non-zero if the menu has changed and needs to be redrawn. */
+int menus_check_for_updates(void);
+
 /* Menu entering/reentering and transformation. */
 
 /* Prepares menu, draws it and switches to the menu mode.  Returns non-zero if
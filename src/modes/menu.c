@@ -26,7 +26,7 @@
 #include <stddef.h> /* NULL wchar_t */
 #include <stdio.h> /* pclose() popen() */
 #include <stdlib.h> /* free() */
-#include <string.h> /* strerror() */
+#include <string.h> /* strdup() strerror() */
 
 #include "../cfg/config.h"
 #include "../compat/curses.h"
@@ -298,7 +298,8 @@ menu_enter_mode(menu_data_t *m, view_t *active_view)
 		return;
 	}
 
-	assert(m->len > 0 && "Menu cannot be empty.");
+	assert((m->len > 0 || m->update_handler != NULL) &&
+			"Menu cannot be empty.");
 
 	werase(status_bar);
 
@@ -315,13 +316,35 @@ void
 menu_reenter_mode(menu_data_t *m)
 {
 	assert(vle_mode_is(MENU_MODE) && "Can't reenter if not in menu mode.");
-	assert(m->len > 0 && "Menu cannot be empty.");
+	assert((m->len > 0 || m->update_handler != NULL) &&
+			"Menu cannot be empty.");
 
 	menus_replace_data(m);
 	menus_full_redraw(m->state);
 	menu = m;
 }
 
+int
+menu_check_for_updates(void)
+{
+	const int changed = menus_check_for_updates();
+
+	/* Menu that was entered before anything was found is closed if nothing was
+	 * found in the end. */
+	if(menu->len == 0 && menu->update_handler == NULL)
+	{
+		char *const msg = (menu->empty_msg == NULL) ? NULL
+		                                            : strdup(menu->empty_msg);
+		leave_menu_mode(0);
+		ui_sb_msg((msg == NULL) ? "" : msg);
+		curr_stats.save_msg = 1;
+		free(msg);
+		return 1;
+	}
+
+	return changed;
+}
+
 void
 menu_pre(void)
 {
@@ -461,6 +484,12 @@ cmd_return(key_info_t key_info, keys_info_t *keys_info)
 {
 	static menu_data_t *saved_menu;
 
+	/* There is nothing to pick until the first item arrives. */
+	if(menu->len == 0)
+	{
+		return;
+	}
+
 	vle_mode_set(NORMAL_MODE, VMT_PRIMARY);
 	saved_menu = menu;
 	if(menu->execute_handler != NULL && menu->execute_handler(view, menu))
@@ -723,7 +752,8 @@ pass_combination_to_khandler(const wchar_t keys[])
 {
 	KHandlerResponse handler_response;
 
-	if(menu->key_handler == NULL)
+	/* Menu-specific keys act on items. */
+	if(menu->key_handler == NULL || menu->len == 0)
 	{
 		return 0;
 	}
@@ -803,6 +833,11 @@ cmd_v(key_info_t key_info, keys_info_t *keys_info)
 	int i;
 	int qf = 1;
 
+	if(menu->len == 0)
+	{
+		return;
+	}
+
 	/* If both first and last lines do not contain colons, treat lines as list of
 	 * file names. */
 	if(strchr(menu->items[0], ':') == NULL &&
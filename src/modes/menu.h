@@ -35,6 +35,11 @@ void menu_enter_mode(menu_data_t *m, struct view_t *active_view);
 /* Replaces menu of the menu mode. */
 void menu_reenter_mode(menu_data_t *m);
 
+/* Lets menu that is filled in the background add new items, closes it if it
+ * ended up being empty.  Menu mode is assumed to be activated.  Returns
+ * non-zero if screen needs to be redrawn. */
+int menu_check_for_updates(void);
+
 /* Performs pre main loop actions for the menu mode, which is assumed to be
  * activated. */
 void menu_pre(void);
@@ -25,12 +25,14 @@
 
 #include "../engine/keys.h"
 #include "../engine/mode.h"
+#include "../ui/quickview.h"
 #include "../ui/statusbar.h"
 #include "../ui/statusline.h"
 #include "../ui/ui.h"
 #include "../utils/log.h"
 #include "../utils/macros.h"
 #include "../event_loop.h"
+#include "../menus/menus.h"
 #include "../status.h"
 #include "dialogs/attr_dialog.h"
 #include "dialogs/change_dialog.h"
@@ -139,6 +141,14 @@ modes_periodic(void)
 {
 	/* Trigger possible view updates. */
 	view_check_for_updates();
+
+	/* Start or finish generation of preview. */
+	qv_check_for_updates();
+
+	if(vle_mode_is(MENU_MODE) && menu_check_for_updates())
+	{
+		stats_redraw_schedule();
+	}
 }
 
 void
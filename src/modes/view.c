@@ -24,6 +24,7 @@
 #include <unistd.h> /* usleep() */
 
 #include <assert.h> /* assert() */
+#include <limits.h> /* INT_MAX */
 #include <stddef.h> /* ptrdiff_t size_t */
 #include <string.h> /* memset() strdup() */
 #include <stdio.h>  /* fclose() snprintf() */
@@ -33,7 +34,6 @@
 #include "../compat/curses.h"
 #include "../compat/fs_limits.h"
 #include "../compat/os.h"
-#include "../compat/reallocarray.h"
 #include "../engine/keys.h"
 #include "../engine/mode.h"
 #include "../int/vim.h"
@@ -48,6 +48,8 @@
 #include "../ui/ui.h"
 #include "../utils/filemon.h"
 #include "../utils/fs.h"
+#include "../utils/linemap.h"
+#include "../utils/linesearch.h"
 #include "../utils/macros.h"
 #include "../utils/path.h"
 #include "../utils/regexp.h"
@@ -72,16 +74,43 @@ enum
 	SILENT,   /* Do not display error message dialog. */
 };
 
+/* Special values of pending_jump field of view_info_t. */
+enum
+{
+	NO_JUMP = -1,     /* There is no pending jump. */
+	JUMP_TO_END = -2, /* Jump to the bottom of the view. */
+};
+
+/* Number of entries in the cache of line widths, should be more than number of
+ * lines that fit on the screen. */
+#define WIDTHS_CACHE_SIZE 256
+
+/* For how long to wait for indexing of lines before postponing a jump (in
+ * milliseconds). */
+#define INDEX_WAIT_MS 100
+
+/* For how long to wait for search to find a match before letting it finish in
+ * the background (in milliseconds). */
+#define SEARCH_WAIT_MS 100
+
+/* Entry of the cache of line widths. */
+typedef struct
+{
+	int line;  /* Real line number or -1 for an unused entry. */
+	int width; /* Screen width of the line. */
+}
+line_width_t;
+
 /* Describes view state and its properties. */
 struct view_info_t
 {
-	/* Data of the view. */
-	char **lines;     /* List of real lines. */
-	int (*widths)[2]; /* (virtual line, screen width) pair per real line. */
-	int nlines;       /* Number of real lines. */
-	int nlinesv;      /* Number of virtual (possibly wrapped) lines. */
+	/* Data of the view.  Only lines that are displayed are looked at. */
+	linemap_t *text;  /* Lines of the view. */
+	line_width_t widths[WIDTHS_CACHE_SIZE]; /* Cache of widths of real lines. */
 	int line;         /* Current real line number. */
-	int linev;        /* Current virtual line number. */
+	int part;         /* Current virtual line within the real line. */
+	int pending_jump; /* Jump to perform once all lines are indexed: percent of
+	                     lines, JUMP_TO_END or NO_JUMP. */
 
 	/* Dimensions, units of actions. */
 	int win_size; /* Scroll window size. */
@@ -94,8 +123,16 @@ struct view_info_t
 
 	/* Related to search. */
 	regex_t re;               /* Search regular expression. */
+	char *pattern;            /* Source of the search regular expression. */
 	int last_search_backward; /* Value -1 means no search was performed. */
 	int search_repeat;        /* Saved count prefix of search commands. */
+	linesearch_t *search;     /* Search for a match that is in progress. */
+	int search_from;          /* First line checked by the search. */
+	int search_backward;      /* Direction of the search in progress. */
+	int search_nth;           /* Number of matching line to look for. */
+	linesearch_t *count;      /* Counting of matching lines in progress. */
+	int count_base;           /* Matches above the lines being counted. */
+	int nmatches;             /* Number of matching lines or -1 if unknown. */
 
 	/* The rest of the state. */
 	view_t *view;    /* File view association with the view. */
@@ -122,8 +159,11 @@ static void init_view_info(view_info_t *vi);
 static void free_view_info(view_info_t *vi);
 static void redraw(void);
 static void calc_vlines(void);
-static void calc_vlines_wrapped(view_info_t *vi);
-static void calc_vlines_non_wrapped(view_info_t *vi);
+static void reset_widths(view_info_t *vi);
+static int get_line_height(view_info_t *vi, int line);
+static char * get_line(const view_info_t *vi, int line);
+static int move_by(view_info_t *vi, int *line, int *part, int n);
+static void clamp_to_bottom(view_info_t *vi, int *line, int *part);
 static void draw(void);
 static int get_part(const char line[], int offset, size_t max_len, char part[]);
 static void display_error(const char error_msg[]);
@@ -160,6 +200,7 @@ static void cmd_R(key_info_t key_info, keys_info_t *keys_info);
 static int load_view_data(view_info_t *vi, const char action[],
 		const char file_to_view[], int silent);
 static int get_view_data(view_info_t *vi, const char file_to_view[]);
+static int check_text(view_info_t *vi);
 static void replace_vi(view_info_t *orig, view_info_t *new);
 static void cmd_b(key_info_t key_info, keys_info_t *keys_info);
 static void cmd_d(key_info_t key_info, keys_info_t *keys_info);
@@ -172,8 +213,16 @@ static void cmd_k(key_info_t key_info, keys_info_t *keys_info);
 static void cmd_n(key_info_t key_info, keys_info_t *keys_info);
 static void goto_search_result(int repeat_count, int inverse_direction);
 static void search(int repeat_count, int backward);
-static void find_previous(int vline_offset);
-static void find_next(void);
+static int find_in_line(view_info_t *vi, int line, int first, int last,
+		int backward, int *n);
+static int count_matching_parts(view_info_t *vi, const char line[], int first,
+		int last, int limit, int *part);
+static void start_search(view_info_t *vi, int from, int backward, int nth);
+static int finish_search(view_info_t *vi);
+static void start_counting(view_info_t *vi, int from, int base);
+static int finish_counting(view_info_t *vi);
+static void get_search_criteria(const view_info_t *vi,
+		linesearch_criteria_t *criteria);
 static void cmd_q(key_info_t key_info, keys_info_t *keys_info);
 static void cmd_u(key_info_t key_info, keys_info_t *keys_info);
 static void update_with_half_win(key_info_t *key_info);
@@ -183,8 +232,16 @@ static void cmd_z(key_info_t key_info, keys_info_t *keys_info);
 static void update_with_win(key_info_t *key_info);
 static int is_trying_the_same_file(void);
 static int get_file_to_explore(const view_t *view, char buf[], size_t buf_len);
+static int is_auto_forwarding(const view_info_t *vi);
 static int forward_if_changed(view_info_t *vi);
+static int follow_appended(view_info_t *info);
+static int line_matches(view_info_t *vi, int line);
 static int scroll_to_bottom(view_info_t *vi);
+static int goto_percent(view_info_t *vi, int percent);
+static int ensure_indexed(view_info_t *vi, int jump);
+static int finish_pending_jump(view_info_t *vi);
+static int has_pending_jump(const view_info_t *vi);
+static int has_pending_search(const view_info_t *vi);
 static void reload_view(view_info_t *vi, int silent);
 static view_info_t * view_info_alloc(void);
 
@@ -422,8 +479,18 @@ view_pre(void)
 {
 	if(curr_stats.save_msg == 0)
 	{
+		char matches[64] = "";
+		if(vi->nmatches >= 0)
+		{
+			snprintf(matches, sizeof(matches), "(%d matching line%s)", vi->nmatches,
+					(vi->nmatches == 1) ? "" : "s");
+		}
+
 		const char *const suffix = vi->auto_forward ? "(auto forwarding)" : "";
-		ui_sb_msgf("-- VIEW -- %s", suffix);
+		const char *const sep = (suffix[0] != '\0' && matches[0] != '\0')
+		                      ? " "
+		                      : "";
+		ui_sb_msgf("-- VIEW -- %s%s%s", suffix, sep, matches);
 		curr_stats.save_msg = 2;
 	}
 }
@@ -438,8 +505,13 @@ view_post(void)
 void
 view_ruler_update(void)
 {
-	char buf[POS_WIN_MIN_WIDTH + 1];
-	snprintf(buf, sizeof(buf), "%d-%d ", vi->line + 1, vi->nlines);
+	/* Two numbers, separator, plus sign, space and terminating null. */
+	char buf[2*11 + 4];
+	int complete;
+	const int nlines = linemap_count(vi->text, &complete);
+	/* Plus sign means that there are more lines than were indexed so far. */
+	snprintf(buf, sizeof(buf), "%d-%d%s ", vi->line + 1, nlines,
+			complete ? "" : "+");
 
 	ui_ruler_set(buf);
 }
@@ -539,23 +611,27 @@ init_view_info(view_info_t *vi)
 	vi->width = -1;
 	vi->last_search_backward = -1;
 	vi->search_repeat = NO_COUNT_GIVEN;
-	vi->nlines = 0;
-	vi->lines = NULL;
-	vi->widths = NULL;
+	vi->nmatches = -1;
+	vi->pending_jump = NO_JUMP;
+	vi->text = NULL;
 	vi->filename = NULL;
 	vi->viewer = NULL;
+	reset_widths(vi);
 }
 
 /* Frees all resources allocated by view_info_t structure instance. */
 static void
 free_view_info(view_info_t *vi)
 {
-	free_string_array(vi->lines, vi->nlines);
-	free(vi->widths);
+	/* Searches refer to the text, so they are stopped first. */
+	linesearch_free(vi->search);
+	linesearch_free(vi->count);
+	linemap_free(vi->text);
 	if(vi->last_search_backward != -1)
 	{
 		regfree(&vi->re);
 	}
+	free(vi->pattern);
 	free(vi->filename);
 	free(vi->viewer);
 }
@@ -582,42 +658,119 @@ calc_vlines(void)
 	vi->width = ui_qv_width(vi->view);
 	vi->wrap = cfg.wrap_quick_view;
 
-	if(vi->wrap)
+	reset_widths(vi);
+	vi->part = MAX(0, MIN(vi->part, get_line_height(vi, vi->line) - 1));
+}
+
+/* Empties cache of line widths. */
+static void
+reset_widths(view_info_t *vi)
+{
+	int i;
+	for(i = 0; i < WIDTHS_CACHE_SIZE; ++i)
 	{
-		calc_vlines_wrapped(vi);
+		vi->widths[i].line = -1;
 	}
-	else
+}
+
+/* Computes number of virtual lines occupied by a real line.  Widths are
+ * calculated only for lines that are asked about.  Returns the number, which is
+ * zero for lines past the end. */
+static int
+get_line_height(view_info_t *vi, int line)
+{
+	const char *text;
+	size_t len;
+	if(vi->text == NULL || linemap_get(vi->text, line, &text, &len) != 0)
+	{
+		return 0;
+	}
+
+	if(!vi->wrap)
 	{
-		calc_vlines_non_wrapped(vi);
+		return 1;
 	}
+
+	line_width_t *const entry = &vi->widths[line%WIDTHS_CACHE_SIZE];
+	if(entry->line != line)
+	{
+		char *const copy = get_line(vi, line);
+		entry->line = line;
+		entry->width = (copy == NULL) ? 0
+		             : utf8_strsw_with_tabs(copy, cfg.tab_stop)
+		             - esc_str_overhead(copy);
+		free(copy);
+	}
+
+	return MAX(DIV_ROUND_UP(entry->width, vi->width), 1);
 }
 
-/* Recalculates virtual lines of a view with line wrapping. */
-static void
-calc_vlines_wrapped(view_info_t *vi)
+/* Retrieves copy of a real line.  Returns newly allocated string or NULL if
+ * there is no such line. */
+static char *
+get_line(const view_info_t *vi, int line)
 {
-	int i;
-	vi->nlinesv = 0;
-	for(i = 0; i < vi->nlines; i++)
+	return (vi->text == NULL ? NULL : linemap_dup(vi->text, line));
+}
+
+/* Moves position specified by real and virtual line by n virtual lines (up if
+ * n is negative) without going outside of the text.  Returns number of virtual
+ * lines passed. */
+static int
+move_by(view_info_t *vi, int *line, int *part, int n)
+{
+	int moved = 0;
+
+	while(n > 0)
 	{
-		vi->widths[i][0] = vi->nlinesv++;
-		vi->widths[i][1] = utf8_strsw_with_tabs(vi->lines[i], cfg.tab_stop) -
-			esc_str_overhead(vi->lines[i]);
-		vi->nlinesv += vi->widths[i][1]/vi->width;
+		if(*part + 1 < get_line_height(vi, *line))
+		{
+			++*part;
+		}
+		else if(get_line_height(vi, *line + 1) != 0)
+		{
+			++*line;
+			*part = 0;
+		}
+		else
+		{
+			break;
+		}
+		--n;
+		++moved;
+	}
+
+	while(n < 0)
+	{
+		if(*part > 0)
+		{
+			--*part;
+		}
+		else if(*line > 0)
+		{
+			--*line;
+			*part = get_line_height(vi, *line) - 1;
+		}
+		else
+		{
+			break;
+		}
+		++n;
+		++moved;
 	}
+
+	return moved;
 }
 
-/* Recalculates virtual lines of a view without line wrapping. */
+/* Moves position up if it's too close to the end of text to fill the whole
+ * window. */
 static void
-calc_vlines_non_wrapped(view_info_t *vi)
+clamp_to_bottom(view_info_t *vi, int *line, int *part)
 {
-	int i;
-	vi->nlinesv = vi->nlines;
-	for(i = 0; i < vi->nlines; i++)
-	{
-		vi->widths[i][0] = i;
-		vi->widths[i][1] = vi->width;
-	}
+	const int height = ui_qv_height(vi->view);
+	int l = *line, p = *part;
+	const int below = move_by(vi, &l, &p, height - 1);
+	(void)move_by(vi, line, part, -(height - 1 - below));
 }
 
 static void
@@ -627,7 +780,6 @@ draw(void)
 	const col_scheme_t *cs = ui_view_get_cs(vi->view);
 	const int height = ui_qv_height(vi->view);
 	const int width = ui_qv_width(vi->view);
-	const int max_l = MIN(vi->line + height, vi->nlines);
 	const int searched = (vi->last_search_backward != -1);
 	esc_state state;
 
@@ -637,14 +789,21 @@ draw(void)
 		cmd = (cmd != NULL) ? ma_get_clear_cmd(cmd) : NULL;
 		qv_cleanup(vi->view, cmd);
 
-		free_string_array(vi->lines, vi->nlines);
+		linemap_free(vi->text);
+		vi->text = NULL;
 		(void)get_view_data(vi, vi->filename);
 
 		if(vi->kind == VK_PASS_THROUGH)
 		{
-			strlist_t list = { .nitems = vi->nlines, .items = vi->lines };
+			strlist_t list = { .nitems = 0, .items = NULL };
+			char *line;
+			while((line = get_line(vi, list.nitems)) != NULL)
+			{
+				list.nitems = put_into_string_array(&list.items, list.nitems, line);
+			}
 			ui_pass_through(&list, vi->view->win, ui_qv_left(vi->view),
 					ui_qv_top(vi->view));
+			free_string_array(list.items, list.nitems);
 			return;
 		}
 
@@ -658,17 +817,21 @@ draw(void)
 	ui_view_erase(vi->view);
 	ui_drop_attr(vi->view->win);
 
-	for(vl = 0, l = vi->line; l < max_l && vl < height; ++l)
+	for(vl = 0, l = vi->line; vl < height; ++l)
 	{
 		int offset = 0;
 		int processed = 0;
-		char *const line = vi->lines[l];
+		char *const line = get_line(vi, l);
+		if(line == NULL)
+		{
+			break;
+		}
+
 		char *p = searched ? esc_highlight_pattern(line, &vi->re) : line;
 		do
 		{
 			int printed;
-			const int vis = l != vi->line
-			             || vl + processed >= vi->linev - vi->widths[vi->line][0];
+			const int vis = l != vi->line || processed >= vi->part;
 			offset += esc_print_line(p + offset, vi->view->win, ui_qv_left(vi->view),
 					ui_qv_top(vi->view) + vl, width, !vis, !vi->wrap, &state, &printed);
 			vl += vis;
@@ -679,6 +842,7 @@ draw(void)
 		{
 			free(p);
 		}
+		free(line);
 	}
 	refresh_view_win(vi->view);
 
@@ -705,6 +869,8 @@ view_find_pattern(const char pattern[], int backward)
 	}
 
 	vi->last_search_backward = backward;
+	(void)replace_string(&vi->pattern, pattern);
+	start_counting(vi, 0, 0);
 
 	search(vi->search_repeat, backward);
 
@@ -921,11 +1087,11 @@ cmd_percent(key_info_t key_info, keys_info_t *keys_info)
 	if(key_info.count > 100)
 		key_info.count = 100;
 
-	vi->line = (key_info.count*vi->nlinesv)/100;
-	if(vi->line >= vi->nlines)
-		vi->line = vi->nlines - 1;
-	vi->linev = vi->widths[vi->line][0];
-	draw();
+	if(ensure_indexed(vi, key_info.count))
+	{
+		(void)goto_percent(vi, key_info.count);
+		draw();
+	}
 }
 
 static void
@@ -1054,19 +1220,6 @@ load_view_data(view_info_t *vi, const char action[], const char file_to_view[],
 			return 1;
 	}
 
-	if(vi->nlines != 0)
-	{
-		vi->widths = reallocarray(NULL, vi->nlines, sizeof(*vi->widths));
-		if(vi->widths == NULL)
-		{
-			free_string_array(vi->lines, vi->nlines);
-			vi->lines = NULL;
-			vi->nlines = 0;
-			show_error_msg(action, "Not enough memory");
-			return 1;
-		}
-	}
-
 	return 0;
 }
 
@@ -1080,24 +1233,22 @@ get_view_data(view_info_t *vi, const char file_to_view[])
 
 	if(vi->viewer == NULL && is_null_or_empty(viewer))
 	{
-		if(is_dir(file_to_view))
+		if(!is_dir(file_to_view))
 		{
-			ui_cancellation_reset();
-			ui_cancellation_enable();
-			fp = qv_view_dir(file_to_view);
-			ui_cancellation_disable();
-		}
-		else
-		{
-			fp = os_fopen(file_to_view, "rb");
+			/* Files aren't read in full, lines are extracted when they are needed. */
+			vi->text = linemap_open(file_to_view);
+			return (vi->text == NULL) ? 2 : check_text(vi);
 		}
 
+		ui_cancellation_reset();
+		ui_cancellation_enable();
+		fp = qv_view_dir(file_to_view);
+		ui_cancellation_disable();
+
 		if(fp == NULL)
 		{
 			return 2;
 		}
-
-		vi->lines = read_file_lines(fp, &vi->nlines);
 	}
 	else
 	{
@@ -1144,27 +1295,45 @@ get_view_data(view_info_t *vi, const char file_to_view[])
 		}
 
 		vi->kind = kind;
-
-		ui_cancellation_reset();
-		ui_cancellation_enable();
-		vi->lines = read_stream_lines(fp, &vi->nlines, 0, NULL, NULL);
-		ui_cancellation_disable();
 	}
 
+	size_t len;
+	ui_cancellation_reset();
+	ui_cancellation_enable();
+	char *const text = read_nonseekable_stream(fp, &len, NULL, NULL);
+	ui_cancellation_disable();
+
 	fclose(fp);
 
-	if(vi->kind != VK_TEXTUAL && vi->nlines == 0)
+	if(text != NULL)
 	{
-		/* Exploring absent output gives error, add an empty line to allow empty
-		 * output for graphical previewers. */
-		vi->nlines = add_to_string_array(&vi->lines, vi->nlines, 1, "");
+		if(vi->kind != VK_TEXTUAL && len == 0U)
+		{
+			/* Exploring absent output gives error, add an empty line to allow empty
+			 * output for graphical previewers.  There is always room for it. */
+			text[len++] = '\n';
+		}
+		vi->text = linemap_from_buffer(text, len);
 	}
-	if(vi->lines == NULL || vi->nlines == 0)
+
+	return check_text(vi);
+}
+
+/* Checks whether there is anything to display.  Returns zero if so, otherwise
+ * frees the text and returns 4. */
+static int
+check_text(view_info_t *vi)
+{
+	const char *line;
+	size_t len;
+	if(vi->text != NULL && linemap_get(vi->text, 0, &line, &len) == 0)
 	{
-		return 4;
+		return 0;
 	}
 
-	return 0;
+	linemap_free(vi->text);
+	vi->text = NULL;
+	return 4;
 }
 
 /* Replaces view_info_t structure with another one preserving as much as
@@ -1183,16 +1352,38 @@ replace_vi(view_info_t *orig, view_info_t *new)
 		new->last_search_backward = orig->last_search_backward;
 		new->re = orig->re;
 		orig->last_search_backward = -1;
+
+		new->pattern = orig->pattern;
+		orig->pattern = NULL;
+		/* Matches need to be counted anew in the new text. */
+		start_counting(new, 0, 0);
+
+		if(orig->search != NULL)
+		{
+			start_search(new, orig->search_from, orig->search_backward,
+					orig->search_nth);
+		}
 	}
 
 	new->win_size = orig->win_size;
 	new->half_win = orig->half_win;
 	new->line = orig->line;
-	new->linev = orig->linev;
+	new->part = orig->part;
+	new->pending_jump = orig->pending_jump;
 	new->view = orig->view;
 	new->auto_forward = orig->auto_forward;
 	filemon_assign(&new->file_mon, &orig->file_mon);
 
+	const char *line;
+	size_t len;
+	if(linemap_get(new->text, new->line, &line, &len) != 0)
+	{
+		/* The text got shorter. */
+		int complete;
+		new->line = MAX(0, linemap_count(new->text, &complete) - 1);
+		new->part = 0;
+	}
+
 	free_view_info(orig);
 	*orig = *new;
 }
@@ -1234,67 +1425,50 @@ cmd_g(key_info_t key_info, keys_info_t *keys_info)
 	if(key_info.count == NO_COUNT_GIVEN)
 		key_info.count = 1;
 
-	key_info.count = MIN(vi->nlinesv - ui_qv_height(vi->view), key_info.count);
-	key_info.count = MAX(1, key_info.count);
+	int line = MAX(1, key_info.count) - 1;
+	int part = 0;
+	if(get_line_height(vi, line) == 0)
+	{
+		int complete;
+		line = MAX(0, linemap_count(vi->text, &complete) - 1);
+	}
+	clamp_to_bottom(vi, &line, &part);
 
-	if(vi->linev == vi->widths[key_info.count - 1][0])
+	if(line == vi->line && part == vi->part)
 		return;
-	vi->line = key_info.count - 1;
-	vi->linev = vi->widths[vi->line][0];
+	vi->line = line;
+	vi->part = part;
 	draw();
 }
 
 static void
 cmd_j(key_info_t key_info, keys_info_t *keys_info)
 {
-	if(key_info.reg == NO_REG_GIVEN)
-	{
-		if((vi->linev + 1) + ui_qv_height(vi->view) > vi->nlinesv)
-			return;
-	}
-	else
-	{
-		if(vi->linev + 1 > vi->nlinesv)
-			return;
-	}
-
 	if(key_info.count == NO_COUNT_GIVEN)
 		key_info.count = 1;
-	if(key_info.reg == NO_REG_GIVEN)
-		key_info.count = MIN(key_info.count,
-				vi->nlinesv - ui_qv_height(vi->view) - vi->linev);
-	else
-		key_info.count = MIN(key_info.count, vi->nlinesv - vi->linev - 1);
 
-	while(key_info.count-- > 0)
-	{
-		const int height = MAX(DIV_ROUND_UP(vi->widths[vi->line][1], vi->width), 1);
-		if(vi->linev + 1 >= vi->widths[vi->line][0] + height)
-			++vi->line;
+	/* Unless register is specified, the last page must remain full. */
+	const int extra = (key_info.reg == NO_REG_GIVEN)
+	                ? ui_qv_height(vi->view) - 1
+	                : 0;
 
-		++vi->linev;
-	}
+	int line = vi->line, part = vi->part;
+	const int room = move_by(vi, &line, &part, key_info.count + extra) - extra;
+	if(room <= 0)
+		return;
 
+	(void)move_by(vi, &vi->line, &vi->part, room);
 	draw();
 }
 
 static void
 cmd_k(key_info_t key_info, keys_info_t *keys_info)
 {
-	if(vi->linev == 0)
-		return;
-
 	if(key_info.count == NO_COUNT_GIVEN)
 		key_info.count = 1;
-	key_info.count = MIN(key_info.count, vi->linev);
 
-	while(key_info.count-- > 0)
-	{
-		if(vi->linev - 1 < vi->widths[vi->line][0])
-			--vi->line;
-
-		--vi->linev;
-	}
+	if(move_by(vi, &vi->line, &vi->part, -key_info.count) == 0)
+		return;
 
 	draw();
 }
@@ -1314,7 +1488,9 @@ goto_search_result(int repeat_count, int inverse_direction)
 	search(repeat_count, backward);
 }
 
-/* Performs search and navigation to the first match. */
+/* Performs search and navigation to the first match.  Matches within current
+ * line are handled right away, while the rest of the text is searched in the
+ * background. */
 static void
 search(int repeat_count, int backward)
 {
@@ -1328,104 +1504,178 @@ search(int repeat_count, int backward)
 		repeat_count = 1;
 	}
 
-	while(repeat_count-- > 0 && curr_stats.save_msg == 0)
+	linesearch_free(vi->search);
+	vi->search = NULL;
+
+	const int part = backward
+	               ? find_in_line(vi, vi->line, 0, vi->part - 1, 1, &repeat_count)
+	               : find_in_line(vi, vi->line, vi->part + 1,
+	                              get_line_height(vi, vi->line) - 1, 0,
+	                              &repeat_count);
+	if(part >= 0)
 	{
-		if(backward)
-		{
-			find_previous(1);
-		}
-		else
-		{
-			find_next();
-		}
+		vi->part = part;
+		draw();
+		return;
 	}
+
+	start_search(vi, vi->line + (backward ? -1 : 1), backward, repeat_count);
+	if(vi->search != NULL && !linesearch_wait(vi->search, SEARCH_WAIT_MS))
+	{
+		ui_sb_msg("Searching...");
+		curr_stats.save_msg = 1;
+		return;
+	}
+
+	(void)finish_search(vi);
+	draw();
 }
 
-static void
-find_previous(int vline_offset)
+/* Looks for matches among parts of a line in the [first, last] range going in
+ * the specified direction and decrementing *n on every match.  Returns the part
+ * at which *n reached zero or -1. */
+static int
+find_in_line(view_info_t *vi, int line, int first, int last, int backward,
+		int *n)
 {
-	int i;
-	int offset = 0;
-	char buf[ui_qv_width(vi->view)*4];
-	int vl, l;
+	if(first > last)
+	{
+		return -1;
+	}
 
-	vl = vi->linev - vline_offset;
-	l = vi->line;
+	char *const text = get_line(vi, line);
+	if(text == NULL)
+	{
+		return -1;
+	}
 
-	if(l > 0 && vl < vi->widths[l][0])
-		l--;
+	int part;
+	int count = count_matching_parts(vi, text, first, last,
+			backward ? INT_MAX : *n, &part);
+	if(backward && count >= *n)
+	{
+		/* Matches are enumerated from the top, so find the one to stop at. */
+		count = count_matching_parts(vi, text, first, last, count - *n + 1, &part);
+		count = *n;
+	}
+	free(text);
 
-	for(i = 0; i <= vl - vi->widths[l][0]; i++)
-		offset = get_part(vi->lines[l], offset, ui_qv_width(vi->view), buf);
+	*n -= count;
+	return (*n == 0) ? part : -1;
+}
 
-	/* Don't stop until we go above first virtual line of the first line. */
-	while(l >= 0 && vl >= 0)
+/* Counts parts of the line in the [first, last] range that match the last
+ * pattern stopping after limit matches.  *part is set to the last counted
+ * match.  Returns the count. */
+static int
+count_matching_parts(view_info_t *vi, const char line[], int first, int last,
+		int limit, int *part)
+{
+	const int width = ui_qv_width(vi->view);
+	char buf[width*4];
+	int offset = 0;
+	int count = 0;
+	int i;
+	for(i = 0; i <= last && count < limit; ++i)
 	{
-		if(regexec(&vi->re, buf, 0, NULL, 0) == 0)
-		{
-			vi->linev = vl;
-			vi->line = l;
-			break;
-		}
-		if(l > 0 && vl - 1 < vi->widths[l][0])
+		offset = get_part(line, offset, width, buf);
+		if(i >= first && regexec(&vi->re, buf, 0, NULL, 0) == 0)
 		{
-			l--;
-			offset = 0;
-			for(i = 0; i <= vl - 1 - vi->widths[l][0]; i++)
-				offset = get_part(vi->lines[l], offset, ui_qv_width(vi->view), buf);
+			*part = i;
+			++count;
 		}
-		else
-			offset = get_part(vi->lines[l], offset, ui_qv_width(vi->view), buf);
-		vl--;
-	}
-	draw();
-	if(vi->line != l)
-	{
-		display_error("Pattern not found");
 	}
+	return count;
 }
 
+/* Starts looking for nth matching line in the background.  Sets vi->search to
+ * NULL if there is nothing to search in. */
 static void
-find_next(void)
+start_search(view_info_t *vi, int from, int backward, int nth)
 {
-	int i;
-	int offset = 0;
-	char buf[ui_qv_width(vi->view)*4];
-	int vl, l;
-
-	vl = vi->linev + 1;
-	l = vi->line;
+	linesearch_criteria_t criteria;
+	get_search_criteria(vi, &criteria);
 
-	if(l < vi->nlines - 1 && vl == vi->widths[l + 1][0])
-		l++;
+	vi->search = (from < 0 || vi->text == NULL)
+	           ? NULL
+	           : linesearch_find(vi->text, &criteria, from, backward, nth);
+	vi->search_from = from;
+	vi->search_backward = backward;
+	vi->search_nth = nth;
+}
 
-	for(i = 0; i <= vl - vi->widths[l][0]; i++)
-		offset = get_part(vi->lines[l], offset, ui_qv_width(vi->view), buf);
+/* Moves position to the match found by the search or reports failure.  Doesn't
+ * redraw the view.  Returns non-zero if position was changed, otherwise zero is
+ * returned. */
+static int
+finish_search(view_info_t *vi)
+{
+	const int line = (vi->search == NULL) ? -1 : linesearch_result(vi->search);
+	linesearch_free(vi->search);
+	vi->search = NULL;
 
-	while(l < vi->nlines)
+	if(curr_stats.save_msg == 1)
 	{
-		if(regexec(&vi->re, buf, 0, NULL, 0) == 0)
-		{
-			vi->linev = vl;
-			vi->line = l;
-			break;
-		}
-		if(l < vi->nlines && (l == vi->nlines - 1 ||
-				vl + 1 >= vi->widths[l + 1][0]))
-		{
-			if(l == vi->nlines - 1)
-				break;
-			l++;
-			offset = 0;
-		}
-		offset = get_part(vi->lines[l], offset, ui_qv_width(vi->view), buf);
-		vl++;
+		/* Remove "Searching..." message. */
+		curr_stats.save_msg = 0;
 	}
-	draw();
-	if(vi->line != l)
+
+	if(line < 0)
 	{
 		display_error("Pattern not found");
+		return 0;
+	}
+
+	int n = 1;
+	const int part = find_in_line(vi, line, 0, get_line_height(vi, line) - 1,
+			vi->search_backward, &n);
+	vi->line = line;
+	vi->part = MAX(part, 0);
+	return 1;
+}
+
+/* Starts counting lines that match the last pattern in the background
+ * starting at line number from.  The base is the number of matches above it. */
+static void
+start_counting(view_info_t *vi, int from, int base)
+{
+	linesearch_free(vi->count);
+	vi->count = NULL;
+	vi->nmatches = -1;
+	vi->count_base = base;
+
+	if(vi->pattern != NULL && vi->text != NULL)
+	{
+		linesearch_criteria_t criteria;
+		get_search_criteria(vi, &criteria);
+		vi->count = linesearch_count(vi->text, &criteria, from);
+	}
+}
+
+/* Picks up number of matches once counting is over.  Returns non-zero if
+ * number of matches became known, otherwise zero is returned. */
+static int
+finish_counting(view_info_t *vi)
+{
+	if(vi == NULL || vi->count == NULL || !linesearch_wait(vi->count, 0))
+	{
+		return 0;
 	}
+
+	vi->nmatches = vi->count_base + linesearch_result(vi->count);
+	linesearch_free(vi->count);
+	vi->count = NULL;
+	return 1;
+}
+
+/* Fills in search criteria from the last pattern. */
+static void
+get_search_criteria(const view_info_t *vi, linesearch_criteria_t *criteria)
+{
+	criteria->pattern = vi->pattern;
+	criteria->cflags = get_regexp_cflags(vi->pattern);
+	/* Escape sequences aren't displayed and shouldn't be matched. */
+	criteria->prep = &esc_remove;
 }
 
 /* Extracts part of the line replacing all occurrences of horizontal tabulation
@@ -1616,10 +1866,56 @@ view_check_for_updates(void)
 	need_redraw += forward_if_changed(lwin.vi);
 	need_redraw += forward_if_changed(rwin.vi);
 
+	need_redraw += finish_pending_jump(curr_stats.preview.explore);
+	need_redraw += finish_pending_jump(lwin.vi);
+	need_redraw += finish_pending_jump(rwin.vi);
+
+	need_redraw += has_pending_search(curr_stats.preview.explore)
+	            && finish_search(curr_stats.preview.explore);
+	need_redraw += has_pending_search(lwin.vi) && finish_search(lwin.vi);
+	need_redraw += has_pending_search(rwin.vi) && finish_search(rwin.vi);
+
+	int counted = 0;
+	counted += finish_counting(curr_stats.preview.explore);
+	counted += finish_counting(lwin.vi);
+	counted += finish_counting(rwin.vi);
+
 	if(need_redraw)
 	{
 		stats_redraw_schedule();
 	}
+
+	/* Update mode line unless it's replaced by some other message. */
+	if(counted && curr_stats.save_msg == 2)
+	{
+		curr_stats.save_msg = 0;
+	}
+	if(curr_stats.save_msg == 0 && vle_mode_is(VIEW_MODE))
+	{
+		view_pre();
+	}
+}
+
+int
+view_needs_periodic_checks(void)
+{
+	return is_auto_forwarding(curr_stats.preview.explore)
+	    || is_auto_forwarding(lwin.vi)
+	    || is_auto_forwarding(rwin.vi)
+	    || has_pending_jump(curr_stats.preview.explore)
+	    || has_pending_jump(lwin.vi)
+	    || has_pending_jump(rwin.vi)
+	    || has_pending_search(curr_stats.preview.explore)
+	    || has_pending_search(lwin.vi)
+	    || has_pending_search(rwin.vi);
+}
+
+/* Checks whether the view follows changes of its file.  Returns non-zero if
+ * so, otherwise zero is returned. */
+static int
+is_auto_forwarding(const view_info_t *vi)
+{
+	return (vi != NULL && vi->auto_forward);
 }
 
 /* Forwards the view if underlying file changed.  Returns non-zero if reload
@@ -1629,7 +1925,7 @@ forward_if_changed(view_info_t *vi)
 {
 	filemon_t mon;
 
-	if(vi == NULL || !vi->auto_forward)
+	if(!is_auto_forwarding(vi))
 	{
 		return 0;
 	}
@@ -1644,9 +1940,95 @@ forward_if_changed(view_info_t *vi)
 		return 0;
 	}
 
+	/* Searches read the text, so it can't change until they are over. */
+	if(vi->search != NULL || vi->count != NULL)
+	{
+		return 0;
+	}
+
 	filemon_assign(&vi->file_mon, &mon);
+	if(follow_appended(vi) == 0)
+	{
+		return 0;
+	}
+
 	reload_view(vi, SILENT);
-	return scroll_to_bottom(vi);
+
+	/* The file was replaced or truncated, so its end is shown anew. */
+	vi->line = 0;
+	vi->part = 0;
+	(void)scroll_to_bottom(vi);
+	return 1;
+}
+
+/* Extends text of the view with data appended to its file, updates the number
+ * of matches by looking only at new lines and draws the view if its changed
+ * part is visible.  Returns zero on success and non-zero if the file needs to
+ * be reloaded (it was replaced, truncated or isn't a file). */
+static int
+follow_appended(view_info_t *info)
+{
+	/* Shrunk or replaced file is detected before anything reads the text. */
+	if(info->text == NULL || !linemap_is_intact(info->text, info->filename))
+	{
+		return 1;
+	}
+
+	int complete;
+	const int last = linemap_count(info->text, &complete) - 1;
+
+	/* Last line can get longer, so it's counted anew. */
+	const int base = (info->nmatches >= 0 && complete && last >= 0)
+	               ? info->nmatches - line_matches(info, last)
+	               : -1;
+
+	if(linemap_extend(info->text, info->filename) != 0)
+	{
+		return 1;
+	}
+
+	reset_widths(info);
+	if(base >= 0)
+	{
+		start_counting(info, last, base);
+	}
+	else
+	{
+		start_counting(info, 0, 0);
+	}
+
+	int line = info->line;
+	int part = info->part;
+	(void)move_by(info, &line, &part, ui_qv_height(info->view) - 1);
+	const int tail_visible = (line >= last);
+
+	if((scroll_to_bottom(info) || tail_visible) &&
+			ui_view_is_visible(info->view))
+	{
+		view_info_t *const saved_vi = vi;
+		vi = info;
+		draw();
+		if(vle_mode_is(VIEW_MODE))
+		{
+			view_ruler_update();
+		}
+		vi = saved_vi;
+	}
+	return 0;
+}
+
+/* Checks whether line matches the last pattern.  Returns non-zero if so,
+ * otherwise zero is returned. */
+static int
+line_matches(view_info_t *vi, int line)
+{
+	char *const text = get_line(vi, line);
+	char *const no_esc = (text == NULL) ? NULL : esc_remove(text);
+	const int matches = (no_esc != NULL
+	                  && regexec(&vi->re, no_esc, 0, NULL, 0) == 0);
+	free(no_esc);
+	free(text);
+	return matches;
 }
 
 /* Scrolls view to the bottom if there is any room for that.  Returns non-zero
@@ -1654,23 +2036,113 @@ forward_if_changed(view_info_t *vi)
 static int
 scroll_to_bottom(view_info_t *vi)
 {
-	if(vi->linev + 1 + ui_qv_height(vi->view) > vi->nlinesv)
+	if(!ensure_indexed(vi, JUMP_TO_END))
 	{
 		return 0;
 	}
 
-	vi->linev = vi->nlinesv - ui_qv_height(vi->view);
-	for(vi->line = 0; vi->line < vi->nlines - 1; ++vi->line)
+	int complete;
+	const int nlines = linemap_count(vi->text, &complete);
+	if(nlines == 0)
 	{
-		if(vi->linev < vi->widths[vi->line + 1][0])
-		{
-			break;
-		}
+		return 0;
+	}
+
+	int line = nlines - 1;
+	int part = get_line_height(vi, line) - 1;
+	(void)move_by(vi, &line, &part, -(ui_qv_height(vi->view) - 1));
+
+	if(line < vi->line || (line == vi->line && part <= vi->part))
+	{
+		return 0;
+	}
+
+	vi->line = line;
+	vi->part = part;
+	return 1;
+}
+
+/* Puts specified percent of lines above the view.  Assumes that all lines are
+ * indexed.  Returns non-zero if position was changed, otherwise zero is
+ * returned. */
+static int
+goto_percent(view_info_t *vi, int percent)
+{
+	int complete;
+	const int nlines = linemap_count(vi->text, &complete);
+
+	int line = (int)(((long long)percent*nlines)/100);
+	if(line >= nlines)
+	{
+		line = nlines - 1;
+	}
+
+	if(line == vi->line && vi->part == 0)
+	{
+		return 0;
 	}
 
+	vi->line = line;
+	vi->part = 0;
 	return 1;
 }
 
+/* Makes sure that all lines are indexed giving indexing some time to finish in
+ * the background.  Remembers the jump to perform it later if indexing takes
+ * longer.  Returns non-zero if lines are indexed, otherwise zero is
+ * returned. */
+static int
+ensure_indexed(view_info_t *vi, int jump)
+{
+	linemap_index_bg(vi->text);
+	if(linemap_wait(vi->text, INDEX_WAIT_MS))
+	{
+		vi->pending_jump = NO_JUMP;
+		return 1;
+	}
+
+	vi->pending_jump = jump;
+	return 0;
+}
+
+/* Performs jump that was waiting for indexing of lines if indexing is over.
+ * Returns non-zero if position was changed, otherwise zero is returned. */
+static int
+finish_pending_jump(view_info_t *vi)
+{
+	if(!has_pending_jump(vi))
+	{
+		return 0;
+	}
+
+	int complete;
+	(void)linemap_count(vi->text, &complete);
+	if(!complete)
+	{
+		return 0;
+	}
+
+	const int jump = vi->pending_jump;
+	vi->pending_jump = NO_JUMP;
+	return (jump == JUMP_TO_END) ? scroll_to_bottom(vi) : goto_percent(vi, jump);
+}
+
+/* Checks whether the view waits for indexing of lines to jump somewhere.
+ * Returns non-zero if so, otherwise zero is returned. */
+static int
+has_pending_jump(const view_info_t *vi)
+{
+	return (vi != NULL && vi->text != NULL && vi->pending_jump != NO_JUMP);
+}
+
+/* Checks whether the view has finished search which results weren't applied
+ * yet.  Returns non-zero if so, otherwise zero is returned. */
+static int
+has_pending_search(const view_info_t *vi)
+{
+	return (vi != NULL && vi->search != NULL && linesearch_wait(vi->search, 0));
+}
+
 /* Reloads contents of the specified view by rerunning corresponding viewer or
  * just rereading a file. */
 static void
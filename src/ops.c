@@ -949,6 +949,12 @@ exec_io_op(ops_t *ops, int (*func)(io_args_t *), io_args_t *args,
 			args->confirm = &confirm_overwrite;
 			args->result.errors_cb = &dispatch_error;
 		}
+		else
+		{
+			/* Operations in background don't interact with a user, so their files
+			 * can be processed in parallel. */
+			args->nthreads = cfg.io_threads;
+		}
 
 		ioe_errlst_init(&args->result.errors);
 	}
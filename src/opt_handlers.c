@@ -140,6 +140,7 @@ static void iec_handler(OPT_OP op, optval_t val);
 static void ignorecase_handler(OPT_OP op, optval_t val);
 static void incsearch_handler(OPT_OP op, optval_t val);
 static void iooptions_handler(OPT_OP op, optval_t val);
+static void iothreads_handler(OPT_OP op, optval_t val);
 static void laststatus_handler(OPT_OP op, optval_t val);
 static void lines_handler(OPT_OP op, optval_t val);
 static void locateprg_handler(OPT_OP op, optval_t val);
@@ -148,6 +149,7 @@ static void mediaprg_handler(OPT_OP op, optval_t val);
 #endif
 static void mintimeoutlen_handler(OPT_OP op, optval_t val);
 static void scroll_line_down(view_t *view);
+static void previewcache_handler(OPT_OP op, optval_t val);
 static void quickview_handler(OPT_OP op, optval_t val);
 static void rulerformat_handler(OPT_OP op, optval_t val);
 static void runexec_handler(OPT_OP op, optval_t val);
@@ -526,6 +528,7 @@ static const char *vifminfo_set[][2] = {
 	[BIT(VINFO_REGISTERS)] = { "registers", "contents of registers" },
 	[BIT(VINFO_PHISTORY)]  = { "phistory",  "prompt history" },
 	[BIT(VINFO_FHISTORY)]  = { "fhistory",  "local filter history" },
+	[BIT(VINFO_DIRSIZES)]  = { "dirsizes",  "sizes of directories" },
 };
 ARRAY_GUARD(vifminfo_set, NUM_VINFO);
 
@@ -670,6 +673,10 @@ options[] = {
 		NULL,
 	  { .init = &init_iooptions },
 	},
+	{ "iothreads", "", "number of threads for file queries",
+	  OPT_INT, 0, NULL, &iothreads_handler, NULL,
+	  { .ref.int_val = &cfg.io_threads },
+	},
 	{ "laststatus", "ls", "visibility of status bar",
 	  OPT_BOOL, 0, NULL, &laststatus_handler, NULL,
 	  { .ref.bool_val = &cfg.display_statusline },
@@ -692,6 +699,10 @@ options[] = {
 	  OPT_INT, 0, NULL, &mintimeoutlen_handler, NULL,
 	  { .ref.int_val = &cfg.min_timeout_len },
 	},
+	{ "previewcache", "", "memory for cached previews in KiB",
+	  OPT_INT, 0, NULL, &previewcache_handler, NULL,
+	  { .ref.int_val = &cfg.preview_cache_size },
+	},
 	{ "quickview", "", "whether quick view is active",
 	  OPT_BOOL, 0, NULL, &quickview_handler, NULL,
 	  { .init = &init_quickview },
@@ -2118,6 +2129,21 @@ iooptions_handler(OPT_OP op, optval_t val)
 	cfg.fast_file_cloning = ((val.set_items & 1) != 0);
 }
 
+/* Handles changes of 'iothreads'.  Makes sure the value is positive. */
+static void
+iothreads_handler(OPT_OP op, optval_t val)
+{
+	if(val.int_val <= 0)
+	{
+		vle_tb_append_linef(vle_err, "Argument must be > 0: %d", val.int_val);
+		error = 1;
+		vle_opts_restore_default("iothreads", OPT_GLOBAL);
+		return;
+	}
+
+	cfg.io_threads = val.int_val;
+}
+
 static void
 laststatus_handler(OPT_OP op, optval_t val)
 {
@@ -2216,6 +2242,21 @@ scroll_line_down(view_t *view)
 	wresize(view->win, view->window_rows, view->window_cols);
 }
 
+/* Handles changes of 'previewcache'.  Makes sure the value isn't negative. */
+static void
+previewcache_handler(OPT_OP op, optval_t val)
+{
+	if(val.int_val < 0)
+	{
+		vle_tb_append_linef(vle_err, "Argument must be >= 0: %d", val.int_val);
+		error = 1;
+		vle_opts_restore_default("previewcache", OPT_GLOBAL);
+		return;
+	}
+
+	cfg.preview_cache_size = val.int_val;
+}
+
 /* Handles switch that controls visibility of quick view. */
 static void
 quickview_handler(OPT_OP op, optval_t val)
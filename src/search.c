@@ -109,6 +109,9 @@ find_pattern(view_t *view, const char pattern[], int backward, int move,
 	int err;
 	view_t *other;
 
+	/* Files that aren't loaded yet can't be matched. */
+	flist_finish_reading(view);
+
 	if(move && cfg.hl_search)
 	{
 		flist_sel_stash(view);
@@ -48,6 +48,7 @@ static void _gnuc_noreturn shutdown_nicely(int sig, const char descr[]);
 #include <stdlib.h> /* EXIT_FAILURE _Exit() */
 
 #include "utils/macros.h"
+#include "utils/wakeup.h"
 #include "background.h"
 #include "status.h"
 
@@ -124,6 +125,9 @@ handle_signal(int sig)
 			break;
 	}
 
+	/* Make sure the main loop processes results of the signal. */
+	wakeup_notify();
+
 	errno = saved_errno;
 }
 
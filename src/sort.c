@@ -23,11 +23,12 @@
 
 #include <assert.h> /* assert() */
 #include <ctype.h>
-#include <stdlib.h> /* abs() */
-#include <string.h> /* strcmp() strrchr() */
+#include <stdlib.h> /* abs() free() malloc() */
+#include <string.h> /* memcmp() memcpy() strcmp() strdup() strrchr() */
 
 #include "cfg/config.h"
 #include "compat/fs_limits.h"
+#include "compat/reallocarray.h"
 #include "ui/ui.h"
 #include "utils/dynarray.h"
 #include "utils/fs.h"
@@ -35,7 +36,6 @@
 #include "utils/path.h"
 #include "utils/regexp.h"
 #include "utils/str.h"
-#include "utils/string_array.h"
 #include "utils/test_helpers.h"
 #include "utils/utils.h"
 #include "filelist.h"
@@ -43,13 +43,47 @@
 #include "status.h"
 #include "types.h"
 
+/* Single sorting key along with its data. */
+typedef struct
+{
+	SortingKey type;      /* Kind of the key. */
+	int descending;       /* Whether order of this key is reversed. */
+	const regex_t *regex; /* Regular expression for SK_BY_GROUPS or NULL. */
+	int group;            /* Index of the group for SK_BY_GROUPS. */
+}
+sort_key_t;
+
+/* Data of an entry which is computed once per sorting instead of on every
+ * comparison.  Entry's tag field is an index into an array of these. */
+typedef struct
+{
+	char *name;         /* Short path for custom views or NULL. */
+	char *iname;        /* Lower case version of the name or NULL. */
+	regmatch_t *groups; /* Matches of sorting groups or NULL. */
+}
+sort_rec_t;
+
 static void sort_tree_slice(dir_entry_t *entries, const dir_entry_t *children,
 		size_t nchildren, int root);
+static void find_positions(dir_entry_t list[], int count,
+		const dir_entry_t entries[], int nentries, int positions[]);
+static int find_pos(dir_entry_t list[], int count, const dir_entry_t *entry,
+		int lo);
 static void sort_sequence(dir_entry_t *entries, size_t nentries);
-static void sort_by_groups(dir_entry_t *entries, size_t nentries);
-static void sort_by_key(dir_entry_t *entries, size_t nentries, char key,
-		void *data);
+static int collect_keys(void);
+static int add_group_keys(void);
+static int update_groups_cache(view_t *v, const char groups[]);
+static int add_key(SortingKey type, int descending, const regex_t *regex,
+		int group);
+static void free_keys(void);
+static int make_recs(dir_entry_t *entries, size_t nentries);
+static int make_rec(sort_rec_t *rec, dir_entry_t *entry, int by_iname);
+static int remake_rec(dir_entry_t *entry, size_t index);
+static int need_iname(void);
+static void free_recs(size_t nentries);
 static int sort_dir_list(const void *one, const void *two);
+static int compare_by_key(const dir_entry_t *first, int first_is_dir,
+		const dir_entry_t *second, int second_is_dir, const sort_key_t *key);
 TSTATIC int strnumcmp(const char s[], const char t[]);
 #if !defined(HAVE_STRVERSCMP_FUNC) || !HAVE_STRVERSCMP_FUNC
 static int vercmp(const char s[], const char t[]);
@@ -58,13 +92,14 @@ static char * skip_leading_zeros(const char str[]);
 #endif
 static int compare_entry_names(const dir_entry_t *a, const dir_entry_t *b,
 		int ignore_case);
-static int compare_full_file_names(const char s[], const char t[],
-		int ignore_case);
-static int compare_file_names(const char s[], const char t[], int ignore_case);
+static int compare_extensions(const dir_entry_t *f, int fdir,
+		const dir_entry_t *s, int sdir, int dirs_first);
+static int compare_file_names(const char s[], const char t[]);
 static int compare_file_sizes(const dir_entry_t *f, const dir_entry_t *s);
 static int compare_item_count(const dir_entry_t *f, int fdir,
 		const dir_entry_t *s, int sdir);
-static int compare_group(const char f[], const char s[], regex_t *regex);
+static int compare_group(const dir_entry_t *f, const dir_entry_t *s,
+		int group);
 static int compare_targets(const dir_entry_t *f, const dir_entry_t *s);
 
 /* View which is being sorted. */
@@ -75,12 +110,16 @@ static const char *view_sort;
 static const char *view_sort_groups;
 /* Whether the view displays custom file list. */
 static int custom_view;
-/* Whether it's descending sort. */
-static int sort_descending;
-/* Key used to sort entries in current sorting round. */
-static SortingKey sort_type;
-/* Sorting key specific data. */
-static void *sort_data;
+/* Keys to sort by in order of decreasing priority. */
+static sort_key_t *sort_keys;
+/* Number of elements in sort_keys array. */
+static int nsort_keys;
+/* Number of SK_BY_GROUPS elements in sort_keys array. */
+static int ngroup_keys;
+/* Precomputed data of entries being sorted or NULL if not needed. */
+static sort_rec_t *sort_recs;
+/* Storage of group matches of all entries, referenced by sort_recs. */
+static regmatch_t *sort_matches;
 
 void
 sort_view(view_t *v)
@@ -191,12 +230,179 @@ sort_entries(view_t *v, entries_t entries)
 	sort_sequence(entries.entries, entries.nentries);
 }
 
-/* Sorts sequence of file entries (plain list, not tree). */
+int
+sort_view_insert(view_t *v, dir_entry_t entries[], int nentries)
+{
+	int i, j, k;
+	int *positions;
+	dir_entry_t *list;
+
+	if(nentries == 0)
+	{
+		return 0;
+	}
+
+	list = dynarray_extend(v->dir_entry, nentries*sizeof(*list));
+	if(list == NULL)
+	{
+		return 1;
+	}
+	v->dir_entry = list;
+
+	positions = reallocarray(NULL, nentries, sizeof(*positions));
+	if(positions == NULL)
+	{
+		return 1;
+	}
+
+	for(i = 0; i < nentries; ++i)
+	{
+		positions[i] = v->list_rows;
+	}
+
+	if(v->sort[0] <= SK_LAST)
+	{
+		view = v;
+		view_sort = v->sort;
+		view_sort_groups = v->sort_groups;
+		custom_view = flist_custom_active(v);
+
+		sort_sequence(entries, nentries);
+
+		if(collect_keys() == 0)
+		{
+			find_positions(list, v->list_rows, entries, nentries, positions);
+		}
+		free_keys();
+	}
+
+	/* Merge from the end to move each of the old entries at most once. */
+	i = v->list_rows - 1;
+	j = v->list_rows + nentries - 1;
+	k = nentries - 1;
+	while(k >= 0)
+	{
+		if(i >= positions[k])
+		{
+			list[j--] = list[i--];
+		}
+		else
+		{
+			list[j--] = entries[k--];
+		}
+	}
+
+	v->list_rows += nentries;
+	free(positions);
+	return 0;
+}
+
+/* Finds positions among first count entries of sorted list at which sorted
+ * entries should be inserted.  Expects sort_keys to be collected.  Leaves
+ * positions intact on memory error. */
+static void
+find_positions(dir_entry_t list[], int count, const dir_entry_t entries[],
+		int nentries, int positions[])
+{
+	int i;
+	int lo = 0;
+
+	/* Data of new entries is precomputed once, while the first slot is reused for
+	 * entries of the list, which puts them before new entries when they are
+	 * equal. */
+	dir_entry_t *const probes = reallocarray(NULL, nentries + 1,
+			sizeof(*probes));
+	if(probes == NULL)
+	{
+		return;
+	}
+	probes[0] = entries[0];
+	memcpy(&probes[1], entries, sizeof(*entries)*nentries);
+
+	if(make_recs(probes, nentries + 1) == 0)
+	{
+		/* Positions of sorted entries are non-decreasing, so each search can start
+		 * where the previous one ended. */
+		for(i = 0; i < nentries; ++i)
+		{
+			lo = find_pos(list, count, &probes[i + 1], lo);
+			positions[i] = lo;
+		}
+	}
+
+	free_recs(nentries + 1);
+	free(probes);
+}
+
+/* Finds position among first count entries of sorted list at which the entry
+ * should be inserted starting search at lo.  Expects data of the entry to be
+ * precomputed with the first slot of it available.  Returns the position. */
+static int
+find_pos(dir_entry_t list[], int count, const dir_entry_t *entry, int lo)
+{
+	int hi = count;
+
+	while(lo < hi)
+	{
+		int cmp;
+		const int mid = lo + (hi - lo)/2;
+		dir_entry_t probe = list[mid];
+
+		/* Only one entry of the list is compared at a time, so compute its data
+		 * on the fly instead of doing it for the whole list. */
+		if(remake_rec(&probe, 0U) != 0)
+		{
+			return count;
+		}
+
+		cmp = sort_dir_list(&probe, entry);
+
+		if(cmp < 0)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+/* Sorts sequence of file entries (plain list, not tree).  All keys are
+ * compared in a single pass, entry's tag field is used to make sorting stable.
+ * Does nothing on memory error. */
 static void
 sort_sequence(dir_entry_t *entries, size_t nentries)
 {
-	int i = SK_COUNT;
-	while(--i >= 0)
+	if(collect_keys() == 0 && make_recs(entries, nentries) == 0)
+	{
+		safe_qsort(entries, nentries, sizeof(*entries), &sort_dir_list);
+	}
+
+	free_recs(nentries);
+	free_keys();
+}
+
+/* Fills sort_keys array according to sorting options.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+collect_keys(void)
+{
+	int i;
+
+	/* Directories always go first unless they are explicitly placed among other
+	 * keys. */
+	if(!ui_view_sort_list_contains(view_sort, SK_BY_DIR))
+	{
+		if(add_key(SK_BY_DIR, 0, NULL, 0) != 0)
+		{
+			return 1;
+		}
+	}
+
+	for(i = 0; i < SK_COUNT; ++i)
 	{
 		const char sorting_key = view_sort[i];
 
@@ -207,66 +413,318 @@ sort_sequence(dir_entry_t *entries, size_t nentries)
 
 		if(sorting_key == SK_BY_GROUPS)
 		{
-			sort_by_groups(entries, nentries);
+			if(add_group_keys() != 0)
+			{
+				return 1;
+			}
 			continue;
 		}
 
-		sort_by_key(entries, nentries, sorting_key, NULL);
+		if(add_key(abs(sorting_key), sorting_key < 0, NULL, 0) != 0)
+		{
+			return 1;
+		}
 	}
 
-	if(!ui_view_sort_list_contains(view_sort, SK_BY_DIR))
+	return 0;
+}
+
+/* Adds a key per group of sorting groups option.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+add_group_keys(void)
+{
+	int i;
+
+	if(update_groups_cache(view, view_sort_groups) != 0)
+	{
+		return 1;
+	}
+
+	for(i = 0; i < view->sort_groups_re_count; ++i)
 	{
-		sort_by_key(entries, nentries, SK_BY_DIR, NULL);
+		const regex_t *const regex = &view->sort_groups_re[i];
+		if(add_key(SK_BY_GROUPS, 0, regex, ngroup_keys++) != 0)
+		{
+			return 1;
+		}
 	}
+
+	return 0;
 }
 
-/* Sorts specified range of entries according to sorting groups option. */
-static void
-sort_by_groups(dir_entry_t *entries, size_t nentries)
+/* Makes sure that cache of compiled sorting groups of the view corresponds to
+ * the value.  The cache is marked as valid only after all groups are compiled,
+ * so that a failed update is retried on the next sorting.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+update_groups_cache(view_t *v, const char groups[])
 {
-	char **groups = NULL;
-	int ngroups = 0;
-	const int optimize = (view_sort_groups != view->sort_groups_g);
-	int i;
+	if(v->sort_groups_re_src != NULL &&
+			strcmp(v->sort_groups_re_src, groups) == 0)
+	{
+		return 0;
+	}
+
+	sort_free_view_data(v);
+
+	char *const copy = strdup(groups);
+	if(copy == NULL)
+	{
+		return 1;
+	}
 
-	char *const copy = strdup(view_sort_groups);
+	int failed = 0;
 	char *group = copy, *state = NULL;
 	while((group = split_and_get(group, ',', &state)) != NULL)
 	{
-		ngroups = add_to_string_array(&groups, ngroups, 1, group);
+		regex_t *const regexes = reallocarray(v->sort_groups_re,
+				v->sort_groups_re_count + 1, sizeof(*regexes));
+		if(regexes == NULL)
+		{
+			failed = 1;
+			break;
+		}
+		v->sort_groups_re = regexes;
+
+		/* Option handler rejects invalid regular expressions, so this can fail
+		 * only due to lack of memory. */
+		if(regcomp(&regexes[v->sort_groups_re_count], group,
+					REG_EXTENDED | REG_ICASE) != 0)
+		{
+			failed = 1;
+			break;
+		}
+		++v->sort_groups_re_count;
 	}
 	free(copy);
 
-	for(i = ngroups - (optimize ? 1 : 0); i >= 1; --i)
+	if(!failed)
 	{
-		regex_t regex;
-		(void)regcomp(&regex, groups[i], REG_EXTENDED | REG_ICASE);
-		sort_by_key(entries, nentries, SK_BY_GROUPS, &regex);
-		regfree(&regex);
+		v->sort_groups_re_src = strdup(groups);
+		failed = (v->sort_groups_re_src == NULL);
 	}
-	if(optimize && ngroups != 0)
+
+	if(failed)
 	{
-		sort_by_key(entries, nentries, SK_BY_GROUPS, &view->primary_group);
+		sort_free_view_data(v);
+		return 1;
 	}
+	return 0;
+}
 
-	free_string_array(groups, ngroups);
+void
+sort_free_view_data(view_t *v)
+{
+	int i;
+	for(i = 0; i < v->sort_groups_re_count; ++i)
+	{
+		regfree(&v->sort_groups_re[i]);
+	}
+	free(v->sort_groups_re);
+	v->sort_groups_re = NULL;
+	v->sort_groups_re_count = 0;
+
+	update_string(&v->sort_groups_re_src, NULL);
+}
+
+/* Appends a key to sort_keys array.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+add_key(SortingKey type, int descending, const regex_t *regex, int group)
+{
+	sort_key_t *const keys = reallocarray(sort_keys, nsort_keys + 1,
+			sizeof(*keys));
+	if(keys == NULL)
+	{
+		return 1;
+	}
+
+	sort_keys = keys;
+	sort_keys[nsort_keys++] = (sort_key_t){
+		.type = type,
+		.descending = descending,
+		.regex = regex,
+		.group = group,
+	};
+	return 0;
 }
 
-/* Sorts specified range of entries by the key in a stable way. */
+/* Frees sort_keys array. */
 static void
-sort_by_key(dir_entry_t *entries, size_t nentries, char key, void *data)
+free_keys(void)
 {
-	sort_descending = (key < 0);
-	sort_type = (SortingKey)abs(key);
-	sort_data = data;
+	free(sort_keys);
+	sort_keys = NULL;
+	nsort_keys = 0;
+	ngroup_keys = 0;
+}
+
+/* Numbers entries and precomputes data used for comparing them by name or by
+ * groups if sort_keys need it.  Names of regular views are compared in place
+ * to avoid extra indirection.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+make_recs(dir_entry_t *entries, size_t nentries)
+{
+	size_t i;
+	int by_name = 0;
+	const int by_iname = need_iname();
 
-	unsigned int i;
 	for(i = 0U; i < nentries; ++i)
 	{
 		entries[i].tag = i;
 	}
 
-	safe_qsort(entries, nentries, sizeof(*entries), &sort_dir_list);
+	for(i = 0U; i < (size_t)nsort_keys; ++i)
+	{
+		by_name |= (sort_keys[i].type == SK_BY_NAME);
+	}
+	if(!by_iname && !(by_name && custom_view) && ngroup_keys == 0)
+	{
+		return 0;
+	}
+
+	sort_recs = reallocarray(NULL, nentries, sizeof(*sort_recs));
+	if(sort_recs == NULL)
+	{
+		return 1;
+	}
+
+	if(ngroup_keys != 0)
+	{
+		sort_matches = reallocarray(NULL, nentries*ngroup_keys,
+				sizeof(*sort_matches));
+		if(sort_matches == NULL)
+		{
+			free(sort_recs);
+			sort_recs = NULL;
+			return 1;
+		}
+	}
+
+	for(i = 0U; i < nentries; ++i)
+	{
+		sort_rec_t *const rec = &sort_recs[i];
+		rec->groups = (sort_matches == NULL) ? NULL
+		                                     : &sort_matches[i*ngroup_keys];
+
+		if(make_rec(rec, &entries[i], by_iname) != 0)
+		{
+			free_recs(i + 1U);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/* Precomputes data of a single entry.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+make_rec(sort_rec_t *rec, dir_entry_t *entry, int by_iname)
+{
+	int i;
+	const char *name = entry->name;
+
+	rec->name = NULL;
+	rec->iname = NULL;
+
+	if(custom_view)
+	{
+		char short_path[PATH_MAX + 1];
+		get_short_path_of(view, entry, NF_NONE, 0, sizeof(short_path),
+				short_path);
+		rec->name = strdup(short_path);
+		if(rec->name == NULL)
+		{
+			return 1;
+		}
+		name = rec->name;
+	}
+
+	if(by_iname)
+	{
+		char lower[PATH_MAX + 1];
+		/* Ignore too small buffer errors by not caring about part that didn't
+		 * fit. */
+		(void)str_to_lower(name, lower, sizeof(lower));
+		rec->iname = strdup(lower);
+		if(rec->iname == NULL)
+		{
+			return 1;
+		}
+	}
+
+	/* Matching is always done against file name even in custom views. */
+	for(i = 0; i < nsort_keys; ++i)
+	{
+		const sort_key_t *const key = &sort_keys[i];
+		if(key->type == SK_BY_GROUPS)
+		{
+			rec->groups[key->group] = get_group_match(key->regex, entry->name);
+		}
+	}
+
+	return 0;
+}
+
+/* Replaces data precomputed by make_recs() at specified index with data of the
+ * entry.  Returns zero on success, otherwise non-zero is returned. */
+static int
+remake_rec(dir_entry_t *entry, size_t index)
+{
+	sort_rec_t *rec;
+
+	entry->tag = index;
+	if(sort_recs == NULL)
+	{
+		return 0;
+	}
+
+	rec = &sort_recs[index];
+	free(rec->name);
+	free(rec->iname);
+	return make_rec(rec, entry, need_iname());
+}
+
+/* Checks whether sort_keys need lower case versions of names.  Returns
+ * non-zero if so, otherwise zero is returned. */
+static int
+need_iname(void)
+{
+	int i;
+	for(i = 0; i < nsort_keys; ++i)
+	{
+		if(sort_keys[i].type == SK_BY_INAME)
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* Frees data computed by make_recs() for the first nentries entries. */
+static void
+free_recs(size_t nentries)
+{
+	size_t i;
+
+	if(sort_recs == NULL)
+	{
+		return;
+	}
+
+	for(i = 0U; i < nentries; ++i)
+	{
+		free(sort_recs[i].name);
+		free(sort_recs[i].iname);
+	}
+
+	free(sort_recs);
+	sort_recs = NULL;
+	free(sort_matches);
+	sort_matches = NULL;
 }
 
 /* Compares file names containing numbers correctly. */
@@ -330,12 +788,12 @@ skip_leading_zeros(const char str[])
 }
 #endif
 
+/* qsort() comparer of entries that goes over all sorting keys.  Returns
+ * standard -1, 0, 1 for comparisons. */
 static int
 sort_dir_list(const void *one, const void *two)
 {
-	/* TODO: refactor this function sort_dir_list(). */
-
-	int retval;
+	int i;
 	const dir_entry_t *const first = one;
 	const dir_entry_t *const second = two;
 
@@ -351,22 +809,34 @@ sort_dir_list(const void *one, const void *two)
 		return 1;
 	}
 
-	retval = 0;
-	switch(sort_type)
+	for(i = 0; i < nsort_keys; ++i)
 	{
-		char *pfirst, *psecond;
+		const int retval = compare_by_key(first, first_is_dir, second,
+				second_is_dir, &sort_keys[i]);
+		if(retval != 0)
+		{
+			return sort_keys[i].descending ? -retval : retval;
+		}
+	}
+
+	return first->tag - second->tag;
+}
 
+/* Compares two entries by a single sorting key ignoring its direction.  Returns
+ * positive value if first is greater than second, zero if they are equal,
+ * otherwise negative value is returned. */
+static int
+compare_by_key(const dir_entry_t *first, int first_is_dir,
+		const dir_entry_t *second, int second_is_dir, const sort_key_t *key)
+{
+	int retval = 0;
+	const SortingKey sort_type = key->type;
+
+	switch(sort_type)
+	{
 		case SK_BY_NAME:
 		case SK_BY_INAME:
-			if(custom_view)
-			{
-				retval = compare_entry_names(first, second, sort_type == SK_BY_INAME);
-			}
-			else
-			{
-				retval = compare_full_file_names(first->name, second->name,
-						sort_type == SK_BY_INAME);
-			}
+			retval = compare_entry_names(first, second, sort_type == SK_BY_INAME);
 			break;
 
 		case SK_BY_DIR:
@@ -382,36 +852,8 @@ sort_dir_list(const void *one, const void *two)
 
 		case SK_BY_FILEEXT:
 		case SK_BY_EXTENSION:
-			pfirst = strrchr(first->name,  '.');
-			psecond = strrchr(second->name, '.');
-
-			if(first_is_dir && second_is_dir && sort_type == SK_BY_FILEEXT)
-			{
-				retval = compare_file_names(first->name, second->name, 0);
-			}
-			else if(first_is_dir != second_is_dir && sort_type == SK_BY_FILEEXT)
-			{
-				retval = first_is_dir ? -1 : 1;
-			}
-			else if(pfirst && psecond)
-			{
-				if(pfirst == first->name && psecond != second->name)
-				{
-					retval = -1;
-				}
-				else if(pfirst != first->name && psecond == second->name)
-				{
-					retval = 1;
-				}
-				else
-				{
-					retval = compare_file_names(++pfirst, ++psecond, 0);
-				}
-			}
-			else if(pfirst || psecond)
-				retval = pfirst ? -1 : 1;
-			else
-				retval = compare_file_names(first->name, second->name, 0);
+			retval = compare_extensions(first, first_is_dir, second, second_is_dir,
+					sort_type == SK_BY_FILEEXT);
 			break;
 
 		case SK_BY_SIZE:
@@ -423,7 +865,7 @@ sort_dir_list(const void *one, const void *two)
 			break;
 
 		case SK_BY_GROUPS:
-			retval = compare_group(first->name, second->name, sort_data);
+			retval = compare_group(first, second, key->group);
 			break;
 
 		case SK_BY_TARGET:
@@ -476,16 +918,43 @@ sort_dir_list(const void *one, const void *two)
 #endif
 	}
 
-	if(retval == 0)
+	return retval;
+}
+
+/* Compares extensions of two entries, treating dot files as having no
+ * extension.  With dirs_first directories precede files and are compared by
+ * names.  Returns positive value if f is greater than s, zero if they are
+ * equal, otherwise negative value is returned. */
+static int
+compare_extensions(const dir_entry_t *f, int fdir, const dir_entry_t *s,
+		int sdir, int dirs_first)
+{
+	if(dirs_first && fdir != sdir)
 	{
-		retval = first->tag - second->tag;
+		return fdir ? -1 : 1;
 	}
-	else if(sort_descending)
+	if(dirs_first && fdir)
 	{
-		retval = -retval;
+		return compare_file_names(f->name, s->name);
 	}
 
-	return retval;
+	const char *const fext = strrchr(f->name, '.');
+	const char *const sext = strrchr(s->name, '.');
+
+	if(fext == NULL || sext == NULL)
+	{
+		if(fext != sext)
+		{
+			return (fext != NULL) ? -1 : 1;
+		}
+		return compare_file_names(f->name, s->name);
+	}
+
+	if((fext == f->name) != (sext == s->name))
+	{
+		return (fext == f->name) ? -1 : 1;
+	}
+	return compare_file_names(fext + 1, sext + 1);
 }
 
 /* Compares two file sizes.  Returns standard -1, 0, 1 for comparisons. */
@@ -511,21 +980,24 @@ compare_item_count(const dir_entry_t *f, int fdir, const dir_entry_t *s,
 	return (fsize > ssize) ? 1 : (fsize < ssize) ? -1 : 0;
 }
 
-/* Compares two file names according to grouping regular expression.  Returns
- * standard -1, 0, 1 for comparisons. */
+/* Compares parts of two file names matched by a grouping regular expression
+ * using matches precomputed by make_recs().  Returns standard -1, 0, 1 for
+ * comparisons. */
 static int
-compare_group(const char f[], const char s[], regex_t *regex)
+compare_group(const dir_entry_t *f, const dir_entry_t *s, int group)
 {
-	char fname[NAME_MAX + 1], sname[NAME_MAX + 1];
-	regmatch_t fmatch = get_group_match(regex, f);
-	regmatch_t smatch = get_group_match(regex, s);
-
-	copy_str(fname, MIN(sizeof(fname), fmatch.rm_eo - fmatch.rm_so + 1U),
-			f + fmatch.rm_so);
-	copy_str(sname, MIN(sizeof(sname), smatch.rm_eo - smatch.rm_so + 1U),
-			s + smatch.rm_so);
-
-	return strcmp(fname, sname);
+	const regmatch_t *const fmatch = &sort_recs[f->tag].groups[group];
+	const regmatch_t *const smatch = &sort_recs[s->tag].groups[group];
+	const size_t flen = fmatch->rm_eo - fmatch->rm_so;
+	const size_t slen = smatch->rm_eo - smatch->rm_so;
+
+	const int result = memcmp(f->name + fmatch->rm_so, s->name + smatch->rm_so,
+			MIN(flen, slen));
+	if(result != 0)
+	{
+		return (result > 0) - (result < 0);
+	}
+	return (flen > slen) - (flen < slen);
 }
 
 /* Compares two file names according to symbolic link target.  Returns standard
@@ -563,72 +1035,51 @@ compare_targets(const dir_entry_t *f, const dir_entry_t *s)
 	return stroscmp(nlink, plink);
 }
 
-/* Compares names of two file entries.  Returns positive value if a is greater
- * than b, zero if they are equal, otherwise negative value is returned. */
+/* Compares names of two file entries using data precomputed by make_recs()
+ * (if any) and assuming that dot character is smaller than any other
+ * character.  Returns positive value if a is greater than b, zero if they are
+ * equal, otherwise negative value is returned. */
 static int
 compare_entry_names(const dir_entry_t *a, const dir_entry_t *b, int ignore_case)
 {
-	char a_short_path[PATH_MAX + 1];
-	char b_short_path[PATH_MAX + 1];
-
-	get_short_path_of(view, a, NF_NONE, 0, sizeof(a_short_path), a_short_path);
-	get_short_path_of(view, b, NF_NONE, 0, sizeof(b_short_path), b_short_path);
-
-	return compare_full_file_names(a_short_path, b_short_path, ignore_case);
-}
+	const char *const a_name = custom_view ? sort_recs[a->tag].name : a->name;
+	const char *const b_name = custom_view ? sort_recs[b->tag].name : b->name;
+	int result;
 
-/* Compares two full filenames and assumes that dot character is smaller than
- * any other character.  Returns positive value if s is greater than t, zero if
- * they are equal, otherwise negative value is returned. */
-static int
-compare_full_file_names(const char s[], const char t[], int ignore_case)
-{
-	if(s[0] == '.' && t[0] != '.')
+	if(a_name[0] == '.' && b_name[0] != '.')
 	{
 		return -1;
 	}
-	else if(s[0] != '.' && t[0] == '.')
+	if(a_name[0] != '.' && b_name[0] == '.')
 	{
 		return 1;
 	}
-	else
-	{
-		return compare_file_names(s, t, ignore_case);
-	}
-}
 
-/* Compares two file names or their parts (e.g. extensions).  Returns positive
- * value if s is greater than t, zero if they are equal, otherwise negative
- * value is returned. */
-static int
-compare_file_names(const char s[], const char t[], int ignore_case)
-{
-	const char *s_val = s, *t_val = t;
-	char s_buf[NAME_MAX + 1];
-	char t_buf[NAME_MAX + 1];
-	int result;
-
-	if(ignore_case)
+	if(!ignore_case)
 	{
-		/* Ignore too small buffer errors by not caring about part that didn't
-		 * fit. */
-		(void)str_to_lower(s, s_buf, sizeof(s_buf));
-		(void)str_to_lower(t, t_buf, sizeof(t_buf));
-
-		s_val = s_buf;
-		t_val = t_buf;
+		return compare_file_names(a_name, b_name);
 	}
 
-	result = cfg.sort_numbers ? strnumcmp(s_val, t_val) : strcmp(s_val, t_val);
-	if(result == 0 && ignore_case)
+	result = compare_file_names(sort_recs[a->tag].iname,
+			sort_recs[b->tag].iname);
+	if(result == 0)
 	{
 		/* Resort to comparing original names when their normalized versions match
 		 * to always solve ties in deterministic way. */
-		result = strcmp(s, t);
+		result = strcmp(a_name, b_name);
 	}
 	return result;
 }
 
+/* Compares two file names or their parts (e.g. extensions).  Returns positive
+ * value if s is greater than t, zero if they are equal, otherwise negative
+ * value is returned. */
+static int
+compare_file_names(const char s[], const char t[])
+{
+	return cfg.sort_numbers ? strnumcmp(s, t) : strcmp(s, t);
+}
+
 SortingKey
 get_secondary_key(SortingKey primary_key)
 {
@@ -29,6 +29,15 @@ void sort_view(view_t *view);
 /* Sorts specified entries using global settings of the view. */
 void sort_entries(view_t *view, entries_t entries);
 
+/* Inserts entries into sorted flat list of the view at positions that keep it
+ * sorted.  The list takes ownership of the entries, but the array itself is
+ * reordered and left to the caller.  Returns zero on success, otherwise
+ * non-zero is returned and the list isn't changed. */
+int sort_view_insert(view_t *view, dir_entry_t entries[], int nentries);
+
+/* Frees data cached by sorting functions in the view. */
+void sort_free_view_data(view_t *view);
+
 /* Maps primary sort key to second column type.  Returns secondary key that
  * corresponds to the primary one. */
 SortingKey get_secondary_key(SortingKey primary_key);
@@ -29,23 +29,29 @@
 #include <assert.h> /* assert() */
 #include <limits.h> /* INT_MIN */
 #include <stddef.h> /* NULL */
+#include <stdio.h> /* snprintf() */
+#include <stdlib.h> /* calloc() free() malloc() */
 #include <string.h>
 #include <time.h> /* time_t time() */
 
 #include "cfg/config.h"
 #include "compat/fs_limits.h"
+#include "compat/os.h"
 #include "compat/pthread.h"
 #include "compat/reallocarray.h"
 #include "modes/modes.h"
 #include "ui/colors.h"
 #include "ui/ui.h"
 #include "utils/env.h"
+#include "utils/fcache.h"
 #include "utils/fsdata.h"
 #include "utils/log.h"
 #include "utils/macros.h"
 #include "utils/path.h"
 #include "utils/str.h"
+#include "utils/trie.h"
 #include "utils/utils.h"
+#include "utils/wakeup.h"
 #include "cmd_completion.h"
 #include "cmd_core.h"
 #include "filelist.h"
@@ -57,6 +63,16 @@
 #define SCREEN_ENVVAR "STY"
 #define TMUX_ENVVAR "TMUX"
 
+/* Number of seconds during which resolved path of a directory is reused. */
+#define RESOLVED_DIR_TTL 1
+
+/* Maximum number of resolved directories to remember. */
+#define MAX_RESOLVED_DIRS 64
+
+/* Maximum number of directories whose information is stored between
+ * sessions. */
+#define MAX_STORED_DIRS 200000
+
 /* dcache entry. */
 typedef struct
 {
@@ -65,13 +81,31 @@ typedef struct
 }
 dcache_data_t;
 
+/* Entry of cache of resolved directories. */
+typedef struct
+{
+	time_t timestamp; /* When the path was resolved. */
+	char path[];      /* Resolved path. */
+}
+resolved_dir_t;
+
 static void load_def_values(status_t *stats, config_t *config);
 static void determine_fuse_umount_cmd(status_t *stats);
 static void set_gtk_available(status_t *stats);
 static int reset_dircache(void);
 static void set_last_cmdline_command(const char cmd[]);
 static void save_into_history(const char item[], hist_t *hist, int len);
+static int get_real_path_of(const dir_entry_t *entry, char real_path[]);
+static int resolve_dir(const char path[], char real_path[]);
+static int resolve_path(const char path[], char real_path[]);
 static void size_updater(void *data, void *arg);
+static void fetch_stored(const char real_path[]);
+static void update_stored(const char real_path[], uint64_t size,
+		uint64_t nitems);
+static void update_stored_sizes(const dcache_size_t sizes[], int count);
+static void update_stored_parents(const char real_path[], uint64_t by);
+static int dstore_enabled(void);
+static fcache_t * get_dstore(void);
 
 status_t curr_stats;
 
@@ -79,15 +113,28 @@ static int pending_redraw;
 static int inside_screen;
 static int inside_tmux;
 
-/* Thread-safety guard for dcache_size variable. */
-static pthread_mutex_t dcache_size_mutex = PTHREAD_MUTEX_INITIALIZER;
-/* Thread-safety guard for dcache_nitems variable. */
-static pthread_mutex_t dcache_nitems_mutex = PTHREAD_MUTEX_INITIALIZER;
-/* Cache for directory sizes. */
+/* Thread-safety guard for dcache_size and dcache_nitems variables.  Lookups,
+ * which happen on every sorting and redraw, don't exclude each other. */
+static pthread_rwlock_t dcache_lock = PTHREAD_RWLOCK_INITIALIZER;
+/* Cache for directory sizes (keys are resolved paths). */
 static fsdata_t *dcache_size;
-/* Cache for directory item count. */
+/* Cache for directory item count (keys are resolved paths). */
 static fsdata_t *dcache_nitems;
 
+/* Thread-safety guard for resolved_dirs and nresolved_dirs variables. */
+static pthread_mutex_t resolved_dirs_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* Maps directories of file list entries onto resolved_dir_t to avoid resolving
+ * the same directory for each of its entries. */
+static trie_t *resolved_dirs;
+/* Number of elements in resolved_dirs. */
+static int nresolved_dirs;
+
+/* Thread-safety guard for dstore variable. */
+static pthread_mutex_t dstore_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* Persistent storage of dcache, which is loaded on first use.  Keys are made
+ * from state of directories, so changed directories don't match. */
+static fcache_t *dstore;
+
 /* Whether UI updates should be "paused" (a counter, not a flag). */
 static int silent_ui;
 /* Whether silencing UI led to skipping of screen updates. */
@@ -242,19 +289,41 @@ stats_reset(const config_t *config)
 static int
 reset_dircache(void)
 {
+	int error;
+
+	pthread_rwlock_wrlock(&dcache_lock);
+
 	fsdata_free(dcache_size);
-	dcache_size = fsdata_create(0, 1);
+	dcache_size = fsdata_create(0, 0);
 
 	fsdata_free(dcache_nitems);
-	dcache_nitems = fsdata_create(0, 1);
+	dcache_nitems = fsdata_create(0, 0);
+
+	error = (dcache_size == NULL || dcache_nitems == NULL);
+
+	pthread_rwlock_unlock(&dcache_lock);
 
-	return (dcache_size == NULL || dcache_nitems == NULL);
+	pthread_mutex_lock(&resolved_dirs_mutex);
+	trie_free_with_data(resolved_dirs, &free);
+	resolved_dirs = NULL;
+	nresolved_dirs = 0;
+	pthread_mutex_unlock(&resolved_dirs_mutex);
+
+	dcache_save();
+
+	pthread_mutex_lock(&dstore_mutex);
+	fcache_free(dstore);
+	dstore = NULL;
+	pthread_mutex_unlock(&dstore_mutex);
+
+	return error;
 }
 
 void
 stats_redraw_schedule(void)
 {
 	pending_redraw = 1;
+	wakeup_notify();
 }
 
 int
@@ -515,20 +584,46 @@ dcache_get_at(const char path[], uint64_t *size, uint64_t *nitems)
 {
 	/* Initialization to make condition false by default. */
 	dcache_data_t size_data, nitems_data;
+	char real_path[PATH_MAX + 1];
 
-	pthread_mutex_lock(&dcache_size_mutex);
-	if(fsdata_get(dcache_size, path, &size_data, sizeof(size_data)) != 0)
-	{
-		size_data.value = DCACHE_UNKNOWN;
-	}
-	pthread_mutex_unlock(&dcache_size_mutex);
+	size_data.value = DCACHE_UNKNOWN;
+	nitems_data.value = DCACHE_UNKNOWN;
 
-	pthread_mutex_lock(&dcache_nitems_mutex);
-	if(fsdata_get(dcache_nitems, path, &nitems_data, sizeof(nitems_data)) != 0)
+	if(resolve_path(path, real_path) == 0)
 	{
-		nitems_data.value = DCACHE_UNKNOWN;
+		int attempt;
+		for(attempt = 0; attempt < 2; ++attempt)
+		{
+			int found = 0;
+
+			pthread_rwlock_rdlock(&dcache_lock);
+			if(fsdata_get(dcache_size, real_path, &size_data,
+						sizeof(size_data)) == 0)
+			{
+				found = 1;
+			}
+			else
+			{
+				size_data.value = DCACHE_UNKNOWN;
+			}
+			if(fsdata_get(dcache_nitems, real_path, &nitems_data,
+						sizeof(nitems_data)) == 0)
+			{
+				found = 1;
+			}
+			else
+			{
+				nitems_data.value = DCACHE_UNKNOWN;
+			}
+			pthread_rwlock_unlock(&dcache_lock);
+
+			if(found || attempt > 0)
+			{
+				break;
+			}
+			fetch_stored(real_path);
+		}
 	}
-	pthread_mutex_unlock(&dcache_nitems_mutex);
 
 	if(size != NULL)
 	{
@@ -545,9 +640,7 @@ dcache_get_of(const dir_entry_t *entry, dcache_result_t *size,
 		dcache_result_t *nitems)
 {
 	dcache_data_t size_data, nitems_data;
-
-	char full_path[PATH_MAX + 1];
-	get_full_path_of(entry, sizeof(full_path), full_path);
+	char real_path[PATH_MAX + 1];
 
 	size->value = DCACHE_UNKNOWN;
 	size->is_valid = 0;
@@ -555,34 +648,164 @@ dcache_get_of(const dir_entry_t *entry, dcache_result_t *size,
 	nitems->value = DCACHE_UNKNOWN;
 	nitems->is_valid = 0;
 
-	pthread_mutex_lock(&dcache_size_mutex);
-	if(fsdata_get(dcache_size, full_path, &size_data, sizeof(size_data)) == 0)
+	if(get_real_path_of(entry, real_path) != 0)
 	{
-		size->value = size_data.value;
-		/* We check strictly for less than to handle scenario when multiple changes
-		 * occurred during the same second. */
-		size->is_valid = (entry->mtime < size_data.timestamp);
+		return;
 	}
-	pthread_mutex_unlock(&dcache_size_mutex);
 
-	pthread_mutex_lock(&dcache_nitems_mutex);
-	if(fsdata_get(dcache_nitems, full_path, &nitems_data,
-				sizeof(nitems_data)) == 0)
+	int attempt;
+	for(attempt = 0; attempt < 2; ++attempt)
 	{
-		nitems->value = nitems_data.value;
-		/* We check strictly for less than to handle scenario when multiple changes
-		 * occurred during the same second. */
-		nitems->is_valid = (entry->mtime < nitems_data.timestamp);
+		int found = 0;
+
+		pthread_rwlock_rdlock(&dcache_lock);
+
+		if(fsdata_get(dcache_size, real_path, &size_data, sizeof(size_data)) == 0)
+		{
+			size->value = size_data.value;
+			/* We check strictly for less than to handle scenario when multiple
+			 * changes occurred during the same second. */
+			size->is_valid = (entry->mtime < size_data.timestamp);
+			found = 1;
+		}
+
+		if(fsdata_get(dcache_nitems, real_path, &nitems_data,
+					sizeof(nitems_data)) == 0)
+		{
+			nitems->value = nitems_data.value;
+			/* We check strictly for less than to handle scenario when multiple
+			 * changes occurred during the same second. */
+			nitems->is_valid = (entry->mtime < nitems_data.timestamp);
+			found = 1;
+		}
+
+		pthread_rwlock_unlock(&dcache_lock);
+
+		if(found || attempt > 0)
+		{
+			break;
+		}
+		fetch_stored(real_path);
+	}
+}
+
+/* Resolves path of the entry.  Only directory of the entry is resolved unless
+ * the entry itself might be a symbolic link.  real_path should be at least
+ * PATH_MAX + 1 bytes long.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+get_real_path_of(const dir_entry_t *entry, char real_path[])
+{
+	char real_dir[PATH_MAX + 1];
+
+	if(entry->type == FT_LINK || is_builtin_dir(entry->name))
+	{
+		char full_path[PATH_MAX + 1];
+		get_full_path_of(entry, sizeof(full_path), full_path);
+		return resolve_path(full_path, real_path);
+	}
+
+	if(resolve_dir(entry->origin, real_dir) != 0)
+	{
+		return 1;
 	}
-	pthread_mutex_unlock(&dcache_nitems_mutex);
+
+	snprintf(real_path, PATH_MAX + 1, "%s%s%s", real_dir,
+			ends_with_slash(real_dir) ? "" : "/", entry->name);
+	return 0;
+}
+
+/* Resolves path to a directory consulting and updating cache of recently
+ * resolved directories.  real_path should be at least PATH_MAX + 1 bytes long.
+ * Returns zero on success, otherwise non-zero is returned. */
+static int
+resolve_dir(const char path[], char real_path[])
+{
+	void *data;
+	resolved_dir_t *resolved;
+	const time_t now = time(NULL);
+
+	pthread_mutex_lock(&resolved_dirs_mutex);
+	if(trie_get(resolved_dirs, path, &data) == 0)
+	{
+		resolved = data;
+		if(now - resolved->timestamp <= RESOLVED_DIR_TTL)
+		{
+			copy_str(real_path, PATH_MAX + 1, resolved->path);
+			pthread_mutex_unlock(&resolved_dirs_mutex);
+			return 0;
+		}
+	}
+	pthread_mutex_unlock(&resolved_dirs_mutex);
+
+	if(resolve_path(path, real_path) != 0)
+	{
+		return 1;
+	}
+
+	resolved = malloc(sizeof(*resolved) + strlen(real_path) + 1U);
+	if(resolved == NULL)
+	{
+		return 0;
+	}
+	resolved->timestamp = now;
+	strcpy(resolved->path, real_path);
+
+	pthread_mutex_lock(&resolved_dirs_mutex);
+
+	/* Start anew instead of evicting individual entries, the cache is mostly
+	 * needed for directories of the views. */
+	if(nresolved_dirs >= MAX_RESOLVED_DIRS)
+	{
+		trie_free_with_data(resolved_dirs, &free);
+		resolved_dirs = NULL;
+		nresolved_dirs = 0;
+	}
+	if(resolved_dirs == NULL)
+	{
+		resolved_dirs = trie_create();
+	}
+
+	if(trie_get(resolved_dirs, path, &data) == 0)
+	{
+		free(data);
+		(void)trie_set(resolved_dirs, path, resolved);
+	}
+	else if(trie_set(resolved_dirs, path, resolved) == 0)
+	{
+		++nresolved_dirs;
+	}
+	else
+	{
+		free(resolved);
+	}
+
+	pthread_mutex_unlock(&resolved_dirs_mutex);
+	return 0;
+}
+
+/* Resolves path into real_path, which should be at least PATH_MAX + 1 bytes
+ * long.  Returns zero on success, otherwise non-zero is returned. */
+static int
+resolve_path(const char path[], char real_path[])
+{
+	return (os_realpath(path, real_path) != real_path);
 }
 
 void
 dcache_update_parent_sizes(const char path[], uint64_t by)
 {
-	pthread_mutex_lock(&dcache_size_mutex);
-	(void)fsdata_map_parents(dcache_size, path, &size_updater, &by);
-	pthread_mutex_unlock(&dcache_size_mutex);
+	char real_path[PATH_MAX + 1];
+	if(resolve_path(path, real_path) != 0)
+	{
+		return;
+	}
+
+	pthread_rwlock_wrlock(&dcache_lock);
+	(void)fsdata_map_parents(dcache_size, real_path, &size_updater, &by);
+	pthread_rwlock_unlock(&dcache_lock);
+
+	update_stored_parents(real_path, by);
 }
 
 /* Updates cached value by a fixed amount. */
@@ -592,7 +815,11 @@ size_updater(void *data, void *arg)
 	const uint64_t *const by = arg;
 	dcache_data_t *const what = data;
 
-	what->value += *by;
+	/* Entries might exist only to remember that nothing is stored for them. */
+	if(what->value != DCACHE_UNKNOWN)
+	{
+		what->value += *by;
+	}
 }
 
 int
@@ -600,27 +827,250 @@ dcache_set_at(const char path[], uint64_t size, uint64_t nitems)
 {
 	int ret = 0;
 	const time_t ts = time(NULL);
+	char real_path[PATH_MAX + 1];
+
+	if(resolve_path(path, real_path) != 0)
+	{
+		return -1;
+	}
+
+	pthread_rwlock_wrlock(&dcache_lock);
 
 	if(size != DCACHE_UNKNOWN)
 	{
 		const dcache_data_t data = { .value = size, .timestamp = ts };
-
-		pthread_mutex_lock(&dcache_size_mutex);
-		ret |= fsdata_set(dcache_size, path, &data, sizeof(data));
-		pthread_mutex_unlock(&dcache_size_mutex);
+		ret |= fsdata_set(dcache_size, real_path, &data, sizeof(data));
 	}
 
 	if(nitems != DCACHE_UNKNOWN)
 	{
 		const dcache_data_t data = { .value = nitems, .timestamp = ts };
-
-		pthread_mutex_lock(&dcache_nitems_mutex);
-		ret |= fsdata_set(dcache_nitems, path, &data, sizeof(data));
-		pthread_mutex_unlock(&dcache_nitems_mutex);
+		ret |= fsdata_set(dcache_nitems, real_path, &data, sizeof(data));
 	}
 
+	pthread_rwlock_unlock(&dcache_lock);
+
+	update_stored(real_path, size, nitems);
+
 	return ret;
 }
 
+void
+dcache_get_size_real(const char real_path[], uint64_t *size)
+{
+	dcache_data_t data;
+
+	pthread_rwlock_rdlock(&dcache_lock);
+	const int found = (fsdata_get(dcache_size, real_path, &data,
+				sizeof(data)) == 0);
+	pthread_rwlock_unlock(&dcache_lock);
+
+	*size = (found ? data.value : DCACHE_UNKNOWN);
+}
+
+void
+dcache_set_sizes(const dcache_size_t sizes[], int count)
+{
+	int i;
+	const dcache_data_t data_template = { .timestamp = time(NULL) };
+
+	pthread_rwlock_wrlock(&dcache_lock);
+	for(i = 0; i < count; ++i)
+	{
+		dcache_data_t data = data_template;
+		data.value = sizes[i].size;
+		(void)fsdata_set(dcache_size, sizes[i].real_path, &data, sizeof(data));
+	}
+	pthread_rwlock_unlock(&dcache_lock);
+
+	update_stored_sizes(sizes, count);
+}
+
+void
+dcache_flush(void)
+{
+	pthread_mutex_lock(&dstore_mutex);
+	if(dstore != NULL)
+	{
+		(void)fcache_flush(dstore);
+	}
+	pthread_mutex_unlock(&dstore_mutex);
+}
+
+void
+dcache_save(void)
+{
+	pthread_mutex_lock(&dstore_mutex);
+	if(dstore != NULL)
+	{
+		(void)fcache_save(dstore);
+	}
+	pthread_mutex_unlock(&dstore_mutex);
+}
+
+/* Copies information about the directory from persistent storage into memory.
+ * Absence of information is recorded as well to not query the storage for the
+ * same directory again. */
+static void
+fetch_stored(const char real_path[])
+{
+	fcache_key_t key;
+	uint64_t size = DCACHE_UNKNOWN, nitems = DCACHE_UNKNOWN;
+	int found = 0;
+
+	if(!dstore_enabled() || fcache_key(real_path, &key) != 0)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&dstore_mutex);
+	fcache_t *const store = get_dstore();
+	if(store != NULL)
+	{
+		found = fcache_get_pair(store, &key, &size, &nitems);
+	}
+	pthread_mutex_unlock(&dstore_mutex);
+
+	/* State of the directory is part of the key, so found data is up-to-date as
+	 * of now. */
+	const time_t ts = (found ? time(NULL) : 0);
+	const dcache_data_t size_data = { .value = size, .timestamp = ts };
+	const dcache_data_t nitems_data = { .value = nitems, .timestamp = ts };
+
+	pthread_rwlock_wrlock(&dcache_lock);
+	/* Don't overwrite data that was added in the meantime. */
+	dcache_data_t data;
+	if(fsdata_get(dcache_size, real_path, &data, sizeof(data)) != 0 &&
+			fsdata_get(dcache_nitems, real_path, &data, sizeof(data)) != 0)
+	{
+		(void)fsdata_set(dcache_size, real_path, &size_data, sizeof(size_data));
+		(void)fsdata_set(dcache_nitems, real_path, &nitems_data,
+				sizeof(nitems_data));
+	}
+	pthread_rwlock_unlock(&dcache_lock);
+}
+
+/* Puts information about the directory into persistent storage.  Either of the
+ * values can be DCACHE_UNKNOWN, in which case stored value is preserved. */
+static void
+update_stored(const char real_path[], uint64_t size, uint64_t nitems)
+{
+	fcache_key_t key;
+	uint64_t old_size = DCACHE_UNKNOWN, old_nitems = DCACHE_UNKNOWN;
+
+	if(!dstore_enabled() || fcache_key(real_path, &key) != 0)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&dstore_mutex);
+	fcache_t *const store = get_dstore();
+	if(store != NULL)
+	{
+		(void)fcache_get_pair(store, &key, &old_size, &old_nitems);
+		fcache_put_pair(store, &key, (size == DCACHE_UNKNOWN ? old_size : size),
+				(nitems == DCACHE_UNKNOWN ? old_nitems : nitems));
+	}
+	pthread_mutex_unlock(&dstore_mutex);
+}
+
+/* Puts sizes of several directories into persistent storage at once.  Number
+ * of items in each directory is preserved. */
+static void
+update_stored_sizes(const dcache_size_t sizes[], int count)
+{
+	int i;
+
+	if(!dstore_enabled() || count == 0)
+	{
+		return;
+	}
+
+	fcache_key_t *const keys = reallocarray(NULL, count, sizeof(*keys));
+	char *const valid = calloc(count, 1);
+	if(keys == NULL || valid == NULL)
+	{
+		free(keys);
+		free(valid);
+		return;
+	}
+
+	/* Directories are queried before taking the lock. */
+	for(i = 0; i < count; ++i)
+	{
+		valid[i] = (fcache_key(sizes[i].real_path, &keys[i]) == 0);
+	}
+
+	pthread_mutex_lock(&dstore_mutex);
+	fcache_t *const store = get_dstore();
+	for(i = 0; i < count && store != NULL; ++i)
+	{
+		uint64_t old_size, nitems = DCACHE_UNKNOWN;
+		if(valid[i])
+		{
+			(void)fcache_get_pair(store, &keys[i], &old_size, &nitems);
+			fcache_put_pair(store, &keys[i], sizes[i].size, nitems);
+		}
+	}
+	pthread_mutex_unlock(&dstore_mutex);
+
+	free(keys);
+	free(valid);
+}
+
+/* Updates stored sizes of parents of the directory by specified amount. */
+static void
+update_stored_parents(const char real_path[], uint64_t by)
+{
+	char parent[PATH_MAX + 1];
+
+	if(!dstore_enabled())
+	{
+		return;
+	}
+
+	copy_str(parent, sizeof(parent), real_path);
+	while(!is_root_dir(parent))
+	{
+		fcache_key_t key;
+		uint64_t size, nitems;
+
+		remove_last_path_component(parent);
+		if(parent[0] == '\0' || fcache_key(parent, &key) != 0)
+		{
+			break;
+		}
+
+		pthread_mutex_lock(&dstore_mutex);
+		fcache_t *const store = get_dstore();
+		if(store != NULL && fcache_get_pair(store, &key, &size, &nitems) &&
+				size != DCACHE_UNKNOWN)
+		{
+			fcache_put_pair(store, &key, size + by, nitems);
+		}
+		pthread_mutex_unlock(&dstore_mutex);
+	}
+}
+
+/* Checks whether information about directories should be stored between
+ * sessions.  Returns non-zero if so, otherwise zero is returned. */
+static int
+dstore_enabled(void)
+{
+	return ((cfg.vifm_info & VINFO_DIRSIZES) && cfg.dirsizes_file[0] != '\0');
+}
+
+/* Retrieves persistent storage of dcache loading it on first use.  Must be
+ * called with dstore_mutex locked.  Returns the storage or NULL on error. */
+static fcache_t *
+get_dstore(void)
+{
+	if(dstore == NULL)
+	{
+		dstore = fcache_load(cfg.dirsizes_file, MAX_STORED_DIRS);
+	}
+	return dstore;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -103,6 +103,14 @@ typedef struct
 }
 dcache_result_t;
 
+/* Input of dcache_set_sizes(). */
+typedef struct
+{
+	char *real_path; /* Canonical path to a directory. */
+	uint64_t size;   /* Size of the directory. */
+}
+dcache_size_t;
+
 /* Current preview (quickview) parameters. */
 typedef struct
 {
@@ -316,6 +324,24 @@ void dcache_update_parent_sizes(const char path[], uint64_t by);
  * non-zero is returned. */
 int dcache_set_at(const char path[], uint64_t size, uint64_t nitems);
 
+/* Retrieves size of a directory specified by its canonical path.  Unlike
+ * dcache_get_at(), neither resolves the path nor consults persistent storage,
+ * which makes it cheap enough to be called for every directory of a
+ * traversal.  Sets *size to DCACHE_UNKNOWN if the size isn't known. */
+void dcache_get_size_real(const char real_path[], uint64_t *size);
+
+/* Updates sizes of several directories specified by their canonical paths at
+ * once. */
+void dcache_set_sizes(const dcache_size_t sizes[], int count);
+
+/* Appends information that was added since the last call to persistent
+ * storage, which happens only if 'vifminfo' contains "dirsizes". */
+void dcache_flush(void);
+
+/* Writes out persistent storage of information about directories if it was
+ * used. */
+void dcache_save(void);
+
 #endif /* VIFM__STATUS_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
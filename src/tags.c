@@ -70,6 +70,7 @@ const char *tags[] = {
 	"vifm-'ignorecase'",
 	"vifm-'incsearch'",
 	"vifm-'iooptions'",
+	"vifm-'iothreads'",
 	"vifm-'is'",
 	"vifm-'laststatus'",
 	"vifm-'lines'",
@@ -85,6 +86,7 @@ const char *tags[] = {
 	"vifm-'number'",
 	"vifm-'numberwidth'",
 	"vifm-'nuw'",
+	"vifm-'previewcache'",
 	"vifm-'previewprg'",
 	"vifm-'quickview'",
 	"vifm-'relativenumber'",
@@ -20,18 +20,22 @@
 #include "quickview.h"
 
 #include <curses.h> /* mvwaddstr() */
+#include <sys/stat.h> /* S_ISDIR stat */
+#include <sys/types.h> /* pid_t */
 #include <unistd.h> /* usleep() */
 
 #include <limits.h> /* INT_MAX */
 #include <stddef.h> /* NULL size_t */
 #include <stdio.h> /* FILE SEEK_SET fclose() fdopen() feof() fseek()
-                      tmpfile() */
-#include <stdlib.h> /* free() */
+                      snprintf() tmpfile() */
+#include <stdlib.h> /* calloc() free() */
 #include <string.h> /* strcat() strlen() strncat() */
+#include <time.h> /* timespec */
 
 #include "../cfg/config.h"
 #include "../compat/fs_limits.h"
 #include "../compat/os.h"
+#include "../compat/pthread.h"
 #include "../engine/mode.h"
 #include "../modes/dialogs/msg_dialog.h"
 #include "../modes/modes.h"
@@ -39,12 +43,14 @@
 #include "../utils/file_streams.h"
 #include "../utils/filemon.h"
 #include "../utils/fs.h"
+#include "../utils/macros.h"
 #include "../utils/path.h"
 #include "../utils/str.h"
 #include "../utils/string_array.h"
 #include "../utils/test_helpers.h"
 #include "../utils/utf8.h"
 #include "../utils/utils.h"
+#include "../utils/wakeup.h"
 #include "../filelist.h"
 #include "../filetype.h"
 #include "../macros.h"
@@ -62,6 +68,18 @@
 /* Maximum number of lines used for preview. */
 enum { MAX_PREVIEW_LINES = 256 };
 
+/* For how long cursor needs to stay on a file before its viewer is run (in
+ * milliseconds). */
+enum { PREVIEW_DELAY_MS = 100 };
+
+/* For how long to wait for a file to be read before displaying a placeholder
+ * (in milliseconds). */
+enum { PREVIEW_WAIT_MS = 20 };
+
+/* Prefetching doesn't start new jobs while there are this many unfinished ones
+ * (including cancelled ones that are still being stopped). */
+enum { MAX_PREFETCH_JOBS = 4 };
+
 /* Cached information about a single file's preview. */
 typedef struct
 {
@@ -77,6 +95,60 @@ typedef struct
 }
 quickview_cache_t;
 
+/* Cached textual preview of a file, an element of doubly-linked list of
+ * previews ordered by time of their last use. */
+typedef struct cached_preview_t
+{
+	char *path;        /* Full path to the file. */
+	char *viewer;      /* Viewer of the file. */
+	filemon_t filemon; /* Timestamp for the file. */
+	strlist_t lines;   /* Top MAX_PREVIEW_LINES of preview contents. */
+	size_t size;       /* Approximate amount of memory taken by the preview. */
+
+	struct cached_preview_t *newer; /* More recently used preview or NULL. */
+	struct cached_preview_t *older; /* Less recently used preview or NULL. */
+}
+cached_preview_t;
+
+/* Reading of preview lines in a background thread. */
+typedef struct
+{
+	char *path; /* File to read if there is no stream. */
+	FILE *fp;   /* Output of a viewer or NULL. */
+	pid_t pgid; /* Process group of the viewer or (pid_t)-1. */
+
+	pthread_mutex_t lock; /* Protects fields below. */
+	pthread_cond_t over;  /* Signaled when the job is done. */
+	int refs;             /* Number of owners (requester and the thread). */
+	int cancelled;        /* Whether result isn't needed anymore. */
+	int done;             /* Whether the job is over. */
+	int failed;           /* Whether the file couldn't be opened. */
+	strlist_t lines;      /* Lines of the preview. */
+}
+preview_job_t;
+
+/* Preview that is prepared in the background. */
+typedef struct
+{
+	char *path;          /* Full path to the file or NULL if there is none. */
+	char *viewer;        /* Viewer of the file. */
+	view_t *source;      /* View which does the preview. */
+	preview_area_t pa;   /* Where preview is being drawn. */
+	long long start_at;  /* When to run the viewer (monotonic milliseconds). */
+	preview_job_t *job;  /* Job that produces the preview or NULL. */
+	const char *error;   /* Message to display instead of preview or NULL. */
+}
+preview_request_t;
+
+/* Preview of a neighbouring entry that is prepared in advance. */
+typedef struct
+{
+	char *path;         /* Full path to the file or NULL if slot is free. */
+	char *viewer;       /* Viewer of the file. */
+	preview_job_t *job; /* Job that produces the preview. */
+}
+prefetch_t;
+
 /* State of directory tree print functions. */
 typedef struct
 {
@@ -86,30 +158,72 @@ typedef struct
 	int nfiles;        /* Number of seen files. */
 	int max;           /* Maximum line number. */
 	char prefix[4096]; /* Prefix character for each tree level. */
+	char path[PATH_MAX + 1]; /* Path to current entry, reused for all of them. */
 }
 tree_print_state_t;
 
 static void view_entry(const dir_entry_t *entry, const preview_area_t *parea,
-		quickview_cache_t *cache);
+		quickview_cache_t *cache, int async);
 static void view_file(const char path[], const preview_area_t *parea,
-		quickview_cache_t *cache);
+		quickview_cache_t *cache, int async);
+static int view_file_async(const char path[], const char viewer[],
+		const preview_area_t *parea, quickview_cache_t *cache);
+static void show_cached(const strlist_t *lines, const char path[],
+		const char viewer[], const preview_area_t *parea, quickview_cache_t *cache);
+static int request_matches(const char path[], const char viewer[]);
+static void cancel_request(void);
+static void run_viewer(void);
+static int finish_request(void);
+static void redraw_preview(view_t *source);
+static FILE * start_viewer(view_t *view, int pos, const char viewer[],
+		const preview_area_t *parea, pid_t *pgid);
+static void schedule_prefetch(view_t *view, const preview_area_t *parea);
+static void run_prefetch(void);
+static void prefetch_entry(prefetch_t *slot, view_t *view, int pos);
+static void finish_prefetch(prefetch_t *slot);
+static preview_job_t * take_prefetch(const char path[], const char viewer[]);
+static void cancel_prefetch(prefetch_t *slot);
+static void cancel_prefetches(void);
+static preview_job_t * job_start(const char path[], FILE *fp, pid_t pgid);
+static void * job_thread(void *arg);
+static void job_run(preview_job_t *job);
+static int job_wait(preview_job_t *job, int timeout);
+static int job_take(preview_job_t *job, strlist_t *lines);
+static void job_cancel(preview_job_t *job);
+static void job_release(preview_job_t *job);
+TSTATIC strlist_t * previews_find(const char path[], const char viewer[]);
+TSTATIC void previews_put(const char path[], const char viewer[],
+		strlist_t lines);
+static void previews_link(cached_preview_t *preview);
+static void previews_unlink(cached_preview_t *preview);
+static void previews_free(cached_preview_t *preview);
+static int viewers_equal(const char a[], const char b[]);
 static int is_cache_valid(const quickview_cache_t *cache, const char path[],
 		const char viewer[], const preview_area_t *parea);
 static void fill_cache(quickview_cache_t *cache, FILE *fp, const char path[],
 		const char viewer[], ViewerKind kind, const preview_area_t *parea);
+static void set_cache(quickview_cache_t *cache, strlist_t lines,
+		const char path[], const char viewer[], ViewerKind kind,
+		const preview_area_t *parea);
 TSTATIC strlist_t read_lines(FILE *fp, int max_lines);
+static strlist_t read_lines_of_job(FILE *fp, int max_lines,
+		preview_job_t *job);
 static FILE * view_dir(const char path[], int max_lines);
-static int print_dir_tree(tree_print_state_t *s, const char path[], int last);
+static int print_dir_tree(tree_print_state_t *s, int last, char *lst[],
+		int len);
+static int path_fits(size_t room, const char name[]);
+static int print_dir_entry(tree_print_state_t *s, int last);
 static int enter_dir(tree_print_state_t *s, const char path[], int last);
-static int visit_file(tree_print_state_t *s, const char path[], int last);
+static int visit_file(tree_print_state_t *s, const char path[], int last,
+		int as_dir);
 static int visit_link(tree_print_state_t *s, const char path[], int last,
-		const char target[]);
+		int as_dir, const char target[]);
 static void leave_dir(tree_print_state_t *s);
 static void indent_prefix(tree_print_state_t *s);
 static void unindent_prefix(tree_print_state_t *s);
 static void set_prefix_char(tree_print_state_t *s, char c);
 static void print_tree_entry(tree_print_state_t *s, const char path[],
-		int end_line);
+		int as_dir, int end_line);
 static void print_entry_prefix(tree_print_state_t *s);
 static void draw_lines(const strlist_t *lines, int wrapped,
 		const preview_area_t *parea, ViewerKind kind);
@@ -122,6 +236,32 @@ static void wipe_area(const preview_area_t *parea);
 /* Cached preview data for a single file entry. */
 static quickview_cache_t qv_cache;
 
+/* Preview for qv_cache that is being prepared. */
+static preview_request_t qv_request;
+
+/* Most recently used cached preview. */
+static cached_preview_t *previews_newest;
+/* Least recently used cached preview. */
+static cached_preview_t *previews_oldest;
+/* Total size of cached previews in bytes. */
+static size_t previews_size;
+
+/* Previews of the next and the previous entries. */
+static prefetch_t prefetches[2];
+/* View whose entries are prefetched. */
+static view_t *prefetch_view;
+/* Path of the entry around which prefetching is done. */
+static char *prefetch_around;
+/* Area in which prefetched previews will be displayed. */
+static preview_area_t prefetch_pa;
+/* When to start prefetching (monotonic milliseconds) or -1. */
+static long long prefetch_at = -1;
+
+/* Protects running_jobs. */
+static pthread_mutex_t running_jobs_lock = PTHREAD_MUTEX_INITIALIZER;
+/* Number of jobs which haven't finished reading yet. */
+static int running_jobs;
+
 int
 qv_ensure_is_shown(void)
 {
@@ -179,6 +319,9 @@ qv_toggle(void)
 	update_string(&curr_stats.preview.cleanup_cmd, NULL);
 	curr_stats.preview.kind = VK_TEXTUAL;
 	qv_ui_updated();
+
+	cancel_request();
+	cancel_prefetches();
 }
 
 void
@@ -216,7 +359,12 @@ qv_draw(view_t *view)
 			.w = ui_qv_width(other_view),
 			.h = ui_qv_height(other_view),
 		};
-		view_entry(curr, &parea, &qv_cache);
+		view_entry(curr, &parea, &qv_cache, 1);
+
+		if(qv_request.path == NULL)
+		{
+			schedule_prefetch(view, &parea);
+		}
 	}
 
 	refresh_view_win(other_view);
@@ -242,7 +390,7 @@ qv_draw_on(const dir_entry_t *entry, const preview_area_t *parea)
 
 	quickview_cache_t *cache = (parea->view == &lwin ? &lwin_cache : &rwin_cache);
 
-	view_entry(entry, parea, cache);
+	view_entry(entry, parea, cache, 0);
 
 	parea->view->displays_graphics = (cache->kind != VK_TEXTUAL);
 
@@ -251,10 +399,11 @@ qv_draw_on(const dir_entry_t *entry, const preview_area_t *parea)
 	cache->graphics_lost = 1;
 }
 
-/* Draws preview of the entry in the other view. */
+/* Draws preview of the entry in the other view.  The async parameter specifies
+ * whether preview can be produced in the background. */
 static void
 view_entry(const dir_entry_t *entry, const preview_area_t *parea,
-		quickview_cache_t *cache)
+		quickview_cache_t *cache, int async)
 {
 	char path[PATH_MAX + 1];
 	qv_get_path_to_explore(entry, path, sizeof(path));
@@ -288,16 +437,17 @@ view_entry(const dir_entry_t *entry, const preview_area_t *parea,
 			/* break is omitted intentionally. */
 		case FT_UNK:
 		default:
-			view_file(path, parea, cache);
+			view_file(path, parea, cache, async);
 			break;
 	}
 }
 
 /* Displays contents of file or output of its viewer in the other pane
- * starting from the second line and second column. */
+ * starting from the second line and second column.  The async parameter
+ * specifies whether preview can be produced in the background. */
 static void
 view_file(const char path[], const preview_area_t *parea,
-		quickview_cache_t *cache)
+		quickview_cache_t *cache, int async)
 {
 	const char *viewer = qv_get_viewer(path);
 
@@ -309,6 +459,18 @@ view_file(const char path[], const preview_area_t *parea,
 		return;
 	}
 
+	const strlist_t *const cached = previews_find(path, viewer);
+	if(cached != NULL)
+	{
+		show_cached(cached, path, viewer, parea, cache);
+		return;
+	}
+
+	if(async && view_file_async(path, viewer, parea, cache) == 0)
+	{
+		return;
+	}
+
 	ViewerKind kind = VK_TEXTUAL;
 
 	FILE *fp;
@@ -378,23 +540,804 @@ view_file(const char path[], const preview_area_t *parea,
 
 	fclose(fp);
 
+	if(kind == VK_TEXTUAL)
+	{
+		previews_put(path, viewer, (strlist_t){
+			.items = copy_string_array(cache->lines.items, cache->lines.nitems),
+			.nitems = cache->lines.nitems,
+		});
+	}
+
 	ui_cancellation_disable();
 
 	draw_lines(&cache->lines, cfg.wrap_quick_view, &cache->pa, cache->kind);
 }
 
+/* Displays textual preview of a file that is produced in the background
+ * showing a placeholder until it's ready.  Viewers are run only after cursor
+ * stays on the file for a while.  Returns zero if preview was handled,
+ * otherwise non-zero is returned. */
+static int
+view_file_async(const char path[], const char viewer[],
+		const preview_area_t *parea, quickview_cache_t *cache)
+{
+#ifdef _WIN32
+	/* Main loop doesn't check for updates while waiting for input here. */
+	return 1;
+#endif
+
+	if(request_matches(path, viewer))
+	{
+		qv_request.source = parea->source;
+		qv_request.pa = *parea;
+		write_message(qv_request.error == NULL ? "Loading preview..."
+		                                       : qv_request.error, parea);
+		return 0;
+	}
+
+	cancel_request();
+
+	const int no_viewer = is_null_or_empty(viewer);
+	if((viewer == NULL && is_dir(path)) ||
+			(!no_viewer && ft_viewer_kind(viewer) != VK_TEXTUAL))
+	{
+		/* Directories have their own cancellation and graphics are drawn by the
+		 * viewer itself. */
+		return 1;
+	}
+
+	/* Placeholder and preview can replace graphics. */
+	cleanup_for_text(parea);
+
+	qv_request.path = strdup(path);
+	qv_request.viewer = (viewer == NULL) ? NULL : strdup(viewer);
+	qv_request.source = parea->source;
+	qv_request.pa = *parea;
+	qv_request.start_at = get_time_ms() + (no_viewer ? 0 : PREVIEW_DELAY_MS);
+	qv_request.error = NULL;
+
+	/* Preview might be already on its way. */
+	qv_request.job = take_prefetch(path, viewer);
+	if(qv_request.job == NULL && no_viewer)
+	{
+		/* Reading a file doesn't need cursor to settle and is usually fast. */
+		qv_request.job = job_start(path, NULL, (pid_t)-1);
+	}
+
+	if(qv_request.job != NULL &&
+			job_wait(qv_request.job, PREVIEW_WAIT_MS) && finish_request())
+	{
+		cache->pa = *parea;
+		draw_lines(&cache->lines, cfg.wrap_quick_view, &cache->pa, cache->kind);
+		return 0;
+	}
+
+	write_message(qv_request.error == NULL ? "Loading preview..."
+	                                       : qv_request.error, parea);
+	return 0;
+}
+
+/* Displays textual preview taken from the cache of previews. */
+static void
+show_cached(const strlist_t *lines, const char path[], const char viewer[],
+		const preview_area_t *parea, quickview_cache_t *cache)
+{
+	/* Previous preview could have been graphical. */
+	cleanup_for_text(parea);
+
+	const char *clear_cmd = (viewer != NULL) ? ma_get_clear_cmd(viewer) : NULL;
+	update_string(&curr_stats.preview.cleanup_cmd, clear_cmd);
+
+	set_cache(cache, (strlist_t){
+			.items = copy_string_array(lines->items, lines->nitems),
+			.nitems = lines->nitems,
+		}, path, viewer, VK_TEXTUAL, parea);
+
+	draw_lines(&cache->lines, cfg.wrap_quick_view, &cache->pa, cache->kind);
+}
+
+/* Checks whether preview of the file with the viewer is being prepared.
+ * Returns non-zero if so, otherwise zero is returned. */
+static int
+request_matches(const char path[], const char viewer[])
+{
+	return qv_request.path != NULL
+	    && paths_are_equal(qv_request.path, path)
+	    && viewers_equal(qv_request.viewer, viewer);
+}
+
+/* Forgets about preview that is being prepared leaving its job to finish in
+ * the background on its own. */
+static void
+cancel_request(void)
+{
+	if(qv_request.job != NULL)
+	{
+		job_cancel(qv_request.job);
+		qv_request.job = NULL;
+	}
+
+	update_string(&qv_request.path, NULL);
+	update_string(&qv_request.viewer, NULL);
+	qv_request.error = NULL;
+}
+
+void
+qv_check_for_updates(void)
+{
+	size_t i;
+	for(i = 0U; i < ARRAY_LEN(prefetches); ++i)
+	{
+		if(prefetches[i].job != NULL && job_wait(prefetches[i].job, 0))
+		{
+			finish_prefetch(&prefetches[i]);
+		}
+	}
+
+	if(prefetch_at >= 0 && get_time_ms() >= prefetch_at)
+	{
+		run_prefetch();
+	}
+
+	if(qv_request.path == NULL || qv_request.error != NULL)
+	{
+		return;
+	}
+
+	if(qv_request.job == NULL)
+	{
+		if(get_time_ms() >= qv_request.start_at)
+		{
+			run_viewer();
+		}
+		return;
+	}
+
+	if(job_wait(qv_request.job, 0))
+	{
+		view_t *const source = qv_request.source;
+		(void)finish_request();
+		redraw_preview(source);
+	}
+}
+
+int
+qv_get_check_delay(void)
+{
+	/* Jobs wake up main loop when they are done, only deadlines matter. */
+	long long deadline = prefetch_at;
+	if(qv_request.path != NULL && qv_request.error == NULL &&
+			qv_request.job == NULL)
+	{
+		deadline = (deadline < 0)
+		         ? qv_request.start_at
+		         : MIN(deadline, qv_request.start_at);
+	}
+
+	return (deadline < 0) ? -1 : MAX(0, (int)(deadline - get_time_ms()));
+}
+
+/* Runs viewer of the request and starts reading its output in the
+ * background. */
+static void
+run_viewer(void)
+{
+	view_t *const source = qv_request.source;
+
+	pid_t pgid;
+	FILE *const fp = start_viewer(source, source->list_pos, qv_request.viewer,
+			&qv_request.pa, &pgid);
+	if(fp == NULL)
+	{
+		qv_request.error = "Cannot read viewer output";
+		redraw_preview(source);
+		return;
+	}
+
+	qv_request.job = job_start(qv_request.path, fp, pgid);
+	if(qv_request.job == NULL)
+	{
+		kill_process_group(pgid);
+		fclose(fp);
+		qv_request.error = "Cannot read viewer output";
+		redraw_preview(source);
+	}
+}
+
+/* Moves result of finished job of the request into the cache.  Returns
+ * non-zero if preview is in the cache, otherwise zero is returned and error
+ * message is set. */
+static int
+finish_request(void)
+{
+	strlist_t lines;
+	const int failed = job_take(qv_request.job, &lines);
+	qv_request.job = NULL;
+
+	if(failed)
+	{
+		qv_request.error = "Cannot open file";
+		return 0;
+	}
+
+	previews_put(qv_request.path, qv_request.viewer, (strlist_t){
+		.items = copy_string_array(lines.items, lines.nitems),
+		.nitems = lines.nitems,
+	});
+	set_cache(&qv_cache, lines, qv_request.path, qv_request.viewer, VK_TEXTUAL,
+			&qv_request.pa);
+
+	const char *const viewer = qv_request.viewer;
+	const char *clear_cmd = (viewer != NULL) ? ma_get_clear_cmd(viewer) : NULL;
+	update_string(&curr_stats.preview.cleanup_cmd, clear_cmd);
+	curr_stats.preview.kind = VK_TEXTUAL;
+
+	cancel_request();
+	return 1;
+}
+
+/* Updates preview on the screen after it changed in the background. */
+static void
+redraw_preview(view_t *source)
+{
+	if(!curr_stats.preview.on || vle_mode_is(VIEW_MODE))
+	{
+		return;
+	}
+
+	if(vle_mode_is(NORMAL_MODE) || vle_mode_is(VISUAL_MODE))
+	{
+		/* Preview is always drawn for the current view. */
+		if(source == curr_view)
+		{
+			qv_draw(source);
+		}
+	}
+	else
+	{
+		stats_redraw_schedule();
+	}
+}
+
+/* Runs viewer for an entry of the view as if cursor was on it in a process
+ * group of its own, id of which is stored in *pgid.  Returns output of the
+ * viewer or NULL on error. */
+static FILE *
+start_viewer(view_t *view, int pos, const char viewer[],
+		const preview_area_t *parea, pid_t *pgid)
+{
+	/* Viewers might use relative path, so make sure that we're at correct
+	 * location. */
+	(void)vifm_chdir(flist_get_dir(view));
+
+	/* Macros are expanded for the current entry of the current view. */
+	view_t *const curr = curr_view;
+	const int list_pos = view->list_pos;
+	curr_view = view;
+	view->list_pos = pos;
+
+	curr_stats.preview_hint = parea;
+	char *const cmd = expand_viewer_command(viewer);
+	FILE *const fp = (cmd == NULL) ? NULL : read_cmd_output_group(cmd, 0, pgid);
+	free(cmd);
+	curr_stats.preview_hint = NULL;
+
+	view->list_pos = list_pos;
+	curr_view = curr;
+
+	return fp;
+}
+
+/* Arranges previews of entries around cursor to be prepared if cursor stays
+ * where it is for a while. */
+static void
+schedule_prefetch(view_t *view, const preview_area_t *parea)
+{
+	if(cfg.preview_cache_size == 0)
+	{
+		return;
+	}
+
+	char path[PATH_MAX + 1];
+	qv_get_path_to_explore(get_current_entry(view), path, sizeof(path));
+
+	if(view == prefetch_view && prefetch_around != NULL &&
+			paths_are_equal(prefetch_around, path))
+	{
+		/* Just a redraw. */
+		return;
+	}
+
+	replace_string(&prefetch_around, path);
+	prefetch_view = view;
+	prefetch_pa = *parea;
+	prefetch_at = get_time_ms() + PREVIEW_DELAY_MS;
+}
+
+/* Starts preparing previews of entries around cursor. */
+static void
+run_prefetch(void)
+{
+	prefetch_at = -1;
+
+	view_t *const view = prefetch_view;
+	if(!curr_stats.preview.on || view != curr_view || view->list_rows == 0)
+	{
+		return;
+	}
+
+	prefetch_entry(&prefetches[0], view, view->list_pos + 1);
+	prefetch_entry(&prefetches[1], view, view->list_pos - 1);
+}
+
+/* Starts preparing preview of an entry of the view in the slot unless it's not
+ * needed. */
+static void
+prefetch_entry(prefetch_t *slot, view_t *view, int pos)
+{
+	if(pos < 0 || pos >= view->list_rows)
+	{
+		cancel_prefetch(slot);
+		return;
+	}
+
+	const dir_entry_t *const entry = &view->dir_entry[pos];
+	if(fentry_is_fake(entry) || entry->type != FT_REG)
+	{
+		/* Other kinds of entries are either cheap to view or aren't textual. */
+		cancel_prefetch(slot);
+		return;
+	}
+
+	char path[PATH_MAX + 1];
+	qv_get_path_to_explore(entry, path, sizeof(path));
+
+	const char *viewer = qv_get_viewer(path);
+	const int no_viewer = is_null_or_empty(viewer);
+	if(!no_viewer && ft_viewer_kind(viewer) != VK_TEXTUAL)
+	{
+		cancel_prefetch(slot);
+		return;
+	}
+
+	if(slot->path != NULL && paths_are_equal(slot->path, path) &&
+			viewers_equal(slot->viewer, viewer))
+	{
+		/* Already in progress. */
+		return;
+	}
+
+	cancel_prefetch(slot);
+
+	if(previews_find(path, viewer) != NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&running_jobs_lock);
+	const int too_busy = (running_jobs >= MAX_PREFETCH_JOBS);
+	pthread_mutex_unlock(&running_jobs_lock);
+	if(too_busy)
+	{
+		/* Don't pile up viewers while previous ones are still running. */
+		return;
+	}
+
+	FILE *fp = NULL;
+	pid_t pgid = (pid_t)-1;
+	if(!no_viewer)
+	{
+		fp = start_viewer(view, pos, viewer, &prefetch_pa, &pgid);
+		if(fp == NULL)
+		{
+			return;
+		}
+	}
+
+	slot->job = job_start(path, fp, pgid);
+	if(slot->job == NULL)
+	{
+		if(fp != NULL)
+		{
+			kill_process_group(pgid);
+			fclose(fp);
+		}
+		return;
+	}
+
+	slot->path = strdup(path);
+	slot->viewer = (viewer == NULL) ? NULL : strdup(viewer);
+}
+
+/* Puts result of finished job of the slot into cache of previews and frees the
+ * slot. */
+static void
+finish_prefetch(prefetch_t *slot)
+{
+	strlist_t lines;
+	if(job_take(slot->job, &lines) == 0)
+	{
+		previews_put(slot->path, slot->viewer, lines);
+	}
+	slot->job = NULL;
+
+	cancel_prefetch(slot);
+}
+
+/* Takes job that prepares preview of the file with the viewer out of a
+ * prefetching slot.  Returns the job or NULL if there is no such job. */
+static preview_job_t *
+take_prefetch(const char path[], const char viewer[])
+{
+	size_t i;
+	for(i = 0U; i < ARRAY_LEN(prefetches); ++i)
+	{
+		prefetch_t *const slot = &prefetches[i];
+		if(slot->path != NULL && paths_are_equal(slot->path, path) &&
+				viewers_equal(slot->viewer, viewer))
+		{
+			preview_job_t *const job = slot->job;
+			slot->job = NULL;
+			cancel_prefetch(slot);
+			return job;
+		}
+	}
+	return NULL;
+}
+
+/* Stops preparing preview in the slot and frees the slot. */
+static void
+cancel_prefetch(prefetch_t *slot)
+{
+	if(slot->job != NULL)
+	{
+		job_cancel(slot->job);
+		slot->job = NULL;
+	}
+
+	update_string(&slot->path, NULL);
+	update_string(&slot->viewer, NULL);
+}
+
+/* Stops all prefetching. */
+static void
+cancel_prefetches(void)
+{
+	size_t i;
+	for(i = 0U; i < ARRAY_LEN(prefetches); ++i)
+	{
+		cancel_prefetch(&prefetches[i]);
+	}
+
+	update_string(&prefetch_around, NULL);
+	prefetch_view = NULL;
+	prefetch_at = -1;
+}
+
+/* Starts reading preview lines either from the stream (which is taken over
+ * along with process group of the viewer, (pid_t)-1 if none) or from the file
+ * if stream is NULL.  Returns new job or NULL on error. */
+static preview_job_t *
+job_start(const char path[], FILE *fp, pid_t pgid)
+{
+	preview_job_t *const job = calloc(1, sizeof(*job));
+	if(job == NULL)
+	{
+		return NULL;
+	}
+
+	job->path = strdup(path);
+	if(job->path == NULL)
+	{
+		free(job);
+		return NULL;
+	}
+
+	job->fp = fp;
+	job->pgid = pgid;
+	job->refs = 2;
+	pthread_mutex_init(&job->lock, NULL);
+	pthread_cond_init(&job->over, NULL);
+
+	pthread_mutex_lock(&running_jobs_lock);
+	++running_jobs;
+	pthread_mutex_unlock(&running_jobs_lock);
+
+	pthread_t thread;
+	if(pthread_create(&thread, NULL, &job_thread, job) == 0)
+	{
+		pthread_detach(thread);
+	}
+	else
+	{
+		/* Read the preview now if the thread can't be started. */
+		job_run(job);
+		job_release(job);
+	}
+	return job;
+}
+
+/* Entry point of the thread that reads preview lines.  Returns NULL. */
+static void *
+job_thread(void *arg)
+{
+	preview_job_t *const job = arg;
+
+	block_all_thread_signals();
+	job_run(job);
+	job_release(job);
+	return NULL;
+}
+
+/* Reads lines of preview and publishes them. */
+static void
+job_run(preview_job_t *job)
+{
+	int failed = 0;
+	strlist_t lines = { .nitems = 0, .items = NULL };
+
+	FILE *const fp = (job->fp != NULL) ? job->fp : os_fopen(job->path, "rb");
+	if(fp == NULL)
+	{
+		failed = 1;
+	}
+	else
+	{
+		lines = read_lines_of_job(fp, MAX_PREVIEW_LINES, job);
+		/* For viewers this breaks the pipe and makes them quit. */
+		fclose(fp);
+	}
+
+	pthread_mutex_lock(&job->lock);
+	job->failed = failed;
+	job->lines = lines;
+	job->done = 1;
+	pthread_cond_broadcast(&job->over);
+	const int cancelled = job->cancelled;
+	pthread_mutex_unlock(&job->lock);
+
+	pthread_mutex_lock(&running_jobs_lock);
+	--running_jobs;
+	pthread_mutex_unlock(&running_jobs_lock);
+
+	if(!cancelled)
+	{
+		wakeup_notify();
+	}
+}
+
+/* Waits for the job to finish, but no longer than timeout (in milliseconds).
+ * Returns non-zero if the job is over. */
+static int
+job_wait(preview_job_t *job, int timeout)
+{
+	struct timespec deadline;
+	get_deadline(timeout, &deadline);
+
+	pthread_mutex_lock(&job->lock);
+	while(!job->done)
+	{
+		if(pthread_cond_timedwait(&job->over, &job->lock, &deadline) != 0)
+		{
+			break;
+		}
+	}
+	const int done = job->done;
+	pthread_mutex_unlock(&job->lock);
+	return done;
+}
+
+/* Takes result of a finished job and drops reference to it.  Returns non-zero
+ * if the job has failed. */
+static int
+job_take(preview_job_t *job, strlist_t *lines)
+{
+	pthread_mutex_lock(&job->lock);
+	const int failed = job->failed;
+	*lines = job->lines;
+	job->lines = (strlist_t){ .nitems = 0, .items = NULL };
+	pthread_mutex_unlock(&job->lock);
+
+	job_release(job);
+	return failed;
+}
+
+/* Lets the job know that its result isn't needed and drops reference to it.
+ * Viewer of unfinished job is terminated, because it might never produce
+ * another line for the job to notice cancellation. */
+static void
+job_cancel(preview_job_t *job)
+{
+	pthread_mutex_lock(&job->lock);
+	job->cancelled = 1;
+	if(!job->done)
+	{
+		kill_process_group(job->pgid);
+	}
+	pthread_mutex_unlock(&job->lock);
+
+	job_release(job);
+}
+
+/* Drops a reference to the job freeing it when the last one is gone. */
+static void
+job_release(preview_job_t *job)
+{
+	pthread_mutex_lock(&job->lock);
+	const int refs = --job->refs;
+	pthread_mutex_unlock(&job->lock);
+
+	if(refs == 0)
+	{
+		pthread_cond_destroy(&job->over);
+		pthread_mutex_destroy(&job->lock);
+		free_string_array(job->lines.items, job->lines.nitems);
+		free(job->path);
+		free(job);
+	}
+}
+
+/* Looks up cached preview of the file produced by the viewer checking that the
+ * file hasn't changed since then.  Returns lines of the preview or NULL. */
+TSTATIC strlist_t *
+previews_find(const char path[], const char viewer[])
+{
+	cached_preview_t *preview = previews_newest;
+	while(preview != NULL)
+	{
+		if(paths_are_equal(preview->path, path) &&
+				viewers_equal(preview->viewer, viewer))
+		{
+			break;
+		}
+		preview = preview->older;
+	}
+
+	if(preview == NULL)
+	{
+		return NULL;
+	}
+
+	filemon_t filemon;
+	if(filemon_from_file(path, FMT_MODIFIED, &filemon) != 0 ||
+			!filemon_equal(&preview->filemon, &filemon))
+	{
+		previews_unlink(preview);
+		previews_free(preview);
+		return NULL;
+	}
+
+	/* Mark the preview as the most recently used one. */
+	previews_unlink(preview);
+	previews_link(preview);
+
+	return &preview->lines;
+}
+
+/* Adds preview of the file produced by the viewer to the cache taking
+ * ownership of the lines and evicting least recently used previews to stay
+ * within memory limit. */
+TSTATIC void
+previews_put(const char path[], const char viewer[], strlist_t lines)
+{
+	cached_preview_t *preview = calloc(1, sizeof(*preview));
+	if(preview == NULL)
+	{
+		free_string_array(lines.items, lines.nitems);
+		return;
+	}
+
+	/* File monitor must always be initialized, because it's compared later. */
+	(void)filemon_from_file(path, FMT_MODIFIED, &preview->filemon);
+	preview->path = strdup(path);
+	preview->viewer = (viewer == NULL) ? NULL : strdup(viewer);
+	preview->lines = lines;
+
+	preview->size = sizeof(*preview) + strlen(path) + 1U
+	              + (viewer == NULL ? 0U : strlen(viewer) + 1U)
+	              + lines.nitems*sizeof(*lines.items);
+	int i;
+	for(i = 0; i < lines.nitems; ++i)
+	{
+		preview->size += strlen(lines.items[i]) + 1U;
+	}
+
+	/* Replace previous version of the preview. */
+	cached_preview_t *old = previews_newest;
+	while(old != NULL)
+	{
+		if(paths_are_equal(old->path, path) && viewers_equal(old->viewer, viewer))
+		{
+			previews_unlink(old);
+			previews_free(old);
+			break;
+		}
+		old = old->older;
+	}
+
+	previews_link(preview);
+
+	const size_t limit = (size_t)cfg.preview_cache_size*1024U;
+	while(previews_size > limit)
+	{
+		cached_preview_t *const victim = previews_oldest;
+		previews_unlink(victim);
+		previews_free(victim);
+	}
+}
+
+/* Includes the preview into the list of cached previews as the most recently
+ * used one. */
+static void
+previews_link(cached_preview_t *preview)
+{
+	preview->older = previews_newest;
+	if(previews_newest == NULL)
+	{
+		previews_oldest = preview;
+	}
+	else
+	{
+		previews_newest->newer = preview;
+	}
+	previews_newest = preview;
+	previews_size += preview->size;
+}
+
+/* Excludes the preview from the list of cached previews. */
+static void
+previews_unlink(cached_preview_t *preview)
+{
+	if(preview->newer == NULL)
+	{
+		previews_newest = preview->older;
+	}
+	else
+	{
+		preview->newer->older = preview->older;
+	}
+
+	if(preview->older == NULL)
+	{
+		previews_oldest = preview->newer;
+	}
+	else
+	{
+		preview->older->newer = preview->newer;
+	}
+
+	preview->newer = NULL;
+	preview->older = NULL;
+	previews_size -= preview->size;
+}
+
+/* Frees preview that isn't in the list. */
+static void
+previews_free(cached_preview_t *preview)
+{
+	free_string_array(preview->lines.items, preview->lines.nitems);
+	free(preview->path);
+	free(preview->viewer);
+	free(preview);
+}
+
+/* Compares two viewers either of which can be NULL.  Returns non-zero if they
+ * are the same, otherwise zero is returned. */
+static int
+viewers_equal(const char a[], const char b[])
+{
+	return (a == NULL && b == NULL)
+	    || (a != NULL && b != NULL && strcmp(a, b) == 0);
+}
+
 /* Checks whether data in the cache is up to date with the file on disk.
  * Returns non-zero if so, otherwise zero is returned. */
 static int
 is_cache_valid(const quickview_cache_t *cache, const char path[],
 		const char viewer[], const preview_area_t *parea)
 {
-	int same_viewer = (cache->viewer == NULL && viewer == NULL)
-	               || (cache->viewer != NULL && viewer != NULL &&
-	                   strcmp(cache->viewer, viewer) == 0);
-
 	filemon_t filemon;
-	if(same_viewer &&
+	if(viewers_equal(cache->viewer, viewer) &&
 			filemon_from_file(path, FMT_MODIFIED, &filemon) == 0 &&
 			cache->path != NULL &&
 			paths_are_equal(cache->path, path) &&
@@ -419,6 +1362,15 @@ is_cache_valid(const quickview_cache_t *cache, const char path[],
 static void
 fill_cache(quickview_cache_t *cache, FILE *fp, const char path[],
 		const char viewer[], ViewerKind kind, const preview_area_t *parea)
+{
+	set_cache(cache, read_lines(fp, MAX_PREVIEW_LINES), path, viewer, kind,
+			parea);
+}
+
+/* Fills the cache data with preview lines taking ownership of them. */
+static void
+set_cache(quickview_cache_t *cache, strlist_t lines, const char path[],
+		const char viewer[], ViewerKind kind, const preview_area_t *parea)
 {
 	/* File monitor must always be initialized, because it's used below. */
 	filemon_t filemon = {};
@@ -429,7 +1381,7 @@ fill_cache(quickview_cache_t *cache, FILE *fp, const char path[],
 	update_string(&cache->viewer, viewer);
 
 	free_string_array(cache->lines.items, cache->lines.nitems);
-	cache->lines = read_lines(fp, MAX_PREVIEW_LINES);
+	cache->lines = lines;
 
 	cache->pa = *parea;
 	cache->beg_x = getbegx(parea->view->win);
@@ -442,6 +1394,14 @@ fill_cache(quickview_cache_t *cache, FILE *fp, const char path[],
  * read. */
 TSTATIC strlist_t
 read_lines(FILE *fp, int max_lines)
+{
+	return read_lines_of_job(fp, max_lines, NULL);
+}
+
+/* Reads at most max_lines from the stream ignoring BOM and stopping early if
+ * the job (can be NULL) is cancelled.  Returns the lines read. */
+static strlist_t
+read_lines_of_job(FILE *fp, int max_lines, preview_job_t *job)
 {
 	strlist_t lines = {};
 	skip_bom(fp);
@@ -449,6 +1409,18 @@ read_lines(FILE *fp, int max_lines)
 	char *next_line;
 	while(lines.nitems < max_lines && (next_line = read_line(fp, NULL)) != NULL)
 	{
+		if(job != NULL)
+		{
+			pthread_mutex_lock(&job->lock);
+			const int cancelled = job->cancelled;
+			pthread_mutex_unlock(&job->lock);
+			if(cancelled)
+			{
+				free(next_line);
+				break;
+			}
+		}
+
 		const int old_len = lines.nitems;
 		lines.nitems = put_into_string_array(&lines.items, lines.nitems, next_line);
 		if(lines.nitems == old_len)
@@ -480,8 +1452,14 @@ view_dir(const char path[], int max_lines)
 			.fp = fp,
 			.max = max_lines,
 		};
+		copy_str(s.path, sizeof(s.path), path);
 
-		if(print_dir_tree(&s, path, 0) == 0 && s.n != 0)
+		int len;
+		char **const lst = list_sorted_files(path, &len);
+		const int stopped = (len < 0 || print_dir_tree(&s, 0, lst, len) != 0);
+		free_string_array(lst, len);
+
+		if(!stopped && s.n != 0)
 		{
 			/* Print summary only if we visited the whole subtree. */
 			fprintf(fp, "%s\n%d director%s, %d file%s",
@@ -507,37 +1485,77 @@ view_dir(const char path[], int max_lines)
 	return fp;
 }
 
-/* Produces tree preview of the path.  Returns non-zero to request stopping of
- * the traversal, otherwise zero is returned. */
+/* Produces tree preview of the directory at s->path whose sorted entries are
+ * in the lst.  Returns non-zero to request stopping of the traversal, otherwise
+ * zero is returned. */
 static int
-print_dir_tree(tree_print_state_t *s, const char path[], int last)
+print_dir_tree(tree_print_state_t *s, int last, char *lst[], int len)
 {
 	int i;
 	int reached_limit;
+	const size_t path_len = strlen(s->path);
+	const size_t room = sizeof(s->path) - path_len;
 
-	int len;
-	char **lst = list_sorted_files(path, &len);
-
-	if(len < 0)
+	if(enter_dir(s, s->path, last) != 0)
 	{
-		free_string_array(lst, len);
 		return 1;
 	}
 
-	if(enter_dir(s, path, last) != 0)
+	/* Entries whose paths don't fit are skipped, so the last entry to be printed
+	 * might precede the last one of the list. */
+	int end = len;
+	while(end > 0 && !path_fits(room, lst[end - 1]))
 	{
-		free_string_array(lst, len);
-		return 1;
+		--end;
 	}
 
 	reached_limit = 0;
-	for(i = 0; i < len && !reached_limit && !ui_cancellation_requested(); ++i)
+	for(i = 0; i < end && !reached_limit && !ui_cancellation_requested(); ++i)
+	{
+		if(!path_fits(room, lst[i]))
+		{
+			continue;
+		}
+
+		/* Path of the entry is formed in place, this avoids allocating it. */
+		snprintf(s->path + path_len, room, "/%s", lst[i]);
+		reached_limit = print_dir_entry(s, i == end - 1);
+		s->path[path_len] = '\0';
+	}
+
+	leave_dir(s);
+
+	return reached_limit;
+}
+
+/* Checks whether path separator followed by the name fits into the room left
+ * in a path buffer.  Returns non-zero if so, otherwise zero is returned. */
+static int
+path_fits(size_t room, const char name[])
+{
+	return 1U + strlen(name) < room;
+}
+
+/* Produces tree preview of an entry at s->path.  Queries file system once per
+ * entry unless it's a symbolic link or a directory.  Returns non-zero to
+ * request stopping of the traversal, otherwise zero is returned. */
+static int
+print_dir_entry(tree_print_state_t *s, int last)
+{
+	struct stat st;
+	if(os_lstat(s->path, &st) != 0)
+	{
+		++s->nfiles;
+		return visit_file(s, s->path, last, 0);
+	}
+
+	if(S_ISLNK(st.st_mode))
 	{
 		char link_target[PATH_MAX + 1];
-		const int last_entry = (i == len - 1);
-		char *const full_path = format_str("%s/%s", path, lst[i]);
 
-		if(is_dir(full_path))
+		/* Symbolic links are counted according to their targets. */
+		const int target_is_dir = is_dir(s->path);
+		if(target_is_dir)
 		{
 			++s->ndirs;
 		}
@@ -546,38 +1564,40 @@ print_dir_tree(tree_print_state_t *s, const char path[], int last)
 			++s->nfiles;
 		}
 
-		if(get_link_target(full_path, link_target, sizeof(link_target)) == 0)
+		if(get_link_target(s->path, link_target, sizeof(link_target)) == 0)
 		{
-			if(visit_link(s, full_path, last_entry, link_target) != 0)
-			{
-				reached_limit = 1;
-			}
+			return visit_link(s, s->path, last, target_is_dir, link_target);
 		}
-		/* If is_dir_empty() returns non-zero than we know that it's directory and
-		 * no additional checks are needed. */
-		else if(!is_dir_empty(full_path))
-		{
-			if(last_entry)
-			{
-				set_prefix_char(s, '`');
-			}
-			if(print_dir_tree(s, full_path, last_entry) != 0)
-			{
-				reached_limit = 1;
-			}
-		}
-		else if(visit_file(s, full_path, last_entry) != 0)
+		return visit_file(s, s->path, last, target_is_dir);
+	}
+
+	if(!S_ISDIR(st.st_mode))
+	{
+		++s->nfiles;
+		return visit_file(s, s->path, last, 0);
+	}
+
+	++s->ndirs;
+
+	int len;
+	int result;
+	char **const lst = list_sorted_files(s->path, &len);
+	/* Empty and unreadable directories are displayed as files. */
+	if(len > 0)
+	{
+		if(last)
 		{
-			reached_limit = 1;
+			set_prefix_char(s, '`');
 		}
-
-		free(full_path);
+		result = print_dir_tree(s, last, lst, len);
+	}
+	else
+	{
+		result = visit_file(s, s->path, last, 1);
 	}
 	free_string_array(lst, len);
 
-	leave_dir(s);
-
-	return reached_limit;
+	return result;
 }
 
 /* Handles entering directory on directory tree traversal.  Returns non-zero to
@@ -585,7 +1605,7 @@ print_dir_tree(tree_print_state_t *s, const char path[], int last)
 static int
 enter_dir(tree_print_state_t *s, const char path[], int last)
 {
-	print_tree_entry(s, path, 1);
+	print_tree_entry(s, path, 1, 1);
 
 	if(last)
 	{
@@ -598,13 +1618,14 @@ enter_dir(tree_print_state_t *s, const char path[], int last)
 	return ++s->n >= s->max;
 }
 
-/* Handles visiting file on directory tree traversal.  Returns non-zero to
- * request stopping of the traversal, otherwise zero is returned. */
+/* Handles visiting file (or something displayed like one) on directory tree
+ * traversal.  Returns non-zero to request stopping of the traversal, otherwise
+ * zero is returned. */
 static int
-visit_file(tree_print_state_t *s, const char path[], int last)
+visit_file(tree_print_state_t *s, const char path[], int last, int as_dir)
 {
 	set_prefix_char(s, last ? '`' : '|');
-	print_tree_entry(s, path, 1);
+	print_tree_entry(s, path, as_dir, 1);
 
 	return ++s->n >= s->max;
 }
@@ -612,11 +1633,11 @@ visit_file(tree_print_state_t *s, const char path[], int last)
 /* Handles visiting symbolic link on directory tree traversal.  Returns non-zero
  * to request stopping of the traversal, otherwise zero is returned. */
 static int
-visit_link(tree_print_state_t *s, const char path[], int last,
+visit_link(tree_print_state_t *s, const char path[], int last, int as_dir,
 		const char target[])
 {
 	set_prefix_char(s, last ? '`' : '|');
-	print_tree_entry(s, path, 0);
+	print_tree_entry(s, path, as_dir, 0);
 	fputs(" -> ", s->fp);
 	fputs(target, s->fp);
 	fputc('\n', s->fp);
@@ -659,13 +1680,15 @@ set_prefix_char(tree_print_state_t *s, char c)
 	}
 }
 
-/* Prints single entry of directory tree. */
+/* Prints single entry of directory tree.  The as_dir flag specifies whether
+ * entry should be displayed as a directory. */
 static void
-print_tree_entry(tree_print_state_t *s, const char path[], int end_line)
+print_tree_entry(tree_print_state_t *s, const char path[], int as_dir,
+		int end_line)
 {
 	print_entry_prefix(s);
 	fputs(get_last_path_component(path), s->fp);
-	if(is_dir(path) && !ends_with_slash(path))
+	if(as_dir && !ends_with_slash(path))
 	{
 		fputc('/', s->fp);
 	}
@@ -55,6 +55,16 @@ int qv_can_show(void);
  * doesn't make sense (e.g. only one pane is visible). */
 void qv_draw(struct view_t *view);
 
+/* Starts viewer of a file on which cursor stayed long enough and displays
+ * previews that were prepared in the background.  Should be called
+ * periodically. */
+void qv_check_for_updates(void);
+
+/* Computes for how long main loop can sleep before qv_check_for_updates() has
+ * something to do that it won't be woken up for.  Returns the time in
+ * milliseconds or -1 if there is no such limit. */
+int qv_get_check_delay(void);
+
 /* Draws file entry on an area. */
 void qv_draw_on(const struct dir_entry_t *entry, const preview_area_t *parea);
 
@@ -92,6 +102,9 @@ void qv_ui_updated(void);
 TSTATIC_DEFS(
 	struct strlist_t;
 	struct strlist_t read_lines(FILE *fp, int max_lines);
+	struct strlist_t * previews_find(const char path[], const char viewer[]);
+	void previews_put(const char path[], const char viewer[],
+			struct strlist_t lines);
 )
 
 #endif /* VIFM__UI__QUICKVIEW_H__ */
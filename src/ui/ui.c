@@ -63,6 +63,7 @@
 #include "../utils/string_array.h"
 #include "../utils/utf8.h"
 #include "../utils/utils.h"
+#include "../utils/wakeup.h"
 #include "../event_loop.h"
 #include "../filelist.h"
 #include "../flist_sel.h"
@@ -2387,6 +2388,7 @@ ui_view_schedule_redraw(view_t *view)
 	pthread_mutex_lock(view->timestamps_mutex);
 	view->postponed_redraw = get_updated_time(view->postponed_redraw);
 	pthread_mutex_unlock(view->timestamps_mutex);
+	wakeup_notify();
 }
 
 void
@@ -2395,6 +2397,7 @@ ui_view_schedule_reload(view_t *view)
 	pthread_mutex_lock(view->timestamps_mutex);
 	view->postponed_reload = get_updated_time(view->postponed_reload);
 	pthread_mutex_unlock(view->timestamps_mutex);
+	wakeup_notify();
 }
 
 /* Gets updated timestamp ensuring that it's always greater than the previous
@@ -352,6 +352,18 @@ struct view_t
 	/* Monitor that checks for directory changes. */
 	fswatch_t *watch;
 	char watched_dir[PATH_MAX + 1];
+	/* Whether the monitor watches directories of custom list instead of just
+	 * watched_dir. */
+	int watch_is_custom;
+
+	/* Reader of current directory while it's being loaded asynchronously.  NULL
+	 * when the list is complete. */
+	struct dirreader_t *dir_reader;
+	/* Number of read entries at the moment of the last update of the list. */
+	int dir_reader_shown;
+	/* Cursor position set by lookup in history or -1 when the lookup shouldn't
+	 * be retried on updates of the list. */
+	int dir_reader_hist_pos;
 
 	char last_dir[PATH_MAX + 1];
 
@@ -407,6 +419,11 @@ struct view_t
 	char *sort_groups, *sort_groups_g;
 	/* Primary group in compiled form. */
 	regex_t primary_group;
+	/* All sorting groups in compiled form, valid for the value of
+	 * sort_groups_re_src, which is either sort_groups or sort_groups_g. */
+	regex_t *sort_groups_re;
+	int sort_groups_re_count;
+	char *sort_groups_re_src;
 
 	int history_num;    /* Number of used history elements. */
 	int history_pos;    /* Current position in history. */
@@ -0,0 +1,454 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "dirreader.h"
+
+#include <dirent.h> /* DIR */
+
+#include <stddef.h> /* NULL */
+#include <stdlib.h> /* free() malloc() */
+#include <string.h> /* memcpy() strcmp() strdup() */
+#include <time.h> /* timespec */
+
+#include "../compat/fs_limits.h"
+#include "../compat/os.h"
+#include "../compat/pthread.h"
+#include "../compat/reallocarray.h"
+#include "parallel.h"
+#include "path.h"
+#include "utils.h"
+
+/* Number of entries collected by the thread before publishing them. */
+#define BATCH_SIZE 64
+
+/* Growable array of entries. */
+typedef struct
+{
+	dirreader_entry_t *items; /* Entries. */
+	int count;                /* Number of entries. */
+	int capacity;             /* Number of allocated entries. */
+}
+entry_list_t;
+
+/* Argument for stat_entry(). */
+typedef struct
+{
+	const char *dir;     /* Path to the directory. */
+	entry_list_t *batch; /* Entries to query. */
+	char *failed;        /* Flags of entries for which querying failed. */
+}
+stat_batch_t;
+
+/* Reader state shared by the caller and background thread. */
+struct dirreader_t
+{
+	char *path;   /* Path to the directory being read. */
+	int nthreads; /* Number of threads to use for querying metadata. */
+
+	pthread_mutex_t lock; /* Protects fields below. */
+	pthread_cond_t cond;  /* Signaled when reading is finished. */
+	entry_list_t pending; /* Entries not yet synchronized with the caller. */
+	int done;             /* Whether background thread has finished. */
+	int failed;           /* Whether reading failed. */
+	int cancelled;        /* Whether reading should be aborted. */
+	int refs;             /* Number of users (at most thread and caller). */
+
+	/* These fields are accessed only by the caller. */
+	entry_list_t synced; /* Entries available via dirreader_get(). */
+	int synced_done;     /* Whether all entries were synchronized. */
+};
+
+static void * read_thread(void *arg);
+static int read_dir(dirreader_t *reader);
+static int flush(dirreader_t *reader, parallel_pool_t *pool,
+		entry_list_t *batch);
+static void stat_entry(int index, void *arg);
+static int publish(dirreader_t *reader, entry_list_t *batch);
+static int append_entry(entry_list_t *list, const dirreader_entry_t *entry);
+static int extend_list(entry_list_t *list, int by);
+static void free_list(entry_list_t *list);
+static void release(dirreader_t *reader);
+
+dirreader_t *
+dirreader_start(const char path[], int nthreads)
+{
+#ifdef _WIN32
+	/* Windows version of directory listing relies on data which isn't collected
+	 * here. */
+	return NULL;
+#else
+	dirreader_t *const reader = malloc(sizeof(*reader));
+	if(reader == NULL)
+	{
+		return NULL;
+	}
+
+	reader->path = strdup(path);
+	if(reader->path == NULL)
+	{
+		free(reader);
+		return NULL;
+	}
+
+	reader->nthreads = nthreads;
+	pthread_mutex_init(&reader->lock, NULL);
+	pthread_cond_init(&reader->cond, NULL);
+	reader->pending = (entry_list_t){};
+	reader->done = 0;
+	reader->failed = 0;
+	reader->cancelled = 0;
+	reader->refs = 2;
+	reader->synced = (entry_list_t){};
+	reader->synced_done = 0;
+
+	pthread_t id;
+	if(pthread_create(&id, NULL, &read_thread, reader) != 0)
+	{
+		reader->refs = 1;
+		release(reader);
+		return NULL;
+	}
+
+	return reader;
+#endif
+}
+
+void
+dirreader_free(dirreader_t *reader)
+{
+	if(reader == NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&reader->lock);
+	reader->cancelled = 1;
+	pthread_mutex_unlock(&reader->lock);
+
+	release(reader);
+}
+
+const char *
+dirreader_get_path(const dirreader_t *reader)
+{
+	return reader->path;
+}
+
+int
+dirreader_wait(dirreader_t *reader, int timeout_ms)
+{
+	struct timespec deadline;
+	int done;
+
+	if(timeout_ms >= 0)
+	{
+		get_deadline(timeout_ms, &deadline);
+	}
+
+	pthread_mutex_lock(&reader->lock);
+	while(!reader->done)
+	{
+		if(timeout_ms < 0)
+		{
+			pthread_cond_wait(&reader->cond, &reader->lock);
+		}
+		else if(pthread_cond_timedwait(&reader->cond, &reader->lock,
+					&deadline) != 0)
+		{
+			break;
+		}
+	}
+	done = reader->done;
+	pthread_mutex_unlock(&reader->lock);
+
+	return done;
+}
+
+int
+dirreader_sync(dirreader_t *reader)
+{
+	if(reader->synced_done)
+	{
+		return 1;
+	}
+
+	pthread_mutex_lock(&reader->lock);
+
+	if(reader->synced.count == 0)
+	{
+		/* Just take the whole array to avoid copying. */
+		free_list(&reader->synced);
+		reader->synced = reader->pending;
+		reader->pending = (entry_list_t){};
+	}
+	else if(reader->pending.count != 0 &&
+			extend_list(&reader->synced, reader->pending.count) == 0)
+	{
+		memcpy(&reader->synced.items[reader->synced.count], reader->pending.items,
+				sizeof(*reader->pending.items)*reader->pending.count);
+		reader->synced.count += reader->pending.count;
+		reader->pending.count = 0;
+	}
+
+	reader->synced_done = (reader->done && reader->pending.count == 0);
+
+	pthread_mutex_unlock(&reader->lock);
+
+	return reader->synced_done;
+}
+
+const dirreader_entry_t *
+dirreader_get(const dirreader_t *reader, int *count)
+{
+	*count = reader->synced.count;
+	return reader->synced.items;
+}
+
+int
+dirreader_failed(const dirreader_t *reader)
+{
+	return reader->synced_done && reader->failed;
+}
+
+/* Entry point of the background thread.  Returns NULL. */
+static void *
+read_thread(void *arg)
+{
+	dirreader_t *const reader = arg;
+
+	(void)pthread_detach(pthread_self());
+	block_all_thread_signals();
+
+	const int failed = read_dir(reader);
+
+	pthread_mutex_lock(&reader->lock);
+	if(failed)
+	{
+		reader->failed = 1;
+	}
+	reader->done = 1;
+	pthread_cond_broadcast(&reader->cond);
+	pthread_mutex_unlock(&reader->lock);
+
+	release(reader);
+	return NULL;
+}
+
+/* Enumerates directory contents publishing them in batches.  Returns non-zero
+ * if directory couldn't be opened or its entries couldn't be stored, otherwise
+ * zero is returned. */
+static int
+read_dir(dirreader_t *reader)
+{
+	DIR *dir;
+	struct dirent *d;
+	entry_list_t batch = {};
+	int failed = 0;
+
+	dir = os_opendir(reader->path);
+	if(dir == NULL)
+	{
+		return 1;
+	}
+
+	/* Threads are started once for all the batches. */
+	parallel_pool_t pool;
+	parallel_pool_start(&pool, reader->nthreads);
+
+	while((d = os_readdir(dir)) != NULL)
+	{
+		dirreader_entry_t entry;
+
+		if(strcmp(d->d_name, ".") == 0 || strcmp(d->d_name, "..") == 0)
+		{
+			continue;
+		}
+
+		entry.name = strdup(d->d_name);
+		if(entry.name == NULL || append_entry(&batch, &entry) != 0)
+		{
+			free(entry.name);
+			failed = 1;
+			break;
+		}
+
+		if(batch.count == BATCH_SIZE && flush(reader, &pool, &batch) != 0)
+		{
+			break;
+		}
+	}
+	os_closedir(dir);
+
+	if(!failed)
+	{
+		(void)flush(reader, &pool, &batch);
+	}
+	free_list(&batch);
+	parallel_pool_stop(&pool);
+	return failed;
+}
+
+/* Queries metadata of entries of the batch using threads of the pool and
+ * publishes them.  Returns non-zero if reading should be stopped, otherwise
+ * zero is returned. */
+static int
+flush(dirreader_t *reader, parallel_pool_t *pool, entry_list_t *batch)
+{
+	char failed[BATCH_SIZE] = {};
+	stat_batch_t arg = { .dir = reader->path, .batch = batch, .failed = failed };
+	int i, j;
+
+	parallel_pool_for(pool, batch->count, &stat_entry, &arg);
+
+	/* Files can disappear between readdir() and lstat(), just skip them. */
+	j = 0;
+	for(i = 0; i < batch->count; ++i)
+	{
+		if(failed[i])
+		{
+			free(batch->items[i].name);
+		}
+		else
+		{
+			batch->items[j++] = batch->items[i];
+		}
+	}
+	batch->count = j;
+
+	return publish(reader, batch);
+}
+
+/* Queries metadata of a single entry of a batch.  Might be invoked from
+ * several threads at once. */
+static void
+stat_entry(int index, void *arg)
+{
+	stat_batch_t *const data = arg;
+	dirreader_entry_t *const entry = &data->batch->items[index];
+	char full_path[PATH_MAX + 1];
+
+	build_path(full_path, sizeof(full_path), data->dir, entry->name);
+	data->failed[index] = (os_lstat(full_path, &entry->s) != 0);
+}
+
+/* Moves collected entries to the list of pending entries.  Marks reading as
+ * failed if entries can't be stored.  Returns non-zero if reading should be
+ * stopped, otherwise zero is returned. */
+static int
+publish(dirreader_t *reader, entry_list_t *batch)
+{
+	int stop;
+
+	pthread_mutex_lock(&reader->lock);
+	stop = reader->cancelled;
+	if(!stop && batch->count != 0)
+	{
+		if(extend_list(&reader->pending, batch->count) == 0)
+		{
+			memcpy(&reader->pending.items[reader->pending.count], batch->items,
+					sizeof(*batch->items)*batch->count);
+			reader->pending.count += batch->count;
+			batch->count = 0;
+		}
+		else
+		{
+			reader->failed = 1;
+			stop = 1;
+		}
+	}
+	pthread_mutex_unlock(&reader->lock);
+
+	return stop;
+}
+
+/* Appends entry to the list.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+append_entry(entry_list_t *list, const dirreader_entry_t *entry)
+{
+	if(extend_list(list, 1) != 0)
+	{
+		return 1;
+	}
+
+	list->items[list->count++] = *entry;
+	return 0;
+}
+
+/* Makes sure that list has enough space for specified number of additional
+ * elements.  Returns zero on success, otherwise non-zero is returned. */
+static int
+extend_list(entry_list_t *list, int by)
+{
+	if(list->count + by <= list->capacity)
+	{
+		return 0;
+	}
+
+	int capacity = MAX(list->capacity*2, list->count + by);
+	capacity = MAX(capacity, BATCH_SIZE);
+
+	void *const items = reallocarray(list->items, capacity, sizeof(*list->items));
+	if(items == NULL)
+	{
+		return 1;
+	}
+
+	list->items = items;
+	list->capacity = capacity;
+	return 0;
+}
+
+/* Frees list of entries along with their names. */
+static void
+free_list(entry_list_t *list)
+{
+	int i;
+	for(i = 0; i < list->count; ++i)
+	{
+		free(list->items[i].name);
+	}
+	free(list->items);
+	*list = (entry_list_t){};
+}
+
+/* Drops a reference to the reader freeing it when the last one is gone. */
+static void
+release(dirreader_t *reader)
+{
+	int refs;
+
+	pthread_mutex_lock(&reader->lock);
+	refs = --reader->refs;
+	pthread_mutex_unlock(&reader->lock);
+
+	if(refs != 0)
+	{
+		return;
+	}
+
+	free_list(&reader->pending);
+	free_list(&reader->synced);
+	pthread_cond_destroy(&reader->cond);
+	pthread_mutex_destroy(&reader->lock);
+	free(reader->path);
+	free(reader);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,77 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__DIRREADER_H__
+#define VIFM__UTILS__DIRREADER_H__
+
+#include <sys/stat.h> /* struct stat */
+
+/* Asynchronous reader of directory contents.  Enumerates files of a directory
+ * and queries their metadata on a separate thread, so that caller can make use
+ * of partial results while reading is still in progress.
+ *
+ * All functions except for dirreader_start() and dirreader_free() must be
+ * called from the same thread that started the reader. */
+
+/* Opaque type of a reader. */
+typedef struct dirreader_t dirreader_t;
+
+/* Single file read from a directory. */
+typedef struct
+{
+	char *name;    /* Name of the file. */
+	struct stat s; /* Result of lstat() on the file. */
+}
+dirreader_entry_t;
+
+/* Starts reading directory specified by the path in background.  Metadata is
+ * queried using up to nthreads threads.  "." and ".." are never reported.
+ * Returns the reader or NULL on error or if asynchronous reading isn't
+ * supported. */
+dirreader_t * dirreader_start(const char path[], int nthreads);
+
+/* Stops reading and frees resources of the reader.  The reader can be NULL. */
+void dirreader_free(dirreader_t *reader);
+
+/* Retrieves path to the directory being read.  Returns the path. */
+const char * dirreader_get_path(const dirreader_t *reader);
+
+/* Waits for reading to finish for at most timeout_ms milliseconds (negative
+ * value means no limit).  Returns non-zero if reading is finished, otherwise
+ * zero is returned. */
+int dirreader_wait(dirreader_t *reader, int timeout_ms);
+
+/* Makes entries read by the background thread so far available via
+ * dirreader_get().  Returns non-zero if reading is finished and all entries
+ * are available, otherwise zero is returned. */
+int dirreader_sync(dirreader_t *reader);
+
+/* Retrieves entries made available by the last call of dirreader_sync().  The
+ * array remains valid until next dirreader_sync() or dirreader_free().  Returns
+ * pointer to the first entry, *count is set to number of entries. */
+const dirreader_entry_t * dirreader_get(const dirreader_t *reader, int *count);
+
+/* Checks whether reading failed because directory couldn't be opened or there
+ * wasn't enough memory to store all of its entries.  Partial results shouldn't
+ * be used in this case.  Returns non-zero if so, otherwise zero is returned. */
+int dirreader_failed(const dirreader_t *reader);
+
+#endif /* VIFM__UTILS__DIRREADER_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
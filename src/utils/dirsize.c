@@ -0,0 +1,726 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "dirsize.h"
+
+#ifndef _WIN32
+#include <fcntl.h> /* AT_FDCWD AT_SYMLINK_NOFOLLOW O_CLOEXEC O_DIRECTORY
+                      O_NOFOLLOW O_RDONLY openat() */
+#include <sys/stat.h> /* S_ISDIR fstatat() stat */
+#include <sys/types.h> /* dev_t ino_t */
+#include <unistd.h> /* close() dup() */
+#endif
+
+#include <dirent.h> /* DIR dirent dirfd() fdopendir() */
+#include <errno.h> /* EMFILE ENFILE errno */
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uint64_t */
+#include <stdlib.h> /* calloc() free() */
+#include <string.h> /* strdup() */
+#include <time.h> /* timespec */
+
+#include "../compat/os.h"
+#include "../compat/pthread.h"
+#include "../compat/reallocarray.h"
+#include "cancellation.h"
+#include "fs.h"
+#include "macros.h"
+#include "parallel.h"
+#include "path.h"
+#include "utils.h"
+
+#if !defined(_WIN32) && defined(AT_FDCWD)
+/* Files and subdirectories are inspected relative to file descriptor of their
+ * directory, which saves resolving the whole path for each of them. */
+#define FD_RELATIVE_STAT
+#endif
+
+/* Number of entries after which calling thread checks for cancellation. */
+#define CANCELLATION_CHECK_PERIOD 64
+
+/* How long calling thread waits for work before checking for cancellation. */
+#define IDLE_WAIT_MS 50
+
+#ifdef FD_RELATIVE_STAT
+/* Identity of a file with several hard links. */
+typedef struct
+{
+	dev_t dev;     /* Device of the file. */
+	ino_t ino;     /* Inode of the file. */
+	uint64_t size; /* Size of the file. */
+	int used;      /* Whether this slot of a table is taken. */
+}
+inode_t;
+
+/* Set of files with several hard links. */
+typedef struct
+{
+	inode_t *items;  /* Hash table of files. */
+	size_t count;    /* Number of used slots. */
+	size_t capacity; /* Number of slots (a power of two). */
+	uint64_t size;   /* Total size of files in the set. */
+	uint64_t lost;   /* Part of the size that comes from files that couldn't
+	                    be remembered. */
+}
+inode_set_t;
+#endif
+
+/* Directory whose size is being calculated. */
+typedef struct dir_t
+{
+	char *path;            /* Path to the directory. */
+	const char *name;      /* Last component of the path. */
+	struct dir_t *parent;  /* Parent directory or NULL for the root. */
+	uint64_t size;         /* Size of files and finished subdirectories. */
+	int pending;           /* Number of unfinished subdirectories (+1 while the
+	                          directory itself is being read). */
+	int failed;            /* Whether directory couldn't be read. */
+#ifdef FD_RELATIVE_STAT
+	int fd;                /* Descriptor of the directory for opening its
+	                          subdirectories or -1. */
+	inode_set_t links;     /* Files with several hard links found in the
+	                          directory and its finished subdirectories, these
+	                          aren't part of the size field. */
+#endif
+}
+dir_t;
+
+/* Directories waiting to be processed by a thread.  The owner takes them from
+ * the end (depth-first), other threads steal from the beginning. */
+typedef struct
+{
+	pthread_mutex_t lock; /* Protects fields below. */
+	dir_t **items;        /* Buffer of directories. */
+	int head;             /* Index of the first directory. */
+	int tail;             /* Index past the last directory. */
+	int capacity;         /* Size of the buffer. */
+}
+deque_t;
+
+/* State of calculation shared among threads. */
+typedef struct
+{
+	dirsize_lookup_func lookup;         /* Lookup of known sizes or NULL. */
+	dirsize_report_func report;         /* Receiver of results or NULL. */
+	void *arg;                          /* Argument for the callbacks. */
+	const cancellation_t *cancellation; /* Checked by calling thread. */
+
+	deque_t deques[PARALLEL_MAX_THREADS]; /* Per-thread queues of dirs. */
+	int nthreads;                         /* Number of threads including
+	                                         calling one. */
+
+	pthread_mutex_t lock;    /* Protects fields below and sizes of dirs. */
+	pthread_cond_t changed;  /* Signaled on adding work and on finishing. */
+	int nqueued;             /* Number of directories in queues. */
+	int nunfinished;         /* Number of directories that aren't done. */
+	int cancelled;           /* Whether calculation was cancelled. */
+	uint64_t result;         /* Size of the root. */
+}
+pool_t;
+
+static void worker_thread(int index, void *arg);
+static void work(pool_t *pool, int index);
+static void wait_for_work(pool_t *pool, int index);
+static dir_t * take_dir(pool_t *pool, int index);
+static void process_dir(pool_t *pool, int index, dir_t *dir);
+static DIR * open_dir(const dir_t *dir);
+static void add_subdir(pool_t *pool, int index, dir_t *dir, char path[]);
+static int push_dir(deque_t *deque, dir_t *dir);
+static void finish_dir(pool_t *pool, dir_t *dir, uint64_t size, void *links);
+static void free_dir(dir_t *dir);
+static int is_cancelled(pool_t *pool, int index);
+#ifdef FD_RELATIVE_STAT
+static void merge_links(inode_set_t *to, inode_set_t *from);
+static void add_link(inode_set_t *set, dev_t dev, ino_t ino, uint64_t size);
+static int grow_links(inode_set_t *set);
+static void insert_link(inode_set_t *set, const inode_t *inode);
+#endif
+
+uint64_t
+dirsize_calc(const char path[], int nthreads, dirsize_lookup_func lookup,
+		dirsize_report_func report, void *arg,
+		const cancellation_t *cancellation)
+{
+	parallel_team_t team;
+	int i;
+
+	if(cancellation_requested(cancellation))
+	{
+		return 0U;
+	}
+
+	pool_t *const pool = calloc(1, sizeof(*pool));
+	dir_t *const root = calloc(1, sizeof(*root));
+	if(pool == NULL || root == NULL || (root->path = strdup(path)) == NULL)
+	{
+		free(root);
+		free(pool);
+		return 0U;
+	}
+
+	pool->lookup = lookup;
+	pool->report = report;
+	pool->arg = arg;
+	pool->cancellation = cancellation;
+	pool->nthreads = MAX(1, MIN(nthreads, PARALLEL_MAX_THREADS));
+
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->changed, NULL);
+	for(i = 0; i < pool->nthreads; ++i)
+	{
+		pthread_mutex_init(&pool->deques[i].lock, NULL);
+	}
+
+	root->name = root->path;
+	root->pending = 1;
+#ifdef FD_RELATIVE_STAT
+	root->fd = -1;
+#endif
+	pool->nunfinished = 1;
+	pool->nqueued = 1;
+	if(push_dir(&pool->deques[0], root) != 0)
+	{
+		/* Let the root be processed as if it were taken from the queue. */
+		pool->nqueued = 0;
+		process_dir(pool, 0, root);
+	}
+
+	/* Calling thread is the first one. */
+	(void)parallel_team_start(&team, pool->nthreads - 1, &worker_thread, pool);
+	work(pool, 0);
+	parallel_team_join(&team);
+
+	const uint64_t result = (pool->cancelled ? 0U : pool->result);
+
+	for(i = 0; i < pool->nthreads; ++i)
+	{
+		pthread_mutex_destroy(&pool->deques[i].lock);
+		free(pool->deques[i].items);
+	}
+	pthread_cond_destroy(&pool->changed);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool);
+
+	return result;
+}
+
+/* Body of additional threads. */
+static void
+worker_thread(int index, void *arg)
+{
+	work(arg, index + 1);
+}
+
+/* Processes directories until all of them are done. */
+static void
+work(pool_t *pool, int index)
+{
+	while(1)
+	{
+		dir_t *const dir = take_dir(pool, index);
+		if(dir != NULL)
+		{
+			process_dir(pool, index, dir);
+			continue;
+		}
+
+		pthread_mutex_lock(&pool->lock);
+		const int done = (pool->nunfinished == 0);
+		pthread_mutex_unlock(&pool->lock);
+
+		if(done)
+		{
+			break;
+		}
+
+		wait_for_work(pool, index);
+		(void)is_cancelled(pool, index);
+	}
+}
+
+/* Waits until there are queued directories or all of them are done.  Calling
+ * thread waits for a limited time to be able to check for cancellation. */
+static void
+wait_for_work(pool_t *pool, int index)
+{
+	pthread_mutex_lock(&pool->lock);
+	/* Number of queued directories can be temporarily negative if one is taken
+	 * before it's counted. */
+	if(pool->nqueued <= 0 && pool->nunfinished != 0)
+	{
+		if(index == 0)
+		{
+			struct timespec deadline;
+			get_deadline(IDLE_WAIT_MS, &deadline);
+			(void)pthread_cond_timedwait(&pool->changed, &pool->lock, &deadline);
+		}
+		else
+		{
+			pthread_cond_wait(&pool->changed, &pool->lock);
+		}
+	}
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/* Takes directory from own queue or steals one from queues of other threads.
+ * Returns the directory or NULL if all queues are empty. */
+static dir_t *
+take_dir(pool_t *pool, int index)
+{
+	dir_t *dir = NULL;
+	int i;
+
+	deque_t *deque = &pool->deques[index];
+	pthread_mutex_lock(&deque->lock);
+	if(deque->tail != deque->head)
+	{
+		dir = deque->items[--deque->tail];
+	}
+	pthread_mutex_unlock(&deque->lock);
+
+	for(i = 1; i < pool->nthreads && dir == NULL; ++i)
+	{
+		deque = &pool->deques[(index + i)%pool->nthreads];
+		pthread_mutex_lock(&deque->lock);
+		if(deque->tail != deque->head)
+		{
+			dir = deque->items[deque->head++];
+		}
+		pthread_mutex_unlock(&deque->lock);
+	}
+
+	if(dir != NULL)
+	{
+		pthread_mutex_lock(&pool->lock);
+		--pool->nqueued;
+		pthread_mutex_unlock(&pool->lock);
+	}
+
+	return dir;
+}
+
+/* Sums up sizes of files of the directory and queues its subdirectories. */
+static void
+process_dir(pool_t *pool, int index, dir_t *dir)
+{
+	struct dirent *d;
+	uint64_t size = 0U;
+	int nentries = 0;
+#ifdef FD_RELATIVE_STAT
+	/* Owned by this thread until the directory is finished. */
+	inode_set_t links = {};
+	inode_set_t *const links_ptr = &links;
+#else
+	void *const links_ptr = NULL;
+#endif
+
+	DIR *const dp = is_cancelled(pool, index) ? NULL : open_dir(dir);
+	if(dp == NULL)
+	{
+		dir->failed = 1;
+		finish_dir(pool, dir, 0U, links_ptr);
+		return;
+	}
+
+	while((d = os_readdir(dp)) != NULL)
+	{
+		if(is_builtin_dir(d->d_name))
+		{
+			continue;
+		}
+
+		if(++nentries%CANCELLATION_CHECK_PERIOD == 0 && is_cancelled(pool, index))
+		{
+			break;
+		}
+
+#ifdef FD_RELATIVE_STAT
+		int is_subdir = 0;
+#if defined(HAVE_STRUCT_DIRENT_D_TYPE) && HAVE_STRUCT_DIRENT_D_TYPE
+		/* Directories don't need to be queried, their size isn't counted. */
+		is_subdir = (d->d_type == DT_DIR);
+#endif
+		if(!is_subdir)
+		{
+			struct stat st;
+			if(fstatat(dirfd(dp), d->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+			{
+				continue;
+			}
+			if(!S_ISDIR(st.st_mode))
+			{
+				if(st.st_nlink > 1)
+				{
+					add_link(&links, st.st_dev, st.st_ino, (uint64_t)st.st_size);
+				}
+				else
+				{
+					size += (uint64_t)st.st_size;
+				}
+				continue;
+			}
+		}
+
+		if(dir->fd == -1)
+		{
+			/* Subdirectories can be opened by path if this fails. */
+			dir->fd = dup(dirfd(dp));
+		}
+
+		char *const path = join_paths(dir->path, d->d_name);
+#else
+		char *const path = join_paths(dir->path, d->d_name);
+		if(entry_is_link(path, d) || !entry_is_dir(path, d))
+		{
+			size += get_file_size(path);
+			free(path);
+			continue;
+		}
+#endif
+
+		if(path != NULL)
+		{
+			add_subdir(pool, index, dir, path);
+		}
+	}
+	os_closedir(dp);
+
+	finish_dir(pool, dir, size, links_ptr);
+}
+
+/* Opens directory for reading, relative to its parent if possible.  Returns
+ * the stream or NULL on error. */
+static DIR *
+open_dir(const dir_t *dir)
+{
+#ifdef FD_RELATIVE_STAT
+	if(dir->parent != NULL && dir->parent->fd != -1)
+	{
+		const int fd = openat(dir->parent->fd, dir->name,
+				O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+		if(fd != -1)
+		{
+			DIR *const dp = fdopendir(fd);
+			if(dp == NULL)
+			{
+				close(fd);
+			}
+			return dp;
+		}
+
+		/* Out of descriptors is the only error that opening by path might not
+		 * hit. */
+		if(errno != EMFILE && errno != ENFILE)
+		{
+			return NULL;
+		}
+	}
+#endif
+
+	return os_opendir(dir->path);
+}
+
+/* Queues subdirectory of the directory or accounts for its size if it's
+ * already known.  Takes ownership of the path. */
+static void
+add_subdir(pool_t *pool, int index, dir_t *dir, char path[])
+{
+	uint64_t size;
+	if(pool->lookup != NULL && pool->lookup(path, &size, pool->arg) == 0)
+	{
+		pthread_mutex_lock(&pool->lock);
+		dir->size += size;
+		pthread_mutex_unlock(&pool->lock);
+		free(path);
+		return;
+	}
+
+	dir_t *const subdir = calloc(1, sizeof(*subdir));
+	if(subdir == NULL)
+	{
+		free(path);
+		return;
+	}
+
+	subdir->path = path;
+	subdir->name = get_last_path_component(path);
+	subdir->parent = dir;
+	subdir->pending = 1;
+#ifdef FD_RELATIVE_STAT
+	subdir->fd = -1;
+#endif
+
+	/* Parent must know about the subdirectory before it can be finished. */
+	pthread_mutex_lock(&pool->lock);
+	++dir->pending;
+	++pool->nunfinished;
+	pthread_mutex_unlock(&pool->lock);
+
+	if(push_dir(&pool->deques[index], subdir) != 0)
+	{
+		/* Just skip the subdirectory. */
+		pthread_mutex_lock(&pool->lock);
+		--dir->pending;
+		--pool->nunfinished;
+		pthread_mutex_unlock(&pool->lock);
+
+		free_dir(subdir);
+		return;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	++pool->nqueued;
+	pthread_cond_signal(&pool->changed);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/* Appends directory to the end of the queue.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+push_dir(deque_t *deque, dir_t *dir)
+{
+	pthread_mutex_lock(&deque->lock);
+
+	if(deque->head == deque->tail)
+	{
+		deque->head = 0;
+		deque->tail = 0;
+	}
+
+	if(deque->tail == deque->capacity)
+	{
+		const int new_capacity = (deque->capacity == 0) ? 64 : deque->capacity*2;
+		dir_t **const items = reallocarray(deque->items, new_capacity,
+				sizeof(*items));
+		if(items == NULL)
+		{
+			pthread_mutex_unlock(&deque->lock);
+			return 1;
+		}
+		deque->items = items;
+		deque->capacity = new_capacity;
+	}
+
+	deque->items[deque->tail++] = dir;
+
+	pthread_mutex_unlock(&deque->lock);
+	return 0;
+}
+
+/* Accounts for size of files of the directory and for its files with several
+ * hard links (inode_set_t *, emptied by this function), finishes it if it has
+ * no pending subdirectories and does the same for its parents.  Each directory
+ * counts a file with hard links once no matter how many of them are in it or
+ * in its subdirectories, which doesn't depend on order of processing. */
+static void
+finish_dir(pool_t *pool, dir_t *dir, uint64_t size, void *links)
+{
+	pthread_mutex_lock(&pool->lock);
+	dir->size += size;
+#ifdef FD_RELATIVE_STAT
+	merge_links(&dir->links, links);
+#endif
+
+	while(dir != NULL && --dir->pending == 0)
+	{
+		uint64_t total = dir->size;
+#ifdef FD_RELATIVE_STAT
+		total += dir->links.size;
+#endif
+
+		dir_t *const parent = dir->parent;
+		if(parent == NULL)
+		{
+			pool->result = total;
+		}
+		else
+		{
+			parent->size += dir->size;
+#ifdef FD_RELATIVE_STAT
+			merge_links(&parent->links, &dir->links);
+#endif
+		}
+
+		const int report = (pool->report != NULL && !pool->cancelled &&
+				!dir->failed);
+		pthread_mutex_unlock(&pool->lock);
+
+		/* Parent is still pending, because it waits for this directory. */
+		if(report)
+		{
+			pool->report(dir->path, total, pool->arg);
+		}
+		free_dir(dir);
+
+		pthread_mutex_lock(&pool->lock);
+		if(--pool->nunfinished == 0)
+		{
+			pthread_cond_broadcast(&pool->changed);
+		}
+		dir = parent;
+	}
+
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/* Frees directory and resources associated with it. */
+static void
+free_dir(dir_t *dir)
+{
+#ifdef FD_RELATIVE_STAT
+	if(dir->fd != -1)
+	{
+		close(dir->fd);
+	}
+	free(dir->links.items);
+#endif
+	free(dir->path);
+	free(dir);
+}
+
+/* Checks whether calculation was cancelled.  Only the calling thread queries
+ * cancellation state.  Returns non-zero if so, otherwise zero is returned. */
+static int
+is_cancelled(pool_t *pool, int index)
+{
+	const int requested = (index == 0 &&
+			cancellation_requested(pool->cancellation));
+
+	pthread_mutex_lock(&pool->lock);
+	if(requested)
+	{
+		pool->cancelled = 1;
+	}
+	const int cancelled = pool->cancelled;
+	pthread_mutex_unlock(&pool->lock);
+
+	return cancelled;
+}
+
+#ifdef FD_RELATIVE_STAT
+
+/* Moves files of one set to another one counting each file once.  The source
+ * set is emptied. */
+static void
+merge_links(inode_set_t *to, inode_set_t *from)
+{
+	size_t i;
+
+	if(to->count == 0U)
+	{
+		/* Set without files just takes over the other one. */
+		const uint64_t size = to->size + from->size;
+		const uint64_t lost = to->lost + from->lost;
+		free(to->items);
+		*to = *from;
+		to->size = size;
+		to->lost = lost;
+	}
+	else
+	{
+		for(i = 0U; i < from->capacity; ++i)
+		{
+			const inode_t *const inode = &from->items[i];
+			if(inode->used)
+			{
+				add_link(to, inode->dev, inode->ino, inode->size);
+			}
+		}
+		to->size += from->lost;
+		to->lost += from->lost;
+		free(from->items);
+	}
+
+	*from = (inode_set_t){};
+}
+
+/* Adds file to the set unless it's already there.  File that can't be
+ * remembered is counted without remembering it. */
+static void
+add_link(inode_set_t *set, dev_t dev, ino_t ino, uint64_t size)
+{
+	/* Keep load factor under 1/2. */
+	if((set->count + 1U)*2U > set->capacity && grow_links(set) != 0)
+	{
+		set->size += size;
+		set->lost += size;
+		return;
+	}
+
+	const inode_t inode = { .dev = dev, .ino = ino, .size = size, .used = 1 };
+	const size_t count = set->count;
+	insert_link(set, &inode);
+	if(set->count != count)
+	{
+		set->size += size;
+	}
+}
+
+/* Doubles capacity of the set.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+grow_links(inode_set_t *set)
+{
+	size_t i;
+
+	const size_t new_capacity = (set->capacity == 0U) ? 64U : set->capacity*2U;
+	inode_t *const items = calloc(new_capacity, sizeof(*items));
+	if(items == NULL)
+	{
+		return 1;
+	}
+
+	inode_set_t grown = { .items = items, .capacity = new_capacity };
+	for(i = 0U; i < set->capacity; ++i)
+	{
+		if(set->items[i].used)
+		{
+			insert_link(&grown, &set->items[i]);
+		}
+	}
+
+	free(set->items);
+	set->items = grown.items;
+	set->capacity = grown.capacity;
+	return 0;
+}
+
+/* Puts file into a free slot of the set unless it's already there.  The set
+ * must have free slots. */
+static void
+insert_link(inode_set_t *set, const inode_t *inode)
+{
+	const size_t mask = set->capacity - 1U;
+	size_t i = ((uint64_t)inode->ino*0x9e3779b97f4a7c15ULL ^ inode->dev) & mask;
+	while(set->items[i].used)
+	{
+		if(set->items[i].ino == inode->ino && set->items[i].dev == inode->dev)
+		{
+			return;
+		}
+		i = (i + 1U) & mask;
+	}
+
+	set->items[i] = *inode;
+	++set->count;
+}
+
+#endif
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,59 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__DIRSIZE_H__
+#define VIFM__UTILS__DIRSIZE_H__
+
+#include <stdint.h> /* uint64_t */
+
+/* Calculator of sizes of directories.  Subdirectories are processed by a pool
+ * of threads, each of which takes directories discovered by itself first and
+ * steals them from other threads when it runs out of work.  Files with
+ * several hard links are counted once per directory (including its
+ * subdirectories), so sizes of subdirectories don't depend on order of
+ * traversal.  Sizes provided by lookup callback can't be deduplicated this
+ * way. */
+
+struct cancellation_t;
+
+/* Type of callback that provides already known size of a directory, which
+ * saves descending into it.  Might be called concurrently from different
+ * threads.  Should return zero and set *size if the size is known, otherwise
+ * non-zero should be returned. */
+typedef int (*dirsize_lookup_func)(const char path[], uint64_t *size,
+		void *arg);
+
+/* Type of callback that receives size of a directory as soon as it's
+ * calculated (subdirectories are reported before their parents).  Might be
+ * called concurrently from different threads. */
+typedef void (*dirsize_report_func)(const char path[], uint64_t size,
+		void *arg);
+
+/* Calculates size of directory at the path using up to nthreads threads
+ * (calling thread is one of them).  lookup can be NULL.  Directories that
+ * can't be read count as empty and aren't reported.  Cancellation is checked
+ * only on the calling thread, nothing is reported after it's requested.
+ * Returns size of the directory or zero on error or cancellation. */
+uint64_t dirsize_calc(const char path[], int nthreads,
+		dirsize_lookup_func lookup, dirsize_report_func report, void *arg,
+		const struct cancellation_t *cancellation);
+
+#endif /* VIFM__UTILS__DIRSIZE_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
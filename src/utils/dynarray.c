@@ -105,5 +105,27 @@ dynarray_shrink(void *darray)
 	return darray;
 }
 
+void
+dynarray_truncate(void *darray, size_t size)
+{
+	if(darray != NULL)
+	{
+		dynarray_t *const dynarray = CAST(darray);
+		if(dynarray->size > size)
+		{
+			dynarray->size = size;
+		}
+	}
+}
+
+size_t
+dynarray_capacity(const void *darray)
+{
+	const dynarray_t *const dynarray = (darray != NULL)
+	                                 ? CAST((void *)darray)
+	                                 : NULL;
+	return (dynarray != NULL) ? dynarray->capacity : 0U;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
@@ -39,6 +39,14 @@ void dynarray_free(void *darray);
 /* Frees unused memory of the darray.  Returns possibly reallocated pointer. */
 void * dynarray_shrink(void *darray);
 
+/* Makes only first size bytes of the darray be in use without freeing any
+ * memory.  Does nothing if darray is smaller than that. */
+void dynarray_truncate(void *darray, size_t size);
+
+/* Retrieves amount of memory available to the darray without reallocation.
+ * Returns the amount in bytes, which is zero for NULL darray. */
+size_t dynarray_capacity(const void *darray);
+
 #endif /* VIFM__UTILS__DYNARRAY_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
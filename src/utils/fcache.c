@@ -0,0 +1,575 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "fcache.h"
+
+#include <sys/stat.h> /* stat */
+
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uint32_t uint64_t */
+#include <stdio.h> /* FILE SEEK_END fclose() fread() fseek() ftell() fwrite()
+                      remove() setvbuf() snprintf() */
+#include <stdlib.h> /* calloc() free() qsort() */
+#include <string.h> /* memcmp() memcpy() memset() strdup() */
+
+#include "../compat/fs_limits.h"
+#include "../compat/os.h"
+#include "../compat/pthread.h"
+#include "../compat/reallocarray.h"
+#include "fs.h"
+#include "macros.h"
+#include "utils.h"
+
+/* Number of sessions during which record can stay unused before it's dropped
+ * on saving. */
+#define MAX_AGE 32
+
+/* Initial number of slots in hash table.  Must be a power of two. */
+#define INITIAL_CAPACITY 64
+
+/* Identifies format of the file. */
+static const char MAGIC[8] = "vifmfc2\n";
+
+/* Header of the file, which is followed by records. */
+typedef struct
+{
+	char magic[sizeof(MAGIC)]; /* Format identifier. */
+	uint32_t record_size;      /* Size of a record for a sanity check. */
+	uint32_t gen;              /* Generation of the session that wrote it. */
+}
+header_t;
+
+/* Flags of records. */
+enum
+{
+	RF_UNFLUSHED = 1 << 0, /* Record was put, but wasn't written out yet. */
+};
+
+/* Single record of the cache. */
+typedef struct
+{
+	fcache_key_t key; /* Key of the record. */
+	uint64_t first;   /* First value of the record. */
+	uint64_t second;  /* Second value of the record. */
+	uint32_t gen;     /* Generation when last used, zero for empty slots. */
+	uint32_t flags;   /* Combination of RF_* values, zero in the file. */
+}
+record_t;
+
+/* Cache of values stored in a hash table with open addressing. */
+struct fcache_t
+{
+	char *path;           /* Path to file of the cache. */
+	int max_records;      /* Limit on number of saved records. */
+	record_t *records;    /* Hash table of records. */
+	size_t capacity;      /* Number of slots in the table (a power of two). */
+	size_t count;         /* Number of occupied slots. */
+	size_t nunflushed;    /* Number of records with RF_UNFLUSHED flag. */
+	uint32_t gen;         /* Generation of current session. */
+	int modified;         /* Whether cache needs to be written back. */
+	int file_ok;          /* Whether file exists and has correct header. */
+	pthread_mutex_t lock; /* Protects the fields above. */
+};
+
+static int load_records(fcache_t *cache, FILE *fp, int merge);
+static record_t * find_slot(record_t records[], size_t capacity,
+		const fcache_key_t *key);
+static uint64_t hash_key(const fcache_key_t *key);
+static uint64_t hash_path(const char path[]);
+static uint64_t hash_bytes(uint64_t seed, const void *data, size_t len);
+static int grow(fcache_t *cache);
+static int append_records(fcache_t *cache);
+static int save_records(fcache_t *cache);
+static int write_records(const fcache_t *cache, FILE *fp);
+static int gen_sorter(const void *first, const void *second);
+
+fcache_t *
+fcache_load(const char path[], int max_records)
+{
+	fcache_t *const cache = calloc(1, sizeof(*cache));
+	if(cache == NULL)
+	{
+		return NULL;
+	}
+
+	pthread_mutex_init(&cache->lock, NULL);
+
+	cache->path = strdup(path);
+	cache->max_records = max_records;
+	cache->capacity = INITIAL_CAPACITY;
+	cache->records = calloc(cache->capacity, sizeof(*cache->records));
+	cache->gen = 1U;
+	if(cache->path == NULL || cache->records == NULL)
+	{
+		fcache_free(cache);
+		return NULL;
+	}
+
+	FILE *const fp = os_fopen(path, "rb");
+	if(fp != NULL)
+	{
+		cache->file_ok = (load_records(cache, fp, 0) == 0);
+		fclose(fp);
+	}
+
+	return cache;
+}
+
+/* Fills the cache with records from the file.  Records that follow the header
+ * might have been appended by different sessions, later ones take precedence.
+ * On merging records of the cache aren't replaced and generation isn't
+ * advanced.  Returns zero on success and non-zero for invalid or incompatible
+ * files, which are otherwise ignored. */
+static int
+load_records(fcache_t *cache, FILE *fp, int merge)
+{
+	header_t header;
+	if(fread(&header, sizeof(header), 1U, fp) != 1U ||
+			memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+			header.record_size != sizeof(record_t))
+	{
+		return 1;
+	}
+
+	uint32_t max_gen = header.gen;
+
+	record_t record;
+	while(fread(&record, sizeof(record), 1U, fp) == 1U)
+	{
+		if(record.gen == 0U)
+		{
+			continue;
+		}
+
+		if(cache->count + 1U > cache->capacity/2U && grow(cache) != 0)
+		{
+			break;
+		}
+
+		record.flags = 0U;
+		max_gen = MAX(max_gen, record.gen);
+
+		record_t *const slot = find_slot(cache->records, cache->capacity,
+				&record.key);
+		if(slot->gen == 0U)
+		{
+			++cache->count;
+			*slot = record;
+		}
+		else if(!merge)
+		{
+			*slot = record;
+		}
+	}
+
+	if(!merge)
+	{
+		/* Each session gets a new generation number to track age of records. */
+		cache->gen = max_gen + 1U;
+	}
+	return 0;
+}
+
+int
+fcache_key(const char path[], fcache_key_t *key)
+{
+	struct stat s;
+	if(os_stat(path, &s) != 0)
+	{
+		return 1;
+	}
+
+	/* Zero padding of the structure to be able to compare it with memcmp(). */
+	memset(key, 0, sizeof(*key));
+	key->path_hash = hash_path(path);
+	key->dev = s.st_dev;
+	key->inode = s.st_ino;
+	key->size = s.st_size;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+	key->mtime = (int64_t)s.st_mtim.tv_sec*1000000000 + s.st_mtim.tv_nsec;
+	key->ctime = (int64_t)s.st_ctim.tv_sec*1000000000 + s.st_ctim.tv_nsec;
+#else
+	key->mtime = s.st_mtime;
+	key->ctime = s.st_ctime;
+#endif
+	return 0;
+}
+
+void
+fcache_pair_key(const fcache_key_t *a, const fcache_key_t *b,
+		fcache_key_t *key)
+{
+	int i;
+
+	if(memcmp(a, b, sizeof(*a)) > 0)
+	{
+		const fcache_key_t *const t = a;
+		a = b;
+		b = t;
+	}
+
+	/* Fields are filled with hashes of both keys using different seeds, which
+	 * makes accidental match of pair keys as unlikely as it can be. */
+	uint64_t hashes[5];
+	uint64_t seed = 0xcbf29ce484222325ULL;
+	for(i = 0; i < (int)ARRAY_LEN(hashes); ++i)
+	{
+		seed = hash_bytes(hash_bytes(seed, a, sizeof(*a)), b, sizeof(*b));
+		hashes[i] = seed;
+	}
+
+	memset(key, 0, sizeof(*key));
+	key->path_hash = hashes[0];
+	key->dev = hashes[1];
+	key->inode = hashes[2];
+	key->size = a->size;
+	key->mtime = (int64_t)hashes[3];
+	key->ctime = (int64_t)hashes[4];
+}
+
+int
+fcache_get(fcache_t *cache, const fcache_key_t *key, uint64_t *value)
+{
+	uint64_t second;
+	return fcache_get_pair(cache, key, value, &second);
+}
+
+int
+fcache_get_pair(fcache_t *cache, const fcache_key_t *key, uint64_t *first,
+		uint64_t *second)
+{
+	int found = 0;
+
+	pthread_mutex_lock(&cache->lock);
+
+	record_t *const slot = find_slot(cache->records, cache->capacity, key);
+	if(slot->gen != 0U)
+	{
+		*first = slot->first;
+		*second = slot->second;
+		if(slot->gen != cache->gen)
+		{
+			/* Refresh age of the record. */
+			slot->gen = cache->gen;
+			cache->modified = 1;
+		}
+		found = 1;
+	}
+
+	pthread_mutex_unlock(&cache->lock);
+
+	return found;
+}
+
+void
+fcache_put(fcache_t *cache, const fcache_key_t *key, uint64_t value)
+{
+	fcache_put_pair(cache, key, value, 0U);
+}
+
+void
+fcache_put_pair(fcache_t *cache, const fcache_key_t *key, uint64_t first,
+		uint64_t second)
+{
+	pthread_mutex_lock(&cache->lock);
+
+	if(cache->count + 1U <= cache->capacity/2U || grow(cache) == 0)
+	{
+		record_t *const slot = find_slot(cache->records, cache->capacity, key);
+		if(slot->gen == 0U)
+		{
+			++cache->count;
+		}
+		if(!(slot->flags & RF_UNFLUSHED))
+		{
+			++cache->nunflushed;
+		}
+		slot->key = *key;
+		slot->first = first;
+		slot->second = second;
+		slot->gen = cache->gen;
+		slot->flags = RF_UNFLUSHED;
+		cache->modified = 1;
+	}
+
+	pthread_mutex_unlock(&cache->lock);
+}
+
+/* Finds slot that holds the key or an empty slot where it should be put.
+ * Returns pointer to the slot. */
+static record_t *
+find_slot(record_t records[], size_t capacity, const fcache_key_t *key)
+{
+	size_t i = hash_key(key) & (capacity - 1U);
+	while(records[i].gen != 0U &&
+			memcmp(&records[i].key, key, sizeof(*key)) != 0)
+	{
+		i = (i + 1U) & (capacity - 1U);
+	}
+	return &records[i];
+}
+
+/* Computes hash of a key.  Returns the hash. */
+static uint64_t
+hash_key(const fcache_key_t *key)
+{
+	uint64_t h = key->path_hash;
+	h ^= key->inode + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+	h ^= key->size + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+	h ^= (uint64_t)key->mtime + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+	return h;
+}
+
+/* Computes FNV-1a hash of a path.  Returns the hash. */
+static uint64_t
+hash_path(const char path[])
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+	while(*path != '\0')
+	{
+		h = (h ^ (unsigned char)*path++)*0x100000001b3ULL;
+	}
+	return h;
+}
+
+/* Continues FNV-1a hash with bytes of the data.  Returns the hash. */
+static uint64_t
+hash_bytes(uint64_t seed, const void *data, size_t len)
+{
+	const unsigned char *bytes = data;
+	while(len-- != 0U)
+	{
+		seed = (seed ^ *bytes++)*0x100000001b3ULL;
+	}
+	return seed;
+}
+
+/* Doubles capacity of the hash table.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+grow(fcache_t *cache)
+{
+	size_t i;
+	const size_t capacity = cache->capacity*2U;
+	record_t *const records = calloc(capacity, sizeof(*records));
+	if(records == NULL)
+	{
+		return 1;
+	}
+
+	for(i = 0U; i < cache->capacity; ++i)
+	{
+		if(cache->records[i].gen != 0U)
+		{
+			*find_slot(records, capacity, &cache->records[i].key) = cache->records[i];
+		}
+	}
+
+	free(cache->records);
+	cache->records = records;
+	cache->capacity = capacity;
+	return 0;
+}
+
+int
+fcache_flush(fcache_t *cache)
+{
+	pthread_mutex_lock(&cache->lock);
+	const int error = cache->file_ok ? append_records(cache)
+	                                 : save_records(cache);
+	pthread_mutex_unlock(&cache->lock);
+	return error;
+}
+
+/* Appends unflushed records to the file in a single write, so that appends of
+ * different sessions don't interleave.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+append_records(fcache_t *cache)
+{
+	size_t i, n = 0U;
+
+	if(cache->nunflushed == 0U)
+	{
+		return 0;
+	}
+
+	record_t *const records = reallocarray(NULL, cache->nunflushed,
+			sizeof(*records));
+	if(records == NULL)
+	{
+		return 1;
+	}
+
+	for(i = 0U; i < cache->capacity && n < cache->nunflushed; ++i)
+	{
+		record_t *const record = &cache->records[i];
+		if(record->flags & RF_UNFLUSHED)
+		{
+			record->flags = 0U;
+			records[n++] = *record;
+		}
+	}
+	cache->nunflushed = 0U;
+
+	int error = 1;
+	FILE *const fp = os_fopen(cache->path, "ab");
+	if(fp != NULL)
+	{
+		/* Without buffering all records are passed to the system at once. */
+		(void)setvbuf(fp, NULL, _IONBF, 0U);
+		/* File that was truncated or removed isn't appended to. */
+		error = (fseek(fp, 0L, SEEK_END) != 0 ||
+				ftell(fp) < (long)sizeof(header_t) ||
+				fwrite(records, sizeof(*records), n, fp) != n);
+		error |= (fclose(fp) != 0);
+	}
+
+	/* Records are still in the cache and will be written on next save, which
+	 * is what flushing results in after an error. */
+	cache->file_ok = !error;
+
+	free(records);
+	return error;
+}
+
+int
+fcache_save(fcache_t *cache)
+{
+	pthread_mutex_lock(&cache->lock);
+	const int error = save_records(cache);
+	pthread_mutex_unlock(&cache->lock);
+	return error;
+}
+
+/* Replaces the file with contents of the cache merged with records of the file
+ * if the cache has changed.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+save_records(fcache_t *cache)
+{
+	size_t i;
+
+	if(!cache->modified)
+	{
+		return 0;
+	}
+
+	/* Other sessions might have added records since the file was loaded. */
+	FILE *const in = os_fopen(cache->path, "rb");
+	if(in != NULL)
+	{
+		(void)load_records(cache, in, 1);
+		fclose(in);
+	}
+
+	char tmp_file[PATH_MAX + 16];
+	snprintf(tmp_file, sizeof(tmp_file), "%s_%u", cache->path, get_pid());
+
+	FILE *const fp = os_fopen(tmp_file, "wb");
+	if(fp == NULL)
+	{
+		return 1;
+	}
+
+	int error = write_records(cache, fp);
+	error |= (fclose(fp) != 0);
+
+	/* Replace the file at once to not leave it in a partially written state. */
+	if(error || rename_file(tmp_file, cache->path) != 0)
+	{
+		(void)remove(tmp_file);
+		return 1;
+	}
+
+	for(i = 0U; i < cache->capacity; ++i)
+	{
+		cache->records[i].flags = 0U;
+	}
+	cache->nunflushed = 0U;
+	cache->modified = 0;
+	cache->file_ok = 1;
+	return 0;
+}
+
+/* Writes header followed by the most recently used records that aren't too
+ * old.  Returns zero on success, otherwise non-zero is returned. */
+static int
+write_records(const fcache_t *cache, FILE *fp)
+{
+	size_t i, n = 0U;
+	record_t *const records = reallocarray(NULL, cache->count + 1U,
+			sizeof(*records));
+	if(records == NULL)
+	{
+		return 1;
+	}
+
+	for(i = 0U; i < cache->capacity; ++i)
+	{
+		const record_t *const record = &cache->records[i];
+		if(record->gen != 0U && (int32_t)(cache->gen - record->gen) < MAX_AGE)
+		{
+			records[n] = *record;
+			records[n++].flags = 0U;
+		}
+	}
+
+	if(n > (size_t)cache->max_records)
+	{
+		qsort(records, n, sizeof(*records), &gen_sorter);
+		n = cache->max_records;
+	}
+
+	header_t header = { .record_size = sizeof(record_t), .gen = cache->gen };
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+
+	int error = (fwrite(&header, sizeof(header), 1U, fp) != 1U);
+	if(!error && n != 0U)
+	{
+		error = (fwrite(records, sizeof(*records), n, fp) != n);
+	}
+
+	free(records);
+	return error;
+}
+
+/* qsort() comparer that puts recently used records first.  Returns standard
+ * -1, 0, 1 for comparisons. */
+static int
+gen_sorter(const void *first, const void *second)
+{
+	const record_t *const a = first;
+	const record_t *const b = second;
+	return (a->gen < b->gen) - (a->gen > b->gen);
+}
+
+void
+fcache_free(fcache_t *cache)
+{
+	if(cache != NULL)
+	{
+		pthread_mutex_destroy(&cache->lock);
+		free(cache->records);
+		free(cache->path);
+		free(cache);
+	}
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
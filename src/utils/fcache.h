@@ -0,0 +1,97 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__FCACHE_H__
+#define VIFM__UTILS__FCACHE_H__
+
+#include <stdint.h> /* uint64_t */
+
+/* Persistent cache of 64-bit values computed from files (like hashes of
+ * contents or sizes of directories).  Values are associated with path and state
+ * of a file (device, inode, size and timestamps), so changing a file in any way
+ * invalidates its value.  Each record holds a pair of values, functions that
+ * work with a single value use the first one.  Records that weren't used for a
+ * while are dropped on saving and number of records is limited.  Several
+ * sessions can share the file: new records can be appended to it and saving
+ * merges records that were added by others.  All functions except for
+ * fcache_load() and fcache_free() can be called concurrently. */
+
+/* Opaque cache type. */
+typedef struct fcache_t fcache_t;
+
+/* Identifies state of a file. */
+typedef struct
+{
+	uint64_t path_hash;  /* Hash of the path. */
+	uint64_t dev;        /* Device of the file. */
+	uint64_t inode;      /* Inode of the file. */
+	uint64_t size;       /* Size of the file. */
+	int64_t mtime;       /* Modification time (nanoseconds if available). */
+	int64_t ctime;       /* Change time (nanoseconds if available). */
+}
+fcache_key_t;
+
+/* Loads cache from the file, which doesn't need to exist.  Cache won't hold
+ * more than max_records records when saved.  Returns newly allocated cache or
+ * NULL on error. */
+fcache_t * fcache_load(const char path[], int max_records);
+
+/* Makes key describing current state of the file.  Returns zero on success,
+ * otherwise non-zero is returned. */
+int fcache_key(const char path[], fcache_key_t *key);
+
+/* Makes key describing current state of a pair of files from their keys, which
+ * can be given in any order.  The key can be used to store results of
+ * comparing the files. */
+void fcache_pair_key(const fcache_key_t *a, const fcache_key_t *b,
+		fcache_key_t *key);
+
+/* Looks up value by the key.  Returns non-zero and sets *value if found,
+ * otherwise zero is returned. */
+int fcache_get(fcache_t *cache, const fcache_key_t *key, uint64_t *value);
+
+/* Associates value with the key. */
+void fcache_put(fcache_t *cache, const fcache_key_t *key, uint64_t value);
+
+/* Looks up pair of values by the key.  Returns non-zero and sets *first and
+ * *second if found, otherwise zero is returned. */
+int fcache_get_pair(fcache_t *cache, const fcache_key_t *key, uint64_t *first,
+		uint64_t *second);
+
+/* Associates pair of values with the key. */
+void fcache_put_pair(fcache_t *cache, const fcache_key_t *key, uint64_t first,
+		uint64_t second);
+
+/* Appends records put since the last flush or save to the file, which is much
+ * cheaper than saving.  Saves the cache if the file is missing or has a
+ * different format.  Returns zero on success, otherwise non-zero is
+ * returned. */
+int fcache_flush(fcache_t *cache);
+
+/* Writes cache back to its file if it has changed merging in records of the
+ * file that aren't in the cache.  The file is replaced at once.  Returns zero
+ * on success, otherwise non-zero is returned. */
+int fcache_save(fcache_t *cache);
+
+/* Frees the cache without saving it.  The cache can be NULL. */
+void fcache_free(fcache_t *cache);
+
+#endif /* VIFM__UTILS__FCACHE_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,469 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "finder.h"
+
+#include <sys/stat.h> /* S_ISDIR stat */
+#include <dirent.h> /* DIR DT_DIR DT_LNK DT_UNKNOWN dirent */
+
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* int64_t */
+#include <stdio.h> /* snprintf() */
+#include <stdlib.h> /* calloc() free() */
+#include <string.h> /* memcpy() strdup() strlen() */
+#include <time.h> /* timespec */
+
+#include "../compat/fs_limits.h"
+#include "../compat/os.h"
+#include "../compat/pthread.h"
+#include "../compat/reallocarray.h"
+#include "macros.h"
+#include "matchers.h"
+#include "parallel.h"
+#include "path.h"
+#include "utils.h"
+#include "wakeup.h"
+
+/* Number of entries after which thread checks for cancellation. */
+#define CANCELLATION_CHECK_PERIOD 256
+
+/* Growable array of strings. */
+typedef struct
+{
+	char **items;    /* Elements of the array. */
+	size_t len;      /* Number of elements. */
+	size_t capacity; /* Number of allocated elements. */
+}
+strvec_t;
+
+struct finder_t
+{
+	finder_criteria_t criteria; /* What to look for. */
+	int need_stat;              /* Whether criteria check metadata. */
+
+	parallel_team_t team; /* Worker threads. */
+
+	pthread_mutex_t lock;    /* Protects fields below. */
+	pthread_cond_t work;     /* Signaled on new directories and on finishing. */
+	pthread_cond_t results;  /* Signaled on new paths and on finishing. */
+	strvec_t dirs;           /* Stack of directories to process. */
+	strvec_t found;          /* Found paths that weren't taken yet. */
+	int nbusy;               /* Number of threads processing a directory. */
+	int done;                /* Whether search is over. */
+	int cancelled;           /* Whether search was cancelled. */
+};
+
+static void work(int index, void *arg);
+static void process_dir(finder_t *finder, const char path[], strvec_t *subdirs,
+		strvec_t *found);
+static int matches(const finder_t *finder, const char path[], int is_dir,
+		const struct stat *st);
+static int is_cancelled(finder_t *finder);
+static int strvec_add(strvec_t *vec, const char str[]);
+static int strvec_move(strvec_t *to, strvec_t *from);
+static void strvec_free(strvec_t *vec);
+
+finder_t *
+finder_start(char *roots[], int nroots, const finder_criteria_t *criteria,
+		int nthreads)
+{
+	int i;
+
+	finder_t *const finder = calloc(1, sizeof(*finder));
+	if(finder == NULL)
+	{
+		return NULL;
+	}
+
+	finder->criteria = *criteria;
+	finder->need_stat = (criteria->min_size >= 0 || criteria->max_size >= 0 ||
+			criteria->min_mtime >= 0 || criteria->max_mtime >= 0);
+
+	pthread_mutex_init(&finder->lock, NULL);
+	pthread_cond_init(&finder->work, NULL);
+	pthread_cond_init(&finder->results, NULL);
+
+	/* Roots are pushed in reverse to process them in the original order. */
+	for(i = nroots - 1; i >= 0; --i)
+	{
+		struct stat st;
+		if(os_lstat(roots[i], &st) != 0)
+		{
+			continue;
+		}
+
+		if(S_ISDIR(st.st_mode))
+		{
+			(void)strvec_add(&finder->dirs, roots[i]);
+		}
+		else if(matches(finder, roots[i], 0, &st))
+		{
+			(void)strvec_add(&finder->found, roots[i]);
+		}
+	}
+
+	parallel_team_run(&finder->team, MAX(1, nthreads), &work, finder);
+	return finder;
+}
+
+/* Body of worker threads, which process directories until there are none
+ * left in the stack and none being processed. */
+static void
+work(int index, void *arg)
+{
+	finder_t *const finder = arg;
+	strvec_t subdirs = {}, found = {};
+
+	pthread_mutex_lock(&finder->lock);
+	while(1)
+	{
+		while(finder->dirs.len == 0 && finder->nbusy != 0 && !finder->cancelled)
+		{
+			pthread_cond_wait(&finder->work, &finder->lock);
+		}
+
+		if(finder->cancelled || finder->dirs.len == 0)
+		{
+			finder->done = 1;
+			pthread_cond_broadcast(&finder->work);
+			pthread_cond_broadcast(&finder->results);
+			wakeup_notify();
+			break;
+		}
+
+		char *const dir = finder->dirs.items[--finder->dirs.len];
+		++finder->nbusy;
+		pthread_mutex_unlock(&finder->lock);
+
+		process_dir(finder, dir, &subdirs, &found);
+		free(dir);
+
+		pthread_mutex_lock(&finder->lock);
+		--finder->nbusy;
+
+		if(found.len != 0)
+		{
+			const int was_empty = (finder->found.len == 0);
+			if(strvec_move(&finder->found, &found) == 0 && was_empty)
+			{
+				pthread_cond_broadcast(&finder->results);
+				wakeup_notify();
+			}
+		}
+
+		if(subdirs.len != 0)
+		{
+			(void)strvec_move(&finder->dirs, &subdirs);
+			pthread_cond_broadcast(&finder->work);
+		}
+		else if(finder->nbusy == 0 && finder->dirs.len == 0)
+		{
+			pthread_cond_broadcast(&finder->work);
+		}
+	}
+	pthread_mutex_unlock(&finder->lock);
+
+	strvec_free(&subdirs);
+	strvec_free(&found);
+}
+
+/* Reads single directory appending its matching entries to found and its
+ * subdirectories to subdirs. */
+static void
+process_dir(finder_t *finder, const char path[], strvec_t *subdirs,
+		strvec_t *found)
+{
+	char full_path[PATH_MAX + 1];
+	struct dirent *d;
+	int nentries = 0;
+
+	DIR *const dir = os_opendir(path);
+	if(dir == NULL)
+	{
+		return;
+	}
+
+	const size_t prefix_len = snprintf(full_path, sizeof(full_path), "%s%s", path,
+			ends_with_slash(path) ? "" : "/");
+	if(prefix_len >= sizeof(full_path))
+	{
+		os_closedir(dir);
+		return;
+	}
+
+	while((d = os_readdir(dir)) != NULL)
+	{
+		struct stat st;
+		int is_dir = -1;
+
+		if(++nentries%CANCELLATION_CHECK_PERIOD == 0 && is_cancelled(finder))
+		{
+			break;
+		}
+
+		if(is_builtin_dir(d->d_name))
+		{
+			continue;
+		}
+
+		/* Entries with paths that don't fit into PATH_MAX are skipped as they can't
+		 * be reported or searched in by a truncated path. */
+		const size_t name_len = strlen(d->d_name);
+		if(prefix_len + name_len >= sizeof(full_path))
+		{
+			continue;
+		}
+		memcpy(full_path + prefix_len, d->d_name, name_len + 1U);
+
+#if defined(HAVE_STRUCT_DIRENT_D_TYPE) && HAVE_STRUCT_DIRENT_D_TYPE
+		if(d->d_type != DT_UNKNOWN)
+		{
+			is_dir = (d->d_type == DT_DIR);
+		}
+#endif
+
+		const int have_stat = ((finder->need_stat || is_dir < 0) &&
+				os_lstat(full_path, &st) == 0);
+		if(is_dir < 0)
+		{
+			if(!have_stat)
+			{
+				continue;
+			}
+			is_dir = S_ISDIR(st.st_mode);
+		}
+
+		if(matches(finder, full_path, is_dir, have_stat ? &st : NULL))
+		{
+			(void)strvec_add(found, full_path);
+		}
+
+		if(is_dir)
+		{
+			(void)strvec_add(subdirs, full_path);
+		}
+	}
+
+	os_closedir(dir);
+}
+
+/* Checks whether file matches criteria.  st can be NULL if metadata isn't
+ * available.  Returns non-zero if so, otherwise zero is returned. */
+static int
+matches(const finder_t *finder, const char path[], int is_dir,
+		const struct stat *st)
+{
+	const finder_criteria_t *const c = &finder->criteria;
+
+	if((c->kind == FK_FILE && is_dir) || (c->kind == FK_DIR && !is_dir))
+	{
+		return 0;
+	}
+
+	if(c->matchers != NULL && !matchers_match(c->matchers, path))
+	{
+		return 0;
+	}
+
+	if(finder->need_stat)
+	{
+		if(st == NULL)
+		{
+			return 0;
+		}
+
+		if((c->min_size >= 0 && (int64_t)st->st_size < c->min_size) ||
+				(c->max_size >= 0 && (int64_t)st->st_size > c->max_size) ||
+				(c->min_mtime >= 0 && st->st_mtime < c->min_mtime) ||
+				(c->max_mtime >= 0 && st->st_mtime > c->max_mtime))
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/* Checks whether search was cancelled.  Returns non-zero if so, otherwise zero
+ * is returned. */
+static int
+is_cancelled(finder_t *finder)
+{
+	pthread_mutex_lock(&finder->lock);
+	const int cancelled = finder->cancelled;
+	pthread_mutex_unlock(&finder->lock);
+	return cancelled;
+}
+
+int
+finder_wait(finder_t *finder, int timeout)
+{
+	int result = 1;
+
+	pthread_mutex_lock(&finder->lock);
+
+	if(timeout < 0)
+	{
+		while(finder->found.len == 0 && !finder->done)
+		{
+			pthread_cond_wait(&finder->results, &finder->lock);
+		}
+	}
+	else
+	{
+		struct timespec deadline;
+		get_deadline(timeout, &deadline);
+
+		while(finder->found.len == 0 && !finder->done)
+		{
+			if(pthread_cond_timedwait(&finder->results, &finder->lock,
+						&deadline) != 0)
+			{
+				result = (finder->found.len != 0 || finder->done);
+				break;
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&finder->lock);
+	return result;
+}
+
+int
+finder_take(finder_t *finder, char ***paths)
+{
+	pthread_mutex_lock(&finder->lock);
+	*paths = finder->found.items;
+	const int len = finder->found.len;
+	finder->found = (strvec_t){};
+	pthread_mutex_unlock(&finder->lock);
+	return len;
+}
+
+int
+finder_is_done(finder_t *finder)
+{
+	pthread_mutex_lock(&finder->lock);
+	const int done = finder->done;
+	pthread_mutex_unlock(&finder->lock);
+	return done;
+}
+
+void
+finder_cancel(finder_t *finder)
+{
+	pthread_mutex_lock(&finder->lock);
+	finder->cancelled = 1;
+	pthread_cond_broadcast(&finder->work);
+	pthread_mutex_unlock(&finder->lock);
+}
+
+void
+finder_free(finder_t *finder)
+{
+	if(finder == NULL)
+	{
+		return;
+	}
+
+	finder_cancel(finder);
+	parallel_team_join(&finder->team);
+
+	strvec_free(&finder->dirs);
+	strvec_free(&finder->found);
+	pthread_cond_destroy(&finder->results);
+	pthread_cond_destroy(&finder->work);
+	pthread_mutex_destroy(&finder->lock);
+	free(finder);
+}
+
+/* Appends copy of a string to the array growing it geometrically.  Returns
+ * zero on success, otherwise non-zero is returned. */
+static int
+strvec_add(strvec_t *vec, const char str[])
+{
+	if(vec->len == vec->capacity)
+	{
+		const size_t capacity = (vec->capacity == 0U ? 64U : vec->capacity*2U);
+		char **const items = reallocarray(vec->items, capacity,
+				sizeof(*vec->items));
+		if(items == NULL)
+		{
+			return 1;
+		}
+		vec->items = items;
+		vec->capacity = capacity;
+	}
+
+	char *const copy = strdup(str);
+	if(copy == NULL)
+	{
+		return 1;
+	}
+
+	vec->items[vec->len++] = copy;
+	return 0;
+}
+
+/* Moves all elements of one array to the end of another one.  Returns zero on
+ * success, otherwise non-zero is returned and nothing is moved. */
+static int
+strvec_move(strvec_t *to, strvec_t *from)
+{
+	if(to->len == 0U)
+	{
+		/* Cheap swap of buffers. */
+		const strvec_t tmp = *to;
+		*to = *from;
+		*from = tmp;
+		return 0;
+	}
+
+	if(to->len + from->len > to->capacity)
+	{
+		const size_t capacity = MAX(to->capacity*2U, to->len + from->len);
+		char **const items = reallocarray(to->items, capacity, sizeof(*to->items));
+		if(items == NULL)
+		{
+			return 1;
+		}
+		to->items = items;
+		to->capacity = capacity;
+	}
+
+	memcpy(to->items + to->len, from->items, sizeof(*from->items)*from->len);
+	to->len += from->len;
+	from->len = 0U;
+	return 0;
+}
+
+/* Frees elements of the array and the array itself. */
+static void
+strvec_free(strvec_t *vec)
+{
+	size_t i;
+	for(i = 0U; i < vec->len; ++i)
+	{
+		free(vec->items[i]);
+	}
+	free(vec->items);
+	*vec = (strvec_t){};
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
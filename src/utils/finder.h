@@ -0,0 +1,89 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__FINDER_H__
+#define VIFM__UTILS__FINDER_H__
+
+#include <stdint.h> /* int64_t */
+#include <time.h> /* time_t */
+
+/* Search for files in directory trees.  Directories are processed by a pool of
+ * threads in the background, while found paths accumulate in the finder until
+ * the caller takes them.  Symbolic links aren't followed and directories that
+ * can't be read are skipped. */
+
+struct matchers_t;
+
+/* Opaque finder type. */
+typedef struct finder_t finder_t;
+
+/* Kinds of files to look for. */
+typedef enum
+{
+	FK_ANY,  /* Files of any type. */
+	FK_FILE, /* Anything but directories. */
+	FK_DIR,  /* Directories only. */
+}
+FinderKind;
+
+/* Properties of files to look for.  Negative values of numeric fields mean
+ * that corresponding property isn't checked. */
+typedef struct
+{
+	const struct matchers_t *matchers; /* Patterns for paths or NULL. */
+	FinderKind kind;                   /* Kind of files. */
+	int64_t min_size;                  /* Lower bound of size in bytes. */
+	int64_t max_size;                  /* Upper bound of size in bytes. */
+	time_t min_mtime;                  /* Lower bound of modification time. */
+	time_t max_mtime;                  /* Upper bound of modification time. */
+}
+finder_criteria_t;
+
+/* Starts search in each of the roots using up to nthreads threads.  Roots that
+ * aren't directories are checked against criteria themselves.  Found paths
+ * start with their root.  Criteria (including matchers) must stay valid until
+ * the finder is freed.  Returns new finder or NULL on error. */
+finder_t * finder_start(char *roots[], int nroots,
+		const finder_criteria_t *criteria, int nthreads);
+
+/* Waits until there are found paths to take or the search is over, but no
+ * longer than timeout (in milliseconds, negative means forever).  Returns
+ * non-zero if waiting wasn't cut short by the timeout. */
+int finder_wait(finder_t *finder, int timeout);
+
+/* Moves paths found since the previous call out of the finder.  Main loop is
+ * woken up via wakeup_notify() when paths appear after all of them were taken.
+ * Sets *paths to newly allocated array of newly allocated strings.  Returns
+ * number of elements in the array. */
+int finder_take(finder_t *finder, char ***paths);
+
+/* Checks whether search is over either because it's done or because it was
+ * cancelled.  Returns non-zero if so, otherwise zero is returned. */
+int finder_is_done(finder_t *finder);
+
+/* Asks threads of the finder to stop without waiting for them. */
+void finder_cancel(finder_t *finder);
+
+/* Stops the search if it's still running, waits for its threads and frees
+ * resources.  finder can be NULL. */
+void finder_free(finder_t *finder);
+
+#endif /* VIFM__UTILS__FINDER_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -18,32 +18,42 @@
 
 /* The implementation is a tree (with links to leftmost child and right
  * sibling), which is traversed according to slash separated path.  Siblings are
- * sorted by name. */
+ * sorted by name.  Nodes with many children also index them by name to avoid
+ * linear scans. */
 
 #include "fsdata.h"
 #include "private/fsdata.h"
 
+#include <ctype.h> /* tolower() */
 #include <stddef.h> /* NULL size_t */
-#include <stdlib.h> /* free() malloc() */
+#include <stdlib.h> /* free() malloc() realloc() */
 #include <string.h> /* memcpy() */
 
 #include "../compat/fs_limits.h"
 #include "../compat/os.h"
 #include "str.h"
+#include "trie.h"
 
 /* Special value for get_or_create_node()'s data_size argument to prevent it
  * from creating a node. */
 #define NO_CREATE (size_t)-1
 
+/* Number of children starting with which they are indexed. */
+#define INDEX_THRESHOLD 8
+
 /* Tree node type. */
 typedef struct node_t
 {
-	char *name;           /* Name of this node. */
-	size_t name_len;      /* Length of the name. */
-	int valid;            /* Whether data in this node is meaningful. */
-	struct node_t *next;  /* Next sibling on this level. */
-	struct node_t *child; /* Leftmost child of this node. */
-	char data[];          /* Data associated with the node follows. */
+	char *name;                /* Name of this node. */
+	size_t name_len;           /* Length of the name. */
+	int valid;                 /* Whether data in this node is meaningful. */
+	int nchildren;             /* Number of direct children. */
+	trie_t *index;             /* Maps names of children onto them or NULL. */
+	struct node_t *next;       /* Next sibling on this level. */
+	struct node_t *child;      /* Leftmost child of this node. */
+	struct node_t *last_child; /* Rightmost child of this node. */
+	size_t data_size;          /* Size of the data allocated for the node. */
+	char data[];               /* Data associated with the node follows. */
 }
 node_t;
 
@@ -58,8 +68,15 @@ struct fsdata_t
 
 static void do_nothing(void *data);
 static void nodes_free(node_t *node, fsd_cleanup_func cleanup);
-static node_t * get_or_create_node(node_t *root, const char path[],
-		size_t data_size, node_t **last, node_t **link);
+static node_t * get_or_create_node(fsdata_t *fsd, const char path[],
+		size_t data_size, node_t **last);
+static node_t * find_child(const node_t *node, const char name[],
+		size_t name_len);
+static void add_child(node_t *node, node_t *child);
+static void index_child(node_t *node, node_t *child);
+static void make_index_key(const char name[], size_t name_len, char key[]);
+static node_t * grow_node(fsdata_t *fsd, node_t *parent, node_t *node,
+		size_t data_size);
 static node_t * make_node(const char name[], size_t name_len, size_t data_size);
 static int map_parents(node_t *root, const char path[],
 		fsdata_visit_func visitor, void *arg);
@@ -111,21 +128,25 @@ fsdata_free(fsdata_t *fsd)
 static void
 nodes_free(node_t *node, fsd_cleanup_func cleanup)
 {
-	if(node == NULL)
+	/* Siblings are processed in a loop to not recur as deep as there are
+	 * them. */
+	while(node != NULL)
 	{
-		return;
-	}
+		node_t *const next = node->next;
 
-	if(node->valid)
-	{
-		cleanup(&node->data);
-	}
+		if(node->valid)
+		{
+			cleanup(&node->data);
+		}
+
+		nodes_free(node->child, cleanup);
 
-	nodes_free(node->child, cleanup);
-	nodes_free(node->next, cleanup);
+		trie_free(node->index);
+		free(node->name);
+		free(node);
 
-	free(node->name);
-	free(node);
+		node = next;
+	}
 }
 
 int
@@ -149,7 +170,7 @@ fsdata_set(fsdata_t *fsd, const char path[], const void *data, size_t len)
 		}
 	}
 
-	node = get_or_create_node(fsd->root, real_path, len, NULL, &fsd->root);
+	node = get_or_create_node(fsd, real_path, len, NULL);
 	if(node == NULL)
 	{
 		return -1;
@@ -183,8 +204,8 @@ fsdata_get(fsdata_t *fsd, const char path[], void *data, size_t len)
 		return -1;
 	}
 
-	node = get_or_create_node(fsd->root, real_path, NO_CREATE,
-			fsd->prefix ? &last : NULL, NULL);
+	node = get_or_create_node(fsd, real_path, NO_CREATE,
+			fsd->prefix ? &last : NULL);
 	if((node == NULL || !node->valid) && last == NULL)
 	{
 		return -1;
@@ -196,81 +217,235 @@ fsdata_get(fsdata_t *fsd, const char path[], void *data, size_t len)
 }
 
 /* Looks up a node by its path.  Inserts a node if it doesn't exist and
- * data_size is not equal to NO_CREATE.  If last is not NULL *last is assigned
- * closest valid parent node.  Optionally reallocates and updates *link.
- * Returns the node at the path or NULL on error. */
+ * data_size is not equal to NO_CREATE, in which case the node is also made big
+ * enough to hold data_size bytes.  If last is not NULL *last is assigned
+ * closest valid parent node.  Returns the node at the path or NULL on
+ * error. */
 static node_t *
-get_or_create_node(node_t *root, const char path[], size_t data_size,
-		node_t **last, node_t **link)
+get_or_create_node(fsdata_t *fsd, const char path[], size_t data_size,
+		node_t **last)
 {
-	const char *end;
-	size_t name_len;
-	node_t *prev = NULL, *curr;
-	node_t *new_node;
+	node_t *parent = NULL;
+	node_t *node = fsd->root;
 
-	path = skip_char(path, '/');
-	if(*path == '\0')
+	while(1)
 	{
-		if(link != NULL)
+		const char *end;
+		size_t name_len;
+		node_t *child;
+
+		path = skip_char(path, '/');
+		if(*path == '\0')
+		{
+			break;
+		}
+
+		end = until_first(path, '/');
+		name_len = end - path;
+
+		child = find_child(node, path, name_len);
+		if(child == NULL)
 		{
-			root = realloc(root, sizeof(*root) + data_size);
-			if(root != NULL)
+			if(data_size == NO_CREATE)
+			{
+				return NULL;
+			}
+
+			child = make_node(path, name_len, data_size);
+			if(child == NULL)
 			{
-				*link = root;
+				return NULL;
 			}
+			add_child(node, child);
 		}
-		return root;
+		else if(child->valid && last != NULL)
+		{
+			*last = child;
+		}
+
+		parent = node;
+		node = child;
+		path = end;
 	}
 
-	end = until_first(path, '/');
+	if(data_size != NO_CREATE && data_size > node->data_size)
+	{
+		node = grow_node(fsd, parent, node, data_size);
+	}
+	return node;
+}
 
-	name_len = end - path;
-	curr = root->child;
-	while(curr != NULL)
+/* Looks up direct child of the node by its name, which doesn't have to be null
+ * terminated.  Returns the child or NULL if there is no such child. */
+static node_t *
+find_child(const node_t *node, const char name[], size_t name_len)
+{
+	node_t *curr;
+
+	if(node->index != NULL)
 	{
-		int comp = strnoscmp(path, curr->name, name_len);
+		void *data;
+		char key[PATH_MAX + 1];
+
+		make_index_key(name, name_len, key);
+		return (trie_get(node->index, key, &data) == 0) ? data : NULL;
+	}
+
+	for(curr = node->child; curr != NULL; curr = curr->next)
+	{
+		const int comp = strnoscmp(name, curr->name, name_len);
 		if(comp == 0 && curr->name_len == name_len)
 		{
-			if(curr->valid && last != NULL)
+			return curr;
+		}
+		if(comp < 0)
+		{
+			break;
+		}
+	}
+	return NULL;
+}
+
+/* Inserts new child into the node keeping children sorted by name. */
+static void
+add_child(node_t *node, node_t *child)
+{
+	node_t *prev = NULL, *curr;
+
+	/* Children are often added in sorted order, so check that first. */
+	if(node->last_child != NULL &&
+			stroscmp(child->name, node->last_child->name) > 0)
+	{
+		prev = node->last_child;
+		curr = NULL;
+	}
+	else
+	{
+		for(curr = node->child; curr != NULL; curr = curr->next)
+		{
+			if(stroscmp(child->name, curr->name) < 0)
 			{
-				*last = curr;
+				break;
 			}
-			return get_or_create_node(curr, end, data_size, last,
-					(data_size == NO_CREATE) ? NULL :
-					(root->child == curr) ? &root->child : &prev->next);
+			prev = curr;
 		}
-		else if(comp < 0)
+	}
+
+	child->next = curr;
+	if(prev == NULL)
+	{
+		node->child = child;
+	}
+	else
+	{
+		prev->next = child;
+	}
+	if(curr == NULL)
+	{
+		node->last_child = child;
+	}
+
+	++node->nchildren;
+
+	if(node->index != NULL)
+	{
+		index_child(node, child);
+	}
+	else if(node->nchildren == INDEX_THRESHOLD)
+	{
+		node->index = trie_create();
+		for(curr = node->child; curr != NULL && node->index != NULL;
+				curr = curr->next)
 		{
-			break;
+			index_child(node, curr);
 		}
-		prev = curr;
-		curr = curr->next;
 	}
+}
 
-	if(data_size == NO_CREATE)
+/* Adds (or updates) child in the index of the node.  Drops the index on failure
+ * as it's not mandatory. */
+static void
+index_child(node_t *node, node_t *child)
+{
+	char key[PATH_MAX + 1];
+	make_index_key(child->name, child->name_len, key);
+	if(trie_set(node->index, key, child) < 0)
 	{
-		return NULL;
+		trie_free(node->index);
+		node->index = NULL;
 	}
+}
 
-	new_node = make_node(path, name_len, data_size);
+/* Makes key for the index out of child's name, which might be not null
+ * terminated.  The key should have at least PATH_MAX + 1 bytes. */
+static void
+make_index_key(const char name[], size_t name_len, char key[])
+{
+	size_t i;
+	if(name_len > PATH_MAX)
+	{
+		name_len = PATH_MAX;
+	}
+	for(i = 0U; i < name_len; ++i)
+	{
+#ifndef _WIN32
+		key[i] = name[i];
+#else
+		/* Match strnoscmp() which ignores case on Windows. */
+		key[i] = tolower((unsigned char)name[i]);
+#endif
+	}
+	key[name_len] = '\0';
+}
+
+/* Reallocates node to fit data_size bytes of data fixing all links to it.  The
+ * parent is NULL for the root.  Returns new node or NULL on error. */
+static node_t *
+grow_node(fsdata_t *fsd, node_t *parent, node_t *node, size_t data_size)
+{
+	node_t *const new_node = realloc(node, sizeof(*node) + data_size);
 	if(new_node == NULL)
 	{
 		return NULL;
 	}
+	new_node->data_size = data_size;
+
+	if(new_node == node)
+	{
+		return new_node;
+	}
 
-	new_node->next = curr;
+	if(parent == NULL)
+	{
+		fsd->root = new_node;
+		return new_node;
+	}
 
-	if(root->child == curr)
+	if(parent->child == node)
 	{
-		root->child = new_node;
+		parent->child = new_node;
 	}
 	else
 	{
+		node_t *prev = parent->child;
+		while(prev->next != node)
+		{
+			prev = prev->next;
+		}
 		prev->next = new_node;
 	}
-	/* No need to update anything here, because size is guaranteed to be the
-	 * same. */
-	return get_or_create_node(new_node, end, data_size, last, NULL);
+
+	if(parent->last_child == node)
+	{
+		parent->last_child = new_node;
+	}
+
+	if(parent->index != NULL)
+	{
+		index_child(parent, new_node);
+	}
+
+	return new_node;
 }
 
 /* Creates new node for the tree.  Returns the node or NULL on memory allocation
@@ -294,8 +469,12 @@ make_node(const char name[], size_t name_len, size_t data_size)
 	copy_str(new_node->name, name_len + 1U, name);
 	new_node->name_len = name_len;
 	new_node->valid = 0;
+	new_node->nchildren = 0;
+	new_node->index = NULL;
 	new_node->child = NULL;
+	new_node->last_child = NULL;
 	new_node->next = NULL;
+	new_node->data_size = data_size;
 
 	return new_node;
 }
@@ -305,7 +484,7 @@ fsdata_map_parents(fsdata_t *fsd, const char path[], fsdata_visit_func visitor,
 		void *arg)
 {
 	char real_path[PATH_MAX + 1];
-	if(resolve_path(fsd, path, real_path) != 0)
+	if(fsd->root == NULL || resolve_path(fsd, path, real_path) != 0)
 	{
 		return 1;
 	}
@@ -346,27 +525,14 @@ map_parents(node_t *root, const char path[], fsdata_visit_func visitor,
 	end = until_first(path, '/');
 
 	name_len = end - path;
-	curr = root->child;
-	while(curr != NULL)
+	curr = find_child(root, path, name_len);
+	if(curr != NULL && map_parents(curr, end, visitor, arg) == 0)
 	{
-		const int cmp = strnoscmp(path, curr->name, name_len);
-		if(cmp == 0 && curr->name_len == name_len)
+		if(root->valid)
 		{
-			if(map_parents(curr, end, visitor, arg) == 0)
-			{
-				if(root->valid)
-				{
-					visitor(&root->data, arg);
-				}
-				return 0;
-			}
-			break;
-		}
-		else if(cmp < 0)
-		{
-			break;
+			visitor(&root->data, arg);
 		}
-		curr = curr->next;
+		return 0;
 	}
 
 	return 1;
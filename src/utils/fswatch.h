@@ -24,10 +24,51 @@
 /* Opaque type of a watcher. */
 typedef struct fswatch_t fswatch_t;
 
+/* Kinds of changes of entries of a watched directory. */
+typedef enum
+{
+	FSWE_CREATED,  /* Entry was created or moved in. */
+	FSWE_DELETED,  /* Entry was deleted or moved out. */
+	FSWE_MODIFIED, /* Contents or attributes of an entry have changed. */
+}
+FsWatchEventType;
+
+/* Single change of an entry of a watched directory. */
+typedef struct
+{
+	FsWatchEventType type; /* Kind of the change. */
+	const char *dir;       /* Path to directory of the entry. */
+	char *name;            /* Name of the entry. */
+}
+fswatch_event_t;
+
+/* Result of polling a watcher for changes. */
+typedef enum
+{
+	FSWS_UNCHANGED, /* Nothing has changed. */
+	FSWS_CHANGED,   /* Something has changed, but there are no details. */
+	FSWS_EVENTS,    /* Changes are fully described by a list of events. */
+}
+FsWatchState;
+
 /* Creates new watcher for the specified path.  Returns the watcher or NULL on
  * error. */
 fswatch_t * fswatch_create(const char path[]);
 
+/* Adds one more directory to be watched by the watcher, so that a single
+ * watcher can cover a set of directories.  Returns zero on success, otherwise
+ * non-zero is returned and errno is set (to ENOSYS if it's not supported). */
+int fswatch_add(fswatch_t *w, const char path[]);
+
+/* Marks all directories of the watcher as unused to start updating set of
+ * watched directories.  Adding directory that's already watched doesn't touch
+ * its watch. */
+void fswatch_mark_unused(fswatch_t *w);
+
+/* Stops watching directories that weren't added since the last call of
+ * fswatch_mark_unused(). */
+void fswatch_drop_unused(fswatch_t *w);
+
 /* Frees a watcher.  w can be NULL. */
 void fswatch_free(fswatch_t *w);
 
@@ -36,6 +77,18 @@ void fswatch_free(fswatch_t *w);
  * non-zero if so, otherwise zero is returned. */
 int fswatch_changed(fswatch_t *w, int *error);
 
+/* Same as fswatch_changed(), but provides per-entry details when they are
+ * available.  On FSWS_EVENTS, *events and *nevents describe changes in the
+ * order they happened, the list is owned by the watcher and stays valid until
+ * the next call.  Returns state of the watched entity. */
+FsWatchState fswatch_poll(fswatch_t *w, int *error,
+		const fswatch_event_t **events, int *nevents);
+
+/* Retrieves descriptor that becomes readable when there are changes to be
+ * reported by the watcher, which allows waiting for them instead of polling.
+ * Returns the descriptor or -1 if the watcher needs to be polled. */
+int fswatch_get_fd(const fswatch_t *w);
+
 #endif /* VIFM__UTILS__FSWATCH_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
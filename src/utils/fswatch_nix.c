@@ -25,18 +25,29 @@
 #include <sys/inotify.h> /* IN_* inotify_* */
 #include <unistd.h> /* close() read() */
 
-#include <errno.h> /* EAGAIN errno */
+#include <errno.h> /* EAGAIN ENOMEM errno */
 #include <stddef.h> /* NULL */
-#include <stdint.h> /* uint32_t */
+#include <stdint.h> /* intptr_t uint32_t */
+#include <stdio.h> /* snprintf() */
 #include <stdlib.h> /* free() */
+#include <string.h> /* strdup() */
 #include <time.h> /* time_t time() */
 
 #include "../compat/fs_limits.h"
+#include "../compat/reallocarray.h"
 #include "trie.h"
 
 /* TODO: consider implementation that could reuse already available descriptor
  *       by just removing old watch and then adding a new one. */
 
+/* Directory watched via inotify. */
+typedef struct
+{
+	char *path; /* Path to the directory or NULL for unused descriptor. */
+	int used;   /* Whether directory was added since fswatch_mark_unused(). */
+}
+watched_dir_t;
+
 /* Watcher data. */
 struct fswatch_t
 {
@@ -44,6 +55,17 @@ struct fswatch_t
 	int fd;
 	/* Trie to keep track of per file frequency of notifications. */
 	trie_t *stats;
+	/* Events collected by the last poll. */
+	fswatch_event_t *events;
+	/* Number of elements in the events array. */
+	int nevents;
+	/* Watched directories indexed by watch descriptors. */
+	watched_dir_t *dirs;
+	/* Number of elements in the dirs array. */
+	int ndirs;
+	/* Maps paths of watched directories to their descriptors plus one, zero
+	 * (NULL) means that directory isn't watched anymore. */
+	trie_t *wds;
 };
 
 /* Per file statistics information. */
@@ -57,25 +79,35 @@ typedef struct
 }
 notif_stat_t;
 
+static int add_watch(fswatch_t *w, const char path[]);
+static void forget_dir(fswatch_t *w, int wd);
+static const char * get_dir(const fswatch_t *w, int wd);
 static int update_file_stats(fswatch_t *w, const struct inotify_event *e,
 		time_t now);
+static int add_event(fswatch_t *w, const struct inotify_event *e);
+static void free_events(fswatch_t *w);
 
 fswatch_t *
 fswatch_create(const char path[])
 {
-	int wd;
-
 	fswatch_t *const w = malloc(sizeof(*w));
 	if(w == NULL)
 	{
 		return NULL;
 	}
 
+	w->events = NULL;
+	w->nevents = 0;
+	w->dirs = NULL;
+	w->ndirs = 0;
+
 	/* Create tree to collect update frequency statistics. */
 	w->stats = trie_create();
-	if(w->stats == NULL)
+	w->wds = trie_create();
+	if(w->stats == NULL || w->wds == NULL)
 	{
 		trie_free_with_data(w->stats, &free);
+		trie_free(w->wds);
 		free(w);
 		return NULL;
 	}
@@ -85,38 +117,157 @@ fswatch_create(const char path[])
 	if(w->fd == -1)
 	{
 		trie_free_with_data(w->stats, &free);
+		trie_free(w->wds);
 		free(w);
 		return NULL;
 	}
 
 	/* Add directory to watch. */
-	wd = inotify_add_watch(w->fd, path, IN_ATTRIB | IN_MODIFY | IN_CREATE |
-			IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_EXCL_UNLINK |
-			IN_CLOSE_WRITE);
-	if(wd == -1)
+	if(add_watch(w, path) != 0)
 	{
-		close(w->fd);
-		trie_free_with_data(w->stats, &free);
-		free(w);
+		fswatch_free(w);
 		return NULL;
 	}
 
 	return w;
 }
 
+int
+fswatch_add(fswatch_t *w, const char path[])
+{
+	return add_watch(w, path);
+}
+
+void
+fswatch_mark_unused(fswatch_t *w)
+{
+	int i;
+	for(i = 0; i < w->ndirs; ++i)
+	{
+		w->dirs[i].used = 0;
+	}
+}
+
+void
+fswatch_drop_unused(fswatch_t *w)
+{
+	int i;
+	for(i = 0; i < w->ndirs; ++i)
+	{
+		if(w->dirs[i].path != NULL && !w->dirs[i].used)
+		{
+			(void)inotify_rm_watch(w->fd, i);
+			forget_dir(w, i);
+		}
+	}
+}
+
+int
+fswatch_get_fd(const fswatch_t *w)
+{
+	return w->fd;
+}
+
 void
 fswatch_free(fswatch_t *w)
 {
 	if(w != NULL)
 	{
+		int i;
+		for(i = 0; i < w->ndirs; ++i)
+		{
+			free(w->dirs[i].path);
+		}
+		free(w->dirs);
+
+		free_events(w);
 		trie_free_with_data(w->stats, &free);
+		trie_free(w->wds);
 		close(w->fd);
 		free(w);
 	}
 }
 
-int
-fswatch_changed(fswatch_t *w, int *error)
+/* Starts watching a directory and remembers its path.  Directory which is
+ * already watched is just marked as used.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+add_watch(fswatch_t *w, const char path[])
+{
+	void *data;
+	if(trie_get(w->wds, path, &data) == 0 && data != NULL)
+	{
+		w->dirs[(intptr_t)data - 1].used = 1;
+		return 0;
+	}
+
+	const int wd = inotify_add_watch(w->fd, path, IN_ATTRIB | IN_MODIFY |
+			IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_EXCL_UNLINK |
+			IN_CLOSE_WRITE);
+	if(wd == -1)
+	{
+		return 1;
+	}
+
+	/* Descriptors are small integers allocated sequentially per inotify instance
+	 * and adding the same directory again (e.g., by a different path) yields the
+	 * same descriptor. */
+	if(wd >= w->ndirs)
+	{
+		watched_dir_t *const dirs = reallocarray(w->dirs, wd + 1, sizeof(*dirs));
+		if(dirs == NULL)
+		{
+			(void)inotify_rm_watch(w->fd, wd);
+			errno = ENOMEM;
+			return 1;
+		}
+
+		w->dirs = dirs;
+		while(w->ndirs <= wd)
+		{
+			w->dirs[w->ndirs++] = (watched_dir_t){};
+		}
+	}
+
+	forget_dir(w, wd);
+	w->dirs[wd].path = strdup(path);
+	if(w->dirs[wd].path == NULL ||
+			trie_set(w->wds, path, (void *)(intptr_t)(wd + 1)) < 0)
+	{
+		(void)inotify_rm_watch(w->fd, wd);
+		forget_dir(w, wd);
+		errno = ENOMEM;
+		return 1;
+	}
+
+	w->dirs[wd].used = 1;
+	return 0;
+}
+
+/* Drops information about directory of the watch descriptor. */
+static void
+forget_dir(fswatch_t *w, int wd)
+{
+	watched_dir_t *const dir = &w->dirs[wd];
+	if(dir->path != NULL)
+	{
+		(void)trie_set(w->wds, dir->path, NULL);
+		free(dir->path);
+		dir->path = NULL;
+	}
+}
+
+/* Maps watch descriptor to path of the directory.  Returns the path or NULL if
+ * descriptor is unknown. */
+static const char *
+get_dir(const fswatch_t *w, int wd)
+{
+	return (wd >= 0 && wd < w->ndirs) ? w->dirs[wd].path : NULL;
+}
+
+FsWatchState
+fswatch_poll(fswatch_t *w, int *error, const fswatch_event_t **events,
+		int *nevents)
 {
 	enum { MAX_READS = 100 };
 	enum { BUF_LEN = (10 * (sizeof(struct inotify_event) + NAME_MAX + 1)) };
@@ -124,9 +275,12 @@ fswatch_changed(fswatch_t *w, int *error)
 	char buf[BUF_LEN];
 	int nread;
 	int changed = 0;
+	int described = 1;
 	int nreads = 0;
 	const time_t now = time(NULL);
 
+	free_events(w);
+
 	*error = 0;
 	do
 	{
@@ -150,9 +304,26 @@ fswatch_changed(fswatch_t *w, int *error)
 		for(p = buf; p < buf + nread; p += sizeof(struct inotify_event) + e->len)
 		{
 			e = (struct inotify_event *)p;
+
+			/* Watch removed by fswatch_drop_unused() isn't a change. */
+			if((e->mask & IN_IGNORED) && get_dir(w, e->wd) == NULL)
+			{
+				continue;
+			}
+
 			if(update_file_stats(w, e, now))
 			{
 				changed = 1;
+				if(described && add_event(w, e) != 0)
+				{
+					described = 0;
+				}
+			}
+
+			/* Directory is gone along with its watch, descriptor can be reused. */
+			if(e->mask & IN_IGNORED)
+			{
+				forget_dir(w, e->wd);
 			}
 		}
 
@@ -165,7 +336,20 @@ fswatch_changed(fswatch_t *w, int *error)
 	}
 	while(nread != 0);
 
-	return changed;
+	if(!changed)
+	{
+		return FSWS_UNCHANGED;
+	}
+
+	if(!described)
+	{
+		free_events(w);
+		return FSWS_CHANGED;
+	}
+
+	*events = w->events;
+	*nevents = w->nevents;
+	return FSWS_EVENTS;
 }
 
 /* Updates information about a file event is about.  Returns non-zero if this is
@@ -179,10 +363,16 @@ update_file_stats(fswatch_t *w, const struct inotify_event *e, time_t now)
 	const uint32_t IMPORTANT_EVENTS = IN_CREATE | IN_DELETE | IN_MOVED_FROM
 	                                | IN_MOVED_TO | IN_Q_OVERFLOW;
 
-	const char *const fname = (e->len == 0U) ? "." : e->name;
+	const char *const dir = get_dir(w, e->wd);
+	char fname[PATH_MAX + NAME_MAX + 2];
 	void *data;
 	notif_stat_t *stats;
 
+	/* Names are qualified by directories to tell apart entries of different
+	 * directories. */
+	snprintf(fname, sizeof(fname), "%s/%s", (dir == NULL) ? "" : dir,
+			(e->len == 0U) ? "." : e->name);
+
 	/* See if we already know this file and retrieve associated information if
 	 * so. */
 	if(trie_get(w->stats, fname, &data) != 0)
@@ -234,10 +424,77 @@ update_file_stats(fswatch_t *w, const struct inotify_event *e, time_t now)
 	return 1;
 }
 
+/* Appends inotify event to the list of events of the watcher.  Events which
+ * aren't about a particular entry (like queue overflow or changes of the
+ * directory itself) can't be described this way.  Returns zero on success and
+ * non-zero if the list can't describe changes anymore. */
+static int
+add_event(fswatch_t *w, const struct inotify_event *e)
+{
+	/* Past this point reloading everything is cheaper than patching. */
+	enum { MAX_EVENTS = 512 };
+
+	fswatch_event_t *events;
+	fswatch_event_t *event;
+	const char *const dir = get_dir(w, e->wd);
+
+	if(e->len == 0U || (e->mask & IN_Q_OVERFLOW) || w->nevents >= MAX_EVENTS ||
+			dir == NULL)
+	{
+		return 1;
+	}
+
+	events = reallocarray(w->events, w->nevents + 1, sizeof(*events));
+	if(events == NULL)
+	{
+		return 1;
+	}
+	w->events = events;
+
+	event = &w->events[w->nevents];
+	event->dir = dir;
+	event->name = strdup(e->name);
+	if(event->name == NULL)
+	{
+		return 1;
+	}
+
+	if(e->mask & (IN_CREATE | IN_MOVED_TO))
+	{
+		event->type = FSWE_CREATED;
+	}
+	else if(e->mask & (IN_DELETE | IN_MOVED_FROM))
+	{
+		event->type = FSWE_DELETED;
+	}
+	else
+	{
+		event->type = FSWE_MODIFIED;
+	}
+
+	++w->nevents;
+	return 0;
+}
+
+/* Frees events collected by the last poll. */
+static void
+free_events(fswatch_t *w)
+{
+	int i;
+	for(i = 0; i < w->nevents; ++i)
+	{
+		free(w->events[i].name);
+	}
+	free(w->events);
+	w->events = NULL;
+	w->nevents = 0;
+}
+
 #else
 
 #include "filemon.h"
 
+#include <errno.h> /* ENOSYS errno */
 #include <string.h> /* strdup() */
 
 /* Watcher data. */
@@ -272,6 +529,33 @@ fswatch_create(const char path[])
 	return w;
 }
 
+int
+fswatch_add(fswatch_t *w, const char path[])
+{
+	/* Only a single file is monitored by this implementation. */
+	errno = ENOSYS;
+	return 1;
+}
+
+void
+fswatch_mark_unused(fswatch_t *w)
+{
+	/* There is only one file which is always in use. */
+}
+
+void
+fswatch_drop_unused(fswatch_t *w)
+{
+	/* There is only one file which is always in use. */
+}
+
+int
+fswatch_get_fd(const fswatch_t *w)
+{
+	/* Changes are detected by querying file system. */
+	return -1;
+}
+
 void
 fswatch_free(fswatch_t *w)
 {
@@ -282,8 +566,9 @@ fswatch_free(fswatch_t *w)
 	}
 }
 
-int
-fswatch_changed(fswatch_t *w, int *error)
+FsWatchState
+fswatch_poll(fswatch_t *w, int *error, const fswatch_event_t **events,
+		int *nevents)
 {
 	int changed;
 
@@ -291,7 +576,7 @@ fswatch_changed(fswatch_t *w, int *error)
 	if(filemon_from_file(w->path, FMT_MODIFIED, &filemon) != 0)
 	{
 		*error = 1;
-		return 1;
+		return FSWS_CHANGED;
 	}
 
 	*error = 0;
@@ -299,10 +584,18 @@ fswatch_changed(fswatch_t *w, int *error)
 
 	filemon_assign(&w->filemon, &filemon);
 
-	return changed;
+	return (changed ? FSWS_CHANGED : FSWS_UNCHANGED);
 }
 
 #endif
 
+int
+fswatch_changed(fswatch_t *w, int *error)
+{
+	const fswatch_event_t *events;
+	int nevents;
+	return (fswatch_poll(w, error, &events, &nevents) != FSWS_UNCHANGED);
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -20,6 +20,7 @@
 
 #include <windows.h>
 
+#include <errno.h> /* ENOSYS errno */
 #include <stdlib.h> /* free() malloc() */
 #include <string.h> /* strdup */
 
@@ -75,6 +76,33 @@ fswatch_create(const char path[])
 	return w;
 }
 
+int
+fswatch_add(fswatch_t *w, const char path[])
+{
+	/* Each watcher here is for a single directory. */
+	errno = ENOSYS;
+	return 1;
+}
+
+void
+fswatch_mark_unused(fswatch_t *w)
+{
+	/* There is only one directory which is always in use. */
+}
+
+void
+fswatch_drop_unused(fswatch_t *w)
+{
+	/* There is only one directory which is always in use. */
+}
+
+int
+fswatch_get_fd(const fswatch_t *w)
+{
+	/* Notification handles aren't file descriptors. */
+	return -1;
+}
+
 void
 fswatch_free(fswatch_t *w)
 {
@@ -112,6 +140,14 @@ fswatch_changed(fswatch_t *w, int *error)
 	return changed;
 }
 
+FsWatchState
+fswatch_poll(fswatch_t *w, int *error, const fswatch_event_t **events,
+		int *nevents)
+{
+	/* Notifications don't carry names of entries here. */
+	return (fswatch_changed(w, error) ? FSWS_CHANGED : FSWS_UNCHANGED);
+}
+
 /* Gets last directory modification time.  Returns non-zero on error, otherwise
  * zero is returned. */
 static int
@@ -0,0 +1,706 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "grepper.h"
+
+#include <sys/stat.h> /* S_ISREG fstat() stat */
+
+#include <regex.h> /* REG_NOSUB REG_STARTEND regcomp() regexec() regfree() */
+#include <stddef.h> /* NULL size_t */
+#include <stdio.h> /* FILE _IONBF fclose() fileno() fread() setvbuf() */
+#include <stdlib.h> /* calloc() free() malloc() realloc() */
+#include <string.h> /* memchr() memcpy() memmove() strdup() strlen() */
+#include <time.h> /* timespec */
+
+#include "../compat/os.h"
+#include "../compat/pthread.h"
+#include "../compat/reallocarray.h"
+#include "finder.h"
+#include "macros.h"
+#include "parallel.h"
+#include "regexp.h"
+#include "str.h"
+#include "string_array.h"
+#include "utils.h"
+#include "wakeup.h"
+
+/* Files with NUL bytes within this many bytes from the start are binary. */
+#define BINARY_CHECK_SIZE 8192
+
+/* Amount of file contents to read at once. */
+#define CHUNK_SIZE (256*1024)
+
+/* Number of lines after which thread checks for cancellation. */
+#define CANCELLATION_CHECK_PERIOD 65536
+
+/* Characters that have special meaning in extended regular expressions. */
+#define ERE_SPECIAL "^.[]$()|*+?{}\\"
+
+/* Growable buffer of a thread. */
+typedef struct
+{
+	char *data;      /* Contents of the buffer. */
+	size_t capacity; /* Number of allocated bytes. */
+}
+buffer_t;
+
+/* Growable array of lines. */
+typedef struct
+{
+	char **items;    /* Elements of the array. */
+	size_t len;      /* Number of elements. */
+	size_t capacity; /* Number of allocated elements. */
+}
+lines_t;
+
+struct grepper_t
+{
+	char *regex;    /* Regular expression to compile in each thread. */
+	int cflags;     /* Flags for compiling the regex. */
+	int invert;     /* Whether non-matching lines are looked for. */
+	char *literal;  /* Text that every match contains or NULL. */
+	size_t lit_len; /* Length of the literal. */
+	int exact;      /* Whether literal is all there is to the regex. */
+
+	finder_criteria_t criteria; /* Criteria of the finder. */
+	finder_t *finder;           /* Source of files to scan. */
+
+	parallel_team_t team; /* Worker threads. */
+
+	pthread_mutex_t lock;   /* Protects fields below. */
+	pthread_cond_t results; /* Signaled on new lines and on finishing. */
+	char **files;           /* Files taken from the finder. */
+	int nfiles;             /* Number of elements in files. */
+	int next_file;          /* Index of the next file to scan. */
+	int files_over;         /* Whether finder has no more files. */
+	lines_t found;          /* Found lines that weren't taken yet. */
+	int nrunning;           /* Number of threads that haven't finished. */
+	int done;               /* Whether search is over. */
+	int cancelled;          /* Whether search was cancelled. */
+};
+
+static void work(int index, void *arg);
+static char * next_file(grepper_t *grepper);
+static void scan_file(grepper_t *grepper, const regex_t *re, const char path[],
+		buffer_t *buf, buffer_t *line_buf, lines_t *found);
+static FILE * open_file(const char path[]);
+static const char * find_last_newline(const char data[], size_t size);
+static int scan_data(grepper_t *grepper, const regex_t *re, const char path[],
+		const char data[], size_t size, int *lineno, buffer_t *line_buf,
+		lines_t *found);
+static int count_newlines(const char from[], const char to[]);
+static int line_matches(const regex_t *re, const char line[], size_t len,
+		buffer_t *line_buf);
+static void add_line(lines_t *found, const char path[], int lineno,
+		const char line[], const char eol[]);
+static int is_cancelled(grepper_t *grepper);
+static int buffer_reserve(buffer_t *buf, size_t size);
+static int lines_move(lines_t *to, lines_t *from);
+static void lines_free(lines_t *lines);
+
+grepper_t *
+grepper_start(char *roots[], int nroots, const grepper_criteria_t *criteria,
+		int nthreads, char **error)
+{
+	regex_t re;
+
+	grepper_t *const grepper = calloc(1, sizeof(*grepper));
+	if(grepper == NULL)
+	{
+		return NULL;
+	}
+
+	grepper->regex = criteria->fixed
+	               ? escape_chars(criteria->pattern, ERE_SPECIAL)
+	               : strdup(criteria->pattern);
+	grepper->cflags = criteria->cflags | REG_EXTENDED | REG_NOSUB;
+	grepper->invert = criteria->invert;
+	if(grepper->regex == NULL)
+	{
+		free(grepper);
+		return NULL;
+	}
+
+	/* Validate the pattern here, threads compile their own copies because
+	 * regexec() can serialize calls on a shared regex. */
+	const int err = regcomp(&re, grepper->regex, grepper->cflags);
+	if(err != 0)
+	{
+		*error = strdup(get_regexp_error(err, &re));
+		regfree(&re);
+		free(grepper->regex);
+		free(grepper);
+		return NULL;
+	}
+	regfree(&re);
+
+	/* Case-insensitive and inverted searches have to look at every line. */
+	if(!grepper->invert && !(grepper->cflags & REG_ICASE))
+	{
+		grepper->literal = criteria->fixed
+		                 ? strdup(criteria->pattern)
+		                 : regexp_extract_literal(criteria->pattern,
+		                                          &grepper->exact);
+		grepper->exact |= criteria->fixed;
+		grepper->lit_len = (grepper->literal == NULL)
+		                 ? 0U
+		                 : strlen(grepper->literal);
+	}
+
+	grepper->criteria = (finder_criteria_t){
+		.kind = FK_FILE,
+		.min_size = -1, .max_size = -1,
+		.min_mtime = -1, .max_mtime = -1,
+	};
+	grepper->finder = finder_start(roots, nroots, &grepper->criteria, nthreads);
+	if(grepper->finder == NULL)
+	{
+		free(grepper->literal);
+		free(grepper->regex);
+		free(grepper);
+		return NULL;
+	}
+
+	pthread_mutex_init(&grepper->lock, NULL);
+	pthread_cond_init(&grepper->results, NULL);
+
+	/* Threads can't finish before they are counted. */
+	pthread_mutex_lock(&grepper->lock);
+	const int nstarted = parallel_team_start(&grepper->team, MAX(1, nthreads),
+			&work, grepper);
+	grepper->nrunning = nstarted;
+	pthread_mutex_unlock(&grepper->lock);
+
+	if(nstarted == 0)
+	{
+		/* Calling thread does the search. */
+		grepper->nrunning = 1;
+		work(0, grepper);
+	}
+
+	return grepper;
+}
+
+/* Body of worker threads, which scan files until there are none left. */
+static void
+work(int index, void *arg)
+{
+	grepper_t *const grepper = arg;
+	regex_t re;
+	buffer_t buf = {};
+	buffer_t line_buf = {};
+	lines_t found = {};
+	char *path;
+
+	if(regcomp(&re, grepper->regex, grepper->cflags) == 0)
+	{
+		while((path = next_file(grepper)) != NULL)
+		{
+			scan_file(grepper, &re, path, &buf, &line_buf, &found);
+			free(path);
+
+			if(found.len != 0U)
+			{
+				pthread_mutex_lock(&grepper->lock);
+				const int was_empty = (grepper->found.len == 0U);
+				if(lines_move(&grepper->found, &found) == 0 && was_empty)
+				{
+					pthread_cond_broadcast(&grepper->results);
+					wakeup_notify();
+				}
+				pthread_mutex_unlock(&grepper->lock);
+			}
+		}
+		regfree(&re);
+	}
+
+	free(buf.data);
+	free(line_buf.data);
+	lines_free(&found);
+
+	pthread_mutex_lock(&grepper->lock);
+	if(--grepper->nrunning == 0)
+	{
+		grepper->done = 1;
+		pthread_cond_broadcast(&grepper->results);
+		wakeup_notify();
+	}
+	pthread_mutex_unlock(&grepper->lock);
+}
+
+/* Picks next file to scan waiting for the finder if necessary.  Returns newly
+ * allocated path or NULL if there are no more files or search was
+ * cancelled. */
+static char *
+next_file(grepper_t *grepper)
+{
+	char *path = NULL;
+
+	pthread_mutex_lock(&grepper->lock);
+	while(!grepper->cancelled)
+	{
+		if(grepper->next_file < grepper->nfiles)
+		{
+			path = grepper->files[grepper->next_file];
+			grepper->files[grepper->next_file++] = NULL;
+			break;
+		}
+
+		if(grepper->files_over)
+		{
+			break;
+		}
+
+		free(grepper->files);
+		const int over = finder_is_done(grepper->finder);
+		grepper->nfiles = finder_take(grepper->finder, &grepper->files);
+		grepper->next_file = 0;
+
+		if(grepper->nfiles == 0)
+		{
+			if(over)
+			{
+				grepper->files_over = 1;
+				break;
+			}
+
+			pthread_mutex_unlock(&grepper->lock);
+			(void)finder_wait(grepper->finder, -1);
+			pthread_mutex_lock(&grepper->lock);
+		}
+	}
+	pthread_mutex_unlock(&grepper->lock);
+
+	return path;
+}
+
+/* Appends matching lines of a file to found.  The file is read into buf by
+ * chunks of limited size, each chunk is scanned up to its last complete line
+ * and the rest is carried over to the next chunk.  The line_buf is for lines
+ * that need to be copied. */
+static void
+scan_file(grepper_t *grepper, const regex_t *re, const char path[],
+		buffer_t *buf, buffer_t *line_buf, lines_t *found)
+{
+	FILE *const fp = open_file(path);
+	if(fp == NULL)
+	{
+		return;
+	}
+
+	size_t len = 0U;
+	int lineno = 1;
+	int first = 1;
+	int eof = 0;
+	while(!eof && buffer_reserve(buf, len + CHUNK_SIZE) == 0)
+	{
+		const size_t nread = fread(buf->data + len, 1, CHUNK_SIZE, fp);
+		eof = (nread == 0U);
+		len += nread;
+
+		if(first)
+		{
+			first = 0;
+			if(len == 0U ||
+					memchr(buf->data, '\0', MIN(len, BINARY_CHECK_SIZE)) != NULL)
+			{
+				break;
+			}
+		}
+		else if(is_cancelled(grepper))
+		{
+			break;
+		}
+
+		/* Incomplete last line is scanned only at the end of the file. */
+		size_t complete = len;
+		if(!eof)
+		{
+			const char *const last_nl = find_last_newline(buf->data, len);
+			if(last_nl == NULL)
+			{
+				continue;
+			}
+			complete = last_nl + 1 - buf->data;
+		}
+
+		if(scan_data(grepper, re, path, buf->data, complete, &lineno, line_buf,
+					found) != 0)
+		{
+			break;
+		}
+
+		len -= complete;
+		memmove(buf->data, buf->data + complete, len);
+	}
+
+	fclose(fp);
+}
+
+/* Opens a regular file for unbuffered reading.  Returns the stream or NULL if
+ * the file isn't a regular one or on error. */
+static FILE *
+open_file(const char path[])
+{
+	FILE *const fp = os_fopen(path, "rb");
+	if(fp == NULL)
+	{
+		return NULL;
+	}
+
+	struct stat st;
+	if(fstat(fileno(fp), &st) != 0 || !S_ISREG(st.st_mode))
+	{
+		fclose(fp);
+		return NULL;
+	}
+
+	/* Buffering of the stream is useless for reads of this size. */
+	(void)setvbuf(fp, NULL, _IONBF, 0);
+	return fp;
+}
+
+/* Looks for the last new line character in the data.  Returns pointer to it or
+ * NULL if there is none. */
+static const char *
+find_last_newline(const char data[], size_t size)
+{
+	while(size != 0U)
+	{
+		if(data[--size] == '\n')
+		{
+			return &data[size];
+		}
+	}
+	return NULL;
+}
+
+/* Appends matching lines of file contents to found.  The data must start at
+ * the beginning of a line with *lineno number, which is updated to number of
+ * the line that follows the data.  The line_buf must not overlap with the data.
+ * Returns non-zero if search was cancelled, otherwise zero is returned. */
+static int
+scan_data(grepper_t *grepper, const regex_t *re, const char path[],
+		const char data[], size_t size, int *lineno, buffer_t *line_buf,
+		lines_t *found)
+{
+	const char *const end = data + size;
+	const char *counted = data;
+	int nlines = 0;
+
+	if(grepper->literal != NULL)
+	{
+		/* Skip straight to lines that contain the literal and count lines only up
+		 * to them. */
+		const char *pos = data;
+		const char *hit;
+		while((hit = find_bytes(pos, end - pos, grepper->literal,
+						grepper->lit_len)) != NULL)
+		{
+			const char *line = hit;
+			while(line != pos && line[-1] != '\n')
+			{
+				--line;
+			}
+
+			const char *eol = memchr(hit, '\n', end - hit);
+			eol = (eol == NULL) ? end : eol;
+
+			*lineno += count_newlines(counted, line);
+			counted = line;
+
+			if(grepper->exact || line_matches(re, line, eol - line, line_buf))
+			{
+				add_line(found, path, *lineno, line, eol);
+			}
+
+			if(eol == end)
+			{
+				break;
+			}
+			if(++nlines%CANCELLATION_CHECK_PERIOD == 0 && is_cancelled(grepper))
+			{
+				return 1;
+			}
+			pos = eol + 1;
+		}
+
+		*lineno += count_newlines(counted, end);
+		return 0;
+	}
+
+	const char *line = data;
+	while(line != end)
+	{
+		const char *eol = memchr(line, '\n', end - line);
+		eol = (eol == NULL) ? end : eol;
+
+		if(line_matches(re, line, eol - line, line_buf) != grepper->invert)
+		{
+			add_line(found, path, *lineno, line, eol);
+		}
+
+		if(eol == end)
+		{
+			break;
+		}
+		line = eol + 1;
+		++*lineno;
+
+		if(++nlines%CANCELLATION_CHECK_PERIOD == 0 && is_cancelled(grepper))
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* Counts new line characters in the range.  Returns the number. */
+static int
+count_newlines(const char from[], const char to[])
+{
+	int count = 0;
+	while((from = memchr(from, '\n', to - from)) != NULL)
+	{
+		++count;
+		++from;
+	}
+	return count;
+}
+
+/* Matches a line, which isn't terminated with a NUL character, against
+ * regular expression.  The line_buf is used to make NUL-terminated copy of the
+ * line if regexec() can't match a range.  Returns non-zero on match, otherwise
+ * zero is returned. */
+static int
+line_matches(const regex_t *re, const char line[], size_t len,
+		buffer_t *line_buf)
+{
+#ifdef REG_STARTEND
+	regmatch_t match = { .rm_so = 0, .rm_eo = len };
+	return (regexec(re, line, 1, &match, REG_STARTEND) == 0);
+#else
+	if(buffer_reserve(line_buf, len + 1U) != 0)
+	{
+		return 0;
+	}
+	memcpy(line_buf->data, line, len);
+	line_buf->data[len] = '\0';
+	return (regexec(re, line_buf->data, 0, NULL, 0) == 0);
+#endif
+}
+
+/* Appends formatted line to the array. */
+static void
+add_line(lines_t *found, const char path[], int lineno, const char line[],
+		const char eol[])
+{
+	if(eol != line && eol[-1] == '\r')
+	{
+		--eol;
+	}
+
+	char *const item = format_str("%s:%d:%.*s", path, lineno, (int)(eol - line),
+			line);
+	if(item == NULL)
+	{
+		return;
+	}
+
+	if(found->len == found->capacity)
+	{
+		const size_t capacity = (found->capacity == 0U ? 64U : found->capacity*2U);
+		char **const items = reallocarray(found->items, capacity,
+				sizeof(*found->items));
+		if(items == NULL)
+		{
+			free(item);
+			return;
+		}
+		found->items = items;
+		found->capacity = capacity;
+	}
+
+	found->items[found->len++] = item;
+}
+
+/* Checks whether search was cancelled.  Returns non-zero if so, otherwise zero
+ * is returned. */
+static int
+is_cancelled(grepper_t *grepper)
+{
+	pthread_mutex_lock(&grepper->lock);
+	const int cancelled = grepper->cancelled;
+	pthread_mutex_unlock(&grepper->lock);
+	return cancelled;
+}
+
+int
+grepper_wait(grepper_t *grepper, int timeout)
+{
+	int result = 1;
+
+	pthread_mutex_lock(&grepper->lock);
+
+	if(timeout < 0)
+	{
+		while(grepper->found.len == 0U && !grepper->done)
+		{
+			pthread_cond_wait(&grepper->results, &grepper->lock);
+		}
+	}
+	else
+	{
+		struct timespec deadline;
+		get_deadline(timeout, &deadline);
+
+		while(grepper->found.len == 0U && !grepper->done)
+		{
+			if(pthread_cond_timedwait(&grepper->results, &grepper->lock,
+						&deadline) != 0)
+			{
+				result = (grepper->found.len != 0U || grepper->done);
+				break;
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&grepper->lock);
+	return result;
+}
+
+int
+grepper_take(grepper_t *grepper, char ***lines)
+{
+	pthread_mutex_lock(&grepper->lock);
+	*lines = grepper->found.items;
+	const int len = grepper->found.len;
+	grepper->found = (lines_t){};
+	pthread_mutex_unlock(&grepper->lock);
+	return len;
+}
+
+int
+grepper_is_done(grepper_t *grepper)
+{
+	pthread_mutex_lock(&grepper->lock);
+	const int done = grepper->done;
+	pthread_mutex_unlock(&grepper->lock);
+	return done;
+}
+
+void
+grepper_cancel(grepper_t *grepper)
+{
+	pthread_mutex_lock(&grepper->lock);
+	grepper->cancelled = 1;
+	pthread_mutex_unlock(&grepper->lock);
+
+	/* This also wakes up threads waiting for files. */
+	finder_cancel(grepper->finder);
+}
+
+void
+grepper_free(grepper_t *grepper)
+{
+	if(grepper == NULL)
+	{
+		return;
+	}
+
+	grepper_cancel(grepper);
+	parallel_team_join(&grepper->team);
+
+	finder_free(grepper->finder);
+	free_string_array(grepper->files, grepper->nfiles);
+	lines_free(&grepper->found);
+	free(grepper->literal);
+	free(grepper->regex);
+	pthread_cond_destroy(&grepper->results);
+	pthread_mutex_destroy(&grepper->lock);
+	free(grepper);
+}
+
+/* Makes sure that buffer can hold at least specified number of bytes.  Returns
+ * zero on success, otherwise non-zero is returned. */
+static int
+buffer_reserve(buffer_t *buf, size_t size)
+{
+	if(size <= buf->capacity)
+	{
+		return 0;
+	}
+
+	char *const data = realloc(buf->data, size);
+	if(data == NULL)
+	{
+		return 1;
+	}
+
+	buf->data = data;
+	buf->capacity = size;
+	return 0;
+}
+
+/* Moves all elements of one array to the end of another one.  Returns zero on
+ * success, otherwise non-zero is returned and nothing is moved. */
+static int
+lines_move(lines_t *to, lines_t *from)
+{
+	if(to->len == 0U)
+	{
+		/* Cheap swap of buffers. */
+		const lines_t tmp = *to;
+		*to = *from;
+		*from = tmp;
+		return 0;
+	}
+
+	if(to->len + from->len > to->capacity)
+	{
+		const size_t capacity = MAX(to->capacity*2U, to->len + from->len);
+		char **const items = reallocarray(to->items, capacity, sizeof(*to->items));
+		if(items == NULL)
+		{
+			return 1;
+		}
+		to->items = items;
+		to->capacity = capacity;
+	}
+
+	memcpy(to->items + to->len, from->items, sizeof(*from->items)*from->len);
+	to->len += from->len;
+	from->len = 0U;
+	return 0;
+}
+
+/* Frees elements of the array and the array itself. */
+static void
+lines_free(lines_t *lines)
+{
+	size_t i;
+	for(i = 0U; i < lines->len; ++i)
+	{
+		free(lines->items[i]);
+	}
+	free(lines->items);
+	*lines = (lines_t){};
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,73 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__GREPPER_H__
+#define VIFM__UTILS__GREPPER_H__
+
+/* Search for lines of files that match a regular expression.  Files are found
+ * by a finder and scanned by a pool of threads in the background, while
+ * matching lines accumulate in the grepper until the caller takes them.
+ * Binary files (those containing NUL bytes near the start) are skipped. */
+
+/* Opaque grepper type. */
+typedef struct grepper_t grepper_t;
+
+/* What to look for. */
+typedef struct
+{
+	const char *pattern; /* Regular expression or fixed string. */
+	int cflags;          /* Flags for regcomp() (REG_ICASE, REG_EXTENDED). */
+	int fixed;           /* Whether pattern is a fixed string. */
+	int invert;          /* Whether to look for lines that don't match. */
+}
+grepper_criteria_t;
+
+/* Starts search in each of the roots (directories are searched recursively)
+ * using up to nthreads threads.  Found lines are of the form "path:line:text"
+ * and paths in them start with their root.  Returns new grepper or NULL on
+ * error, in which case *error is set to newly allocated error message if
+ * pattern is invalid. */
+grepper_t * grepper_start(char *roots[], int nroots,
+		const grepper_criteria_t *criteria, int nthreads, char **error);
+
+/* Waits until there are found lines to take or the search is over, but no
+ * longer than timeout (in milliseconds, negative means forever).  Returns
+ * non-zero if waiting wasn't cut short by the timeout. */
+int grepper_wait(grepper_t *grepper, int timeout);
+
+/* Moves lines found since the previous call out of the grepper.  Main loop is
+ * woken up via wakeup_notify() when lines appear after all of them were taken.
+ * Sets *lines to newly allocated array of newly allocated strings.  Returns
+ * number of elements in the array. */
+int grepper_take(grepper_t *grepper, char ***lines);
+
+/* Checks whether search is over either because it's done or because it was
+ * cancelled.  Returns non-zero if so, otherwise zero is returned. */
+int grepper_is_done(grepper_t *grepper);
+
+/* Asks threads of the grepper to stop without waiting for them. */
+void grepper_cancel(grepper_t *grepper);
+
+/* Stops the search if it's still running, waits for its threads and frees
+ * resources.  grepper can be NULL. */
+void grepper_free(grepper_t *grepper);
+
+#endif /* VIFM__UTILS__GREPPER_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,1027 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "linemap.h"
+
+#ifndef _WIN32
+#include <sys/mman.h> /* MAP_ANONYMOUS MAP_FAILED MAP_FIXED MAP_PRIVATE
+                         PROT_READ mmap() munmap() */
+#include <fcntl.h> /* O_RDONLY open() */
+#include <unistd.h> /* _SC_PAGESIZE close() pread() read() sysconf() */
+#endif
+#include <sys/stat.h> /* S_ISDIR S_ISREG fstat() stat */
+
+#include <signal.h> /* SA_SIGINFO SIGBUS sigaction sigaction() siginfo_t */
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uintptr_t */
+#include <stdio.h> /* FILE SEEK_SET fclose() fdopen() ferror() fread()
+                      fseek() */
+#include <stdlib.h> /* calloc() free() malloc() realloc() */
+#include <string.h> /* memchr() memcmp() memcpy() */
+#include <time.h> /* timespec */
+
+#include "../compat/os.h"
+#include "../compat/pthread.h"
+#include "../compat/reallocarray.h"
+#include "macros.h"
+#include "utils.h"
+#include "wakeup.h"
+
+/* Files of at least this size are mapped into memory instead of being read. */
+#define MMAP_THRESHOLD (1024*1024)
+
+/* Offset of every LINE_STEP-th line is stored in the index. */
+#define LINE_STEP 256
+
+/* Number of bytes indexed at once. */
+#define CHUNK_SIZE (256*1024)
+
+/* Maximum number of files that can be mapped at the same time. */
+#define MAX_MAPPINGS 64
+
+struct linemap_t
+{
+	const char *data; /* Text (past BOM). */
+	size_t size;      /* Size of the text. */
+	void *base;       /* Beginning of allocated or mapped memory. */
+	size_t base_size; /* Size of allocated or mapped memory. */
+	int mapped;       /* Whether memory is mapped rather than allocated. */
+	int has_file;     /* Whether the text comes from a file. */
+	dev_t dev;        /* Device of the file. */
+	ino_t inode;      /* Inode of the file. */
+
+	pthread_mutex_t lock;  /* Protects fields below. */
+	pthread_cond_t over;   /* Signaled when background indexing is over. */
+	pthread_cond_t step;   /* Signaled when background indexing makes progress. */
+	size_t *marks;         /* Offsets of lines whose number is a multiple of
+	                          LINE_STEP. */
+	int nmarks;            /* Number of elements in marks. */
+	int marks_cap;         /* Number of allocated elements of marks. */
+	size_t scanned;        /* Start of the first line that wasn't indexed. */
+	int nlines;            /* Number of indexed lines. */
+	int complete;          /* Whether whole text is indexed. */
+	int failed;            /* Whether indexing failed to allocate memory. */
+	pthread_t thread;      /* Thread that indexes in the background. */
+	int has_thread;        /* Whether thread field is valid. */
+	int running;           /* Whether background indexing is in progress. */
+	int cancelled;         /* Whether background indexing was cancelled. */
+};
+
+#ifndef _WIN32
+/* Memory of a mapped file. */
+typedef struct
+{
+	char *start; /* Beginning of the mapping or NULL for unused slot. */
+	size_t size; /* Size of the mapping. */
+}
+mapping_t;
+#endif
+
+static linemap_t * make_linemap(void *base, size_t size, int mapped);
+static void * read_file(const char path[], size_t *size, int *mapped,
+		struct stat *st);
+static char * read_stream(FILE *fp, size_t *size);
+static void * extend_data(linemap_t *lm, const char path[], size_t *size,
+		int *mapped);
+static void release_data(void *base, size_t size, int mapped);
+#ifndef _WIN32
+static void * map_file(int fd, size_t size);
+static void init_guard(void);
+static void sigbus_handler(int sig, siginfo_t *info, void *context);
+#endif
+static void rescan_last_line(linemap_t *lm);
+static int stop_indexing(linemap_t *lm);
+static void * index_thread(void *arg);
+static int index_chunk(linemap_t *lm);
+static void scan_chunk(const linemap_t *lm, size_t *offset, int *nlines,
+		size_t marks[], int *nmarks);
+static int add_marks(linemap_t *lm, const size_t marks[], int nmarks);
+static const char * skip_lines(const linemap_t *lm, const char from[], int n);
+static int find_mark(const linemap_t *lm, size_t offset);
+
+#ifndef _WIN32
+/* Mapped files, which are read without holding any locks by SIGBUS handler.
+ * Slots are taken by setting start last and freed by resetting it first. */
+static mapping_t mappings[MAX_MAPPINGS];
+/* Protects taking and freeing of slots of mappings. */
+static pthread_mutex_t mappings_lock = PTHREAD_MUTEX_INITIALIZER;
+/* Makes sure SIGBUS handler is installed only once. */
+static pthread_once_t guard_once = PTHREAD_ONCE_INIT;
+/* Disposition of SIGBUS before installing our handler. */
+static struct sigaction old_sigbus;
+/* Size of a memory page. */
+static size_t page_size;
+#endif
+
+linemap_t *
+linemap_open(const char path[])
+{
+	size_t size;
+	int mapped;
+	struct stat st;
+	void *const data = read_file(path, &size, &mapped, &st);
+	if(data == NULL)
+	{
+		return NULL;
+	}
+
+	linemap_t *const lm = make_linemap(data, size, mapped);
+	if(lm == NULL)
+	{
+		release_data(data, size, mapped);
+		return NULL;
+	}
+
+	/* Text that doesn't match size of a regular file can't be kept in sync with
+	 * it. */
+	lm->has_file = (S_ISREG(st.st_mode) && (size_t)st.st_size == size);
+	lm->dev = st.st_dev;
+	lm->inode = st.st_ino;
+	return lm;
+}
+
+linemap_t *
+linemap_from_buffer(char text[], size_t len)
+{
+	linemap_t *const lm = make_linemap(text, len, 0);
+	if(lm == NULL)
+	{
+		free(text);
+	}
+	return lm;
+}
+
+/* Allocates and initializes line map for the memory.  Returns new line map or
+ * NULL on error. */
+static linemap_t *
+make_linemap(void *base, size_t size, int mapped)
+{
+	linemap_t *const lm = calloc(1, sizeof(*lm));
+	if(lm == NULL)
+	{
+		return NULL;
+	}
+
+	lm->base = base;
+	lm->base_size = size;
+	lm->mapped = mapped;
+
+	lm->data = base;
+	lm->size = size;
+	if(size >= 3U && memcmp(lm->data, "\xef\xbb\xbf", 3U) == 0)
+	{
+		lm->data += 3;
+		lm->size -= 3U;
+	}
+
+	lm->complete = (lm->size == 0U);
+
+	pthread_mutex_init(&lm->lock, NULL);
+	pthread_cond_init(&lm->over, NULL);
+	pthread_cond_init(&lm->step, NULL);
+	return lm;
+}
+
+/* Obtains contents of a file either by mapping it into memory or by reading it
+ * into a buffer.  Files that aren't regular or report zero size (like those in
+ * /proc) are read until the end.  Sets *mapped to non-zero in the former case
+ * and fills *st.  Returns pointer to contents of *size bytes (can be zero) or
+ * NULL on error. */
+static void *
+read_file(const char path[], size_t *size, int *mapped, struct stat *st)
+{
+	char *data;
+
+	*mapped = 0;
+
+#ifndef _WIN32
+	const int fd = open(path, O_RDONLY);
+	if(fd < 0)
+	{
+		return NULL;
+	}
+
+	if(fstat(fd, st) != 0 || S_ISDIR(st->st_mode))
+	{
+		close(fd);
+		return NULL;
+	}
+
+	if(!S_ISREG(st->st_mode) || st->st_size == 0)
+	{
+		FILE *const fp = fdopen(fd, "rb");
+		if(fp == NULL)
+		{
+			close(fd);
+			return NULL;
+		}
+
+		data = read_stream(fp, size);
+		fclose(fp);
+		return data;
+	}
+
+	if(st->st_size >= MMAP_THRESHOLD)
+	{
+		void *const data = map_file(fd, st->st_size);
+		if(data != NULL)
+		{
+			close(fd);
+			*mapped = 1;
+			*size = st->st_size;
+			return data;
+		}
+	}
+
+	data = malloc(st->st_size + 1U);
+	if(data == NULL)
+	{
+		close(fd);
+		return NULL;
+	}
+
+	*size = 0U;
+	while(*size < (size_t)st->st_size)
+	{
+		const ssize_t n = read(fd, data + *size, st->st_size - *size);
+		if(n <= 0)
+		{
+			break;
+		}
+		*size += n;
+	}
+	close(fd);
+#else
+	FILE *const fp = os_fopen(path, "rb");
+	if(fp == NULL)
+	{
+		return NULL;
+	}
+
+	if(fstat(fileno(fp), st) != 0 || S_ISDIR(st->st_mode))
+	{
+		fclose(fp);
+		return NULL;
+	}
+
+	if(!S_ISREG(st->st_mode) || st->st_size == 0)
+	{
+		data = read_stream(fp, size);
+	}
+	else if((data = malloc(st->st_size + 1U)) != NULL)
+	{
+		*size = fread(data, 1, st->st_size, fp);
+	}
+	fclose(fp);
+#endif
+
+	return data;
+}
+
+/* Reads stream until its end without relying on its size.  Returns pointer to
+ * contents of *size bytes (can be zero) or NULL on error. */
+static char *
+read_stream(FILE *fp, size_t *size)
+{
+	char *data = NULL;
+	size_t capacity = 0U;
+
+	*size = 0U;
+	while(1)
+	{
+		if(capacity - *size < CHUNK_SIZE)
+		{
+			char *const new_data = realloc(data, *size + CHUNK_SIZE + 1U);
+			if(new_data == NULL)
+			{
+				free(data);
+				return NULL;
+			}
+			data = new_data;
+			capacity = *size + CHUNK_SIZE;
+		}
+
+		const size_t n = fread(data + *size, 1, CHUNK_SIZE, fp);
+		*size += n;
+		if(n == 0U)
+		{
+			break;
+		}
+	}
+
+	if(ferror(fp))
+	{
+		free(data);
+		return NULL;
+	}
+	return data;
+}
+
+int
+linemap_extend(linemap_t *lm, const char path[])
+{
+	if(!lm->has_file)
+	{
+		return 1;
+	}
+
+	const int was_indexing = stop_indexing(lm);
+
+	size_t size;
+	int mapped;
+	void *const base = extend_data(lm, path, &size, &mapped);
+	if(base == NULL)
+	{
+		return 1;
+	}
+
+	if(base != lm->base || size != lm->base_size)
+	{
+		const size_t bom_len = lm->data - (const char *)lm->base;
+		lm->base = base;
+		lm->base_size = size;
+		lm->mapped = mapped;
+		lm->data = (const char *)base + bom_len;
+		lm->size = size - bom_len;
+
+		rescan_last_line(lm);
+	}
+
+	if(was_indexing)
+	{
+		linemap_index_bg(lm);
+	}
+	return 0;
+}
+
+/* Brings memory of the map in sync with the file, which is checked to be the
+ * same one and to have not shrunk.  Old memory is released if it's replaced.
+ * Sets *size and *mapped.  Returns pointer to the memory or NULL on error. */
+static void *
+extend_data(linemap_t *lm, const char path[], size_t *size, int *mapped)
+{
+	struct stat st;
+	char *data;
+
+#ifndef _WIN32
+	const int fd = open(path, O_RDONLY);
+	if(fd < 0)
+	{
+		return NULL;
+	}
+
+	if(fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_dev != lm->dev ||
+			st.st_ino != lm->inode || (size_t)st.st_size < lm->base_size)
+	{
+		close(fd);
+		return NULL;
+	}
+
+	*size = st.st_size;
+	*mapped = lm->mapped;
+	if(*size == lm->base_size)
+	{
+		close(fd);
+		return lm->base;
+	}
+
+	if(*size >= MMAP_THRESHOLD)
+	{
+		/* Remapping is cheap and doesn't read anything. */
+		data = map_file(fd, *size);
+		if(data != NULL)
+		{
+			close(fd);
+			release_data(lm->base, lm->base_size, lm->mapped);
+			*mapped = 1;
+			return data;
+		}
+	}
+
+	if(lm->mapped)
+	{
+		/* Can't append to a mapping, the map has to be recreated. */
+		close(fd);
+		return NULL;
+	}
+
+	/* Otherwise memory of the map is a buffer. */
+	data = realloc(lm->base, *size + 1U);
+	if(data == NULL)
+	{
+		close(fd);
+		return NULL;
+	}
+
+	size_t read_size = lm->base_size;
+	while(read_size < *size)
+	{
+		const ssize_t n = pread(fd, data + read_size, *size - read_size,
+				read_size);
+		if(n <= 0)
+		{
+			break;
+		}
+		read_size += n;
+	}
+	close(fd);
+	*size = read_size;
+#else
+	FILE *const fp = os_fopen(path, "rb");
+	if(fp == NULL)
+	{
+		return NULL;
+	}
+
+	if(fstat(fileno(fp), &st) != 0 || !S_ISREG(st.st_mode) ||
+			st.st_dev != lm->dev || st.st_ino != lm->inode ||
+			(size_t)st.st_size < lm->base_size)
+	{
+		fclose(fp);
+		return NULL;
+	}
+
+	*size = st.st_size;
+	*mapped = 0;
+	if(*size == lm->base_size)
+	{
+		fclose(fp);
+		return lm->base;
+	}
+
+	data = realloc(lm->base, *size + 1U);
+	if(data == NULL)
+	{
+		fclose(fp);
+		return NULL;
+	}
+
+	*size = lm->base_size;
+	if(fseek(fp, lm->base_size, SEEK_SET) == 0)
+	{
+		*size += fread(data + lm->base_size, 1, st.st_size - lm->base_size, fp);
+	}
+	fclose(fp);
+#endif
+
+	return data;
+}
+
+int
+linemap_is_intact(const linemap_t *lm, const char path[])
+{
+	struct stat st;
+	return lm->has_file
+	    && os_stat(path, &st) == 0
+	    && S_ISREG(st.st_mode)
+	    && st.st_dev == lm->dev
+	    && st.st_ino == lm->inode
+	    && (size_t)st.st_size >= lm->base_size;
+}
+
+/* Releases memory obtained by read_file() or extend_data(). */
+static void
+release_data(void *base, size_t size, int mapped)
+{
+#ifndef _WIN32
+	if(mapped)
+	{
+		int i;
+
+		pthread_mutex_lock(&mappings_lock);
+		for(i = 0; i < MAX_MAPPINGS; ++i)
+		{
+			if(mappings[i].start == base)
+			{
+				__atomic_store_n(&mappings[i].start, NULL, __ATOMIC_SEQ_CST);
+				break;
+			}
+		}
+		pthread_mutex_unlock(&mappings_lock);
+
+		(void)munmap(base, size);
+		return;
+	}
+#endif
+
+	free(base);
+}
+
+#ifndef _WIN32
+
+/* Maps file into memory protecting the process from being killed by SIGBUS if
+ * the file is truncated while it's mapped.  Pages past the new end of the file
+ * read as zeroes instead.  Returns the mapping or NULL on error. */
+static void *
+map_file(int fd, size_t size)
+{
+	int i;
+
+	pthread_once(&guard_once, &init_guard);
+	if(page_size == 0U)
+	{
+		return NULL;
+	}
+
+	void *const data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if(data == MAP_FAILED)
+	{
+		return NULL;
+	}
+
+	pthread_mutex_lock(&mappings_lock);
+	for(i = 0; i < MAX_MAPPINGS; ++i)
+	{
+		if(mappings[i].start == NULL)
+		{
+			mappings[i].size = size;
+			__atomic_store_n(&mappings[i].start, data, __ATOMIC_SEQ_CST);
+			break;
+		}
+	}
+	pthread_mutex_unlock(&mappings_lock);
+
+	if(i == MAX_MAPPINGS)
+	{
+		/* Unprotected mapping isn't safe, caller will read the file instead. */
+		(void)munmap(data, size);
+		return NULL;
+	}
+	return data;
+}
+
+/* Installs SIGBUS handler.  Leaves page_size at zero on failure. */
+static void
+init_guard(void)
+{
+	const long size = sysconf(_SC_PAGESIZE);
+	if(size <= 0)
+	{
+		return;
+	}
+
+	struct sigaction action;
+	action.sa_sigaction = &sigbus_handler;
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = SA_SIGINFO;
+	if(sigaction(SIGBUS, &action, &old_sigbus) == 0)
+	{
+		page_size = size;
+	}
+}
+
+/* Handles access to a page of mapped file that is past its end by replacing
+ * the page with zeroed memory, after which access is retried. */
+static void
+sigbus_handler(int sig, siginfo_t *info, void *context)
+{
+	int i;
+	char *const addr = info->si_addr;
+
+	for(i = 0; i < MAX_MAPPINGS; ++i)
+	{
+		char *const start = __atomic_load_n(&mappings[i].start, __ATOMIC_SEQ_CST);
+		if(start == NULL || addr < start || addr >= start + mappings[i].size)
+		{
+			continue;
+		}
+
+		char *const page = addr - (uintptr_t)addr%page_size;
+		if(mmap(page, page_size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED,
+					-1, 0) != MAP_FAILED)
+		{
+			return;
+		}
+		break;
+	}
+
+	/* Not our fault, retrying access will handle it the way it would have been
+	 * handled without us. */
+	(void)sigaction(SIGBUS, &old_sigbus, NULL);
+}
+
+#endif
+
+/* Makes indexing continue after the text got longer.  If the text didn't end
+ * with a newline, its last line is incomplete and is indexed anew. */
+static void
+rescan_last_line(linemap_t *lm)
+{
+	pthread_mutex_lock(&lm->lock);
+
+	const int partial = (lm->nlines > 0 && lm->scanned != 0U &&
+			lm->data[lm->scanned - 1U] != '\n');
+	if(partial)
+	{
+		const int last = lm->nlines - 1;
+		lm->scanned = skip_lines(lm, lm->data + lm->marks[last/LINE_STEP],
+				last%LINE_STEP) - lm->data;
+		lm->nlines = last;
+		if(last%LINE_STEP == 0)
+		{
+			--lm->nmarks;
+		}
+	}
+
+	lm->complete = (lm->scanned == lm->size);
+
+	pthread_mutex_unlock(&lm->lock);
+}
+
+int
+linemap_get(linemap_t *lm, int n, const char **line, size_t *len)
+{
+	if(n < 0)
+	{
+		return 1;
+	}
+
+	pthread_mutex_lock(&lm->lock);
+	while(!lm->complete && !lm->failed && lm->nlines <= n)
+	{
+		if(lm->running)
+		{
+			pthread_cond_wait(&lm->step, &lm->lock);
+		}
+		else
+		{
+			(void)index_chunk(lm);
+		}
+	}
+	if(n >= lm->nlines)
+	{
+		pthread_mutex_unlock(&lm->lock);
+		return 1;
+	}
+	const char *const mark = lm->data + lm->marks[n/LINE_STEP];
+	pthread_mutex_unlock(&lm->lock);
+
+	/* Text changes only when nobody reads it, so it can be examined without
+	 * holding the lock. */
+	const char *const start = skip_lines(lm, mark, n%LINE_STEP);
+	const char *const end = lm->data + lm->size;
+	const char *nl = memchr(start, '\n', end - start);
+	if(nl == NULL)
+	{
+		nl = end;
+	}
+
+	*line = start;
+	*len = nl - start;
+	if(*len != 0U && start[*len - 1U] == '\r')
+	{
+		--*len;
+	}
+	return 0;
+}
+
+/* Skips specified number of lines.  Returns pointer to the beginning of the
+ * line, which is the end of the text if it's shorter than indexed (happens when
+ * mapped file gets truncated). */
+static const char *
+skip_lines(const linemap_t *lm, const char from[], int n)
+{
+	const char *const end = lm->data + lm->size;
+	while(n-- > 0)
+	{
+		const char *const nl = memchr(from, '\n', end - from);
+		if(nl == NULL)
+		{
+			return end;
+		}
+		from = nl + 1;
+	}
+	return from;
+}
+
+char *
+linemap_dup(linemap_t *lm, int n)
+{
+	const char *line;
+	size_t len;
+	if(linemap_get(lm, n, &line, &len) != 0)
+	{
+		return NULL;
+	}
+
+	char *const copy = malloc(len + 1U);
+	if(copy != NULL)
+	{
+		memcpy(copy, line, len);
+		copy[len] = '\0';
+	}
+	return copy;
+}
+
+const char *
+linemap_text(const linemap_t *lm, size_t *size)
+{
+	*size = lm->size;
+	return lm->data;
+}
+
+int
+linemap_line_at(linemap_t *lm, size_t offset)
+{
+	pthread_mutex_lock(&lm->lock);
+	while(!lm->complete && !lm->failed && lm->scanned <= offset)
+	{
+		if(lm->running)
+		{
+			pthread_cond_wait(&lm->step, &lm->lock);
+		}
+		else
+		{
+			(void)index_chunk(lm);
+		}
+	}
+	if(lm->nmarks == 0)
+	{
+		pthread_mutex_unlock(&lm->lock);
+		return 0;
+	}
+	const int mark = find_mark(lm, offset);
+	const char *const from = lm->data + lm->marks[mark];
+	pthread_mutex_unlock(&lm->lock);
+
+	const char *const to = lm->data + MIN(offset, lm->size);
+	int line = mark*LINE_STEP;
+	const char *p = from;
+	while((p = memchr(p, '\n', to - p)) != NULL)
+	{
+		++line;
+		++p;
+	}
+	return line;
+}
+
+/* Finds the last element of the index that doesn't come after the offset.
+ * Assumes that the lock is held and the index isn't empty.  Returns index of
+ * the element. */
+static int
+find_mark(const linemap_t *lm, size_t offset)
+{
+	int l = 0, r = lm->nmarks - 1;
+	while(l < r)
+	{
+		const int m = l + (r - l + 1)/2;
+		if(lm->marks[m] <= offset)
+		{
+			l = m;
+		}
+		else
+		{
+			r = m - 1;
+		}
+	}
+	return l;
+}
+
+int
+linemap_count(linemap_t *lm, int *complete)
+{
+	pthread_mutex_lock(&lm->lock);
+	const int nlines = lm->nlines;
+	*complete = lm->complete;
+	pthread_mutex_unlock(&lm->lock);
+	return nlines;
+}
+
+void
+linemap_index_bg(linemap_t *lm)
+{
+	pthread_mutex_lock(&lm->lock);
+
+	if(lm->complete || lm->failed || lm->running)
+	{
+		pthread_mutex_unlock(&lm->lock);
+		return;
+	}
+
+	if(lm->has_thread)
+	{
+		/* Collect thread that was cancelled before. */
+		pthread_mutex_unlock(&lm->lock);
+		pthread_join(lm->thread, NULL);
+		pthread_mutex_lock(&lm->lock);
+		lm->has_thread = 0;
+	}
+
+	lm->cancelled = 0;
+	if(pthread_create(&lm->thread, NULL, &index_thread, lm) == 0)
+	{
+		lm->has_thread = 1;
+		lm->running = 1;
+	}
+	else
+	{
+		/* Index the whole file now if the thread can't be started. */
+		while(index_chunk(lm))
+		{
+			/* Keep going until the end. */
+		}
+	}
+
+	pthread_mutex_unlock(&lm->lock);
+}
+
+/* Entry point of background indexing thread.  Returns NULL. */
+static void *
+index_thread(void *arg)
+{
+	linemap_t *const lm = arg;
+	size_t marks[CHUNK_SIZE/LINE_STEP + 1];
+
+	block_all_thread_signals();
+
+	pthread_mutex_lock(&lm->lock);
+	while(!lm->cancelled && !lm->complete && !lm->failed)
+	{
+		/* Only this thread changes the index while it's running, so scanning can
+		 * be done without holding the lock. */
+		size_t offset = lm->scanned;
+		int nlines = lm->nlines;
+		int nmarks;
+		pthread_mutex_unlock(&lm->lock);
+
+		scan_chunk(lm, &offset, &nlines, marks, &nmarks);
+
+		pthread_mutex_lock(&lm->lock);
+		if(add_marks(lm, marks, nmarks) == 0)
+		{
+			lm->scanned = offset;
+			lm->nlines = nlines;
+			lm->complete = (offset == lm->size);
+		}
+		pthread_cond_broadcast(&lm->step);
+	}
+	lm->running = 0;
+	pthread_cond_broadcast(&lm->step);
+	pthread_cond_broadcast(&lm->over);
+	pthread_mutex_unlock(&lm->lock);
+
+	wakeup_notify();
+	return NULL;
+}
+
+/* Indexes next chunk of the text.  Assumes that the lock is held.  Returns
+ * non-zero if there is more to index. */
+static int
+index_chunk(linemap_t *lm)
+{
+	size_t marks[CHUNK_SIZE/LINE_STEP + 1];
+	size_t offset = lm->scanned;
+	int nlines = lm->nlines;
+	int nmarks;
+
+	scan_chunk(lm, &offset, &nlines, marks, &nmarks);
+	if(add_marks(lm, marks, nmarks) == 0)
+	{
+		lm->scanned = offset;
+		lm->nlines = nlines;
+		lm->complete = (offset == lm->size);
+	}
+	return !lm->complete && !lm->failed;
+}
+
+/* Finds beginnings of lines in a chunk of text that starts at *offset, which
+ * is the beginning of line number *nlines.  Updates both of them and fills
+ * marks with offsets of lines that should be in the index. */
+static void
+scan_chunk(const linemap_t *lm, size_t *offset, int *nlines, size_t marks[],
+		int *nmarks)
+{
+	const char *const end = lm->data + lm->size;
+	const char *p = lm->data + *offset;
+	const char *const limit = (end - p > CHUNK_SIZE) ? p + CHUNK_SIZE : end;
+
+	*nmarks = 0;
+	while(p < limit)
+	{
+		if(*nlines%LINE_STEP == 0)
+		{
+			marks[(*nmarks)++] = p - lm->data;
+		}
+		++*nlines;
+
+		const char *const nl = memchr(p, '\n', end - p);
+		p = (nl == NULL) ? end : nl + 1;
+	}
+	*offset = p - lm->data;
+}
+
+/* Appends offsets to the index.  Assumes that the lock is held.  Returns zero
+ * on success, otherwise non-zero is returned. */
+static int
+add_marks(linemap_t *lm, const size_t marks[], int nmarks)
+{
+	if(lm->nmarks + nmarks > lm->marks_cap)
+	{
+		int cap = (lm->marks_cap == 0) ? 64 : lm->marks_cap;
+		while(cap < lm->nmarks + nmarks)
+		{
+			cap *= 2;
+		}
+
+		size_t *const new_marks = reallocarray(lm->marks, cap, sizeof(*new_marks));
+		if(new_marks == NULL)
+		{
+			lm->failed = 1;
+			return 1;
+		}
+		lm->marks = new_marks;
+		lm->marks_cap = cap;
+	}
+
+	memcpy(lm->marks + lm->nmarks, marks, sizeof(*marks)*nmarks);
+	lm->nmarks += nmarks;
+	return 0;
+}
+
+int
+linemap_wait(linemap_t *lm, int timeout)
+{
+	pthread_mutex_lock(&lm->lock);
+
+	if(timeout < 0)
+	{
+		while(lm->running)
+		{
+			pthread_cond_wait(&lm->over, &lm->lock);
+		}
+	}
+	else
+	{
+		struct timespec deadline;
+		get_deadline(timeout, &deadline);
+
+		while(lm->running)
+		{
+			if(pthread_cond_timedwait(&lm->over, &lm->lock, &deadline) != 0)
+			{
+				break;
+			}
+		}
+	}
+
+	const int complete = lm->complete;
+	pthread_mutex_unlock(&lm->lock);
+	return complete;
+}
+
+void
+linemap_free(linemap_t *lm)
+{
+	if(lm == NULL)
+	{
+		return;
+	}
+
+	(void)stop_indexing(lm);
+
+	pthread_cond_destroy(&lm->step);
+	pthread_cond_destroy(&lm->over);
+	pthread_mutex_destroy(&lm->lock);
+
+	release_data(lm->base, lm->base_size, lm->mapped);
+	free(lm->marks);
+	free(lm);
+}
+
+/* Cancels background indexing and waits for its thread to finish.  Returns
+ * non-zero if indexing was in progress. */
+static int
+stop_indexing(linemap_t *lm)
+{
+	pthread_mutex_lock(&lm->lock);
+	const int was_running = lm->running;
+	lm->cancelled = 1;
+	pthread_mutex_unlock(&lm->lock);
+
+	if(lm->has_thread)
+	{
+		pthread_join(lm->thread, NULL);
+		lm->has_thread = 0;
+	}
+
+	lm->cancelled = 0;
+	return was_running;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
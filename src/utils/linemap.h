@@ -0,0 +1,96 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__LINEMAP_H__
+#define VIFM__UTILS__LINEMAP_H__
+
+#include <stddef.h> /* size_t */
+
+/* Line-oriented access to text of any size.  Large regular files are mapped
+ * into memory instead of being read.  Offsets of lines are indexed lazily as
+ * lines are requested and sparsely (only every few hundredth line start is
+ * remembered), so memory usage doesn't grow with size of the text.  Lines are
+ * separated by newlines, carriage returns before them are dropped and leading
+ * UTF-8 BOM is skipped. */
+
+/* Opaque line map type. */
+typedef struct linemap_t linemap_t;
+
+/* Creates line map of a file.  Files that aren't regular (like FIFOs) or report
+ * zero size (like those in /proc) are read until the end and can't be extended
+ * afterwards.  Returns new line map or NULL on error or if path refers to a
+ * directory. */
+linemap_t * linemap_open(const char path[]);
+
+/* Creates line map of a buffer taking ownership of it (the buffer must be
+ * allocated by malloc()).  Returns new line map or NULL on error, in which case
+ * the buffer is freed. */
+linemap_t * linemap_from_buffer(char text[], size_t len);
+
+/* Appends to the text of a map created by linemap_open() bytes that were
+ * added to the end of its file since then, keeping what was indexed so far.
+ * Must not be called while other threads access the map.  Returns zero on
+ * success (also when nothing was added) and non-zero if the map wasn't created
+ * from a file, the file was replaced or truncated or on error, in which case
+ * the map should be recreated. */
+int linemap_extend(linemap_t *lm, const char path[]);
+
+/* Checks whether file of a map created by linemap_open() is still the same one
+ * and wasn't truncated, which must be done before reading text of the map if
+ * the file could have been changed.  Returns non-zero if so. */
+int linemap_is_intact(const linemap_t *lm, const char path[]);
+
+/* Retrieves contents of the line by its zero-based number indexing text up to
+ * it if necessary.  Sets *line and *len, the line isn't terminated.  Returns
+ * zero on success and non-zero if there is no such line. */
+int linemap_get(linemap_t *lm, int n, const char **line, size_t *len);
+
+/* Retrieves copy of the line by its zero-based number.  Returns newly allocated
+ * string or NULL if there is no such line or on error. */
+char * linemap_dup(linemap_t *lm, int n);
+
+/* Retrieves whole text, which isn't terminated.  Sets *size to its length.
+ * Returns pointer to the text. */
+const char * linemap_text(const linemap_t *lm, size_t *size);
+
+/* Finds line that contains byte at the offset in the text indexing text up to
+ * it if necessary.  Returns zero-based number of the line. */
+int linemap_line_at(linemap_t *lm, size_t offset);
+
+/* Retrieves number of lines indexed so far.  Sets *complete to non-zero if
+ * whole text was indexed and thus the number is the total one. */
+int linemap_count(linemap_t *lm, int *complete);
+
+/* Starts indexing rest of the text in the background.  Main loop is woken up
+ * via wakeup_notify() when indexing is over.  Does nothing if text is already
+ * indexed or indexing is in progress. */
+void linemap_index_bg(linemap_t *lm);
+
+/* Waits for background indexing to finish, but no longer than timeout (in
+ * milliseconds, negative means forever).  Returns non-zero if whole text is
+ * indexed. */
+int linemap_wait(linemap_t *lm, int timeout);
+
+/* Stops background indexing if it's running and frees resources.  lm can be
+ * NULL. */
+void linemap_free(linemap_t *lm);
+
+#endif /* VIFM__UTILS__LINEMAP_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
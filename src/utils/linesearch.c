@@ -0,0 +1,541 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "linesearch.h"
+
+#include <regex.h> /* REG_NOSUB REG_STARTEND regcomp() regexec() regfree() */
+#include <stddef.h> /* NULL size_t */
+#include <stdlib.h> /* calloc() free() realloc() */
+#include <string.h> /* memchr() memcpy() strdup() strlen() */
+#include <time.h> /* timespec */
+
+#include "../compat/pthread.h"
+#include "../compat/reallocarray.h"
+#include "linemap.h"
+#include "macros.h"
+#include "parallel.h"
+#include "regexp.h"
+#include "str.h"
+#include "utils.h"
+#include "wakeup.h"
+
+/* Number of bytes processed between checks for cancellation. */
+#define CHUNK_SIZE (1024*1024)
+
+/* Growable buffer of the thread. */
+typedef struct
+{
+	char *data;      /* Contents of the buffer. */
+	size_t capacity; /* Number of allocated bytes. */
+}
+buffer_t;
+
+/* Growable array of offsets. */
+typedef struct
+{
+	size_t *items;   /* Elements of the array. */
+	size_t len;      /* Number of elements. */
+	size_t capacity; /* Number of allocated elements. */
+}
+offsets_t;
+
+struct linesearch_t
+{
+	linemap_t *lm;             /* Text to search in. */
+	char *pattern;             /* Regular expression to compile in the thread. */
+	int cflags;                /* Flags for compiling the regex. */
+	linesearch_prep_func prep; /* Preprocessing of lines with escapes. */
+	char *literal;             /* Text that every match contains or NULL. */
+	size_t lit_len;            /* Length of the literal. */
+	int exact;                 /* Whether literal is all there is to the regex. */
+
+	int counting; /* Whether matching lines are counted. */
+	int from;     /* Line to start looking from. */
+	int backward; /* Whether search goes up. */
+	int nth;      /* Number of matching line to look for. */
+
+	parallel_team_t team; /* Thread that does the search. */
+
+	pthread_mutex_t lock; /* Protects fields below. */
+	pthread_cond_t over;  /* Signaled when search is over. */
+	int result;           /* Found line or number of matches. */
+	int done;             /* Whether search is over. */
+	int cancelled;        /* Whether search was cancelled. */
+};
+
+static linesearch_t * start_search(linemap_t *lm,
+		const linesearch_criteria_t *criteria, int counting);
+static void work(int index, void *arg);
+static int find_forward(linesearch_t *ls, const regex_t *re, buffer_t *buf);
+static int find_backward(linesearch_t *ls, const regex_t *re, buffer_t *buf);
+static int count_matches(linesearch_t *ls, const regex_t *re, buffer_t *buf);
+static size_t get_chunk_end(const char data[], size_t size, size_t pos);
+static void scan_chunk(const linesearch_t *ls, const regex_t *re,
+		const char data[], size_t from, size_t to, buffer_t *buf,
+		offsets_t *hits);
+static int line_matches(const linesearch_t *ls, const regex_t *re,
+		const char line[], const char eol[], buffer_t *buf);
+static int is_cancelled(linesearch_t *ls);
+static int buffer_reserve(buffer_t *buf, size_t size);
+static void add_offset(offsets_t *offsets, size_t offset);
+
+linesearch_t *
+linesearch_find(linemap_t *lm, const linesearch_criteria_t *criteria, int from,
+		int backward, int nth)
+{
+	linesearch_t *const ls = start_search(lm, criteria, 0);
+	if(ls == NULL)
+	{
+		return NULL;
+	}
+
+	ls->from = from;
+	ls->backward = backward;
+	ls->nth = MAX(nth, 1);
+
+	parallel_team_run(&ls->team, 1, &work, ls);
+	return ls;
+}
+
+linesearch_t *
+linesearch_count(linemap_t *lm, const linesearch_criteria_t *criteria,
+		int from)
+{
+	linesearch_t *const ls = start_search(lm, criteria, 1);
+	if(ls == NULL)
+	{
+		return NULL;
+	}
+
+	ls->from = from;
+
+	parallel_team_run(&ls->team, 1, &work, ls);
+	return ls;
+}
+
+/* Allocates and initializes search that isn't started yet.  Returns new search
+ * or NULL on error. */
+static linesearch_t *
+start_search(linemap_t *lm, const linesearch_criteria_t *criteria,
+		int counting)
+{
+	linesearch_t *const ls = calloc(1, sizeof(*ls));
+	if(ls == NULL)
+	{
+		return NULL;
+	}
+
+	ls->pattern = strdup(criteria->pattern);
+	if(ls->pattern == NULL)
+	{
+		free(ls);
+		return NULL;
+	}
+
+	ls->lm = lm;
+	ls->cflags = criteria->cflags | REG_NOSUB;
+	ls->prep = criteria->prep;
+	ls->counting = counting;
+	ls->result = counting ? 0 : -1;
+
+	/* Case-insensitive matches can't be found by comparing bytes. */
+	if(!(ls->cflags & REG_ICASE))
+	{
+		ls->literal = regexp_extract_literal(ls->pattern, &ls->exact);
+		ls->lit_len = (ls->literal == NULL) ? 0U : strlen(ls->literal);
+	}
+
+	pthread_mutex_init(&ls->lock, NULL);
+	pthread_cond_init(&ls->over, NULL);
+	return ls;
+}
+
+/* Body of the search thread, which performs the search and publishes its
+ * result. */
+static void
+work(int index, void *arg)
+{
+	linesearch_t *const ls = arg;
+	regex_t re;
+	buffer_t buf = { .data = NULL, .capacity = 0U };
+	int result = ls->result;
+
+	if(regcomp(&re, ls->pattern, ls->cflags) == 0)
+	{
+		if(ls->counting)
+		{
+			result = count_matches(ls, &re, &buf);
+		}
+		else if(ls->backward)
+		{
+			result = find_backward(ls, &re, &buf);
+		}
+		else
+		{
+			result = find_forward(ls, &re, &buf);
+		}
+		regfree(&re);
+	}
+
+	free(buf.data);
+
+	pthread_mutex_lock(&ls->lock);
+	ls->result = result;
+	ls->done = 1;
+	pthread_cond_broadcast(&ls->over);
+	pthread_mutex_unlock(&ls->lock);
+
+	wakeup_notify();
+}
+
+/* Looks for nth matching line at or below the starting one.  Returns its
+ * number or -1. */
+static int
+find_forward(linesearch_t *ls, const regex_t *re, buffer_t *buf)
+{
+	size_t size;
+	const char *const data = linemap_text(ls->lm, &size);
+	const char *line;
+	size_t len;
+	if(linemap_get(ls->lm, ls->from, &line, &len) != 0)
+	{
+		return -1;
+	}
+
+	offsets_t hits = { .items = NULL, .len = 0U, .capacity = 0U };
+	size_t pos = line - data;
+	size_t left = ls->nth;
+	int result = -1;
+	while(pos < size && !is_cancelled(ls))
+	{
+		const size_t end = get_chunk_end(data, size, pos);
+
+		hits.len = 0U;
+		scan_chunk(ls, re, data, pos, end, buf, &hits);
+		if(hits.len >= left)
+		{
+			result = linemap_line_at(ls->lm, hits.items[left - 1U]);
+			break;
+		}
+
+		left -= hits.len;
+		pos = end;
+	}
+
+	free(hits.items);
+	return result;
+}
+
+/* Looks for nth matching line at or above the starting one.  Returns its
+ * number or -1. */
+static int
+find_backward(linesearch_t *ls, const regex_t *re, buffer_t *buf)
+{
+	size_t size;
+	const char *const data = linemap_text(ls->lm, &size);
+	const char *line;
+	size_t len;
+	if(linemap_get(ls->lm, ls->from, &line, &len) != 0)
+	{
+		return -1;
+	}
+
+	const char *const nl = memchr(line, '\n', data + size - line);
+	size_t end = (nl == NULL) ? size : (size_t)(nl + 1 - data);
+
+	offsets_t hits = { .items = NULL, .len = 0U, .capacity = 0U };
+	size_t left = ls->nth;
+	int result = -1;
+	while(end > 0U && !is_cancelled(ls))
+	{
+		size_t start = (end > CHUNK_SIZE) ? end - CHUNK_SIZE : 0U;
+		while(start > 0U && data[start - 1U] != '\n')
+		{
+			--start;
+		}
+
+		hits.len = 0U;
+		scan_chunk(ls, re, data, start, end, buf, &hits);
+		if(hits.len >= left)
+		{
+			result = linemap_line_at(ls->lm, hits.items[hits.len - left]);
+			break;
+		}
+
+		left -= hits.len;
+		end = start;
+	}
+
+	free(hits.items);
+	return result;
+}
+
+/* Counts matching lines at or below the starting one.  Returns the number. */
+static int
+count_matches(linesearch_t *ls, const regex_t *re, buffer_t *buf)
+{
+	size_t size;
+	const char *const data = linemap_text(ls->lm, &size);
+	const char *line;
+	size_t len;
+	if(linemap_get(ls->lm, ls->from, &line, &len) != 0)
+	{
+		return 0;
+	}
+
+	offsets_t hits = { .items = NULL, .len = 0U, .capacity = 0U };
+	size_t pos = line - data;
+	int count = 0;
+	while(pos < size && !is_cancelled(ls))
+	{
+		const size_t end = get_chunk_end(data, size, pos);
+
+		hits.len = 0U;
+		scan_chunk(ls, re, data, pos, end, buf, &hits);
+		count += hits.len;
+
+		pos = end;
+	}
+
+	free(hits.items);
+	return count;
+}
+
+/* Determines end of a chunk that starts at the position so that it ends at a
+ * line boundary.  Returns the end offset. */
+static size_t
+get_chunk_end(const char data[], size_t size, size_t pos)
+{
+	if(size - pos <= CHUNK_SIZE)
+	{
+		return size;
+	}
+
+	const char *const limit = data + pos + CHUNK_SIZE;
+	const char *const nl = memchr(limit, '\n', data + size - limit);
+	return (nl == NULL) ? size : (size_t)(nl + 1 - data);
+}
+
+/* Appends offsets of matching lines of the [from, to) range of the text, which
+ * starts and ends at line boundaries, to hits. */
+static void
+scan_chunk(const linesearch_t *ls, const regex_t *re, const char data[],
+		size_t from, size_t to, buffer_t *buf, offsets_t *hits)
+{
+	const char *const begin = data + from;
+	const char *const end = data + to;
+
+	/* Escape sequences can break up the literal. */
+	const int prefilter = ls->literal != NULL
+	                   && (ls->prep == NULL
+	                    || memchr(begin, '\033', end - begin) == NULL);
+
+	const char *p = begin;
+	while(p < end)
+	{
+		const char *line = p;
+		if(prefilter)
+		{
+			const char *const hit = find_bytes(p, end - p, ls->literal, ls->lit_len);
+			if(hit == NULL)
+			{
+				break;
+			}
+
+			line = hit;
+			while(line != p && line[-1] != '\n')
+			{
+				--line;
+			}
+		}
+
+		const char *eol = memchr(line, '\n', end - line);
+		if(eol == NULL)
+		{
+			eol = end;
+		}
+
+		if((prefilter && ls->exact) || line_matches(ls, re, line, eol, buf))
+		{
+			add_offset(hits, line - data);
+		}
+
+		p = (eol == end) ? end : eol + 1;
+	}
+}
+
+/* Checks whether line matches the regular expression.  Returns non-zero if so,
+ * otherwise zero is returned. */
+static int
+line_matches(const linesearch_t *ls, const regex_t *re, const char line[],
+		const char eol[], buffer_t *buf)
+{
+	size_t len = eol - line;
+	if(len != 0U && line[len - 1U] == '\r')
+	{
+		--len;
+	}
+
+	if(ls->prep != NULL && memchr(line, '\033', len) != NULL)
+	{
+		if(buffer_reserve(buf, len + 1U) != 0)
+		{
+			return 0;
+		}
+		memcpy(buf->data, line, len);
+		buf->data[len] = '\0';
+
+		char *const prepped = ls->prep(buf->data);
+		const int matches = (prepped != NULL && regexec(re, prepped, 0, NULL, 0)
+				== 0);
+		free(prepped);
+		return matches;
+	}
+
+#ifdef REG_STARTEND
+	regmatch_t match = { .rm_so = 0, .rm_eo = len };
+	return (regexec(re, line, 1, &match, REG_STARTEND) == 0);
+#else
+	if(buffer_reserve(buf, len + 1U) != 0)
+	{
+		return 0;
+	}
+	memcpy(buf->data, line, len);
+	buf->data[len] = '\0';
+	return (regexec(re, buf->data, 0, NULL, 0) == 0);
+#endif
+}
+
+int
+linesearch_wait(linesearch_t *ls, int timeout)
+{
+	pthread_mutex_lock(&ls->lock);
+
+	if(timeout < 0)
+	{
+		while(!ls->done)
+		{
+			pthread_cond_wait(&ls->over, &ls->lock);
+		}
+	}
+	else
+	{
+		struct timespec deadline;
+		get_deadline(timeout, &deadline);
+
+		while(!ls->done)
+		{
+			if(pthread_cond_timedwait(&ls->over, &ls->lock, &deadline) != 0)
+			{
+				break;
+			}
+		}
+	}
+
+	const int done = ls->done;
+	pthread_mutex_unlock(&ls->lock);
+	return done;
+}
+
+int
+linesearch_result(linesearch_t *ls)
+{
+	pthread_mutex_lock(&ls->lock);
+	const int result = ls->result;
+	pthread_mutex_unlock(&ls->lock);
+	return result;
+}
+
+void
+linesearch_free(linesearch_t *ls)
+{
+	if(ls == NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&ls->lock);
+	ls->cancelled = 1;
+	pthread_mutex_unlock(&ls->lock);
+
+	parallel_team_join(&ls->team);
+
+	pthread_cond_destroy(&ls->over);
+	pthread_mutex_destroy(&ls->lock);
+
+	free(ls->literal);
+	free(ls->pattern);
+	free(ls);
+}
+
+/* Checks whether the search should stop.  Returns non-zero if so, otherwise
+ * zero is returned. */
+static int
+is_cancelled(linesearch_t *ls)
+{
+	pthread_mutex_lock(&ls->lock);
+	const int cancelled = ls->cancelled;
+	pthread_mutex_unlock(&ls->lock);
+	return cancelled;
+}
+
+/* Makes sure that buffer can hold at least size bytes.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+buffer_reserve(buffer_t *buf, size_t size)
+{
+	if(size <= buf->capacity)
+	{
+		return 0;
+	}
+
+	char *const data = realloc(buf->data, size);
+	if(data == NULL)
+	{
+		return 1;
+	}
+
+	buf->data = data;
+	buf->capacity = size;
+	return 0;
+}
+
+/* Appends offset to the array ignoring allocation errors. */
+static void
+add_offset(offsets_t *offsets, size_t offset)
+{
+	if(offsets->len == offsets->capacity)
+	{
+		const size_t capacity = (offsets->capacity == 0U)
+		                      ? 64U
+		                      : offsets->capacity*2U;
+		size_t *const items = reallocarray(offsets->items, capacity,
+				sizeof(*items));
+		if(items == NULL)
+		{
+			return;
+		}
+		offsets->items = items;
+		offsets->capacity = capacity;
+	}
+
+	offsets->items[offsets->len++] = offset;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,76 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__LINESEARCH_H__
+#define VIFM__UTILS__LINESEARCH_H__
+
+/* Search for lines of a line map that match a regular expression.  Text is
+ * processed in chunks by a background thread, which checks for cancellation
+ * between chunks.  When possible, a literal that every match must contain is
+ * looked for first and the regular expression is evaluated only on lines that
+ * contain it. */
+
+struct linemap_t;
+
+/* Opaque line search type. */
+typedef struct linesearch_t linesearch_t;
+
+/* Converts line into the form in which it's matched.  Returns newly allocated
+ * string or NULL on error. */
+typedef char * (*linesearch_prep_func)(const char line[]);
+
+/* What to look for. */
+typedef struct
+{
+	const char *pattern;       /* Extended regular expression. */
+	int cflags;                /* Flags for compiling the pattern. */
+	linesearch_prep_func prep; /* Applied to lines that contain escape
+	                              character (\033) before matching or NULL. */
+}
+linesearch_criteria_t;
+
+/* Starts looking for nth (counting from 1) matching line starting at line
+ * number from and going in specified direction.  Line map must stay valid
+ * until the search is freed.  Returns new search or NULL on error. */
+linesearch_t * linesearch_find(struct linemap_t *lm,
+		const linesearch_criteria_t *criteria, int from, int backward, int nth);
+
+/* Starts counting matching lines of the text starting at line number from.
+ * Line map must stay valid until the search is freed.  Returns new search or
+ * NULL on error. */
+linesearch_t * linesearch_count(struct linemap_t *lm,
+		const linesearch_criteria_t *criteria, int from);
+
+/* Waits for the search to finish, but no longer than timeout (in milliseconds,
+ * negative means forever).  Main loop is woken up via wakeup_notify() when
+ * search is over.  Returns non-zero if search is over. */
+int linesearch_wait(linesearch_t *ls, int timeout);
+
+/* Retrieves result of a search that is over.  Returns number of the found line
+ * or -1 for linesearch_find() and number of matching lines for
+ * linesearch_count(). */
+int linesearch_result(linesearch_t *ls);
+
+/* Stops the search if it's still running, waits for its thread and frees
+ * resources.  ls can be NULL. */
+void linesearch_free(linesearch_t *ls);
+
+#endif /* VIFM__UTILS__LINESEARCH_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,237 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "parallel.h"
+
+#include <stddef.h> /* NULL */
+
+#include "../compat/pthread.h"
+#include "macros.h"
+#include "utils.h"
+
+static void pool_thread(int index, void *arg);
+static void process_range(parallel_pool_t *pool);
+static void * member_thread(void *arg);
+
+void
+parallel_for(int count, int nthreads, parallel_func func, void *arg)
+{
+	parallel_pool_t pool;
+	parallel_pool_start(&pool, nthreads);
+	parallel_pool_for(&pool, count, func, arg);
+	parallel_pool_stop(&pool);
+}
+
+void
+parallel_pool_start(parallel_pool_t *pool, int nthreads)
+{
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->wakeup, NULL);
+	pthread_cond_init(&pool->idle, NULL);
+	pool->gen = 0U;
+	pool->nbusy = 0;
+	pool->stop = 0;
+	pool->nthreads = nthreads;
+	pool->started = 0;
+	pool->team.count = 0;
+}
+
+void
+parallel_pool_for(parallel_pool_t *pool, int count, parallel_func func,
+		void *arg)
+{
+	int i;
+
+	if(!pool->started && count >= 2 && pool->nthreads >= 2)
+	{
+		/* Calling thread is one of the workers. */
+		pool->started = 1;
+		(void)parallel_team_start(&pool->team, MIN(pool->nthreads, count) - 1,
+				&pool_thread, pool);
+	}
+
+	if(pool->team.count == 0 || count < 2)
+	{
+		for(i = 0; i < count; ++i)
+		{
+			func(i, arg);
+		}
+		return;
+	}
+
+	const int nthreads = pool->team.count + 1;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->func = func;
+	pool->arg = arg;
+	pool->count = count;
+	/* Reduce contention for large ranges, but leave enough items to balance the
+	 * load. */
+	pool->chunk = MAX(1, count/(nthreads*16));
+	pool->next = 0;
+	pool->nbusy = pool->team.count;
+	++pool->gen;
+	pthread_cond_broadcast(&pool->wakeup);
+	pthread_mutex_unlock(&pool->lock);
+
+	process_range(pool);
+
+	pthread_mutex_lock(&pool->lock);
+	while(pool->nbusy != 0)
+	{
+		pthread_cond_wait(&pool->idle, &pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+}
+
+void
+parallel_pool_stop(parallel_pool_t *pool)
+{
+	pthread_mutex_lock(&pool->lock);
+	pool->stop = 1;
+	pthread_cond_broadcast(&pool->wakeup);
+	pthread_mutex_unlock(&pool->lock);
+
+	parallel_team_join(&pool->team);
+
+	pthread_cond_destroy(&pool->idle);
+	pthread_cond_destroy(&pool->wakeup);
+	pthread_mutex_destroy(&pool->lock);
+}
+
+/* Entry point of threads of a pool, which process every new range until the
+ * pool is stopped. */
+static void
+pool_thread(int index, void *arg)
+{
+	parallel_pool_t *const pool = arg;
+	unsigned int seen_gen = 0U;
+
+	pthread_mutex_lock(&pool->lock);
+	while(1)
+	{
+		while(!pool->stop && pool->gen == seen_gen)
+		{
+			pthread_cond_wait(&pool->wakeup, &pool->lock);
+		}
+		if(pool->stop)
+		{
+			break;
+		}
+		seen_gen = pool->gen;
+		pthread_mutex_unlock(&pool->lock);
+
+		process_range(pool);
+
+		pthread_mutex_lock(&pool->lock);
+		if(--pool->nbusy == 0)
+		{
+			pthread_cond_signal(&pool->idle);
+		}
+	}
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/* Processes items of current range of the pool until there are none left. */
+static void
+process_range(parallel_pool_t *pool)
+{
+	while(1)
+	{
+		int from, to;
+
+		pthread_mutex_lock(&pool->lock);
+		from = pool->next;
+		to = MIN(from + pool->chunk, pool->count);
+		pool->next = to;
+		pthread_mutex_unlock(&pool->lock);
+
+		if(from >= to)
+		{
+			break;
+		}
+
+		for(; from < to; ++from)
+		{
+			pool->func(from, pool->arg);
+		}
+	}
+}
+
+int
+parallel_team_start(parallel_team_t *team, int nthreads, parallel_func func,
+		void *arg)
+{
+	int i;
+
+	team->func = func;
+	team->arg = arg;
+	team->count = 0;
+
+	nthreads = MIN(nthreads, PARALLEL_MAX_THREADS);
+	for(i = 0; i < nthreads; ++i)
+	{
+		parallel_member_t *const member = &team->members[team->count];
+		member->team = team;
+		member->index = team->count;
+		if(pthread_create(&team->ids[team->count], NULL, &member_thread,
+					member) == 0)
+		{
+			++team->count;
+		}
+	}
+
+	return team->count;
+}
+
+void
+parallel_team_run(parallel_team_t *team, int nthreads, parallel_func func,
+		void *arg)
+{
+	if(parallel_team_start(team, nthreads, func, arg) == 0)
+	{
+		/* Do all the work right away if threads aren't available. */
+		func(0, arg);
+	}
+}
+
+void
+parallel_team_join(parallel_team_t *team)
+{
+	int i;
+	for(i = 0; i < team->count; ++i)
+	{
+		(void)pthread_join(team->ids[i], NULL);
+	}
+	team->count = 0;
+}
+
+/* Entry point of threads of teams.  Returns NULL. */
+static void *
+member_thread(void *arg)
+{
+	const parallel_member_t *const member = arg;
+	const parallel_team_t *const team = member->team;
+
+	block_all_thread_signals();
+	team->func(member->index, team->arg);
+	return NULL;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,122 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__PARALLEL_H__
+#define VIFM__UTILS__PARALLEL_H__
+
+#include "../compat/pthread.h"
+
+/* Simple means of splitting independent pieces of work among several threads,
+ * of reusing the same threads for many such splits (pools) and of starting
+ * groups of threads (teams) for more elaborate schemes. */
+
+/* Upper limit on number of threads of a team to avoid exhausting resources. */
+#define PARALLEL_MAX_THREADS 64
+
+/* Type of function that processes a single item specified by its index.  It
+ * can be invoked concurrently from different threads. */
+typedef void (*parallel_func)(int index, void *arg);
+
+struct parallel_team_t;
+
+/* Thread of a team. */
+typedef struct
+{
+	struct parallel_team_t *team; /* Team of the thread. */
+	int index;                    /* Index of the thread within the team. */
+}
+parallel_member_t;
+
+/* Group of threads running the same function.  Its fields are private. */
+typedef struct parallel_team_t
+{
+	parallel_func func; /* Function of the threads. */
+	void *arg;          /* Argument of the function. */
+	int count;          /* Number of started threads. */
+
+	pthread_t ids[PARALLEL_MAX_THREADS];             /* Started threads. */
+	parallel_member_t members[PARALLEL_MAX_THREADS]; /* Their arguments. */
+}
+parallel_team_t;
+
+/* Team of threads that is kept alive to process several ranges of items one
+ * after another.  Its fields are private. */
+typedef struct
+{
+	parallel_team_t team; /* Threads of the pool. */
+	int nthreads;         /* Maximum number of threads to use. */
+	int started;          /* Whether starting threads was attempted. */
+
+	pthread_mutex_t lock;  /* Protects fields below. */
+	pthread_cond_t wakeup; /* Signaled when there is new range or on stop. */
+	pthread_cond_t idle;   /* Signaled when the last thread leaves a range. */
+	unsigned int gen;      /* Incremented for each new range. */
+	int nbusy;             /* Number of threads working on current range. */
+	int stop;              /* Whether threads should exit. */
+
+	parallel_func func; /* Function to invoke for items of current range. */
+	void *arg;          /* Argument for the function. */
+	int count;          /* Number of items in current range. */
+	int chunk;          /* Number of items taken by a thread at once. */
+	int next;           /* Index of the first not yet taken item. */
+}
+parallel_pool_t;
+
+/* Invokes func for each index in [0; count) range using at most nthreads
+ * threads (calling thread is one of them).  Falls back to processing items
+ * sequentially if nthreads is less than two or threads can't be created.
+ * Returns after all items were processed. */
+void parallel_for(int count, int nthreads, parallel_func func, void *arg);
+
+/* Prepares pool that uses at most nthreads threads (calling thread of
+ * parallel_pool_for() is one of them).  Threads are started on the first
+ * parallel_pool_for() call and their number is limited by the size of its
+ * range.  Pool falls back to processing items sequentially if nthreads is less
+ * than two or threads can't be created.  The pool must stay in place until
+ * it's stopped. */
+void parallel_pool_start(parallel_pool_t *pool, int nthreads);
+
+/* Same as parallel_for(), but items are processed by threads of the pool
+ * instead of new ones. */
+void parallel_pool_for(parallel_pool_t *pool, int count, parallel_func func,
+		void *arg);
+
+/* Stops threads of the pool and frees its resources. */
+void parallel_pool_stop(parallel_pool_t *pool);
+
+/* Starts up to nthreads threads (but no more than PARALLEL_MAX_THREADS) each of
+ * which invokes func with its index in the team, which is in [0; number of
+ * started threads) range.  All signals are blocked in the threads.  The team
+ * must stay in place until it's joined.  Returns number of started threads,
+ * which can be smaller than requested or zero. */
+int parallel_team_start(parallel_team_t *team, int nthreads,
+		parallel_func func, void *arg);
+
+/* Same as parallel_team_start(), but invokes func with zero index on the
+ * calling thread before returning if no threads could be started. */
+void parallel_team_run(parallel_team_t *team, int nthreads, parallel_func func,
+		void *arg);
+
+/* Waits for all threads of the team to finish.  The team can be started again
+ * afterwards. */
+void parallel_team_join(parallel_team_t *team);
+
+#endif /* VIFM__UTILS__PARALLEL_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -21,10 +21,17 @@
 #include <regex.h> /* regex_t regmatch_t regerror() regexec() */
 
 #include <ctype.h> /* isdigit() */
+#include <stddef.h> /* size_t */
+#include <stdlib.h> /* free() malloc() */
+#include <string.h> /* memcpy() strchr() strlen() */
 
 #include "../cfg/config.h"
+#include "macros.h"
 #include "str.h"
 
+/* Characters that have special meaning in extended regular expressions. */
+#define ERE_SPECIAL "^.[]$()|*+?{}\\"
+
 int
 get_regexp_cflags(const char pattern[])
 {
@@ -202,5 +209,120 @@ regexp_subst(const char src[], const char sub[], const regmatch_t matches[],
 	return buf;
 }
 
+char *
+regexp_extract_literal(const char pattern[], int *exact)
+{
+	/* Alternatives can make any piece optional. */
+	if(strchr(pattern, '|') != NULL)
+	{
+		return NULL;
+	}
+
+	char *const run = malloc(strlen(pattern) + 1U);
+	char *const best = malloc(strlen(pattern) + 1U);
+	if(run == NULL || best == NULL)
+	{
+		free(run);
+		free(best);
+		return NULL;
+	}
+
+	size_t run_len = 0U, best_len = 0U;
+	int depth = 0;
+	const char *p;
+
+	*exact = 1;
+	for(p = pattern; ; ++p)
+	{
+		const char c = *p;
+
+		if(depth == 0 && c != '\0' && strchr(ERE_SPECIAL, c) == NULL)
+		{
+			run[run_len++] = c;
+			continue;
+		}
+
+		if(c == '\\' && p[1] != '\0' && strchr(ERE_SPECIAL, p[1]) != NULL)
+		{
+			*exact = 0;
+			++p;
+			if(depth == 0)
+			{
+				run[run_len++] = *p;
+			}
+			continue;
+		}
+
+		/* Quantifiers make preceding character optional. */
+		if(depth == 0 && run_len != 0U && (c == '*' || c == '?' || c == '{'))
+		{
+			--run_len;
+		}
+
+		if(run_len > best_len)
+		{
+			memcpy(best, run, run_len);
+			best_len = run_len;
+		}
+		run_len = 0U;
+
+		if(c == '\0')
+		{
+			break;
+		}
+
+		*exact = 0;
+
+		if(c == '(')
+		{
+			++depth;
+		}
+		else if(c == ')')
+		{
+			depth = MAX(0, depth - 1);
+		}
+		else if(c == '{')
+		{
+			const char *const end = strchr(p, '}');
+			p = (end == NULL) ? p : end;
+		}
+		else if(c == '\\')
+		{
+			/* Escapes like \< or \w don't match themselves. */
+			if(p[1] != '\0')
+			{
+				++p;
+			}
+		}
+		else if(c == '[')
+		{
+			/* Skip bracket expression, which can contain "]" at the start and
+			 * classes like [:alpha:]. */
+			p += (p[1] == '^');
+			p += (p[1] == ']');
+			while(p[1] != '\0' && p[1] != ']')
+			{
+				++p;
+				if(p[0] == '[' && (p[1] == ':' || p[1] == '.' || p[1] == '='))
+				{
+					const char *const end = strchr(p + 2, ']');
+					p = (end == NULL) ? p : end;
+				}
+			}
+			p += (p[1] == ']');
+		}
+	}
+
+	free(run);
+	if(best_len == 0U)
+	{
+		free(best);
+		return NULL;
+	}
+
+	best[best_len] = '\0';
+	return best;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
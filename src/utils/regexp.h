@@ -61,6 +61,11 @@ const char * regexp_gsubst(regex_t *re, const char src[], const char sub[],
 const char * regexp_subst(const char src[], const char sub[],
 		const regmatch_t matches[], int *off);
 
+/* Finds the longest piece of text that all matches of an extended regular
+ * expression must contain.  Sets *exact to non-zero if the text is the whole
+ * pattern.  Returns newly allocated string or NULL if there is no such text. */
+char * regexp_extract_literal(const char pattern[], int *exact);
+
 #endif /* VIFM__UTILS__REGEXP_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -26,8 +26,9 @@
 #include <stdio.h> /* snprintf() */
 #include <stdlib.h> /* free() malloc() mbstowcs() memmove() memset() realloc()
                        strtol() wcstombs() */
-#include <string.h> /* memcpy() strdup() strncmp() strlen() strcmp() strchr()
-                       strrchr() strncpy() strcspn() strspn() */
+#include <string.h> /* memchr() memcmp() memcpy() strdup() strncmp() strlen()
+                       strcmp() strchr() strrchr() strncpy() strcspn()
+                       strspn() */
 #include <wchar.h> /* wint_t vswprintf() */
 #include <wctype.h> /* iswprint() iswupper() towlower() towupper() */
 
@@ -1090,6 +1091,31 @@ chars_in_str(const char s[], char c)
 	return char_count;
 }
 
+const char *
+find_bytes(const char data[], size_t size, const char bytes[], size_t len)
+{
+	if(size < len)
+	{
+		return NULL;
+	}
+
+	const char *const last = data + (size - len);
+	while(data <= last)
+	{
+		data = memchr(data, bytes[0], last - data + 1);
+		if(data == NULL)
+		{
+			return NULL;
+		}
+		if(memcmp(data + 1, bytes + 1, len - 1) == 0)
+		{
+			return data;
+		}
+		++data;
+	}
+	return NULL;
+}
+
 #ifdef _WIN32
 
 char *
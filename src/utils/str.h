@@ -293,6 +293,12 @@ int count_lines(const char text[], int max_width);
 /* Counts number of c char occurrences in the s string.  Returns the number. */
 size_t chars_in_str(const char s[], char c);
 
+/* Looks for the first occurrence of a sequence of bytes in the data using
+ * memchr(), which is vectorized by C libraries, to skip to candidates.  len
+ * must be positive.  Returns pointer to the occurrence or NULL. */
+const char * find_bytes(const char data[], size_t size, const char bytes[],
+		size_t len);
+
 #ifdef _WIN32
 
 /* Same as strstr(), but in case insensitive way. */
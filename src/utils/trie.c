@@ -18,22 +18,55 @@
 
 #include "trie.h"
 
-#include <stdlib.h> /* calloc() free() */
+#include <stddef.h> /* size_t */
+#include <stdlib.h> /* calloc() free() malloc() */
+#include <string.h> /* memcpy() strcmp() strlen() */
 
-/* Trie node. */
+/* Despite the name, this is a hash table with open addressing (linear probing)
+ * whose keys are kept in large blocks of memory that are freed all at once.
+ * Lookups touch a couple of cache lines instead of a node per character and
+ * insertion doesn't allocate in most cases. */
+
+/* Initial number of slots of a table, must be a power of two. */
+#define INITIAL_CAPACITY 16U
+/* Size of the first block for keys, subsequent blocks grow up to the limit. */
+#define MIN_BLOCK_SIZE 4096U
+/* Maximum size of block of keys (longer keys get blocks of their own size). */
+#define MAX_BLOCK_SIZE (1024U*1024U)
+
+/* Slot of the table. */
+typedef struct
+{
+	const char *key; /* Key stored in a block or NULL for an empty slot. */
+	void *data;      /* Data associated with the key. */
+	size_t hash;     /* Hash of the key to skip most of key comparisons. */
+}
+slot_t;
+
+/* Piece of memory that stores keys. */
+typedef struct block_t
+{
+	struct block_t *prev; /* Previously allocated block or NULL. */
+	size_t size;          /* Capacity of the block. */
+	size_t used;          /* Number of bytes already taken. */
+	char data[];          /* The storage. */
+}
+block_t;
+
+/* The table. */
 struct trie_t
 {
-	trie_t *left;     /* Nodes with values less than value. */
-	trie_t *right;    /* Nodes with values greater than value. */
-	trie_t *children; /* Child nodes. */
-	void *data;       /* Data associated with the key. */
-	char value;       /* Value of the node. */
-	char exists;      /* Whether this node exists or it's an intermediate node. */
+	slot_t *slots;    /* Slots of the table or NULL if nothing was added yet. */
+	size_t capacity;  /* Number of slots, always a power of two. */
+	size_t count;     /* Number of occupied slots. */
+	block_t *blocks;  /* Last allocated block of keys. */
 };
 
-static trie_t *clone_nodes(trie_t *trie, int *error);
-static void get_or_create(trie_t *trie, const char str[], void *data,
-		int *result);
+static slot_t * find_slot(slot_t slots[], size_t capacity, const char str[],
+		size_t hash);
+static int grow(trie_t *trie);
+static const char * store_key(trie_t *trie, const char str[], size_t len);
+static size_t hash_key(const char str[], size_t *len);
 
 trie_t *
 trie_create(void)
@@ -44,41 +77,51 @@ trie_create(void)
 trie_t *
 trie_clone(trie_t *trie)
 {
-	int error = 0;
+	trie_t *new_trie;
+	size_t i;
 
-	trie = clone_nodes(trie, &error);
-	if(error)
+	if(trie == NULL)
 	{
-		trie_free(trie);
 		return NULL;
 	}
 
-	return trie;
-}
-
-/* Clones node and all its relatives.  Sets *error to non-zero on error.
- * Returns new node. */
-static trie_t *
-clone_nodes(trie_t *trie, int *error)
-{
-	trie_t *new_trie;
-
-	if(trie == NULL)
+	new_trie = trie_create();
+	if(new_trie == NULL || trie->slots == NULL)
 	{
-		return NULL;
+		return new_trie;
 	}
 
-	new_trie = malloc(sizeof(*new_trie));
-	if(new_trie == NULL)
+	new_trie->slots = malloc(sizeof(*new_trie->slots)*trie->capacity);
+	if(new_trie->slots == NULL)
 	{
-		*error = 1;
+		trie_free(new_trie);
 		return NULL;
 	}
 
-	*new_trie = *trie;
-	new_trie->left = clone_nodes(trie->left, error);
-	new_trie->right = clone_nodes(trie->right, error);
-	new_trie->children = clone_nodes(trie->children, error);
+	memcpy(new_trie->slots, trie->slots,
+			sizeof(*new_trie->slots)*trie->capacity);
+	new_trie->capacity = trie->capacity;
+	new_trie->count = trie->count;
+
+	/* Keys must be copied into blocks of the new table. */
+	for(i = 0U; i < new_trie->capacity; ++i)
+	{
+		slot_t *const slot = &new_trie->slots[i];
+		if(slot->key != NULL)
+		{
+			slot->key = store_key(new_trie, slot->key, strlen(slot->key));
+			if(slot->key == NULL)
+			{
+				/* Drop keys that weren't copied to not free them as blocks. */
+				for(; i < new_trie->capacity; ++i)
+				{
+					new_trie->slots[i].key = NULL;
+				}
+				trie_free(new_trie);
+				return NULL;
+			}
+		}
+	}
 
 	return new_trie;
 }
@@ -86,26 +129,41 @@ clone_nodes(trie_t *trie, int *error)
 void
 trie_free(trie_t *trie)
 {
-	if(trie != NULL)
+	if(trie == NULL)
+	{
+		return;
+	}
+
+	while(trie->blocks != NULL)
 	{
-		trie_free(trie->left);
-		trie_free(trie->right);
-		trie_free(trie->children);
-		free(trie);
+		block_t *const prev = trie->blocks->prev;
+		free(trie->blocks);
+		trie->blocks = prev;
 	}
+
+	free(trie->slots);
+	free(trie);
 }
 
 void
 trie_free_with_data(trie_t *trie, trie_free_func free_func)
 {
-	if(trie != NULL)
+	size_t i;
+
+	if(trie == NULL)
 	{
-		trie_free_with_data(trie->left, free_func);
-		trie_free_with_data(trie->right, free_func);
-		trie_free_with_data(trie->children, free_func);
-		free_func(trie->data);
-		free(trie);
+		return;
 	}
+
+	for(i = 0U; i < trie->capacity; ++i)
+	{
+		if(trie->slots[i].key != NULL)
+		{
+			free_func(trie->slots[i].data);
+		}
+	}
+
+	trie_free(trie);
 }
 
 int
@@ -117,91 +175,178 @@ trie_put(trie_t *trie, const char str[])
 int
 trie_set(trie_t *trie, const char str[], const void *data)
 {
-	int result;
+	size_t len;
+	size_t hash;
+	slot_t *slot;
 
 	if(trie == NULL)
 	{
 		return -1;
 	}
 
-	get_or_create(trie, str, (void *)data, &result);
-	return result;
+	hash = hash_key(str, &len);
+
+	/* Updating existing key doesn't need more space. */
+	slot = (trie->slots == NULL)
+	     ? NULL
+	     : find_slot(trie->slots, trie->capacity, str, hash);
+	if(slot != NULL && slot->key != NULL)
+	{
+		slot->data = (void *)data;
+		return 1;
+	}
+
+	/* Keep load factor under 3/4. */
+	if((trie->count + 1U)*4U > trie->capacity*3U)
+	{
+		if(grow(trie) != 0)
+		{
+			return -1;
+		}
+		slot = find_slot(trie->slots, trie->capacity, str, hash);
+	}
+
+	slot->key = store_key(trie, str, len);
+	if(slot->key == NULL)
+	{
+		return -1;
+	}
+	slot->data = (void *)data;
+	slot->hash = hash;
+	++trie->count;
+	return 0;
 }
 
-/* Gets node which might involve its creation.  Sets *return to negative value
- * on error, to zero on successful insertion and to positive number if element
- * was already in the trie. */
-static void
-get_or_create(trie_t *trie, const char str[], void *data, int *result)
+int
+trie_get(trie_t *trie, const char str[], void **data)
 {
-	trie_t **link = &trie;
-	while(1)
+	size_t len;
+	size_t hash;
+	const slot_t *slot;
+
+	if(trie == NULL || trie->count == 0U)
+	{
+		return 1;
+	}
+
+	hash = hash_key(str, &len);
+	slot = find_slot(trie->slots, trie->capacity, str, hash);
+	if(slot->key == NULL)
 	{
-		/* Create inexistent node. */
-		if(trie == NULL)
+		return 1;
+	}
+
+	*data = slot->data;
+	return 0;
+}
+
+/* Looks up slot that either holds the key or is the empty one where it should
+ * be put.  The table must have at least one empty slot.  Returns the slot. */
+static slot_t *
+find_slot(slot_t slots[], size_t capacity, const char str[], size_t hash)
+{
+	const size_t mask = capacity - 1U;
+	size_t i = hash & mask;
+	while(slots[i].key != NULL)
+	{
+		if(slots[i].hash == hash && strcmp(slots[i].key, str) == 0)
 		{
-			trie = trie_create();
-			if(trie == NULL)
-			{
-				*result = -1;
-				break;
-			}
-			trie->value = *str;
-			*link = trie;
+			break;
 		}
+		i = (i + 1U) & mask;
+	}
+	return &slots[i];
+}
+
+/* Doubles capacity of the table (or allocates initial one) redistributing
+ * slots.  Returns zero on success, otherwise non-zero is returned. */
+static int
+grow(trie_t *trie)
+{
+	const size_t new_capacity = (trie->capacity == 0U)
+	                          ? INITIAL_CAPACITY
+	                          : trie->capacity*2U;
+	const size_t mask = new_capacity - 1U;
+	size_t i;
+
+	slot_t *const new_slots = calloc(new_capacity, sizeof(*new_slots));
+	if(new_slots == NULL)
+	{
+		return 1;
+	}
 
-		if(trie->value == *str)
+	/* Keys are unique, so only need to find an empty slot for each of them. */
+	for(i = 0U; i < trie->capacity; ++i)
+	{
+		const slot_t *const slot = &trie->slots[i];
+		if(slot->key != NULL)
 		{
-			if(*str == '\0')
+			size_t j = slot->hash & mask;
+			while(new_slots[j].key != NULL)
 			{
-				/* Found full match. */
-				*result = (trie->exists != 0);
-				trie->exists = 1;
-				trie->data = data;
-				break;
+				j = (j + 1U) & mask;
 			}
-
-			link = &trie->children;
-			++str;
-		}
-		else
-		{
-			link = (*str < trie->value) ? &trie->left : &trie->right;
+			new_slots[j] = *slot;
 		}
-		trie = *link;
 	}
+
+	free(trie->slots);
+	trie->slots = new_slots;
+	trie->capacity = new_capacity;
+	return 0;
 }
 
-int
-trie_get(trie_t *trie, const char str[], void **data)
+/* Copies the key into a block of the table allocating a new block if there
+ * isn't enough space left.  Returns pointer to the copy or NULL on error. */
+static const char *
+store_key(trie_t *trie, const char str[], size_t len)
 {
-	while(1)
+	block_t *block = trie->blocks;
+	char *key;
+
+	if(block == NULL || block->size - block->used < len + 1U)
 	{
-		if(trie == NULL)
+		size_t size = (block == NULL) ? MIN_BLOCK_SIZE : block->size*2U;
+		if(size > MAX_BLOCK_SIZE)
 		{
-			return 1;
+			size = MAX_BLOCK_SIZE;
 		}
-
-		if(trie->value == *str)
+		if(size < len + 1U)
 		{
-			if(*str == '\0')
-			{
-				/* Found full match. */
-				if(!trie->exists)
-				{
-					return 1;
-				}
-				*data = trie->data;
-				return 0;
-			}
+			size = len + 1U;
+		}
 
-			trie = trie->children;
-			++str;
-			continue;
+		block = malloc(sizeof(*block) + size);
+		if(block == NULL)
+		{
+			return NULL;
 		}
 
-		trie = (*str < trie->value) ? trie->left : trie->right;
+		block->prev = trie->blocks;
+		block->size = size;
+		block->used = 0U;
+		trie->blocks = block;
+	}
+
+	key = &block->data[block->used];
+	memcpy(key, str, len + 1U);
+	block->used += len + 1U;
+	return key;
+}
+
+/* Computes FNV-1a hash of the key and its length.  Returns the hash. */
+static size_t
+hash_key(const char str[], size_t *len)
+{
+	const unsigned char *s = (const unsigned char *)str;
+	unsigned long long hash = 14695981039346656037ULL;
+	while(*s != '\0')
+	{
+		hash = (hash ^ *s++)*1099511628211ULL;
 	}
+	*len = (const char *)s - str;
+	/* Fold upper bits, which are better mixed, into lower ones used as index. */
+	return (size_t)(hash ^ (hash >> 32));
 }
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
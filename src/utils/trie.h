@@ -21,7 +21,8 @@
 
 #include <stddef.h> /* NULL */
 
-/* Declaration of opaque trie type. */
+/* Declaration of opaque trie type.  It's a mapping of strings to pointers,
+ * which is implemented as a hash table despite the name. */
 typedef struct trie_t trie_t;
 
 /* Type of function to free data in the trie via trie_free_with_data() . */
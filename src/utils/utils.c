@@ -37,6 +37,8 @@
 #include <stdio.h> /* snprintf() */
 #include <stdlib.h> /* free() malloc() qsort() */
 #include <string.h> /* memcpy() strdup() strchr() strlen() strpbrk() strtol() */
+#include <time.h> /* CLOCK_MONOTONIC CLOCK_REALTIME clock_gettime()
+                      timespec */
 #include <wchar.h> /* wcwidth() */
 
 #include "../cfg/config.h"
@@ -729,5 +731,26 @@ safe_qsort(void *base, size_t nmemb, size_t size,
 	}
 }
 
+void
+get_deadline(int timeout_ms, struct timespec *deadline)
+{
+	clock_gettime(CLOCK_REALTIME, deadline);
+	deadline->tv_sec += timeout_ms/1000;
+	deadline->tv_nsec += (long)(timeout_ms%1000)*1000000L;
+	if(deadline->tv_nsec >= 1000000000L)
+	{
+		++deadline->tv_sec;
+		deadline->tv_nsec -= 1000000000L;
+	}
+}
+
+long long
+get_time_ms(void)
+{
+	struct timespec ts;
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec*1000LL + ts.tv_nsec/1000000;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
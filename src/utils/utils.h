@@ -21,11 +21,12 @@
 #define VIFM__UTILS__UTILS_H__
 
 #include <sys/stat.h> /* stat */
-#include <sys/types.h> /* gid_t mode_t uid_t */
+#include <sys/types.h> /* gid_t mode_t pid_t uid_t */
 
 #include <stddef.h> /* size_t wchar_t */
 #include <stdint.h> /* uint64_t */
 #include <stdio.h> /* FILE */
+#include <time.h> /* timespec */
 
 #include "../status.h"
 
@@ -161,6 +162,14 @@ int def_count(int count);
 void safe_qsort(void *base, size_t nmemb, size_t size,
 		int (*compar)(const void *, const void *));
 
+/* Computes absolute time point (of CLOCK_REALTIME) that is timeout_ms
+ * milliseconds from now for use with pthread_cond_timedwait(). */
+void get_deadline(int timeout_ms, struct timespec *deadline);
+
+/* Retrieves current value of a monotonic clock.  Returns the value in
+ * milliseconds. */
+long long get_time_ms(void);
+
 /* Checks line for path in it.  Ignores empty lines and attempts to parse it as
  * location line (path followed by a colon and optional line and column
  * numbers).  Returns canonicalized path as a newly allocated string or NULL. */
@@ -255,6 +264,16 @@ int reopen_term_stdin(void);
  * NULL on error, otherwise stream valid for reading is returned. */
 FILE * read_cmd_output(const char cmd[], int preserve_stdin);
 
+/* Same as read_cmd_output(), but runs the command in a process group of its
+ * own, which lets terminating it along with its children.  Sets *pgid to id of
+ * the group or to (pid_t)-1 if there is none.  Returns NULL on error, otherwise
+ * stream valid for reading is returned. */
+FILE * read_cmd_output_group(const char cmd[], int preserve_stdin,
+		pid_t *pgid);
+
+/* Terminates all processes of the group.  Does nothing for (pid_t)-1. */
+void kill_process_group(pid_t pgid);
+
 /* Gets path to directory where files bundled with Vifm are stored.  Returns
  * pointer to a statically allocated buffer. */
 const char * get_installed_data_dir(void);
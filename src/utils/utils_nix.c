@@ -35,22 +35,24 @@
 #include <sys/statvfs.h> /* statvfs statvfs() */
 #include <sys/time.h> /* timeval futimens() utimes() */
 #include <sys/wait.h> /* waitpid */
-#include <fcntl.h> /* open() close() */
+#include <fcntl.h> /* O_CLOEXEC O_RDONLY open() close() */
 #include <grp.h> /* getgrnam() getgrgid_r() */
-#include <pthread.h> /* pthread_sigmask() */
+#include <poll.h> /* POLLERR POLLPRI poll() pollfd */
+#include <pthread.h> /* PTHREAD_MUTEX_INITIALIZER pthread_mutex_lock()
+                       pthread_mutex_unlock() pthread_sigmask() */
 #include <pwd.h> /* getpwnam() getpwuid_r() */
 #include <unistd.h> /* X_OK chown() dup() dup2() getpid() isatty() pause()
-                       sysconf() ttyname() */
+                       setpgid() sysconf() ttyname() */
 
-#include <assert.h> /* assert() */
 #include <ctype.h> /* isdigit() */
 #include <errno.h> /* EINTR ENOTSUP errno */
 #include <signal.h> /* SIG* SIG_* sigset_t kill() sigaddset() sigemptyset()
                        sigfillset() signal() sigprocmask() */
 #include <stddef.h> /* NULL size_t */
 #include <stdio.h> /* FILE stderr fclose() fdopen() fprintf() snprintf() */
-#include <stdlib.h> /* atoi() free() */
-#include <string.h> /* strchr() strdup() strerror() strlen() strncmp() */
+#include <stdlib.h> /* atoi() free() malloc() */
+#include <string.h> /* memset() strchr() strcmp() strdup() strerror() strlen()
+                      strncmp() strrchr() */
 
 #include "../cfg/config.h"
 #include "../compat/fs_limits.h"
@@ -70,28 +72,25 @@
 #include "macros.h"
 #include "path.h"
 #include "str.h"
+#include "trie.h"
 #include "utils.h"
 
-/* Types of mount point information for get_mount_point_traverser_state. */
-typedef enum
-{
-	MI_MOUNT_POINT, /* Path to the mount point. */
-	MI_FS_TYPE,     /* File system name. */
-}
-mntinfo;
-
-/* State for get_mount_point() traverser. */
+/* Cached table of mounts. */
 typedef struct
 {
-	mntinfo type;     /* Type of information to put into the buffer. */
-	const char *path; /* Path whose mount point we're looking for. */
-	size_t buf_len;   /* Output buffer length. */
-	char *buf;        /* Output buffer. */
-	size_t curr_len;  /* Max length among all found points (len of buf string). */
+	struct mntent *entries; /* Mount entries in the order of the table. */
+	unsigned int nentries;  /* Number of entries. */
+	trie_t *index;          /* Mount point -> its entry. */
+	signed char *verdicts;  /* Whether entry is slow (1), fast (0) or unknown. */
+	char *verdicts_specs;   /* Value of slowfs specs verdicts are made for. */
 }
-get_mount_point_traverser_state;
+mount_table_t;
 
-static int get_mount_info_traverser(struct mntent *entry, void *arg);
+static mount_table_t * lock_mount_table(void);
+static void unlock_mount_table(void);
+static int mount_table_changed(void);
+static void rebuild_mount_table(mount_table_t *table);
+static struct mntent * find_mount(mount_table_t *table, const char path[]);
 static void free_mnt_entries(struct mntent *entries, unsigned int nentries);
 static struct mntent * read_mnt_entries(unsigned int *nentries);
 static int clone_mnt_entry(struct mntent *lhs, const struct mntent *rhs);
@@ -99,10 +98,15 @@ static void free_mnt_entry(struct mntent *entry);
 static int starts_with_list_item(const char str[], const char list[]);
 static int find_path_prefix_index(const char path[], const char list[]);
 static int open_tty(void);
+static FILE * run_for_output(const char cmd[], int preserve_stdin,
+		int new_group, pid_t *pgid);
 static void clone_timestamps(const char path[], const char from[],
 		const struct stat *st);
 static void clone_xattrs(const char path[], const char from[]);
 
+/* Protects table of mounts, which is queried by background threads as well. */
+static pthread_mutex_t mount_table_lock = PTHREAD_MUTEX_INITIALIZER;
+
 void
 pause_shell(void)
 {
@@ -203,6 +207,9 @@ block_all_thread_signals(void)
 {
 	sigset_t set;
 	sigfillset(&set);
+	/* Blocked SIGBUS caused by reading a mapped file can't be handled and kills
+	 * the process. */
+	sigdelset(&set, SIGBUS);
 	pthread_sigmask(SIG_SETMASK, &set, NULL);
 }
 
@@ -457,15 +464,6 @@ refers_to_slower_fs(const char from[], const char to[])
 int
 is_on_slow_fs(const char full_path[], const char slowfs_specs[])
 {
-	char fs_name[PATH_MAX + 1];
-	get_mount_point_traverser_state state = {
-		.type = MI_FS_TYPE,
-		.path = full_path,
-		.buf_len = sizeof(fs_name),
-		.buf = fs_name,
-		.curr_len = 0UL,
-	};
-
 	/* Empty list optimization. */
 	if(slowfs_specs[0] == '\0')
 	{
@@ -480,96 +478,222 @@ is_on_slow_fs(const char full_path[], const char slowfs_specs[])
 		return 1;
 	}
 
-	if(traverse_mount_points(&get_mount_info_traverser, &state) == 0)
+	int slow = 0;
+	mount_table_t *const table = lock_mount_table();
+	struct mntent *const entry = find_mount(table, full_path);
+	if(entry != NULL)
 	{
-		if(state.curr_len > 0)
+		/* Matching file system type against the list is what's slow given how
+		 * often this function is called, so results are cached per mount. */
+		if(table->verdicts_specs == NULL ||
+				strcmp(table->verdicts_specs, slowfs_specs) != 0)
 		{
-			if(starts_with_list_item(fs_name, slowfs_specs))
-			{
-				return 1;
-			}
+			(void)replace_string(&table->verdicts_specs, slowfs_specs);
+			memset(table->verdicts, -1, table->nentries);
 		}
+
+		signed char *const verdict = &table->verdicts[entry - table->entries];
+		if(*verdict < 0)
+		{
+			*verdict = starts_with_list_item(entry->mnt_type, slowfs_specs);
+		}
+		slow = *verdict;
 	}
+	unlock_mount_table();
 
-	return find_path_prefix_index(full_path, slowfs_specs) != -1;
+	return slow || find_path_prefix_index(full_path, slowfs_specs) != -1;
 }
 
 int
 get_mount_point(const char path[], size_t buf_len, char buf[])
 {
-	get_mount_point_traverser_state state = {
-		.type = MI_MOUNT_POINT,
-		.path = path,
-		.buf_len = buf_len,
-		.buf = buf,
-		.curr_len = 0UL,
-	};
-	return traverse_mount_points(&get_mount_info_traverser, &state);
+	int result = 1;
+
+	mount_table_t *const table = lock_mount_table();
+	struct mntent *const entry = find_mount(table, path);
+	if(entry != NULL)
+	{
+		copy_str(buf, buf_len, entry->mnt_dir);
+		result = 0;
+	}
+	unlock_mount_table();
+
+	return result;
 }
 
-/* traverse_mount_points client that gets mount point info for a given path. */
-static int
-get_mount_info_traverser(struct mntent *entry, void *arg)
+int
+traverse_mount_points(mptraverser client, void *arg)
 {
-	get_mount_point_traverser_state *const state = arg;
-	if(path_starts_with(state->path, entry->mnt_dir))
+	unsigned int i;
+	unsigned int nentries = 0U;
+
+	/* Clients can be slow, so they are run on a copy of the table to not block
+	 * other threads. */
+	mount_table_t *const table = lock_mount_table();
+	struct mntent *const entries = reallocarray(NULL, table->nentries,
+			sizeof(*entries));
+	if(entries != NULL)
 	{
-		const size_t new_len = strlen(entry->mnt_dir);
-		if(new_len > state->curr_len)
+		for(i = 0U; i < table->nentries; ++i)
 		{
-			state->curr_len = new_len;
-			switch(state->type)
+			if(clone_mnt_entry(&entries[nentries], &table->entries[i]) == 0)
 			{
-				case MI_MOUNT_POINT:
-					copy_str(state->buf, state->buf_len, entry->mnt_dir);
-					break;
-				case MI_FS_TYPE:
-					copy_str(state->buf, state->buf_len, entry->mnt_type);
-					break;
-
-				default:
-					assert(0 && "Unknown mount information type.");
-					break;
+				++nentries;
 			}
 		}
 	}
+	unlock_mount_table();
+
+	if(nentries == 0U)
+	{
+		free(entries);
+		return 1;
+	}
+
+	for(i = 0U; i < nentries; ++i)
+	{
+		if(client(&entries[i], arg))
+		{
+			break;
+		}
+	}
+
+	free_mnt_entries(entries, nentries);
 	return 0;
 }
 
-int
-traverse_mount_points(mptraverser client, void *arg)
+/* Locks table of mounts updating it if it has changed since the last call.
+ * The table must be released with unlock_mount_table().  Returns pointer to
+ * the table. */
+static mount_table_t *
+lock_mount_table(void)
+{
+	static mount_table_t table;
+	static int initialized;
+
+	pthread_mutex_lock(&mount_table_lock);
+
+	if(mount_table_changed() || !initialized)
+	{
+		rebuild_mount_table(&table);
+		initialized = 1;
+	}
+
+	return &table;
+}
+
+/* Releases table of mounts locked by lock_mount_table(). */
+static void
+unlock_mount_table(void)
 {
-	/* Cached mount entries, updated only when /etc/mtab changes. */
+	pthread_mutex_unlock(&mount_table_lock);
+}
+
+/* Checks whether mounts have changed since the last call.  Returns non-zero if
+ * so or if it's unknown, otherwise zero is returned. */
+static int
+mount_table_changed(void)
+{
+	static int mountinfo_fd = -2;
 	static filemon_t mtab_mon;
-	static struct mntent *entries;
-	static unsigned int nentries;
 
-	filemon_t mon;
-	unsigned int i;
+	if(mountinfo_fd == -2)
+	{
+		int flags = O_RDONLY;
+#ifdef O_CLOEXEC
+		flags |= O_CLOEXEC;
+#endif
+		mountinfo_fd = open("/proc/self/mountinfo", flags);
+	}
 
-	/* Check for cache validity. */
+	if(mountinfo_fd >= 0)
+	{
+		/* Linux reports changes in mount namespace as exceptional condition on
+		 * this file, poll() also resets the condition. */
+		struct pollfd pfd = { .fd = mountinfo_fd, .events = POLLPRI };
+		return (poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLERR | POLLPRI)));
+	}
+
+	filemon_t mon;
 	if(filemon_from_file("/etc/mtab", FMT_MODIFIED, &mon) != 0 ||
 			!filemon_equal(&mon, &mtab_mon))
 	{
 		filemon_assign(&mtab_mon, &mon);
-		free_mnt_entries(entries, nentries);
-		entries = read_mnt_entries(&nentries);
+		return 1;
 	}
+	return 0;
+}
 
-	if(nentries == 0U)
+/* Rereads mount entries and indexes them by mount points. */
+static void
+rebuild_mount_table(mount_table_t *table)
+{
+	unsigned int i;
+
+	free_mnt_entries(table->entries, table->nentries);
+	trie_free(table->index);
+	free(table->verdicts);
+	free(table->verdicts_specs);
+
+	table->entries = read_mnt_entries(&table->nentries);
+	table->index = trie_create();
+	table->verdicts = malloc(table->nentries);
+	table->verdicts_specs = NULL;
+
+	if(table->index == NULL || (table->verdicts == NULL && table->nentries != 0U))
 	{
-		return 1;
+		free_mnt_entries(table->entries, table->nentries);
+		trie_free(table->index);
+		free(table->verdicts);
+		*table = (mount_table_t){ .entries = NULL };
+		return;
 	}
 
-	for(i = 0; i < nentries; ++i)
+	for(i = 0U; i < table->nentries; ++i)
 	{
-		if(client(&entries[i], arg))
+		char mount_point[PATH_MAX + 1];
+		void *data;
+
+		copy_str(mount_point, sizeof(mount_point), table->entries[i].mnt_dir);
+		if(strlen(mount_point) > 1U)
 		{
-			break;
+			chosp(mount_point);
+		}
+
+		/* The first of several entries for the same mount point wins. */
+		if(trie_get(table->index, mount_point, &data) != 0)
+		{
+			(void)trie_set(table->index, mount_point, &table->entries[i]);
 		}
 	}
+}
 
-	return 0;
+/* Finds entry of a mount that contains the path by looking up its prefixes from
+ * the longest to the shortest one.  Returns the entry or NULL. */
+static struct mntent *
+find_mount(mount_table_t *table, const char path[])
+{
+	char prefix[PATH_MAX + 1];
+	void *data;
+
+	copy_str(prefix, sizeof(prefix), path);
+	if(strlen(prefix) > 1U)
+	{
+		chosp(prefix);
+	}
+
+	while(trie_get(table->index, prefix, &data) != 0)
+	{
+		char *const slash = strrchr(prefix, '/');
+		if(slash == NULL || (slash == prefix && prefix[1] == '\0'))
+		{
+			return NULL;
+		}
+
+		slash[slash == prefix] = '\0';
+	}
+
+	return data;
 }
 
 /* Frees array of mount entries. */
@@ -1011,11 +1135,41 @@ open_tty(void)
 
 FILE *
 read_cmd_output(const char cmd[], int preserve_stdin)
+{
+	return run_for_output(cmd, preserve_stdin, 0, NULL);
+}
+
+FILE *
+read_cmd_output_group(const char cmd[], int preserve_stdin, pid_t *pgid)
+{
+	return run_for_output(cmd, preserve_stdin, 1, pgid);
+}
+
+void
+kill_process_group(pid_t pgid)
+{
+	if(pgid > 0)
+	{
+		(void)kill(-pgid, SIGTERM);
+	}
+}
+
+/* Executes the command via shell, possibly in a new process group whose id is
+ * then stored in *pgid.  Returns NULL on error, otherwise stream valid for
+ * reading is returned. */
+static FILE *
+run_for_output(const char cmd[], int preserve_stdin, int new_group,
+		pid_t *pgid)
 {
 	FILE *fp;
 	pid_t pid;
 	int out_pipe[2];
 
+	if(new_group)
+	{
+		*pgid = (pid_t)-1;
+	}
+
 	if(pipe(out_pipe) != 0)
 	{
 		return NULL;
@@ -1024,15 +1178,28 @@ read_cmd_output(const char cmd[], int preserve_stdin)
 	pid = fork();
 	if(pid == (pid_t)-1)
 	{
+		close(out_pipe[0]);
+		close(out_pipe[1]);
 		return NULL;
 	}
 
 	if(pid == 0)
 	{
+		if(new_group)
+		{
+			setpgid(0, 0);
+		}
 		run_from_fork(out_pipe, 0, preserve_stdin, (char *)cmd, SHELL_BY_USER);
 		return NULL;
 	}
 
+	if(new_group)
+	{
+		/* Done by both processes to have the group before either continues. */
+		(void)setpgid(pid, pid);
+		*pgid = pid;
+	}
+
 	/* Close write end of pipe. */
 	close(out_pipe[1]);
 
@@ -1040,6 +1207,11 @@ read_cmd_output(const char cmd[], int preserve_stdin)
 	if(fp == NULL)
 	{
 		close(out_pipe[0]);
+		if(new_group)
+		{
+			kill_process_group(*pgid);
+			*pgid = (pid_t)-1;
+		}
 	}
 	return fp;
 }
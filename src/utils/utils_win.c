@@ -707,6 +707,20 @@ read_cmd_output(const char cmd[], int preserve_stdin)
 	return result;
 }
 
+FILE *
+read_cmd_output_group(const char cmd[], int preserve_stdin, pid_t *pgid)
+{
+	/* There are no process groups to terminate. */
+	*pgid = (pid_t)-1;
+	return read_cmd_output(cmd, preserve_stdin);
+}
+
+void
+kill_process_group(pid_t pgid)
+{
+	/* Nothing to do. */
+}
+
 /* Performs redirection and execution of the command.  Returns file descriptor
  * bound to stdout of the command. */
 static FILE *
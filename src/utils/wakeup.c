@@ -0,0 +1,140 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "wakeup.h"
+
+#ifndef _WIN32
+
+#include <fcntl.h> /* FD_CLOEXEC F_GETFD F_GETFL F_SETFD F_SETFL O_NONBLOCK
+                      fcntl() */
+#include <sys/types.h> /* ssize_t */
+#include <unistd.h> /* close() pipe() read() write() */
+
+#include <errno.h> /* EINTR errno */
+#include <signal.h> /* sig_atomic_t */
+
+#include "../compat/pthread.h"
+#include "log.h"
+
+static void init(void);
+static int setup_fd(int fd);
+
+/* Read end of the pipe or -1. */
+static int read_fd = -1;
+/* Write end of the pipe or -1.  Read from signal handlers. */
+static volatile sig_atomic_t write_fd = -1;
+
+int
+wakeup_get_fd(void)
+{
+	static pthread_once_t once = PTHREAD_ONCE_INIT;
+	(void)pthread_once(&once, &init);
+	return read_fd;
+}
+
+/* Creates the pipe. */
+static void
+init(void)
+{
+	int fds[2];
+
+	if(pipe(fds) != 0)
+	{
+		LOG_SERROR_MSG(errno, "Failed to create wake up pipe");
+		return;
+	}
+
+	if(setup_fd(fds[0]) != 0 || setup_fd(fds[1]) != 0)
+	{
+		LOG_SERROR_MSG(errno, "Failed to configure wake up pipe");
+		close(fds[0]);
+		close(fds[1]);
+		return;
+	}
+
+	read_fd = fds[0];
+	write_fd = fds[1];
+}
+
+/* Makes descriptor non-blocking and not inheritable by child processes.
+ * Returns zero on success, otherwise non-zero is returned. */
+static int
+setup_fd(int fd)
+{
+	const int fl = fcntl(fd, F_GETFL);
+	const int fd_fl = fcntl(fd, F_GETFD);
+	return fl == -1 || fd_fl == -1
+	    || fcntl(fd, F_SETFL, fl | O_NONBLOCK) == -1
+	    || fcntl(fd, F_SETFD, fd_fl | FD_CLOEXEC) == -1;
+}
+
+void
+wakeup_notify(void)
+{
+	const int fd = write_fd;
+	if(fd != -1)
+	{
+		/* Preserve errno for signal handlers.  A full pipe is fine, there is
+		 * already something to read. */
+		const int saved_errno = errno;
+		const char c = '\0';
+		(void)write(fd, &c, 1);
+		errno = saved_errno;
+	}
+}
+
+void
+wakeup_drain(void)
+{
+	char buf[64];
+	ssize_t nread;
+
+	if(read_fd == -1)
+	{
+		return;
+	}
+
+	do
+	{
+		nread = read(read_fd, buf, sizeof(buf));
+	}
+	while(nread > 0 || (nread == -1 && errno == EINTR));
+}
+
+#else
+
+int
+wakeup_get_fd(void)
+{
+	return -1;
+}
+
+void
+wakeup_notify(void)
+{
+}
+
+void
+wakeup_drain(void)
+{
+}
+
+#endif
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,40 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__WAKEUP_H__
+#define VIFM__UTILS__WAKEUP_H__
+
+/* Process-wide mechanism for interrupting a thread that sleeps waiting for file
+ * descriptors to become readable (a "self-pipe"). */
+
+/* Retrieves descriptor which becomes readable after wakeup_notify() call.
+ * Initializes the unit on the first call.  Returns the descriptor or -1 if it's
+ * not available. */
+int wakeup_get_fd(void);
+
+/* Makes descriptor of the unit readable.  Does nothing until the unit is
+ * initialized.  Can be called from other threads and signal handlers. */
+void wakeup_notify(void);
+
+/* Consumes all pending notifications. */
+void wakeup_drain(void);
+
+#endif /* VIFM__UTILS__WAKEUP_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -78,6 +78,7 @@
 #include "builtin_functions.h"
 #include "cmd_completion.h"
 #include "cmd_core.h"
+#include "compare.h"
 #include "dir_stack.h"
 #include "event_loop.h"
 #include "filelist.h"
@@ -637,8 +638,11 @@ vifm_try_leave(int write_info, int cquit, int force)
 	if(write_info)
 	{
 		write_info_file();
+		dcache_save();
 	}
 
+	compare_save_cache();
+
 	if(stats_file_choose_action_set())
 	{
 		vim_write_empty_file_list();
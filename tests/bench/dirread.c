@@ -0,0 +1,157 @@
+#include <stic.h>
+
+#include <sys/stat.h> /* stat */
+#include <unistd.h> /* rmdir() */
+
+#include <stdio.h> /* FILE fclose() fopen() snprintf() */
+
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/os.h"
+#include "../../src/utils/dirreader.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/parallel.h"
+
+#include "utils.h"
+
+/* Number of files in the directory. */
+#define NFILES 20000
+
+/* Number of files whose metadata is queried at once. */
+#define BATCH_SIZE 64
+
+/* Number of threads of parallel reading. */
+#define NTHREADS 8
+
+/* Batch of files to query. */
+typedef struct
+{
+	int first;          /* Number of the first file. */
+	struct stat *stats; /* Output aligned with files. */
+}
+batch_t;
+
+static void make_dir(void);
+static int read_dir(int nthreads);
+static void stat_file(int index, void *arg);
+
+static struct stat stats[NFILES];
+
+SETUP_ONCE()
+{
+	make_dir();
+}
+
+TEARDOWN_ONCE()
+{
+	remove_dir_content(SANDBOX_PATH "/dir");
+	assert_success(rmdir(SANDBOX_PATH "/dir"));
+}
+
+TEST(directory_reading)
+{
+	const double old_start = bench_now();
+	assert_int_equal(NFILES, read_dir(1));
+	const double old_time = bench_now() - old_start;
+
+	const double new_start = bench_now();
+	assert_int_equal(NFILES, read_dir(NTHREADS));
+	const double new_time = bench_now() - new_start;
+
+	bench_report("dirread: single thread", old_time);
+	bench_report("dirread: several threads", new_time);
+	bench_report_speedup("dirread: speedup", old_time, new_time);
+}
+
+TEST(querying_batches)
+{
+	int i;
+	batch_t batch = { .stats = stats };
+
+	const double serial_start = bench_now();
+	for(i = 0; i < NFILES; i += BATCH_SIZE)
+	{
+		int j;
+		batch.first = i;
+		for(j = 0; j < BATCH_SIZE; ++j)
+		{
+			stat_file(j, &batch);
+		}
+	}
+	const double serial_time = bench_now() - serial_start;
+
+	const double old_start = bench_now();
+	for(i = 0; i < NFILES; i += BATCH_SIZE)
+	{
+		batch.first = i;
+		parallel_for(BATCH_SIZE, NTHREADS, &stat_file, &batch);
+	}
+	const double old_time = bench_now() - old_start;
+
+	const double new_start = bench_now();
+	parallel_pool_t pool;
+	parallel_pool_start(&pool, NTHREADS);
+	for(i = 0; i < NFILES; i += BATCH_SIZE)
+	{
+		batch.first = i;
+		parallel_pool_for(&pool, BATCH_SIZE, &stat_file, &batch);
+	}
+	parallel_pool_stop(&pool);
+	const double new_time = bench_now() - new_start;
+
+	bench_report("batches: serial", serial_time);
+	bench_report("batches: threads per batch", old_time);
+	bench_report("batches: pool of threads", new_time);
+	bench_report_speedup("batches: pool vs. serial", serial_time, new_time);
+	bench_report_speedup("batches: pool vs. threads per batch", old_time,
+			new_time);
+}
+
+/* Creates directory with many empty files in the sandbox. */
+static void
+make_dir(void)
+{
+	int i;
+	char path[PATH_MAX + 1];
+
+	assert_success(os_mkdir(SANDBOX_PATH "/dir", 0700));
+	for(i = 0; i < NFILES; ++i)
+	{
+		snprintf(path, sizeof(path), "%s/dir/file-number-%d", SANDBOX_PATH, i);
+		FILE *const f = fopen(path, "w");
+		assert_non_null(f);
+		fclose(f);
+	}
+}
+
+/* Reads the directory querying metadata of its files with specified number of
+ * threads.  Returns number of read entries. */
+static int
+read_dir(int nthreads)
+{
+	int count;
+	dirreader_t *const reader = dirreader_start(SANDBOX_PATH "/dir", nthreads);
+	assert_non_null(reader);
+
+	(void)dirreader_wait(reader, -1);
+	assert_true(dirreader_sync(reader));
+	(void)dirreader_get(reader, &count);
+
+	dirreader_free(reader);
+	return count;
+}
+
+/* Queries metadata of a single file of a batch (past the end of the files is
+ * fine). */
+static void
+stat_file(int index, void *arg)
+{
+	batch_t *const batch = arg;
+	const int n = batch->first + index;
+	char path[PATH_MAX + 1];
+
+	snprintf(path, sizeof(path), "%s/dir/file-number-%d", SANDBOX_PATH, n);
+	(void)os_lstat(path, &batch->stats[n % NFILES]);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
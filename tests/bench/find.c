@@ -0,0 +1,125 @@
+#include <stic.h>
+
+#include <unistd.h> /* rmdir() */
+
+#include <stdio.h> /* FILE fclose() fopen() snprintf() */
+#include <stdlib.h> /* free() */
+
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/os.h"
+#include "../../src/utils/finder.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/matchers.h"
+#include "../../src/utils/string_array.h"
+
+#include "utils.h"
+
+/* Shape of the tree to search in. */
+enum { NDIRS = 50, NSUBDIRS = 4, NFILES = 100 };
+
+/* Number of threads of parallel search. */
+#define NTHREADS 8
+
+static void make_tree(void);
+static int find(const finder_criteria_t *criteria, int nthreads);
+
+SETUP_ONCE()
+{
+	make_tree();
+}
+
+TEARDOWN_ONCE()
+{
+	remove_dir_content(SANDBOX_PATH "/findtree");
+	assert_success(rmdir(SANDBOX_PATH "/findtree"));
+}
+
+TEST(parallel_search)
+{
+	char *error;
+	matchers_t *const ms = matchers_alloc("*-7", 1, 1, "", &error);
+	assert_non_null(ms);
+
+	const finder_criteria_t criteria = {
+		.matchers = ms,
+		.kind = FK_FILE,
+		.min_size = -1, .max_size = -1,
+		.min_mtime = -1, .max_mtime = -1,
+	};
+
+	const double old_start = bench_now();
+	assert_int_equal(NDIRS*NSUBDIRS, find(&criteria, 1));
+	const double old_time = bench_now() - old_start;
+
+	const double new_start = bench_now();
+	assert_int_equal(NDIRS*NSUBDIRS, find(&criteria, NTHREADS));
+	const double new_time = bench_now() - new_start;
+
+	bench_report("find: single thread", old_time);
+	bench_report("find: several threads", new_time);
+	bench_report_speedup("find: speedup", old_time, new_time);
+
+	matchers_free(ms);
+}
+
+/* Creates tree of directories and empty files in the sandbox. */
+static void
+make_tree(void)
+{
+	int i, j, k;
+	char path[PATH_MAX + 1];
+
+	assert_success(os_mkdir(SANDBOX_PATH "/findtree", 0700));
+	for(i = 0; i < NDIRS; ++i)
+	{
+		snprintf(path, sizeof(path), "%s/findtree/dir%d", SANDBOX_PATH, i);
+		assert_success(os_mkdir(path, 0700));
+
+		for(j = 0; j < NSUBDIRS; ++j)
+		{
+			snprintf(path, sizeof(path), "%s/findtree/dir%d/sub%d", SANDBOX_PATH, i,
+					j);
+			assert_success(os_mkdir(path, 0700));
+
+			for(k = 0; k < NFILES; ++k)
+			{
+				snprintf(path, sizeof(path), "%s/findtree/dir%d/sub%d/file-%d",
+						SANDBOX_PATH, i, j, k);
+				FILE *const f = fopen(path, "w");
+				assert_non_null(f);
+				fclose(f);
+			}
+		}
+	}
+}
+
+/* Searches the tree.  Returns number of found files. */
+static int
+find(const finder_criteria_t *criteria, int nthreads)
+{
+	char *roots[] = { SANDBOX_PATH "/findtree" };
+	finder_t *const finder = finder_start(roots, 1, criteria, nthreads);
+	assert_non_null(finder);
+
+	int total = 0;
+	while(1)
+	{
+		char **paths;
+		const int done = finder_is_done(finder);
+		const int npaths = finder_take(finder, &paths);
+		total += npaths;
+		free_string_array(paths, npaths);
+
+		if(done)
+		{
+			break;
+		}
+		(void)finder_wait(finder, -1);
+	}
+
+	finder_free(finder);
+	return total;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,122 @@
+#include <stic.h>
+
+#include <unistd.h> /* rmdir() */
+
+#include <stdio.h> /* FILE fclose() fopen() fprintf() snprintf() */
+#include <stdlib.h> /* free() */
+
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/os.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/grepper.h"
+#include "../../src/utils/string_array.h"
+
+#include "utils.h"
+
+/* Shape of the tree to search in. */
+enum { NFILES = 200, NLINES = 5000 };
+
+/* Number of threads of parallel search. */
+#define NTHREADS 8
+
+static void make_tree(void);
+static int grep(const char pattern[], int nthreads);
+
+SETUP_ONCE()
+{
+	make_tree();
+}
+
+TEARDOWN_ONCE()
+{
+	remove_dir_content(SANDBOX_PATH "/greptree");
+	assert_success(rmdir(SANDBOX_PATH "/greptree"));
+}
+
+TEST(literal_prefilter)
+{
+	/* Group hides the literal from the prefilter without changing matches. */
+	const double old_start = bench_now();
+	assert_int_equal(NFILES, grep("(needle)", 1));
+	const double old_time = bench_now() - old_start;
+
+	const double new_start = bench_now();
+	assert_int_equal(NFILES, grep("needle", 1));
+	const double new_time = bench_now() - new_start;
+
+	bench_report("grep: regexec() per line", old_time);
+	bench_report("grep: memchr() prefilter", new_time);
+	bench_report_speedup("grep: prefilter speedup", old_time, new_time);
+}
+
+TEST(parallel_search)
+{
+	const double old_start = bench_now();
+	assert_int_equal(NFILES, grep("need+le", 1));
+	const double old_time = bench_now() - old_start;
+
+	const double new_start = bench_now();
+	assert_int_equal(NFILES, grep("need+le", NTHREADS));
+	const double new_time = bench_now() - new_start;
+
+	bench_report("grep: single thread", old_time);
+	bench_report("grep: several threads", new_time);
+	bench_report_speedup("grep: threads speedup", old_time, new_time);
+}
+
+/* Creates files with a single matching line each in the sandbox. */
+static void
+make_tree(void)
+{
+	int i, j;
+	char path[PATH_MAX + 1];
+
+	assert_success(os_mkdir(SANDBOX_PATH "/greptree", 0700));
+	for(i = 0; i < NFILES; ++i)
+	{
+		snprintf(path, sizeof(path), "%s/greptree/file-%d.c", SANDBOX_PATH, i);
+		FILE *const f = fopen(path, "w");
+		assert_non_null(f);
+		for(j = 0; j < NLINES; ++j)
+		{
+			fprintf(f, "static int value_%d = %d; /* %s */\n", j, j,
+					(j == NLINES/2) ? "needle" : "hay");
+		}
+		fclose(f);
+	}
+}
+
+/* Searches the tree.  Returns number of found lines. */
+static int
+grep(const char pattern[], int nthreads)
+{
+	char *roots[] = { SANDBOX_PATH "/greptree" };
+	const grepper_criteria_t criteria = { .pattern = pattern };
+	char *error = NULL;
+
+	grepper_t *const grepper = grepper_start(roots, 1, &criteria, nthreads,
+			&error);
+	assert_non_null(grepper);
+
+	int total = 0;
+	while(1)
+	{
+		char **lines;
+		const int done = grepper_is_done(grepper);
+		const int nlines = grepper_take(grepper, &lines);
+		total += nlines;
+		free_string_array(lines, nlines);
+
+		if(done)
+		{
+			break;
+		}
+		(void)grepper_wait(grepper, -1);
+	}
+
+	grepper_free(grepper);
+	return total;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,80 @@
+#include <stic.h>
+
+#include <string.h> /* strlen() */
+
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/mntent.h"
+#include "../../src/utils/filemon.h"
+#include "../../src/utils/macros.h"
+#include "../../src/utils/path.h"
+#include "../../src/utils/str.h"
+#include "../../src/utils/utils.h"
+
+#include "utils.h"
+
+/* Number of lookups. */
+#define NLOOKUPS 100000
+
+/* State of linear_lookup(). */
+typedef struct
+{
+	const char *path; /* Path whose mount point we're looking for. */
+	char *buf;        /* Output buffer of PATH_MAX + 1 bytes. */
+	size_t len;       /* Length of the longest mount point found so far. */
+}
+lookup_state_t;
+
+static int linear_lookup(struct mntent *entry, void *arg);
+
+TEST(mount_point_lookup)
+{
+	static const char *const paths[] = {
+		"/", "/proc/self/fd", "/usr/share/doc/vifm", "/tmp/a/b/c/d/e",
+	};
+
+	char buf[PATH_MAX + 1];
+	int i;
+
+	/* Reference implementation checks /etc/mtab and scans all mounts. */
+	const double old_start = bench_now();
+	for(i = 0; i < NLOOKUPS; ++i)
+	{
+		filemon_t mon;
+		lookup_state_t state = { .path = paths[i%ARRAY_LEN(paths)], .buf = buf };
+		(void)filemon_from_file("/etc/mtab", FMT_MODIFIED, &mon);
+		(void)traverse_mount_points(&linear_lookup, &state);
+	}
+	const double old_time = bench_now() - old_start;
+
+	const double new_start = bench_now();
+	for(i = 0; i < NLOOKUPS; ++i)
+	{
+		(void)get_mount_point(paths[i%ARRAY_LEN(paths)], sizeof(buf), buf);
+	}
+	const double new_time = bench_now() - new_start;
+
+	bench_report("mounts: mtab check and linear scan", old_time);
+	bench_report("mounts: prefix index", new_time);
+	bench_report_speedup("mounts: speedup", old_time, new_time);
+}
+
+/* traverse_mount_points() client that looks for the longest mount point that
+ * contains the path.  Returns zero. */
+static int
+linear_lookup(struct mntent *entry, void *arg)
+{
+	lookup_state_t *const state = arg;
+	if(state->buf != NULL && path_starts_with(state->path, entry->mnt_dir))
+	{
+		const size_t len = strlen(entry->mnt_dir);
+		if(len > state->len)
+		{
+			state->len = len;
+			copy_str(state->buf, PATH_MAX + 1, entry->mnt_dir);
+		}
+	}
+	return 0;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
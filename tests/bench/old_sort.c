@@ -0,0 +1,453 @@
+/* Copy of flat list sorting as it was implemented before sorting in a single
+ * pass to have a faithful base for comparison. */
+
+#include "old_sort.h"
+
+#include <regex.h> /* regex_t regcomp() regexec() regfree() */
+
+#include <stdint.h> /* uint64_t */
+#include <stdlib.h> /* abs() free() */
+#include <string.h> /* strcmp() strdup() strrchr() */
+
+#include "../../src/cfg/config.h"
+#include "../../src/compat/fs_limits.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/macros.h"
+#include "../../src/utils/path.h"
+#include "../../src/utils/regexp.h"
+#include "../../src/utils/str.h"
+#include "../../src/utils/string_array.h"
+#include "../../src/utils/utils.h"
+#include "../../src/filelist.h"
+#include "../../src/sort.h"
+#include "../../src/types.h"
+
+static void sort_sequence(dir_entry_t *entries, size_t nentries);
+static void sort_by_groups(dir_entry_t *entries, size_t nentries);
+static void sort_by_key(dir_entry_t *entries, size_t nentries, char key,
+		void *data);
+static int sort_dir_list(const void *one, const void *two);
+static int compare_entry_names(const dir_entry_t *a, const dir_entry_t *b,
+		int ignore_case);
+static int compare_full_file_names(const char s[], const char t[],
+		int ignore_case);
+static int compare_file_names(const char s[], const char t[], int ignore_case);
+static int compare_file_sizes(const dir_entry_t *f, const dir_entry_t *s);
+static int compare_item_count(const dir_entry_t *f, int fdir,
+		const dir_entry_t *s, int sdir);
+static int compare_group(const char f[], const char s[], regex_t *regex);
+static int compare_targets(const dir_entry_t *f, const dir_entry_t *s);
+
+/* View which is being sorted. */
+static view_t* view;
+/* Picked sort array of the view. */
+static const char *view_sort;
+/* Picked sort groups setting of the view. */
+static const char *view_sort_groups;
+/* Whether the view displays custom file list. */
+static int custom_view;
+/* Whether it's descending sort. */
+static int sort_descending;
+/* Key used to sort entries in current sorting round. */
+static SortingKey sort_type;
+/* Sorting key specific data. */
+static void *sort_data;
+
+void
+old_sort_view(view_t *v)
+{
+	if(v->sort[0] > SK_LAST)
+	{
+		/* Completely skip sorting if primary key isn't set. */
+		return;
+	}
+
+	view = v;
+	view_sort = v->sort;
+	view_sort_groups = v->sort_groups;
+	custom_view = flist_custom_active(v);
+
+	sort_sequence(&v->dir_entry[0], v->list_rows);
+}
+
+/* Sorts sequence of file entries (plain list, not tree). */
+static void
+sort_sequence(dir_entry_t *entries, size_t nentries)
+{
+	int i = SK_COUNT;
+	while(--i >= 0)
+	{
+		const char sorting_key = view_sort[i];
+
+		if(abs(sorting_key) > SK_LAST)
+		{
+			continue;
+		}
+
+		if(sorting_key == SK_BY_GROUPS)
+		{
+			sort_by_groups(entries, nentries);
+			continue;
+		}
+
+		sort_by_key(entries, nentries, sorting_key, NULL);
+	}
+
+	if(!ui_view_sort_list_contains(view_sort, SK_BY_DIR))
+	{
+		sort_by_key(entries, nentries, SK_BY_DIR, NULL);
+	}
+}
+
+/* Sorts specified range of entries according to sorting groups option. */
+static void
+sort_by_groups(dir_entry_t *entries, size_t nentries)
+{
+	char **groups = NULL;
+	int ngroups = 0;
+	const int optimize = (view_sort_groups != view->sort_groups_g);
+	int i;
+
+	char *const copy = strdup(view_sort_groups);
+	char *group = copy, *state = NULL;
+	while((group = split_and_get(group, ',', &state)) != NULL)
+	{
+		ngroups = add_to_string_array(&groups, ngroups, 1, group);
+	}
+	free(copy);
+
+	for(i = ngroups - (optimize ? 1 : 0); i >= 1; --i)
+	{
+		regex_t regex;
+		(void)regcomp(&regex, groups[i], REG_EXTENDED | REG_ICASE);
+		sort_by_key(entries, nentries, SK_BY_GROUPS, &regex);
+		regfree(&regex);
+	}
+	if(optimize && ngroups != 0)
+	{
+		sort_by_key(entries, nentries, SK_BY_GROUPS, &view->primary_group);
+	}
+
+	free_string_array(groups, ngroups);
+}
+
+/* Sorts specified range of entries by the key in a stable way. */
+static void
+sort_by_key(dir_entry_t *entries, size_t nentries, char key, void *data)
+{
+	sort_descending = (key < 0);
+	sort_type = (SortingKey)abs(key);
+	sort_data = data;
+
+	unsigned int i;
+	for(i = 0U; i < nentries; ++i)
+	{
+		entries[i].tag = i;
+	}
+
+	safe_qsort(entries, nentries, sizeof(*entries), &sort_dir_list);
+}
+
+/* Compares two entries by the key of current sorting round.  Returns positive
+ * value if first is greater than second, zero if they are equal, otherwise
+ * negative value is returned. */
+static int
+sort_dir_list(const void *one, const void *two)
+{
+	int retval;
+	const dir_entry_t *const first = one;
+	const dir_entry_t *const second = two;
+
+	const int first_is_dir = fentry_is_dir(first);
+	const int second_is_dir = fentry_is_dir(second);
+
+	if(first_is_dir && is_parent_dir(first->name))
+	{
+		return -1;
+	}
+	if(second_is_dir && is_parent_dir(second->name))
+	{
+		return 1;
+	}
+
+	retval = 0;
+	switch(sort_type)
+	{
+		char *pfirst, *psecond;
+
+		case SK_BY_NAME:
+		case SK_BY_INAME:
+			if(custom_view)
+			{
+				retval = compare_entry_names(first, second, sort_type == SK_BY_INAME);
+			}
+			else
+			{
+				retval = compare_full_file_names(first->name, second->name,
+						sort_type == SK_BY_INAME);
+			}
+			break;
+
+		case SK_BY_DIR:
+			if(first_is_dir != second_is_dir)
+			{
+				retval = first_is_dir ? -1 : 1;
+			}
+			break;
+
+		case SK_BY_TYPE:
+			retval = strcmp(get_type_str(first->type), get_type_str(second->type));
+			break;
+
+		case SK_BY_FILEEXT:
+		case SK_BY_EXTENSION:
+			pfirst = strrchr(first->name,  '.');
+			psecond = strrchr(second->name, '.');
+
+			if(first_is_dir && second_is_dir && sort_type == SK_BY_FILEEXT)
+			{
+				retval = compare_file_names(first->name, second->name, 0);
+			}
+			else if(first_is_dir != second_is_dir && sort_type == SK_BY_FILEEXT)
+			{
+				retval = first_is_dir ? -1 : 1;
+			}
+			else if(pfirst && psecond)
+			{
+				if(pfirst == first->name && psecond != second->name)
+				{
+					retval = -1;
+				}
+				else if(pfirst != first->name && psecond == second->name)
+				{
+					retval = 1;
+				}
+				else
+				{
+					retval = compare_file_names(++pfirst, ++psecond, 0);
+				}
+			}
+			else if(pfirst || psecond)
+				retval = pfirst ? -1 : 1;
+			else
+				retval = compare_file_names(first->name, second->name, 0);
+			break;
+
+		case SK_BY_SIZE:
+			retval = compare_file_sizes(first, second);
+			break;
+
+		case SK_BY_NITEMS:
+			retval = compare_item_count(first, first_is_dir, second, second_is_dir);
+			break;
+
+		case SK_BY_GROUPS:
+			retval = compare_group(first->name, second->name, sort_data);
+			break;
+
+		case SK_BY_TARGET:
+			retval = compare_targets(first, second);
+			break;
+
+		case SK_BY_TIME_MODIFIED:
+			retval = first->mtime - second->mtime;
+			break;
+
+		case SK_BY_TIME_ACCESSED:
+			retval = first->atime - second->atime;
+			break;
+
+		case SK_BY_TIME_CHANGED:
+			retval = first->ctime - second->ctime;
+			break;
+
+#ifndef _WIN32
+		case SK_BY_MODE:
+			retval = first->mode - second->mode;
+			break;
+
+		case SK_BY_INODE:
+			retval = first->inode - second->inode;
+			break;
+
+		case SK_BY_OWNER_NAME: /* FIXME */
+		case SK_BY_OWNER_ID:
+			retval = first->uid - second->uid;
+			break;
+
+		case SK_BY_GROUP_NAME: /* FIXME */
+		case SK_BY_GROUP_ID:
+			retval = first->gid - second->gid;
+			break;
+
+		case SK_BY_PERMISSIONS:
+			{
+				char first_perm[11], second_perm[11];
+				get_perm_string(first_perm, sizeof(first_perm), first->mode);
+				get_perm_string(second_perm, sizeof(second_perm), second->mode);
+				retval = strcmp(first_perm, second_perm);
+			}
+			break;
+
+		case SK_BY_NLINKS:
+			retval = first->nlinks - second->nlinks;
+			break;
+#endif
+	}
+
+	if(retval == 0)
+	{
+		retval = first->tag - second->tag;
+	}
+	else if(sort_descending)
+	{
+		retval = -retval;
+	}
+
+	return retval;
+}
+
+/* Compares two file sizes.  Returns standard -1, 0, 1 for comparisons. */
+static int
+compare_file_sizes(const dir_entry_t *f, const dir_entry_t *s)
+{
+	const uint64_t fsize = fentry_get_size(view, f);
+	const uint64_t ssize = fentry_get_size(view, s);
+	return (fsize < ssize) ? -1 : (fsize > ssize);
+}
+
+/* Compares number of items in two directories (taken as zero for files).
+ * Returns standard -1, 0, 1 for comparisons. */
+static int
+compare_item_count(const dir_entry_t *f, int fdir, const dir_entry_t *s,
+		int sdir)
+{
+	/* We don't want to call fentry_get_nitems() for files as sorting huge lists
+	 * of files can call this function a lot of times, thus even small extra
+	 * performance overhead is not desirable. */
+	const uint64_t fsize = fdir ? fentry_get_nitems(view, f) : 0U;
+	const uint64_t ssize = sdir ? fentry_get_nitems(view, s) : 0U;
+	return (fsize > ssize) ? 1 : (fsize < ssize) ? -1 : 0;
+}
+
+/* Compares two file names according to grouping regular expression.  Returns
+ * standard -1, 0, 1 for comparisons. */
+static int
+compare_group(const char f[], const char s[], regex_t *regex)
+{
+	char fname[NAME_MAX + 1], sname[NAME_MAX + 1];
+	regmatch_t fmatch = get_group_match(regex, f);
+	regmatch_t smatch = get_group_match(regex, s);
+
+	copy_str(fname, MIN(sizeof(fname), fmatch.rm_eo - fmatch.rm_so + 1U),
+			f + fmatch.rm_so);
+	copy_str(sname, MIN(sizeof(sname), smatch.rm_eo - smatch.rm_so + 1U),
+			s + smatch.rm_so);
+
+	return strcmp(fname, sname);
+}
+
+/* Compares two file names according to symbolic link target.  Returns standard
+ * -1, 0, 1 for comparisons. */
+static int
+compare_targets(const dir_entry_t *f, const dir_entry_t *s)
+{
+	char full_path[PATH_MAX + 1];
+	char nlink[PATH_MAX + 1], plink[PATH_MAX + 1];
+
+	if((f->type == FT_LINK) != (s->type == FT_LINK))
+	{
+		/* One of the entries is not a link. */
+		return (f->type == FT_LINK) ? 1 : -1;
+	}
+	if(f->type != FT_LINK)
+	{
+		/* Both entries are not symbolic links. */
+		return 0;
+	}
+
+	/* Both entries are symbolic links. */
+
+	get_full_path_of(f, sizeof(full_path), full_path);
+	if(get_link_target(full_path, nlink, sizeof(nlink)) != 0)
+	{
+		return 0;
+	}
+	get_full_path_of(s, sizeof(full_path), full_path);
+	if(get_link_target(full_path, plink, sizeof(plink)) != 0)
+	{
+		return 0;
+	}
+
+	return stroscmp(nlink, plink);
+}
+
+/* Compares names of two file entries.  Returns positive value if a is greater
+ * than b, zero if they are equal, otherwise negative value is returned. */
+static int
+compare_entry_names(const dir_entry_t *a, const dir_entry_t *b, int ignore_case)
+{
+	char a_short_path[PATH_MAX + 1];
+	char b_short_path[PATH_MAX + 1];
+
+	get_short_path_of(view, a, NF_NONE, 0, sizeof(a_short_path), a_short_path);
+	get_short_path_of(view, b, NF_NONE, 0, sizeof(b_short_path), b_short_path);
+
+	return compare_full_file_names(a_short_path, b_short_path, ignore_case);
+}
+
+/* Compares two full filenames and assumes that dot character is smaller than
+ * any other character.  Returns positive value if s is greater than t, zero if
+ * they are equal, otherwise negative value is returned. */
+static int
+compare_full_file_names(const char s[], const char t[], int ignore_case)
+{
+	if(s[0] == '.' && t[0] != '.')
+	{
+		return -1;
+	}
+	else if(s[0] != '.' && t[0] == '.')
+	{
+		return 1;
+	}
+	else
+	{
+		return compare_file_names(s, t, ignore_case);
+	}
+}
+
+/* Compares two file names or their parts (e.g. extensions).  Returns positive
+ * value if s is greater than t, zero if they are equal, otherwise negative
+ * value is returned. */
+static int
+compare_file_names(const char s[], const char t[], int ignore_case)
+{
+	const char *s_val = s, *t_val = t;
+	char s_buf[NAME_MAX + 1];
+	char t_buf[NAME_MAX + 1];
+	int result;
+
+	if(ignore_case)
+	{
+		/* Ignore too small buffer errors by not caring about part that didn't
+		 * fit. */
+		(void)str_to_lower(s, s_buf, sizeof(s_buf));
+		(void)str_to_lower(t, t_buf, sizeof(t_buf));
+
+		s_val = s_buf;
+		t_val = t_buf;
+	}
+
+	result = cfg.sort_numbers ? strnumcmp(s_val, t_val) : strcmp(s_val, t_val);
+	if(result == 0 && ignore_case)
+	{
+		/* Resort to comparing original names when their normalized versions match
+		 * to always solve ties in deterministic way. */
+		result = strcmp(s, t);
+	}
+	return result;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
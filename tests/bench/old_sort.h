@@ -0,0 +1,13 @@
+#ifndef VIFM_TESTS__BENCH__OLD_SORT_H__
+#define VIFM_TESTS__BENCH__OLD_SORT_H__
+
+#include "../../src/ui/ui.h"
+
+/* Sorts flat list of the view the way it was done before sorting in a single
+ * pass: by one stable sort per key starting with the least significant one. */
+void old_sort_view(view_t *v);
+
+#endif /* VIFM_TESTS__BENCH__OLD_SORT_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,169 @@
+#include <stic.h>
+
+#include <stdio.h> /* FILE fclose() fopen() fprintf() printf() remove() */
+#include <stdlib.h> /* free() */
+
+#ifdef __GLIBC__
+#include <malloc.h> /* mallinfo2() */
+#endif
+
+#include "../../src/utils/linemap.h"
+#include "../../src/utils/string_array.h"
+#include "../../src/utils/utf8.h"
+
+#include "utils.h"
+
+/* Number of lines in the file, number of lines on the screen and number of
+ * times the file is appended to. */
+enum { NLINES = 2000000, NSCREEN = 50, NAPPENDS = 20 };
+
+static size_t heap_usage(void);
+static void report_heap(const char name[], size_t bytes);
+
+SETUP_ONCE()
+{
+	int i;
+	FILE *const f = fopen(SANDBOX_PATH "/log", "w");
+	assert_non_null(f);
+	for(i = 0; i < NLINES; ++i)
+	{
+		fprintf(f, "%d: message of a fairly long log file\twith a tab\n", i);
+	}
+	fclose(f);
+}
+
+TEARDOWN_ONCE()
+{
+	assert_success(remove(SANDBOX_PATH "/log"));
+}
+
+TEST(first_screen)
+{
+	int i, nlines;
+	size_t total_width;
+
+	const size_t heap_before = heap_usage();
+
+	/* Reading all lines and computing their widths. */
+	double start = bench_now();
+	FILE *const f = fopen(SANDBOX_PATH "/log", "rb");
+	assert_non_null(f);
+	char **const lines = read_file_lines(f, &nlines);
+	fclose(f);
+	int *const widths = malloc(sizeof(*widths)*nlines);
+	assert_non_null(widths);
+	for(i = 0; i < nlines; ++i)
+	{
+		widths[i] = utf8_strsw_with_tabs(lines[i], 8);
+	}
+	const double old_time = bench_now() - start;
+	const size_t old_heap = heap_usage() - heap_before;
+	assert_int_equal(NLINES, nlines);
+	free(widths);
+	free_string_array(lines, nlines);
+
+	/* Mapping the file and looking only at the first screen. */
+	start = bench_now();
+	linemap_t *const lm = linemap_open(SANDBOX_PATH "/log");
+	assert_non_null(lm);
+	total_width = 0U;
+	for(i = 0; i < NSCREEN; ++i)
+	{
+		char *const line = linemap_dup(lm, i);
+		total_width += utf8_strsw_with_tabs(line, 8);
+		free(line);
+	}
+	const double new_time = bench_now() - start;
+	const size_t new_heap = heap_usage() - heap_before;
+	assert_true(total_width > 0U);
+
+	/* Indexing the rest to be able to jump to the end. */
+	start = bench_now();
+	char *const last = linemap_dup(lm, NLINES - 1);
+	const double index_time = bench_now() - start;
+	assert_non_null(last);
+	free(last);
+	const size_t index_heap = heap_usage() - heap_before;
+
+	linemap_free(lm);
+
+	report_heap("pager: heap after reading all lines", old_heap);
+	report_heap("pager: heap after mapping", new_heap);
+	report_heap("pager: heap after indexing whole file", index_heap);
+
+	bench_report("pager: reading all lines", old_time);
+	bench_report("pager: first screen of mapped file", new_time);
+	bench_report_speedup("pager: first screen speedup", old_time, new_time);
+	bench_report("pager: indexing whole file", index_time);
+}
+
+TEST(following_appends)
+{
+	int i, j;
+	int nlines = NLINES;
+	double old_time = 0.0, new_time = 0.0;
+
+	linemap_t *const lm = linemap_open(SANDBOX_PATH "/log");
+	assert_non_null(lm);
+	char *line = linemap_dup(lm, nlines - 1);
+	assert_non_null(line);
+	free(line);
+
+	for(i = 0; i < NAPPENDS; ++i)
+	{
+		FILE *const f = fopen(SANDBOX_PATH "/log", "a");
+		assert_non_null(f);
+		for(j = 0; j < 10; ++j)
+		{
+			fprintf(f, "%d: appended line\n", nlines++);
+		}
+		fclose(f);
+
+		/* Reloading the whole file. */
+		double start = bench_now();
+		linemap_t *const reloaded = linemap_open(SANDBOX_PATH "/log");
+		assert_non_null(reloaded);
+		line = linemap_dup(reloaded, nlines - 1);
+		old_time += bench_now() - start;
+		assert_non_null(line);
+		free(line);
+		linemap_free(reloaded);
+
+		/* Reading only what was appended. */
+		start = bench_now();
+		assert_success(linemap_extend(lm, SANDBOX_PATH "/log"));
+		line = linemap_dup(lm, nlines - 1);
+		new_time += bench_now() - start;
+		assert_non_null(line);
+		free(line);
+	}
+
+	linemap_free(lm);
+
+	bench_report("pager: reloading after appends", old_time);
+	bench_report("pager: extending after appends", new_time);
+	bench_report_speedup("pager: following speedup", old_time, new_time);
+}
+
+/* Queries amount of memory taken from heap.  Returns the amount in bytes or
+ * zero if it's unknown. */
+static size_t
+heap_usage(void)
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+	const struct mallinfo2 info = mallinfo2();
+	return info.uordblks + info.hblkhd;
+#else
+	return 0U;
+#endif
+}
+
+/* Prints amount of memory in megabytes. */
+static void
+report_heap(const char name[], size_t bytes)
+{
+	printf("%-50s %10.1f MiB\n", name, bytes/(1024.0*1024.0));
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
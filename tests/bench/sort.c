@@ -0,0 +1,215 @@
+#include <stic.h>
+
+#include <regex.h> /* REG_EXTENDED REG_ICASE regcomp() regfree() */
+
+#include <stdio.h> /* snprintf() */
+#include <stdlib.h> /* free() rand() srand() */
+#include <string.h> /* memcpy() memset() strcpy() strdup() */
+
+#include "../../src/cfg/config.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/dynarray.h"
+#include "../../src/utils/str.h"
+#include "../../src/sort.h"
+
+#include "old_sort.h"
+#include "utils.h"
+
+/* Number of entries in synthetic lists. */
+#define NENTRIES 200000
+
+static void make_list(int nentries);
+static double sort_with(const char keys[], int nkeys);
+static double sort_the_old_way(const char keys[], int nkeys);
+static void check_same_order(const dir_entry_t *expected);
+static dir_entry_t * copy_list(const dir_entry_t *list, int nentries);
+static void free_list(dir_entry_t *list, int nentries);
+
+/* Unsorted list of entries. */
+static dir_entry_t *orig_list;
+
+SETUP()
+{
+	strcpy(lwin.curr_dir, "/bench");
+	update_string(&lwin.sort_groups, "");
+	srand(0);
+	make_list(NENTRIES);
+}
+
+TEARDOWN()
+{
+	free_list(orig_list, NENTRIES);
+	update_string(&lwin.sort_groups, NULL);
+	cfg.sort_numbers = 0;
+}
+
+TEST(dir_iname_mtime)
+{
+	const char keys[] = { SK_BY_DIR, SK_BY_INAME, -SK_BY_TIME_MODIFIED };
+
+	const double old_time = sort_the_old_way(keys, 3);
+	dir_entry_t *const expected = lwin.dir_entry;
+
+	const double new_time = sort_with(keys, 3);
+
+	check_same_order(expected);
+
+	bench_report("sort=+dir,+iname,-mtime: old", old_time);
+	bench_report("sort=+dir,+iname,-mtime: new", new_time);
+	bench_report_speedup("sort=+dir,+iname,-mtime: speedup", old_time, new_time);
+
+	free_list(expected, NENTRIES);
+	free_list(lwin.dir_entry, NENTRIES);
+	lwin.dir_entry = NULL;
+}
+
+TEST(name_with_numbers_ext_ctime)
+{
+	const char keys[] = { SK_BY_NAME, SK_BY_EXTENSION, SK_BY_TIME_CHANGED };
+
+	cfg.sort_numbers = 1;
+
+	const double old_time = sort_the_old_way(keys, 3);
+	dir_entry_t *const expected = lwin.dir_entry;
+
+	const double new_time = sort_with(keys, 3);
+
+	check_same_order(expected);
+
+	bench_report("sort=+name,+ext,+ctime: old", old_time);
+	bench_report("sort=+name,+ext,+ctime: new", new_time);
+	bench_report_speedup("sort=+name,+ext,+ctime: speedup", old_time, new_time);
+
+	free_list(expected, NENTRIES);
+	free_list(lwin.dir_entry, NENTRIES);
+	lwin.dir_entry = NULL;
+}
+
+TEST(groups_scale_like_names)
+{
+	const char name_keys[] = { SK_BY_NAME };
+	const char group_keys[] = { SK_BY_GROUPS, SK_BY_NAME };
+
+	const double name_time = sort_with(name_keys, 1);
+	free_list(lwin.dir_entry, NENTRIES);
+
+	/* Old implementation relies on primary group being precompiled. */
+	update_string(&lwin.sort_groups, "-([0-9]+)\\.,\\.(.*)$,^(.)");
+	assert_success(regcomp(&lwin.primary_group, "-([0-9]+)\\.",
+				REG_EXTENDED | REG_ICASE));
+
+	const double old_time = sort_the_old_way(group_keys, 2);
+	dir_entry_t *const expected = lwin.dir_entry;
+
+	const double new_time = sort_with(group_keys, 2);
+
+	check_same_order(expected);
+	regfree(&lwin.primary_group);
+
+	bench_report("sort=+name", name_time);
+	bench_report("sort=+groups,+name (3 groups): old", old_time);
+	bench_report("sort=+groups,+name (3 groups): new", new_time);
+	bench_report_speedup("sort=+groups,+name (3 groups): speedup", old_time,
+			new_time);
+
+	free_list(expected, NENTRIES);
+	free_list(lwin.dir_entry, NENTRIES);
+	lwin.dir_entry = NULL;
+}
+
+/* Fills orig_list with entries of random names, types and times. */
+static void
+make_list(int nentries)
+{
+	static const char *const exts[] = { "c", "h", "TXT", "md", "tar.gz", "" };
+
+	int i;
+	orig_list = dynarray_cextend(NULL, nentries*sizeof(*orig_list));
+	for(i = 0; i < nentries; ++i)
+	{
+		char name[64];
+		dir_entry_t *const entry = &orig_list[i];
+
+		snprintf(name, sizeof(name), "%c%s-%d.%s", 'a' + rand()%26,
+				(rand()%2 == 0) ? "File" : "file", rand()%(nentries/4),
+				exts[rand()%(sizeof(exts)/sizeof(exts[0]))]);
+
+		entry->name = strdup(name);
+		entry->origin = lwin.curr_dir;
+		entry->type = (rand()%10 == 0) ? FT_DIR : FT_REG;
+		entry->mtime = rand()%1000;
+		entry->ctime = rand()%1000;
+	}
+}
+
+/* Sorts copy of orig_list into lwin by specified keys at once.  Returns time
+ * it took. */
+static double
+sort_with(const char keys[], int nkeys)
+{
+	lwin.dir_entry = copy_list(orig_list, NENTRIES);
+	lwin.list_rows = NENTRIES;
+
+	memset(lwin.sort, SK_NONE, sizeof(lwin.sort));
+	memcpy(lwin.sort, keys, nkeys);
+
+	const double start = bench_now();
+	sort_view(&lwin);
+	return bench_now() - start;
+}
+
+/* Sorts copy of orig_list into lwin by specified keys using implementation
+ * that was used before sorting in a single pass.  Returns time it took. */
+static double
+sort_the_old_way(const char keys[], int nkeys)
+{
+	lwin.dir_entry = copy_list(orig_list, NENTRIES);
+	lwin.list_rows = NENTRIES;
+
+	memset(lwin.sort, SK_NONE, sizeof(lwin.sort));
+	memcpy(lwin.sort, keys, nkeys);
+
+	const double start = bench_now();
+	old_sort_view(&lwin);
+	return bench_now() - start;
+}
+
+/* Checks that entries of lwin are in the same order as in expected list. */
+static void
+check_same_order(const dir_entry_t *expected)
+{
+	int i;
+	for(i = 0; i < NENTRIES; ++i)
+	{
+		assert_string_equal(expected[i].name, lwin.dir_entry[i].name);
+	}
+}
+
+/* Makes a deep copy of a list.  Returns the copy. */
+static dir_entry_t *
+copy_list(const dir_entry_t *list, int nentries)
+{
+	int i;
+	dir_entry_t *const copy = dynarray_extend(NULL, nentries*sizeof(*copy));
+	memcpy(copy, list, nentries*sizeof(*copy));
+	for(i = 0; i < nentries; ++i)
+	{
+		copy[i].name = strdup(list[i].name);
+	}
+	return copy;
+}
+
+/* Frees a list along with names of its entries. */
+static void
+free_list(dir_entry_t *list, int nentries)
+{
+	int i;
+	for(i = 0; i < nentries; ++i)
+	{
+		free(list[i].name);
+	}
+	dynarray_free(list);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
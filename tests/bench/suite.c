@@ -0,0 +1,6 @@
+#include <stic.h>
+
+DEFINE_SUITE();
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,144 @@
+#include <stic.h>
+
+#include <unistd.h> /* rmdir() */
+
+#include <stdio.h> /* FILE fclose() fopen() snprintf() */
+#include <stdlib.h> /* free() */
+
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/os.h"
+#include "../../src/io/private/traverser.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/path.h"
+
+#include "utils.h"
+
+/* Shape of the tree used for traversal. */
+enum { NDIRS = 50, NSUBDIRS = 4, NFILES = 100 };
+
+/* Total number of visited entries. */
+#define NENTRIES (1 + NDIRS*(1 + NSUBDIRS*(1 + NFILES)))
+
+static void make_tree(void);
+static VisitResult count_visitor(const char full_path[], VisitAction action,
+		void *param);
+static int traverse_by_path(const char path[], int *count);
+
+SETUP_ONCE()
+{
+	make_tree();
+}
+
+TEARDOWN_ONCE()
+{
+	remove_dir_content(SANDBOX_PATH "/tree");
+	assert_success(rmdir(SANDBOX_PATH "/tree"));
+}
+
+TEST(fd_relative_traversal)
+{
+	int old_count = 0, new_count = 0;
+
+	const double old_start = bench_now();
+	assert_success(traverse_by_path(SANDBOX_PATH "/tree", &old_count));
+	const double old_time = bench_now() - old_start;
+
+	const double new_start = bench_now();
+	assert_success(traverse(SANDBOX_PATH "/tree", &count_visitor, &new_count));
+	const double new_time = bench_now() - new_start;
+
+	assert_int_equal(NENTRIES, old_count);
+	assert_int_equal(NENTRIES, new_count);
+
+	bench_report("traverse: path per entry", old_time);
+	bench_report("traverse: fd-relative", new_time);
+	bench_report_speedup("traverse: speedup", old_time, new_time);
+}
+
+/* Creates tree of directories and empty files in the sandbox. */
+static void
+make_tree(void)
+{
+	int i, j, k;
+	char path[PATH_MAX + 1];
+
+	assert_success(os_mkdir(SANDBOX_PATH "/tree", 0700));
+	for(i = 0; i < NDIRS; ++i)
+	{
+		snprintf(path, sizeof(path), "%s/tree/dir%d", SANDBOX_PATH, i);
+		assert_success(os_mkdir(path, 0700));
+
+		for(j = 0; j < NSUBDIRS; ++j)
+		{
+			snprintf(path, sizeof(path), "%s/tree/dir%d/sub%d", SANDBOX_PATH, i, j);
+			assert_success(os_mkdir(path, 0700));
+
+			for(k = 0; k < NFILES; ++k)
+			{
+				snprintf(path, sizeof(path), "%s/tree/dir%d/sub%d/file-number-%d",
+						SANDBOX_PATH, i, j, k);
+				FILE *const f = fopen(path, "w");
+				assert_non_null(f);
+				fclose(f);
+			}
+		}
+	}
+}
+
+/* Visitor that counts files and directories.  Returns VR_OK. */
+static VisitResult
+count_visitor(const char full_path[], VisitAction action, void *param)
+{
+	int *const count = param;
+	if(action != VA_DIR_LEAVE)
+	{
+		++*count;
+	}
+	return VR_OK;
+}
+
+/* Reference implementation of traversal that builds full path of every entry
+ * and inspects entries by their paths.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+traverse_by_path(const char path[], int *count)
+{
+	DIR *dir;
+	struct dirent *d;
+	int result = 0;
+
+	dir = os_opendir(path);
+	if(dir == NULL)
+	{
+		return 1;
+	}
+
+	++*count;
+
+	while(result == 0 && (d = os_readdir(dir)) != NULL)
+	{
+		char *full_path;
+
+		if(is_builtin_dir(d->d_name))
+		{
+			continue;
+		}
+
+		full_path = join_paths(path, d->d_name);
+		if(!entry_is_link(full_path, d) && entry_is_dir(full_path, d))
+		{
+			result = traverse_by_path(full_path, count);
+		}
+		else
+		{
+			++*count;
+		}
+		free(full_path);
+	}
+	(void)os_closedir(dir);
+
+	return result;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
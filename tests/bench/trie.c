@@ -0,0 +1,251 @@
+#include <stic.h>
+
+#include <stdio.h> /* printf() snprintf() */
+#include <stdlib.h> /* calloc() free() malloc() rand() srand() */
+
+#ifdef __GLIBC__
+#include <malloc.h> /* mallinfo2() */
+#endif
+
+#include "../../src/utils/trie.h"
+
+#include "utils.h"
+
+/* Number of names in the synthetic directory. */
+#define NNAMES 1000000
+
+/* Node of reference ternary search tree, which allocates a node per
+ * character. */
+typedef struct tst_t
+{
+	struct tst_t *left;     /* Nodes with values less than value. */
+	struct tst_t *right;    /* Nodes with values greater than value. */
+	struct tst_t *children; /* Child nodes. */
+	void *data;             /* Data associated with the key. */
+	char value;             /* Value of the node. */
+	char exists;            /* Whether this node ends a key. */
+}
+tst_t;
+
+static int tst_set(tst_t **root, const char str[], void *data);
+static int tst_get(tst_t *node, const char str[], void **data);
+static void tst_free(tst_t *node);
+static size_t heap_usage(void);
+static void report_heap(const char name[], size_t bytes);
+
+/* Names of files. */
+static char (*names)[32];
+/* Order in which names are looked up (not the one of insertion). */
+static int *order;
+/* Number of allocations made by the reference implementation. */
+static size_t tst_allocs;
+
+SETUP_ONCE()
+{
+	int i;
+
+	names = malloc(sizeof(*names)*NNAMES);
+	order = malloc(sizeof(*order)*NNAMES);
+	assert_non_null(names);
+	assert_non_null(order);
+
+	for(i = 0; i < NNAMES; ++i)
+	{
+		snprintf(names[i], sizeof(names[i]), "file-number-%d.txt", i);
+		order[i] = i;
+	}
+
+	srand(0);
+	for(i = NNAMES - 1; i > 0; --i)
+	{
+		const int j = rand()%(i + 1);
+		const int tmp = order[i];
+		order[i] = order[j];
+		order[j] = tmp;
+	}
+}
+
+TEARDOWN_ONCE()
+{
+	free(names);
+	free(order);
+}
+
+TEST(build_and_lookup_names)
+{
+	int i;
+	void *data;
+	int failures;
+
+	const size_t heap_before = heap_usage();
+
+	failures = 0;
+	double start = bench_now();
+	tst_t *tst = NULL;
+	for(i = 0; i < NNAMES; ++i)
+	{
+		failures += (tst_set(&tst, names[i], names[i]) != 0);
+	}
+	const double old_build = bench_now() - start;
+	assert_int_equal(0, failures);
+	const size_t old_heap = heap_usage() - heap_before;
+
+	failures = 0;
+	start = bench_now();
+	for(i = 0; i < NNAMES; ++i)
+	{
+		failures += (tst_get(tst, names[order[i]], &data) != 0);
+	}
+	const double old_lookup = bench_now() - start;
+	assert_int_equal(0, failures);
+
+	start = bench_now();
+	tst_free(tst);
+	const double old_free = bench_now() - start;
+
+	failures = 0;
+	start = bench_now();
+	trie_t *const trie = trie_create();
+	for(i = 0; i < NNAMES; ++i)
+	{
+		failures += (trie_set(trie, names[i], names[i]) != 0);
+	}
+	const double new_build = bench_now() - start;
+	assert_int_equal(0, failures);
+	const size_t new_heap = heap_usage() - heap_before;
+
+	failures = 0;
+	start = bench_now();
+	for(i = 0; i < NNAMES; ++i)
+	{
+		failures += (trie_get(trie, names[order[i]], &data) != 0);
+	}
+	const double new_lookup = bench_now() - start;
+	assert_int_equal(0, failures);
+
+	start = bench_now();
+	trie_free(trie);
+	const double new_free = bench_now() - start;
+
+	printf("%-50s %10zu\n", "trie: ternary tree allocations", tst_allocs);
+	report_heap("trie: ternary tree heap", old_heap);
+	report_heap("trie: hash table heap", new_heap);
+
+	bench_report("trie: ternary tree build", old_build);
+	bench_report("trie: hash table build", new_build);
+	bench_report_speedup("trie: build speedup", old_build, new_build);
+
+	bench_report("trie: ternary tree lookup", old_lookup);
+	bench_report("trie: hash table lookup", new_lookup);
+	bench_report_speedup("trie: lookup speedup", old_lookup, new_lookup);
+
+	bench_report("trie: ternary tree free", old_free);
+	bench_report("trie: hash table free", new_free);
+	bench_report_speedup("trie: free speedup", old_free, new_free);
+}
+
+/* Inserts or updates key of the reference tree.  Returns negative value on
+ * error, zero on insertion and positive number on update. */
+static int
+tst_set(tst_t **root, const char str[], void *data)
+{
+	tst_t **link = root;
+	while(1)
+	{
+		tst_t *node = *link;
+		if(node == NULL)
+		{
+			node = calloc(1U, sizeof(*node));
+			if(node == NULL)
+			{
+				return -1;
+			}
+			++tst_allocs;
+			node->value = *str;
+			*link = node;
+		}
+
+		if(node->value == *str)
+		{
+			if(*str == '\0')
+			{
+				const int result = (node->exists != 0);
+				node->exists = 1;
+				node->data = data;
+				return result;
+			}
+
+			link = &node->children;
+			++str;
+		}
+		else
+		{
+			link = (*str < node->value) ? &node->left : &node->right;
+		}
+	}
+}
+
+/* Looks up key in the reference tree.  Returns zero when found and sets *data,
+ * otherwise returns non-zero. */
+static int
+tst_get(tst_t *node, const char str[], void **data)
+{
+	while(node != NULL)
+	{
+		if(node->value == *str)
+		{
+			if(*str == '\0')
+			{
+				if(!node->exists)
+				{
+					return 1;
+				}
+				*data = node->data;
+				return 0;
+			}
+
+			node = node->children;
+			++str;
+			continue;
+		}
+
+		node = (*str < node->value) ? node->left : node->right;
+	}
+	return 1;
+}
+
+/* Frees reference tree. */
+static void
+tst_free(tst_t *node)
+{
+	if(node != NULL)
+	{
+		tst_free(node->left);
+		tst_free(node->right);
+		tst_free(node->children);
+		free(node);
+	}
+}
+
+/* Queries amount of memory taken from heap.  Returns the amount in bytes or
+ * zero if it's unknown. */
+static size_t
+heap_usage(void)
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+	const struct mallinfo2 info = mallinfo2();
+	return info.uordblks + info.hblkhd;
+#else
+	return 0U;
+#endif
+}
+
+/* Prints amount of memory in megabytes. */
+static void
+report_heap(const char name[], size_t bytes)
+{
+	printf("%-50s %10.1f MiB\n", name, bytes/(1024.0*1024.0));
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
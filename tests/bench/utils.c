@@ -0,0 +1,27 @@
+#include "utils.h"
+
+#include <stdio.h> /* printf() */
+#include <time.h> /* CLOCK_MONOTONIC clock_gettime() */
+
+double
+bench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec/1e9;
+}
+
+void
+bench_report(const char name[], double secs)
+{
+	printf("%-50s %10.3f ms\n", name, secs*1000);
+}
+
+void
+bench_report_speedup(const char name[], double old_secs, double new_secs)
+{
+	printf("%-50s %10.2fx\n", name, (new_secs > 0) ? old_secs/new_secs : 0.0);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
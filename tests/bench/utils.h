@@ -0,0 +1,17 @@
+#ifndef VIFM_TESTS__BENCH__UTILS_H__
+#define VIFM_TESTS__BENCH__UTILS_H__
+
+/* Retrieves value of monotonic clock.  Returns time in seconds. */
+double bench_now(void);
+
+/* Prints time it took to perform the action described by the name. */
+void bench_report(const char name[], double secs);
+
+/* Prints how many times the new version of an action is faster than the old
+ * one. */
+void bench_report_speedup(const char name[], double old_secs, double new_secs);
+
+#endif /* VIFM_TESTS__BENCH__UTILS_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
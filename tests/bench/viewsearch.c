@@ -0,0 +1,141 @@
+#include <stic.h>
+
+#include <regex.h> /* REG_EXTENDED regcomp() regexec() regfree() */
+
+#include <stdio.h> /* FILE fclose() fopen() fprintf() remove() */
+#include <stdlib.h> /* free() */
+
+#include "../../src/utils/linemap.h"
+#include "../../src/utils/linesearch.h"
+
+#include "utils.h"
+
+/* Number of lines in the file. */
+enum { NLINES = 2000000 };
+
+static int find_line_by_line(linemap_t *lm, const char pattern[]);
+static int count_line_by_line(linemap_t *lm, const char pattern[]);
+static int run(linesearch_t *ls);
+
+/* Mapped log file. */
+static linemap_t *lm;
+
+SETUP_ONCE()
+{
+	int i;
+	FILE *const f = fopen(SANDBOX_PATH "/log", "w");
+	assert_non_null(f);
+	for(i = 0; i < NLINES; ++i)
+	{
+		fprintf(f, "%d: message of a fairly long log file\twith a tab\n", i);
+	}
+	fclose(f);
+
+	lm = linemap_open(SANDBOX_PATH "/log");
+	assert_non_null(lm);
+}
+
+TEARDOWN_ONCE()
+{
+	linemap_free(lm);
+	assert_success(remove(SANDBOX_PATH "/log"));
+}
+
+TEST(find_match_near_the_end)
+{
+	const char *const pattern = "^1999990:";
+	const linesearch_criteria_t criteria = {
+		.pattern = pattern, .cflags = REG_EXTENDED
+	};
+
+	double start = bench_now();
+	assert_int_equal(1999990, find_line_by_line(lm, pattern));
+	const double old_time = bench_now() - start;
+
+	start = bench_now();
+	assert_int_equal(1999990, run(linesearch_find(lm, &criteria, 0, 0, 1)));
+	const double new_time = bench_now() - start;
+
+	bench_report("viewsearch: line by line find", old_time);
+	bench_report("viewsearch: prefiltered find", new_time);
+	bench_report_speedup("viewsearch: find speedup", old_time, new_time);
+}
+
+TEST(count_all_matches)
+{
+	const char *const pattern = "99 *:";
+	const linesearch_criteria_t criteria = {
+		.pattern = pattern, .cflags = REG_EXTENDED
+	};
+
+	double start = bench_now();
+	assert_int_equal(20000, count_line_by_line(lm, pattern));
+	const double old_time = bench_now() - start;
+
+	start = bench_now();
+	assert_int_equal(20000, run(linesearch_count(lm, &criteria, 0)));
+	const double new_time = bench_now() - start;
+
+	bench_report("viewsearch: line by line count", old_time);
+	bench_report("viewsearch: prefiltered count", new_time);
+	bench_report_speedup("viewsearch: count speedup", old_time, new_time);
+}
+
+/* Reference implementation of search, which matches every line separately.
+ * Returns number of the first matching line or -1. */
+static int
+find_line_by_line(linemap_t *lm, const char pattern[])
+{
+	regex_t re;
+	assert_success(regcomp(&re, pattern, REG_EXTENDED | REG_NOSUB));
+
+	int i;
+	char *line;
+	for(i = 0; (line = linemap_dup(lm, i)) != NULL; ++i)
+	{
+		const int matches = (regexec(&re, line, 0, NULL, 0) == 0);
+		free(line);
+		if(matches)
+		{
+			break;
+		}
+	}
+
+	regfree(&re);
+	return (line == NULL) ? -1 : i;
+}
+
+/* Reference implementation of counting, which matches every line separately.
+ * Returns number of matching lines. */
+static int
+count_line_by_line(linemap_t *lm, const char pattern[])
+{
+	regex_t re;
+	assert_success(regcomp(&re, pattern, REG_EXTENDED | REG_NOSUB));
+
+	int i;
+	int count = 0;
+	char *line;
+	for(i = 0; (line = linemap_dup(lm, i)) != NULL; ++i)
+	{
+		count += (regexec(&re, line, 0, NULL, 0) == 0);
+		free(line);
+	}
+
+	regfree(&re);
+	return count;
+}
+
+/* Waits for the search to finish and frees it.  Returns its result. */
+static int
+run(linesearch_t *ls)
+{
+	assert_non_null(ls);
+	assert_true(linesearch_wait(ls, -1));
+	const int result = linesearch_result(ls);
+	linesearch_free(ls);
+	return result;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
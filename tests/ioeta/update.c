@@ -2,9 +2,12 @@
 
 #include <stddef.h> /* NULL */
 
+#include "../../src/compat/pthread.h"
 #include "../../src/io/private/ioeta.h"
 #include "../../src/io/ioeta.h"
 
+static void * update_in_thread(void *arg);
+
 static ioeta_estim_t *estim;
 
 SETUP()
@@ -101,5 +104,47 @@ TEST(finished_update_increments_current_item)
 	assert_int_equal(prev + 1, estim->current_item);
 }
 
+TEST(file_progress_is_tracked_per_thread)
+{
+	pthread_t thread;
+
+	ioeta_update(estim, TEST_DATA_PATH "/read/binary-data", "x", 0, 100);
+
+	assert_success(pthread_create(&thread, NULL, &update_in_thread, NULL));
+	assert_success(pthread_join(thread, NULL));
+	assert_int_equal(5, estim->current_file_byte);
+	assert_int_equal(9, estim->total_file_bytes);
+
+	ioeta_update(estim, NULL, NULL, 0, 10);
+	assert_int_equal(110, estim->current_file_byte);
+	assert_int_equal(1024, estim->total_file_bytes);
+
+	assert_int_equal(2, estim->inspected_items);
+	assert_int_equal(115, estim->current_byte);
+}
+
+TEST(skipping_file_counts_its_remaining_bytes)
+{
+	ioeta_update(estim, TEST_DATA_PATH "/read/binary-data", "x", 0, 100);
+	ioeta_skip_file(estim);
+
+	assert_int_equal(1, estim->current_item);
+	assert_int_equal(1024, estim->current_byte);
+	assert_int_equal(0, estim->current_file_byte);
+	assert_int_equal(0, estim->total_file_bytes);
+
+	ioeta_skip_file(estim);
+	assert_int_equal(2, estim->current_item);
+	assert_int_equal(1024, estim->current_byte);
+}
+
+/* Updates estimation from a separate thread. */
+static void *
+update_in_thread(void *arg)
+{
+	ioeta_update(estim, TEST_DATA_PATH "/read/utf8-bom", "y", 0, 5);
+	return NULL;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
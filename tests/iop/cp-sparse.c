@@ -0,0 +1,226 @@
+#include <stic.h>
+
+#include <sys/stat.h> /* fstat() stat */
+#include <unistd.h> /* ftruncate() lstat() truncate() */
+
+#include <stdio.h> /* FILE fclose() fflush() fopen() fread() fseek() fwrite()
+                      remove() */
+#include <string.h> /* memcmp() */
+
+#include "../../src/io/ioeta.h"
+#include "../../src/io/iop.h"
+
+#include "utils.h"
+
+/* Windows lacks definitions of some declarations and sparse files aren't
+ * copied there by this code. */
+#ifndef _WIN32
+
+/* Size of sparse files used in tests. */
+#define SPARSE_SIZE (16*1024*1024)
+
+static void make_sparse_file(const char path[], const long offsets[],
+		int noffsets);
+static void copy_is_sparse_and_identical(const char src[], const char dst[]);
+static int contents_match(const char a[], const char b[]);
+static int can_make_sparse_files(void);
+
+static const io_cancellation_t no_cancellation;
+
+TEST(holes_between_data_are_preserved, IF(can_make_sparse_files))
+{
+	const long offsets[] = { 0, 4*1024*1024 + 3, 12*1024*1024 };
+
+	io_args_t args = {
+		.arg1.src = SANDBOX_PATH "/sparse",
+		.arg2.dst = SANDBOX_PATH "/copy",
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	make_sparse_file(SANDBOX_PATH "/sparse", offsets, 3);
+
+	assert_success(iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+
+	copy_is_sparse_and_identical(SANDBOX_PATH "/sparse", SANDBOX_PATH "/copy");
+
+	delete_test_file(SANDBOX_PATH "/sparse");
+	delete_test_file(SANDBOX_PATH "/copy");
+}
+
+TEST(trailing_hole_is_preserved, IF(can_make_sparse_files))
+{
+	const long offsets[] = { 1024*1024 };
+
+	io_args_t args = {
+		.arg1.src = SANDBOX_PATH "/sparse",
+		.arg2.dst = SANDBOX_PATH "/copy",
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	make_sparse_file(SANDBOX_PATH "/sparse", offsets, 1);
+
+	assert_success(iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+
+	copy_is_sparse_and_identical(SANDBOX_PATH "/sparse", SANDBOX_PATH "/copy");
+
+	delete_test_file(SANDBOX_PATH "/sparse");
+	delete_test_file(SANDBOX_PATH "/copy");
+}
+
+TEST(file_that_is_a_hole_is_copied, IF(can_make_sparse_files))
+{
+	io_args_t args = {
+		.arg1.src = SANDBOX_PATH "/sparse",
+		.arg2.dst = SANDBOX_PATH "/copy",
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	make_sparse_file(SANDBOX_PATH "/sparse", NULL, 0);
+
+	assert_success(iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+
+	copy_is_sparse_and_identical(SANDBOX_PATH "/sparse", SANDBOX_PATH "/copy");
+
+	delete_test_file(SANDBOX_PATH "/sparse");
+	delete_test_file(SANDBOX_PATH "/copy");
+}
+
+TEST(holes_count_towards_progress, IF(can_make_sparse_files))
+{
+	const long offsets[] = { 8*1024*1024 };
+
+	io_args_t args = {
+		.arg1.src = SANDBOX_PATH "/sparse",
+		.arg2.dst = SANDBOX_PATH "/copy",
+
+		.estim = ioeta_alloc(NULL, no_cancellation),
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	make_sparse_file(SANDBOX_PATH "/sparse", offsets, 1);
+	ioeta_calculate(args.estim, SANDBOX_PATH "/sparse", 0);
+
+	assert_success(iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+
+	assert_int_equal(SPARSE_SIZE, args.estim->total_bytes);
+	assert_int_equal(SPARSE_SIZE, args.estim->current_byte);
+
+	ioeta_free(args.estim);
+	delete_test_file(SANDBOX_PATH "/sparse");
+	delete_test_file(SANDBOX_PATH "/copy");
+}
+
+TEST(appending_to_sparse_file_works, IF(can_make_sparse_files))
+{
+	const long offsets[] = { 4*1024*1024 };
+
+	io_args_t args = {
+		.arg1.src = SANDBOX_PATH "/sparse",
+		.arg2.dst = SANDBOX_PATH "/copy",
+		.arg3.crs = IO_CRS_APPEND_TO_FILES,
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	make_sparse_file(SANDBOX_PATH "/sparse", offsets, 1);
+	make_sparse_file(SANDBOX_PATH "/copy", NULL, 0);
+	assert_success(truncate(SANDBOX_PATH "/copy", 1024*1024));
+
+	assert_success(iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+
+	assert_true(contents_match(SANDBOX_PATH "/sparse", SANDBOX_PATH "/copy"));
+
+	delete_test_file(SANDBOX_PATH "/sparse");
+	delete_test_file(SANDBOX_PATH "/copy");
+}
+
+/* Creates sparse file of SPARSE_SIZE bytes with a few bytes of data at each of
+ * the specified offsets. */
+static void
+make_sparse_file(const char path[], const long offsets[], int noffsets)
+{
+	int i;
+	FILE *const f = fopen(path, "wb");
+	assert_non_null(f);
+	for(i = 0; i < noffsets; ++i)
+	{
+		assert_success(fseek(f, offsets[i], SEEK_SET));
+		assert_int_equal(4, fwrite("data", 1, 4, f));
+	}
+	assert_success(fflush(f));
+	assert_success(ftruncate(fileno(f), SPARSE_SIZE));
+	fclose(f);
+}
+
+/* Checks that copy has the same contents as the original and occupies less
+ * space on disk than its size. */
+static void
+copy_is_sparse_and_identical(const char src[], const char dst[])
+{
+	struct stat st;
+
+	assert_true(contents_match(src, dst));
+
+	assert_success(lstat(dst, &st));
+	assert_int_equal(SPARSE_SIZE, st.st_size);
+	assert_true(st.st_blocks*512 < st.st_size);
+}
+
+/* Compares contents of two files byte by byte.  Returns non-zero if they are
+ * the same, otherwise zero is returned. */
+static int
+contents_match(const char a[], const char b[])
+{
+	static char a_block[64*1024], b_block[64*1024];
+
+	size_t a_len, b_len;
+	int match = 1;
+
+	FILE *const a_file = fopen(a, "rb");
+	FILE *const b_file = fopen(b, "rb");
+	assert_non_null(a_file);
+	assert_non_null(b_file);
+
+	do
+	{
+		a_len = fread(a_block, 1, sizeof(a_block), a_file);
+		b_len = fread(b_block, 1, sizeof(b_block), b_file);
+		match = (a_len == b_len && memcmp(a_block, b_block, a_len) == 0);
+	}
+	while(match && a_len != 0U);
+
+	fclose(b_file);
+	fclose(a_file);
+
+	return match;
+}
+
+/* Checks whether file system of the sandbox supports sparse files.  Returns
+ * non-zero if so, otherwise zero is returned. */
+static int
+can_make_sparse_files(void)
+{
+	struct stat st;
+	int sparse;
+
+	FILE *const f = fopen(SANDBOX_PATH "/probe", "wb");
+	if(f == NULL)
+	{
+		return 0;
+	}
+	sparse = (ftruncate(fileno(f), SPARSE_SIZE) == 0 &&
+			fstat(fileno(f), &st) == 0 && st.st_blocks*512 < st.st_size);
+	fclose(f);
+	(void)remove(SANDBOX_PATH "/probe");
+
+	return sparse;
+}
+
+#endif
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -9,16 +9,23 @@
 #include <unistd.h> /* _Exit() lstat() */
 
 #include <signal.h> /* SIGXFSZ SIG_IGN signal() */
+#include <stdio.h> /* FILE fclose() fopen() fputc() */
 #include <stdlib.h> /* EXIT_SUCCESS */
 
 #include "../../src/compat/fs_limits.h"
 #include "../../src/compat/os.h"
+#include "../../src/io/ioeta.h"
 #include "../../src/io/iop.h"
 #include "../../src/utils/fs.h"
 
 #include "utils.h"
 
 static void file_is_copied(const char original[]);
+static void make_big_file(const char path[], int size);
+static int cancel_copy(void *arg);
+static int has_procfs(void);
+
+static const io_cancellation_t no_cancellation;
 
 TEST(dir_is_not_copied)
 {
@@ -174,6 +181,68 @@ file_is_copied(const char original[])
 	delete_test_file(SANDBOX_PATH "/copy");
 }
 
+TEST(big_file_is_copied_with_progress)
+{
+	enum { SIZE = 20*1024*1024 + 1 };
+
+	io_args_t args = {
+		.arg1.src = SANDBOX_PATH "/big",
+		.arg2.dst = SANDBOX_PATH "/copy",
+
+		.estim = ioeta_alloc(NULL, no_cancellation),
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	make_big_file(SANDBOX_PATH "/big", SIZE);
+	ioeta_calculate(args.estim, SANDBOX_PATH "/big", 0);
+
+	assert_success(iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+
+	assert_int_equal(SIZE, args.estim->current_byte);
+	assert_int_equal(SIZE, args.estim->total_bytes);
+	assert_true(files_are_identical(SANDBOX_PATH "/big", SANDBOX_PATH "/copy"));
+
+	ioeta_free(args.estim);
+	delete_test_file(SANDBOX_PATH "/big");
+	delete_test_file(SANDBOX_PATH "/copy");
+}
+
+TEST(file_copying_can_be_cancelled)
+{
+	io_args_t args = {
+		.arg1.src = SANDBOX_PATH "/big",
+		.arg2.dst = SANDBOX_PATH "/copy",
+
+		.cancellation.hook = &cancel_copy,
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	make_big_file(SANDBOX_PATH "/big", 1024*1024);
+
+	assert_failure(iop_cp(&args));
+	assert_true(get_file_size(SANDBOX_PATH "/copy") < 1024*1024);
+
+	delete_test_file(SANDBOX_PATH "/big");
+	delete_test_file(SANDBOX_PATH "/copy");
+}
+
+TEST(files_of_zero_reported_size_are_copied, IF(has_procfs))
+{
+	io_args_t args = {
+		.arg1.src = "/proc/self/status",
+		.arg2.dst = SANDBOX_PATH "/copy",
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	assert_success(iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+
+	assert_true(get_file_size(SANDBOX_PATH "/copy") > 0);
+
+	delete_test_file(SANDBOX_PATH "/copy");
+}
+
 TEST(appending_works_for_files)
 {
 	uint64_t size;
@@ -530,5 +599,35 @@ TEST(append_truncates_destination_files_on_error, IF(not_windows))
 
 #endif
 
+/* Creates file of specified size filled with a pattern. */
+static void
+make_big_file(const char path[], int size)
+{
+	int i;
+	FILE *const f = fopen(path, "wb");
+	assert_non_null(f);
+	for(i = 0; i < size; ++i)
+	{
+		fputc(i%251, f);
+	}
+	fclose(f);
+}
+
+/* Cancellation hook that requests cancellation right away.  Returns non-zero
+ * if operation should be cancelled. */
+static int
+cancel_copy(void *arg)
+{
+	return 1;
+}
+
+/* Checks whether procfs is mounted.  Returns non-zero if so, otherwise zero is
+ * returned. */
+static int
+has_procfs(void)
+{
+	return path_exists("/proc/self/status", DEREF);
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
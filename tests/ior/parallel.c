@@ -0,0 +1,213 @@
+#include <stic.h>
+
+#include <sys/stat.h> /* chmod() stat */
+#include <unistd.h> /* R_OK access() */
+
+#include <stdio.h> /* FILE fclose() fopen() fputs() snprintf() */
+
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/os.h"
+#include "../../src/io/ioeta.h"
+#include "../../src/io/ior.h"
+#include "../../src/utils/fs.h"
+
+#include "utils.h"
+
+/* Shape of the tree used in tests. */
+enum { NDIRS = 8, NFILES = 40 };
+
+static void make_tree(const char root[]);
+static int tree_is_copied(const char root[], int check_modes);
+static int can_deny_reading(void);
+
+static const io_cancellation_t no_cancellation;
+
+TEST(tree_is_copied_and_removed_by_several_threads, IF(not_windows))
+{
+	make_tree(SANDBOX_PATH "/src");
+
+	{
+		io_args_t args = {
+			.arg1.src = SANDBOX_PATH "/src",
+			.arg2.dst = SANDBOX_PATH "/dst",
+			.nthreads = 4,
+		};
+		ioe_errlst_init(&args.result.errors);
+
+		assert_success(ior_cp(&args));
+		assert_int_equal(0, args.result.errors.error_count);
+	}
+
+	assert_true(tree_is_copied(SANDBOX_PATH "/dst", 1));
+
+	{
+		io_args_t args = {
+			.arg1.path = SANDBOX_PATH "/dst",
+			.nthreads = 4,
+		};
+		ioe_errlst_init(&args.result.errors);
+
+		assert_success(ior_rm(&args));
+		assert_int_equal(0, args.result.errors.error_count);
+	}
+
+	assert_false(path_exists(SANDBOX_PATH "/dst", NODEREF));
+
+	delete_tree(SANDBOX_PATH "/src");
+}
+
+TEST(directories_are_merged_by_several_threads)
+{
+	make_tree(SANDBOX_PATH "/src");
+	create_empty_nested_dir(SANDBOX_PATH "/dst", "dir0");
+
+	{
+		io_args_t args = {
+			.arg1.src = SANDBOX_PATH "/src",
+			.arg2.dst = SANDBOX_PATH "/dst",
+			.arg3.crs = IO_CRS_REPLACE_FILES,
+			.nthreads = 4,
+		};
+		ioe_errlst_init(&args.result.errors);
+
+		assert_success(ior_mv(&args));
+		assert_int_equal(0, args.result.errors.error_count);
+	}
+
+	/* Moving doesn't update permissions of merged directories. */
+	assert_true(tree_is_copied(SANDBOX_PATH "/dst", 0));
+	assert_false(path_exists(SANDBOX_PATH "/src", NODEREF));
+
+	delete_tree(SANDBOX_PATH "/dst");
+}
+
+TEST(progress_of_all_threads_is_counted)
+{
+	make_tree(SANDBOX_PATH "/src");
+
+	io_args_t args = {
+		.arg1.src = SANDBOX_PATH "/src",
+		.arg2.dst = SANDBOX_PATH "/dst",
+		.nthreads = 4,
+
+		.estim = ioeta_alloc(NULL, no_cancellation),
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	ioeta_calculate(args.estim, SANDBOX_PATH "/src", 0);
+
+	assert_success(ior_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+
+	assert_int_equal(args.estim->total_items, args.estim->current_item);
+	assert_int_equal(args.estim->total_bytes, args.estim->current_byte);
+	assert_true(args.estim->current_byte > 0);
+
+	ioeta_free(args.estim);
+	delete_tree(SANDBOX_PATH "/src");
+	delete_tree(SANDBOX_PATH "/dst");
+}
+
+TEST(errors_of_all_threads_are_collected, IF(can_deny_reading))
+{
+	make_tree(SANDBOX_PATH "/src");
+	assert_success(chmod(SANDBOX_PATH "/src/dir1/file1", 0000));
+	assert_success(chmod(SANDBOX_PATH "/src/dir5/file7", 0000));
+
+	io_args_t args = {
+		.arg1.src = SANDBOX_PATH "/src",
+		.arg2.dst = SANDBOX_PATH "/dst",
+		.nthreads = 4,
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	assert_failure(ior_cp(&args));
+	assert_true(args.result.errors.error_count >= 1);
+	assert_true(args.result.errors.error_count <= 2);
+
+	ioe_errlst_free(&args.result.errors);
+
+	assert_success(chmod(SANDBOX_PATH "/src/dir1/file1", 0600));
+	assert_success(chmod(SANDBOX_PATH "/src/dir5/file7", 0600));
+	delete_tree(SANDBOX_PATH "/src");
+	delete_tree(SANDBOX_PATH "/dst");
+}
+
+/* Creates tree of directories with files in them.  The last directory is
+ * nested in the first one and has custom permissions. */
+static void
+make_tree(const char root[])
+{
+	int i, j;
+	char path[PATH_MAX + 1];
+
+	create_empty_dir(root);
+	for(i = 0; i < NDIRS; ++i)
+	{
+		snprintf(path, sizeof(path),
+				(i == NDIRS - 1) ? "%s/dir0/dir%d" : "%s/dir%d", root, i);
+		create_empty_dir(path);
+
+		for(j = 0; j < NFILES; ++j)
+		{
+			snprintf(path, sizeof(path),
+					(i == NDIRS - 1) ? "%s/dir0/dir%d/file%d" : "%s/dir%d/file%d", root,
+					i, j);
+			FILE *const f = fopen(path, "w");
+			assert_non_null(f);
+			fputs(path, f);
+			fclose(f);
+		}
+	}
+
+	snprintf(path, sizeof(path), "%s/dir0/dir%d", root, NDIRS - 1);
+	assert_success(chmod(path, 0750));
+}
+
+/* Checks that tree created by make_tree() is at the root optionally checking
+ * permissions of directories.  Returns non-zero if so, otherwise zero is
+ * returned. */
+static int
+tree_is_copied(const char root[], int check_modes)
+{
+	int i, j;
+	char path[PATH_MAX + 1];
+	struct stat st;
+
+	for(i = 0; i < NDIRS; ++i)
+	{
+		for(j = 0; j < NFILES; ++j)
+		{
+			snprintf(path, sizeof(path),
+					(i == NDIRS - 1) ? "%s/dir0/dir%d/file%d" : "%s/dir%d/file%d", root,
+					i, j);
+			if(!path_exists(path, NODEREF))
+			{
+				return 0;
+			}
+		}
+	}
+
+	snprintf(path, sizeof(path), "%s/dir0/dir%d", root, NDIRS - 1);
+	return os_stat(path, &st) == 0 &&
+	       (!check_modes || (st.st_mode & 0777) == 0750);
+}
+
+/* Checks whether reading of a file can be denied (it can't be for root).
+ * Returns non-zero if so, otherwise zero is returned. */
+static int
+can_deny_reading(void)
+{
+	int denied;
+
+	create_empty_file(SANDBOX_PATH "/probe");
+	(void)chmod(SANDBOX_PATH "/probe", 0000);
+	denied = (access(SANDBOX_PATH "/probe", R_OK) != 0);
+	(void)chmod(SANDBOX_PATH "/probe", 0600);
+	delete_file(SANDBOX_PATH "/probe");
+
+	return denied;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -1,8 +1,16 @@
 #include <stic.h>
 
+#include <sys/types.h> /* pid_t */
+#ifndef _WIN32
+#include <sys/wait.h> /* waitpid() */
+#endif
+
+#include <stdio.h> /* EOF FILE fclose() fgetc() */
+
 #include "../../src/cfg/config.h"
 #include "../../src/utils/cancellation.h"
 #include "../../src/utils/str.h"
+#include "../../src/utils/utils.h"
 #include "../../src/ui/ui.h"
 #include "../../src/background.h"
 
@@ -29,5 +37,31 @@ TEST(background_redirects_streams_properly, IF(not_windows))
 	update_string(&cfg.shell_cmd_flag, NULL);
 }
 
+TEST(killing_group_of_command_stops_its_output, IF(not_windows))
+{
+	update_string(&cfg.shell, "/bin/sh");
+	update_string(&cfg.shell_cmd_flag, "-c");
+
+	pid_t pgid;
+	FILE *const fp = read_cmd_output_group("echo a; sleep 10; echo b", 0,
+			&pgid);
+	assert_non_null(fp);
+	assert_true(pgid > 0);
+
+	assert_int_equal('a', fgetc(fp));
+	assert_int_equal('\n', fgetc(fp));
+
+	kill_process_group(pgid);
+	assert_int_equal(EOF, fgetc(fp));
+
+	fclose(fp);
+#ifndef _WIN32
+	assert_int_equal(pgid, waitpid(pgid, NULL, 0));
+#endif
+
+	update_string(&cfg.shell, NULL);
+	update_string(&cfg.shell_cmd_flag, NULL);
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,280 @@
+#include <stic.h>
+
+#include <unistd.h> /* rmdir() */
+
+#include <stdint.h> /* uint64_t */
+#include <stdio.h> /* FILE fclose() fopen() fputc() remove() snprintf() */
+#include <string.h> /* strcpy() */
+
+#include "../../src/cfg/config.h"
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/os.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/fcache.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/str.h"
+#include "../../src/compare.h"
+#include "../../src/filelist.h"
+
+#include "utils.h"
+
+static void make_big_file(const char path[], char last);
+
+SETUP()
+{
+	curr_view = &lwin;
+	other_view = &rwin;
+
+	view_setup(&lwin);
+	view_setup(&rwin);
+
+	opt_handlers_setup();
+
+	columns_setup_column(SK_BY_NAME);
+	columns_setup_column(SK_BY_SIZE);
+}
+
+TEARDOWN()
+{
+	columns_teardown();
+
+	view_teardown(&lwin);
+	view_teardown(&rwin);
+
+	opt_handlers_teardown();
+}
+
+TEST(files_are_hashed_by_several_threads)
+{
+	enum { NFILES = 100, NGROUPS = 10 };
+
+	int i;
+	char path[PATH_MAX + 1];
+
+	const int io_threads = cfg.io_threads;
+	cfg.io_threads = 4;
+
+	for(i = 0; i < NFILES; ++i)
+	{
+		snprintf(path, sizeof(path), "%s/file%03d", SANDBOX_PATH, i);
+		FILE *const f = fopen(path, "w");
+		assert_non_null(f);
+		fputc('0' + i%NGROUPS, f);
+		fclose(f);
+	}
+
+	strcpy(lwin.curr_dir, SANDBOX_PATH);
+	compare_one_pane(&lwin, CT_CONTENTS, LT_DUPS, 0);
+
+	assert_int_equal(CV_COMPARE, lwin.custom.type);
+	assert_int_equal(NFILES, lwin.list_rows);
+	for(i = 0; i < NFILES; ++i)
+	{
+		assert_int_equal(1 + i/(NFILES/NGROUPS), lwin.dir_entry[i].id);
+	}
+
+	for(i = 0; i < NFILES; ++i)
+	{
+		snprintf(path, sizeof(path), "%s/file%03d", SANDBOX_PATH, i);
+		assert_success(remove(path));
+	}
+
+	cfg.io_threads = io_threads;
+}
+
+TEST(files_differing_after_hashed_prefix_are_told_apart)
+{
+	make_big_file(SANDBOX_PATH "/big-1", 'a');
+	make_big_file(SANDBOX_PATH "/big-2", 'b');
+	make_big_file(SANDBOX_PATH "/big-3", 'a');
+
+	strcpy(lwin.curr_dir, SANDBOX_PATH);
+	compare_one_pane(&lwin, CT_CONTENTS, LT_ALL, 0);
+
+	assert_int_equal(CV_COMPARE, lwin.custom.type);
+	assert_int_equal(3, lwin.list_rows);
+	assert_string_equal("big-1", lwin.dir_entry[0].name);
+	assert_int_equal(1, lwin.dir_entry[0].id);
+	assert_string_equal("big-3", lwin.dir_entry[1].name);
+	assert_int_equal(1, lwin.dir_entry[1].id);
+	assert_string_equal("big-2", lwin.dir_entry[2].name);
+	assert_int_equal(2, lwin.dir_entry[2].id);
+
+	assert_success(remove(SANDBOX_PATH "/big-1"));
+	assert_success(remove(SANDBOX_PATH "/big-2"));
+	assert_success(remove(SANDBOX_PATH "/big-3"));
+}
+
+TEST(collisions_are_resolved_by_several_threads)
+{
+	enum { NFILES = 9, NGROUPS = 3 };
+
+	int i;
+	char path[PATH_MAX + 1];
+
+	const int io_threads = cfg.io_threads;
+	cfg.io_threads = 4;
+
+	for(i = 0; i < NFILES; ++i)
+	{
+		snprintf(path, sizeof(path), "%s/big-%d", SANDBOX_PATH, i);
+		make_big_file(path, 'a' + i%NGROUPS);
+	}
+
+	strcpy(lwin.curr_dir, SANDBOX_PATH);
+	compare_one_pane(&lwin, CT_CONTENTS, LT_ALL, 0);
+
+	assert_int_equal(CV_COMPARE, lwin.custom.type);
+	assert_int_equal(NFILES, lwin.list_rows);
+	for(i = 0; i < NFILES; ++i)
+	{
+		const int n = lwin.dir_entry[i].name[4] - '0';
+		assert_int_equal(1 + n%NGROUPS, lwin.dir_entry[i].id);
+		assert_int_equal(1 + i/(NFILES/NGROUPS), lwin.dir_entry[i].id);
+	}
+
+	for(i = 0; i < NFILES; ++i)
+	{
+		snprintf(path, sizeof(path), "%s/big-%d", SANDBOX_PATH, i);
+		assert_success(remove(path));
+	}
+
+	cfg.io_threads = io_threads;
+}
+
+TEST(files_of_unique_sizes_differ)
+{
+	create_file(SANDBOX_PATH "/empty");
+	make_big_file(SANDBOX_PATH "/big", 'a');
+
+	strcpy(lwin.curr_dir, SANDBOX_PATH);
+	compare_one_pane(&lwin, CT_CONTENTS, LT_ALL, 0);
+
+	assert_int_equal(CV_COMPARE, lwin.custom.type);
+	assert_int_equal(2, lwin.list_rows);
+	assert_false(lwin.dir_entry[0].id == lwin.dir_entry[1].id);
+
+	assert_success(remove(SANDBOX_PATH "/empty"));
+	assert_success(remove(SANDBOX_PATH "/big"));
+}
+
+TEST(sizes_are_matched_across_panes)
+{
+	copy_file(TEST_DATA_PATH "/read/dos-eof", SANDBOX_PATH "/copy");
+	make_big_file(SANDBOX_PATH "/big", 'a');
+
+	strcpy(lwin.curr_dir, SANDBOX_PATH);
+	strcpy(rwin.curr_dir, TEST_DATA_PATH "/read");
+	(void)compare_two_panes(CT_CONTENTS, LT_DUPS, 0, 0);
+
+	assert_int_equal(CV_DIFF, lwin.custom.type);
+	assert_int_equal(CV_DIFF, rwin.custom.type);
+	assert_int_equal(1, lwin.list_rows);
+	assert_int_equal(1, rwin.list_rows);
+	assert_string_equal("copy", lwin.dir_entry[0].name);
+	assert_string_equal("dos-eof", rwin.dir_entry[0].name);
+
+	assert_success(remove(SANDBOX_PATH "/copy"));
+	assert_success(remove(SANDBOX_PATH "/big"));
+}
+
+TEST(cached_fingerprints_are_used)
+{
+	fcache_key_t key;
+
+	copy_str(cfg.fingerprints_file, sizeof(cfg.fingerprints_file),
+			SANDBOX_PATH "/fingerprints");
+
+	assert_success(os_mkdir(SANDBOX_PATH "/dir", 0700));
+	make_big_file(SANDBOX_PATH "/dir/big-1", 'a');
+	make_big_file(SANDBOX_PATH "/dir/big-2", 'a');
+
+	strcpy(lwin.curr_dir, SANDBOX_PATH "/dir");
+	compare_one_pane(&lwin, CT_CONTENTS, LT_ALL, 0);
+	assert_int_equal(2, lwin.list_rows);
+	assert_int_equal(lwin.dir_entry[0].id, lwin.dir_entry[1].id);
+	assert_true(path_exists(SANDBOX_PATH "/fingerprints", NODEREF));
+	compare_save_cache();
+
+	/* Poison the cache to make sure that it's consulted. */
+	fcache_t *const cache = fcache_load(SANDBOX_PATH "/fingerprints", 10);
+	assert_success(fcache_key(SANDBOX_PATH "/dir/big-1", &key));
+	fcache_put(cache, &key, 0);
+	assert_success(fcache_save(cache));
+	fcache_free(cache);
+
+	compare_one_pane(&lwin, CT_CONTENTS, LT_ALL, 0);
+	assert_int_equal(2, lwin.list_rows);
+	assert_false(lwin.dir_entry[0].id == lwin.dir_entry[1].id);
+
+	compare_save_cache();
+	cfg.fingerprints_file[0] = '\0';
+
+	assert_success(remove(SANDBOX_PATH "/dir/big-1"));
+	assert_success(remove(SANDBOX_PATH "/dir/big-2"));
+	assert_success(rmdir(SANDBOX_PATH "/dir"));
+	assert_success(remove(SANDBOX_PATH "/fingerprints"));
+}
+
+TEST(cached_results_of_comparisons_are_used)
+{
+	fcache_key_t a_key, b_key, key;
+	uint64_t identical;
+
+	copy_str(cfg.fingerprints_file, sizeof(cfg.fingerprints_file),
+			SANDBOX_PATH "/fingerprints");
+
+	assert_success(os_mkdir(SANDBOX_PATH "/dir", 0700));
+	make_big_file(SANDBOX_PATH "/dir/big-1", 'a');
+	make_big_file(SANDBOX_PATH "/dir/big-2", 'a');
+
+	strcpy(lwin.curr_dir, SANDBOX_PATH "/dir");
+	compare_one_pane(&lwin, CT_CONTENTS, LT_ALL, 0);
+	assert_int_equal(2, lwin.list_rows);
+	assert_int_equal(lwin.dir_entry[0].id, lwin.dir_entry[1].id);
+	compare_save_cache();
+
+	/* Files with matching hashes were compared and the result was stored. */
+	fcache_t *const cache = fcache_load(SANDBOX_PATH "/fingerprints", 10);
+	assert_success(fcache_key(SANDBOX_PATH "/dir/big-1", &a_key));
+	assert_success(fcache_key(SANDBOX_PATH "/dir/big-2", &b_key));
+	fcache_pair_key(&b_key, &a_key, &key);
+	assert_true(fcache_get(cache, &key, &identical));
+	assert_true(identical != 0U);
+
+	/* Poison the result to make sure that it's consulted. */
+	fcache_put(cache, &key, 0U);
+	assert_success(fcache_save(cache));
+	fcache_free(cache);
+
+	compare_one_pane(&lwin, CT_CONTENTS, LT_ALL, 0);
+	assert_int_equal(2, lwin.list_rows);
+	assert_false(lwin.dir_entry[0].id == lwin.dir_entry[1].id);
+
+	compare_save_cache();
+	cfg.fingerprints_file[0] = '\0';
+
+	assert_success(remove(SANDBOX_PATH "/dir/big-1"));
+	assert_success(remove(SANDBOX_PATH "/dir/big-2"));
+	assert_success(rmdir(SANDBOX_PATH "/dir"));
+	assert_success(remove(SANDBOX_PATH "/fingerprints"));
+}
+
+/* Creates a file which is bigger than hashed prefix and ends with the
+ * specified character. */
+static void
+make_big_file(const char path[], char last)
+{
+	int i;
+	FILE *const f = fopen(path, "wb");
+	assert_non_null(f);
+	for(i = 0; i < 512*1024; ++i)
+	{
+		fputc('x', f);
+	}
+	fputc(last, f);
+	fclose(f);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -1,16 +1,25 @@
 #include <stic.h>
 
+#include <unistd.h> /* rmdir() symlink() */
+
 #include <stddef.h> /* NULL */
+#include <stdio.h> /* remove() */
 #include <string.h> /* memset() strcpy() */
 #include <time.h> /* time() */
 
 #include "../../src/cfg/config.h"
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/os.h"
 #include "../../src/ui/ui.h"
+#include "../../src/utils/fs.h"
 #include "../../src/utils/str.h"
 #include "../../src/status.h"
 
 #include "utils.h"
 
+static void enable_dstore(void);
+static void disable_dstore(void);
+
 SETUP()
 {
 	update_string(&cfg.shell, "");
@@ -69,5 +78,219 @@ TEST(outdated_data_is_detected)
 	assert_false(nitems.is_valid);
 }
 
+TEST(entry_is_found_by_its_directory)
+{
+	dcache_result_t size, nitems;
+
+	dir_entry_t entry = {
+		.name = "read", .origin = TEST_DATA_PATH, .type = FT_DIR, .mtime = 0
+	};
+
+	dcache_set_at(TEST_DATA_PATH "/read", 10, 11);
+
+	dcache_get_of(&entry, &size, &nitems);
+	assert_ulong_equal(10, size.value);
+	assert_ulong_equal(11, nitems.value);
+	assert_true(size.is_valid);
+	assert_true(nitems.is_valid);
+}
+
+TEST(entry_in_symlinked_directory_is_found, IF(not_windows))
+{
+	dcache_result_t size, nitems;
+
+	dir_entry_t entry = {
+		.name = "read", .origin = SANDBOX_PATH "/link", .type = FT_DIR, .mtime = 0
+	};
+
+	char cwd[PATH_MAX + 1], test_data[PATH_MAX + 1];
+	assert_non_null(get_cwd(cwd, sizeof(cwd)));
+	make_abs_path(test_data, sizeof(test_data), TEST_DATA_PATH, "", cwd);
+	assert_success(symlink(test_data, SANDBOX_PATH "/link"));
+
+	dcache_set_at(TEST_DATA_PATH "/read", 10, 11);
+
+	dcache_get_of(&entry, &size, &nitems);
+	assert_ulong_equal(10, size.value);
+	assert_ulong_equal(11, nitems.value);
+
+	assert_success(remove(SANDBOX_PATH "/link"));
+}
+
+TEST(symlinked_entry_is_resolved, IF(not_windows))
+{
+	dcache_result_t size, nitems;
+
+	dir_entry_t entry = {
+		.name = "link", .origin = SANDBOX_PATH, .type = FT_LINK, .mtime = 0
+	};
+
+	char cwd[PATH_MAX + 1], read_dir[PATH_MAX + 1];
+	assert_non_null(get_cwd(cwd, sizeof(cwd)));
+	make_abs_path(read_dir, sizeof(read_dir), TEST_DATA_PATH, "read", cwd);
+	assert_success(symlink(read_dir, SANDBOX_PATH "/link"));
+
+	dcache_set_at(TEST_DATA_PATH "/read", 10, 11);
+
+	dcache_get_of(&entry, &size, &nitems);
+	assert_ulong_equal(10, size.value);
+	assert_ulong_equal(11, nitems.value);
+
+	assert_success(remove(SANDBOX_PATH "/link"));
+}
+
+TEST(stored_information_survives_reset)
+{
+	uint64_t size, nitems;
+
+	enable_dstore();
+
+	dcache_set_at(SANDBOX_PATH "/dir", 10, DCACHE_UNKNOWN);
+	dcache_set_at(SANDBOX_PATH "/dir", DCACHE_UNKNOWN, 11);
+	assert_success(stats_reset(&cfg));
+
+	dcache_get_at(SANDBOX_PATH "/dir", &size, &nitems);
+	assert_ulong_equal(10, size);
+	assert_ulong_equal(11, nitems);
+
+	disable_dstore();
+}
+
+TEST(stored_information_is_valid)
+{
+	dcache_result_t size, nitems;
+
+	dir_entry_t entry = {
+		.name = "dir", .origin = SANDBOX_PATH, .type = FT_DIR, .mtime = 0
+	};
+
+	enable_dstore();
+
+	dcache_set_at(SANDBOX_PATH "/dir", 10, 11);
+	assert_success(stats_reset(&cfg));
+
+	dcache_get_of(&entry, &size, &nitems);
+	assert_ulong_equal(10, size.value);
+	assert_ulong_equal(11, nitems.value);
+	assert_true(size.is_valid);
+	assert_true(nitems.is_valid);
+
+	disable_dstore();
+}
+
+TEST(changed_directory_does_not_match_stored_information)
+{
+	uint64_t size, nitems;
+
+	enable_dstore();
+
+	dcache_set_at(SANDBOX_PATH "/dir", 10, 11);
+	assert_success(stats_reset(&cfg));
+
+	create_file(SANDBOX_PATH "/dir/file");
+
+	dcache_get_at(SANDBOX_PATH "/dir", &size, &nitems);
+	assert_ulong_equal(DCACHE_UNKNOWN, size);
+	assert_ulong_equal(DCACHE_UNKNOWN, nitems);
+
+	assert_success(remove(SANDBOX_PATH "/dir/file"));
+	disable_dstore();
+}
+
+TEST(stored_sizes_of_parents_are_updated)
+{
+	uint64_t size;
+
+	enable_dstore();
+	assert_success(os_mkdir(SANDBOX_PATH "/dir/sub", 0700));
+
+	dcache_set_at(SANDBOX_PATH "/dir", 10, DCACHE_UNKNOWN);
+	dcache_set_at(SANDBOX_PATH "/dir/sub", 5, DCACHE_UNKNOWN);
+	dcache_update_parent_sizes(SANDBOX_PATH "/dir/sub", 3);
+	assert_success(stats_reset(&cfg));
+
+	dcache_get_at(SANDBOX_PATH "/dir", &size, NULL);
+	assert_ulong_equal(13, size);
+
+	assert_success(rmdir(SANDBOX_PATH "/dir/sub"));
+	disable_dstore();
+}
+
+TEST(sizes_are_stored_in_batches_preserving_nitems)
+{
+	uint64_t size, nitems;
+	char real_path[PATH_MAX + 1];
+
+	enable_dstore();
+	assert_non_null(os_realpath(SANDBOX_PATH "/dir", real_path));
+
+	dcache_set_at(SANDBOX_PATH "/dir", DCACHE_UNKNOWN, 11);
+	dcache_size_t sizes[] = { { .real_path = real_path, .size = 10 } };
+	dcache_set_sizes(sizes, 1);
+
+	dcache_get_size_real(real_path, &size);
+	assert_ulong_equal(10, size);
+
+	assert_success(stats_reset(&cfg));
+
+	dcache_get_at(SANDBOX_PATH "/dir", &size, &nitems);
+	assert_ulong_equal(10, size);
+	assert_ulong_equal(11, nitems);
+
+	disable_dstore();
+}
+
+TEST(size_by_real_path_is_not_looked_up_in_storage)
+{
+	uint64_t size;
+	char real_path[PATH_MAX + 1];
+
+	enable_dstore();
+	assert_non_null(os_realpath(SANDBOX_PATH "/dir", real_path));
+
+	dcache_set_at(SANDBOX_PATH "/dir", 10, DCACHE_UNKNOWN);
+	assert_success(stats_reset(&cfg));
+
+	dcache_get_size_real(real_path, &size);
+	assert_ulong_equal(DCACHE_UNKNOWN, size);
+
+	dcache_get_at(SANDBOX_PATH "/dir", &size, NULL);
+	assert_ulong_equal(10, size);
+
+	disable_dstore();
+}
+
+TEST(nothing_is_stored_unless_enabled)
+{
+	uint64_t size;
+
+	dcache_set_at(TEST_DATA_PATH, 10, 11);
+	assert_success(stats_reset(&cfg));
+
+	dcache_get_at(TEST_DATA_PATH, &size, NULL);
+	assert_ulong_equal(DCACHE_UNKNOWN, size);
+}
+
+/* Turns on persistent storage of dcache and creates directory for tests. */
+static void
+enable_dstore(void)
+{
+	cfg.vifm_info |= VINFO_DIRSIZES;
+	copy_str(cfg.dirsizes_file, sizeof(cfg.dirsizes_file),
+			SANDBOX_PATH "/dirsizes");
+	assert_success(os_mkdir(SANDBOX_PATH "/dir", 0700));
+}
+
+/* Reverts effects of enable_dstore(). */
+static void
+disable_dstore(void)
+{
+	assert_success(stats_reset(&cfg));
+	cfg.vifm_info &= ~VINFO_DIRSIZES;
+	cfg.dirsizes_file[0] = '\0';
+	assert_success(rmdir(SANDBOX_PATH "/dir"));
+	assert_success(remove(SANDBOX_PATH "/dirsizes"));
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -126,6 +126,52 @@ TEST(custom_view_replaces_custom_view_fine)
 	assert_true(flist_custom_active(&lwin));
 }
 
+TEST(deferred_entries_are_filled_on_finish)
+{
+	opt_handlers_setup();
+	cfg.io_threads = 4;
+
+	flist_custom_start(&lwin, "test");
+	flist_custom_add_deferred(&lwin, TEST_DATA_PATH "/existing-files/a");
+	flist_custom_add_deferred(&lwin, TEST_DATA_PATH "/existing-files/b");
+	flist_custom_add_deferred(&lwin, TEST_DATA_PATH "/existing-files/b");
+	flist_custom_add_deferred(&lwin, TEST_DATA_PATH "/existing-files/nope");
+	flist_custom_add_deferred(&lwin, TEST_DATA_PATH "/existing-files");
+	assert_true(flist_custom_finish(&lwin, CV_VERY, 0) == 0);
+
+	assert_int_equal(3, lwin.list_rows);
+	assert_string_equal("a", lwin.dir_entry[0].name);
+	assert_int_equal(FT_REG, lwin.dir_entry[0].type);
+	assert_string_equal("b", lwin.dir_entry[1].name);
+	assert_int_equal(FT_REG, lwin.dir_entry[1].type);
+	assert_string_equal("existing-files", lwin.dir_entry[2].name);
+	assert_int_equal(FT_DIR, lwin.dir_entry[2].type);
+
+	cfg.io_threads = 0;
+	opt_handlers_teardown();
+}
+
+TEST(deferred_entries_are_mixed_with_regular_ones)
+{
+	opt_handlers_setup();
+
+	flist_custom_start(&lwin, "test");
+	flist_custom_add_deferred(&lwin, TEST_DATA_PATH "/existing-files/nope");
+	flist_custom_add(&lwin, TEST_DATA_PATH "/existing-files/a");
+	flist_custom_add_deferred(&lwin, TEST_DATA_PATH "/existing-files/b");
+	flist_custom_add_separator(&lwin, 1);
+	flist_custom_add_deferred(&lwin, TEST_DATA_PATH "/existing-files/c");
+	assert_true(flist_custom_finish(&lwin, CV_VERY, 0) == 0);
+
+	assert_int_equal(4, lwin.list_rows);
+	assert_string_equal("a", lwin.dir_entry[0].name);
+	assert_string_equal("b", lwin.dir_entry[1].name);
+	assert_string_equal("", lwin.dir_entry[2].name);
+	assert_string_equal("c", lwin.dir_entry[3].name);
+
+	opt_handlers_teardown();
+}
+
 TEST(reload_does_not_remove_broken_symlinks, IF(not_windows))
 {
 	char test_file[PATH_MAX + 1];
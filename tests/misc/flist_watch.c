@@ -0,0 +1,308 @@
+#include <stic.h>
+
+#include <unistd.h> /* rmdir() */
+
+#include <stdio.h> /* FILE fclose() fopen() fputs() remove() rename() */
+#include <string.h> /* strcpy() */
+
+#include "../../src/cfg/config.h"
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/os.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/dynarray.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/path.h"
+#include "../../src/utils/str.h"
+#include "../../src/filelist.h"
+
+#include "utils.h"
+
+static void check_patched(void);
+static void append_to(const char path[], const char text[]);
+static int using_inotify(void);
+
+SETUP()
+{
+	char cwd[PATH_MAX + 1];
+
+	view_setup(&lwin);
+	curr_view = &lwin;
+	other_view = &rwin;
+
+	update_string(&cfg.slow_fs_list, "");
+
+	assert_non_null(get_cwd(cwd, sizeof(cwd)));
+	make_abs_path(lwin.curr_dir, sizeof(lwin.curr_dir), SANDBOX_PATH, "", cwd);
+
+	create_file(SANDBOX_PATH "/a");
+	create_file(SANDBOX_PATH "/c");
+
+	populate_dir_list(&lwin, 0);
+	assert_int_equal(2, lwin.list_rows);
+	(void)ui_view_query_scheduled_event(&lwin);
+}
+
+TEARDOWN()
+{
+	view_teardown(&lwin);
+
+	update_string(&cfg.slow_fs_list, NULL);
+
+	(void)remove(SANDBOX_PATH "/a");
+	(void)remove(SANDBOX_PATH "/b");
+	(void)remove(SANDBOX_PATH "/c");
+	(void)remove(SANDBOX_PATH "/d");
+	(void)remove(SANDBOX_PATH "/.hidden");
+}
+
+TEST(created_file_is_inserted_in_sorted_position, IF(using_inotify))
+{
+	lwin.list_pos = 1;
+
+	create_file(SANDBOX_PATH "/b");
+	check_patched();
+
+	assert_int_equal(3, lwin.list_rows);
+	assert_string_equal("a", lwin.dir_entry[0].name);
+	assert_string_equal("b", lwin.dir_entry[1].name);
+	assert_string_equal("c", lwin.dir_entry[2].name);
+	assert_int_equal(2, lwin.list_pos);
+}
+
+TEST(created_file_is_inserted_by_precomputed_key, IF(using_inotify))
+{
+	lwin.sort[0] = SK_BY_INAME;
+
+	create_file(SANDBOX_PATH "/B");
+	check_patched();
+
+	assert_int_equal(3, lwin.list_rows);
+	assert_string_equal("a", lwin.dir_entry[0].name);
+	assert_string_equal("B", lwin.dir_entry[1].name);
+	assert_string_equal("c", lwin.dir_entry[2].name);
+
+	assert_success(remove(SANDBOX_PATH "/B"));
+}
+
+TEST(deleted_file_is_removed, IF(using_inotify))
+{
+	lwin.list_pos = 1;
+
+	assert_success(remove(SANDBOX_PATH "/a"));
+	check_patched();
+
+	assert_int_equal(1, lwin.list_rows);
+	assert_string_equal("c", lwin.dir_entry[0].name);
+	assert_int_equal(0, lwin.list_pos);
+}
+
+TEST(renamed_file_is_moved, IF(using_inotify))
+{
+	assert_success(rename(SANDBOX_PATH "/a", SANDBOX_PATH "/d"));
+	check_patched();
+
+	assert_int_equal(2, lwin.list_rows);
+	assert_string_equal("c", lwin.dir_entry[0].name);
+	assert_string_equal("d", lwin.dir_entry[1].name);
+}
+
+TEST(modified_file_is_resorted_with_its_state, IF(using_inotify))
+{
+	lwin.sort[0] = SK_BY_SIZE;
+	lwin.list_pos = 0;
+	lwin.dir_entry[0].selected = 1;
+	lwin.selected_files = 1;
+
+	append_to(SANDBOX_PATH "/a", "text");
+	check_patched();
+
+	assert_int_equal(2, lwin.list_rows);
+	assert_string_equal("c", lwin.dir_entry[0].name);
+	assert_string_equal("a", lwin.dir_entry[1].name);
+	assert_int_equal(4, lwin.dir_entry[1].size);
+	assert_true(lwin.dir_entry[1].selected);
+	assert_int_equal(1, lwin.selected_files);
+	assert_int_equal(1, lwin.list_pos);
+}
+
+TEST(repeated_patches_do_not_grow_the_list, IF(using_inotify))
+{
+	int i;
+	size_t capacity;
+
+	append_to(SANDBOX_PATH "/a", "t");
+	check_patched();
+	capacity = dynarray_capacity(lwin.dir_entry);
+
+	for(i = 0; i < 32; ++i)
+	{
+		append_to(SANDBOX_PATH "/a", "t");
+		check_patched();
+	}
+
+	assert_int_equal(2, lwin.list_rows);
+	assert_int_equal(capacity, dynarray_capacity(lwin.dir_entry));
+}
+
+TEST(filtered_files_are_counted, IF(using_inotify))
+{
+	lwin.hide_dot = 1;
+
+	create_file(SANDBOX_PATH "/.hidden");
+	check_patched();
+	assert_int_equal(2, lwin.list_rows);
+	assert_int_equal(1, lwin.filtered);
+
+	assert_success(remove(SANDBOX_PATH "/.hidden"));
+	check_patched();
+	assert_int_equal(2, lwin.list_rows);
+	assert_int_equal(0, lwin.filtered);
+}
+
+TEST(selected_file_is_unselected_on_removal, IF(using_inotify))
+{
+	lwin.dir_entry[1].selected = 1;
+	lwin.selected_files = 1;
+
+	assert_success(remove(SANDBOX_PATH "/c"));
+	check_patched();
+
+	assert_int_equal(1, lwin.list_rows);
+	assert_int_equal(0, lwin.selected_files);
+}
+
+TEST(emptied_list_is_reloaded, IF(using_inotify))
+{
+	assert_success(remove(SANDBOX_PATH "/a"));
+	assert_success(remove(SANDBOX_PATH "/c"));
+
+	check_if_filelist_has_changed(&lwin);
+	assert_int_equal(UUE_RELOAD, ui_view_query_scheduled_event(&lwin));
+
+	assert_int_equal(1, lwin.list_rows);
+	assert_string_equal("..", lwin.dir_entry[0].name);
+	assert_int_equal(0, lwin.list_pos);
+}
+
+TEST(changes_in_nested_directories_of_tree_are_detected, IF(using_inotify))
+{
+	char path[PATH_MAX + 1];
+
+	assert_success(os_mkdir(SANDBOX_PATH "/dir", 0700));
+	assert_success(os_mkdir(SANDBOX_PATH "/dir/sub", 0700));
+
+	snprintf(path, sizeof(path), "%s", lwin.curr_dir);
+	assert_success(flist_load_tree(&lwin, path));
+	(void)ui_view_query_scheduled_event(&lwin);
+	assert_true(lwin.watch_is_custom);
+
+	check_if_filelist_has_changed(&lwin);
+	assert_int_equal(UUE_NONE, ui_view_query_scheduled_event(&lwin));
+
+	create_file(SANDBOX_PATH "/dir/sub/file");
+	check_if_filelist_has_changed(&lwin);
+	assert_int_equal(UUE_RELOAD, ui_view_query_scheduled_event(&lwin));
+
+	assert_success(remove(SANDBOX_PATH "/dir/sub/file"));
+	assert_success(rmdir(SANDBOX_PATH "/dir/sub"));
+	assert_success(rmdir(SANDBOX_PATH "/dir"));
+}
+
+TEST(custom_view_tracks_only_its_files, IF(using_inotify))
+{
+	assert_success(os_mkdir(SANDBOX_PATH "/dir", 0700));
+	create_file(SANDBOX_PATH "/dir/listed");
+
+	flist_custom_start(&lwin, "test");
+	flist_custom_add(&lwin, SANDBOX_PATH "/dir/listed");
+	flist_custom_add(&lwin, SANDBOX_PATH "/a");
+	assert_success(flist_custom_finish(&lwin, CV_REGULAR, 0));
+	(void)ui_view_query_scheduled_event(&lwin);
+
+	create_file(SANDBOX_PATH "/dir/unrelated");
+	check_if_filelist_has_changed(&lwin);
+	assert_int_equal(UUE_NONE, ui_view_query_scheduled_event(&lwin));
+
+	append_to(SANDBOX_PATH "/dir/listed", "text");
+	check_if_filelist_has_changed(&lwin);
+	assert_int_equal(UUE_RELOAD, ui_view_query_scheduled_event(&lwin));
+
+	assert_success(remove(SANDBOX_PATH "/dir/unrelated"));
+	assert_success(remove(SANDBOX_PATH "/dir/listed"));
+	assert_success(rmdir(SANDBOX_PATH "/dir"));
+}
+
+TEST(leaving_custom_view_restores_plain_watch, IF(using_inotify))
+{
+	char path[PATH_MAX + 1];
+
+	flist_custom_start(&lwin, "test");
+	flist_custom_add(&lwin, SANDBOX_PATH "/a");
+	assert_success(flist_custom_finish(&lwin, CV_REGULAR, 0));
+	assert_true(lwin.watch_is_custom);
+
+	snprintf(path, sizeof(path), "%s", lwin.custom.orig_dir);
+	assert_true(change_directory(&lwin, path) >= 0);
+	populate_dir_list(&lwin, 0);
+	assert_false(lwin.watch_is_custom);
+}
+
+TEST(plain_view_can_be_waited_on, IF(using_inotify))
+{
+	int fds[FLIST_MAX_WATCH_FDS];
+	assert_int_equal(1, flist_get_watch_fds(&lwin, fds));
+}
+
+TEST(view_on_slow_fs_is_not_waited_on)
+{
+	int fds[FLIST_MAX_WATCH_FDS];
+	lwin.on_slow_fs = 1;
+	assert_int_equal(0, flist_get_watch_fds(&lwin, fds));
+	lwin.on_slow_fs = 0;
+}
+
+TEST(tree_view_can_be_waited_on, IF(using_inotify))
+{
+	int fds[FLIST_MAX_WATCH_FDS];
+	char path[PATH_MAX + 1];
+
+	assert_success(os_mkdir(SANDBOX_PATH "/dir", 0700));
+
+	snprintf(path, sizeof(path), "%s", lwin.curr_dir);
+	assert_success(flist_load_tree(&lwin, path));
+	assert_int_equal(1, flist_get_watch_fds(&lwin, fds));
+
+	assert_success(rmdir(SANDBOX_PATH "/dir"));
+}
+
+/* Checks for changes and verifies that list was updated without scheduling a
+ * reload. */
+static void
+check_patched(void)
+{
+	check_if_filelist_has_changed(&lwin);
+	assert_int_equal(UUE_REDRAW, ui_view_query_scheduled_event(&lwin));
+}
+
+/* Appends text to a file. */
+static void
+append_to(const char path[], const char text[])
+{
+	FILE *const f = fopen(path, "a");
+	assert_non_null(f);
+	fputs(text, f);
+	fclose(f);
+}
+
+static int
+using_inotify(void)
+{
+#ifdef HAVE_INOTIFY
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
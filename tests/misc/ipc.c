@@ -2,6 +2,8 @@
 
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <poll.h> /* POLLIN poll() pollfd */
 #endif
 
 #include <stddef.h> /* NULL */
@@ -23,6 +25,7 @@ static char * test_ipc_eval_error(const char expr[]);
 static void other_instance(bg_op_t *bg_op, void *arg);
 static int enabled_and_not_in_wine(void);
 static int enabled_and_not_windows(void);
+static int is_readable(int fd);
 
 static const char NAME[] = "vifm-test";
 static int nmessages;
@@ -195,6 +198,53 @@ TEST(checking_ipc_from_ipc_handler_is_noop, IF(enabled_and_not_windows))
 	ipc_free(ipc2);
 }
 
+TEST(descriptor_signals_incoming_messages, IF(enabled_and_not_windows))
+{
+	char msg[] = "test message";
+	char *data[] = { msg, NULL };
+
+	ipc_t *const ipc1 = ipc_init(NAME, &test_ipc_args, &test_ipc_eval);
+	ipc_t *const ipc2 = ipc_init(NAME, &test_ipc_args2, &test_ipc_eval);
+
+	assert_true(ipc_get_fd(ipc2) >= 0);
+	assert_false(is_readable(ipc_get_fd(ipc2)));
+
+	assert_success(ipc_send(ipc1, ipc_get_name(ipc2), data));
+	assert_true(is_readable(ipc_get_fd(ipc2)));
+
+	assert_true(ipc_check(ipc2));
+	assert_false(is_readable(ipc_get_fd(ipc2)));
+
+	ipc_free(ipc1);
+	ipc_free(ipc2);
+}
+
+TEST(several_messages_are_received_after_one_wakeup,
+     IF(enabled_and_not_windows))
+{
+	char msg[] = "test message";
+	char *data[] = { msg, NULL };
+
+	ipc_t *const ipc1 = ipc_init(NAME, &test_ipc_args, &test_ipc_eval);
+	ipc_t *const ipc2 = ipc_init(NAME, &test_ipc_args2, &test_ipc_eval);
+
+	assert_success(ipc_send(ipc1, ipc_get_name(ipc2), data));
+	assert_success(ipc_send(ipc1, ipc_get_name(ipc2), data));
+
+	assert_true(ipc_check(ipc2));
+	assert_true(ipc_check(ipc2));
+	assert_false(ipc_check(ipc2));
+	assert_int_equal(4, nmessages2);
+
+	ipc_free(ipc1);
+	ipc_free(ipc2);
+}
+
+TEST(no_descriptor_without_instance)
+{
+	assert_int_equal(-1, ipc_get_fd(NULL));
+}
+
 static void
 test_ipc_args(char *args[])
 {
@@ -270,5 +320,18 @@ enabled_and_not_windows(void)
 #endif
 }
 
+/* Checks whether there is data to read from the descriptor.  Returns non-zero
+ * if so, otherwise zero is returned. */
+static int
+is_readable(int fd)
+{
+#ifndef _WIN32
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	return (poll(&pfd, 1, 0) == 1 && (pfd.revents & POLLIN));
+#else
+	return 0;
+#endif
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
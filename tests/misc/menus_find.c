@@ -1,6 +1,6 @@
 #include <stic.h>
 
-#include <unistd.h> /* chdir() */
+#include <unistd.h> /* chdir() usleep() */
 
 #include <stdio.h> /* snprintf() */
 #include <string.h> /* strcpy() */
@@ -8,6 +8,9 @@
 #include "../../src/cfg/config.h"
 #include "../../src/engine/cmds.h"
 #include "../../src/engine/keys.h"
+#include "../../src/engine/mode.h"
+#include "../../src/menus/menus.h"
+#include "../../src/modes/menu.h"
 #include "../../src/modes/modes.h"
 #include "../../src/modes/wk.h"
 #include "../../src/ui/ui.h"
@@ -18,6 +21,8 @@
 
 #include "utils.h"
 
+static void wait_for_search(void);
+
 static char test_data[PATH_MAX + 1];
 
 SETUP_ONCE()
@@ -118,5 +123,77 @@ TEST(p_macro_works, IF(not_windows))
 	assert_failure(exec_commands("find a$NO_SUCH_VAR", &lwin, CIT_COMMAND));
 }
 
+TEST(builtin_find_fills_menu)
+{
+	assert_success(exec_commands("set findprg=", &lwin, CIT_COMMAND));
+
+	assert_success(chdir(TEST_DATA_PATH));
+	strcpy(lwin.curr_dir, test_data);
+
+	assert_success(exec_commands("find -type d dir1", &lwin, CIT_COMMAND));
+	assert_true(vle_mode_is(MENU_MODE));
+	wait_for_search();
+	assert_true(vle_mode_is(MENU_MODE));
+
+	char dst[PATH_MAX + 1];
+	snprintf(dst, sizeof(dst), "%s/tree", test_data);
+
+	(void)vle_keys_exec(WK_CR);
+	assert_true(paths_are_equal(lwin.curr_dir, dst));
+	(void)vle_keys_exec(WK_ESC);
+}
+
+TEST(builtin_find_with_no_matches_does_not_open_menu)
+{
+	assert_success(exec_commands("set findprg=", &lwin, CIT_COMMAND));
+
+	assert_success(chdir(TEST_DATA_PATH));
+	strcpy(lwin.curr_dir, test_data);
+
+	assert_success(exec_commands("find no-such-file", &lwin, CIT_COMMAND));
+	wait_for_search();
+	assert_true(vle_mode_is(NORMAL_MODE));
+	assert_false(menus_check_for_updates());
+}
+
+TEST(builtin_find_handles_quoted_arguments)
+{
+	assert_success(exec_commands("set findprg=", &lwin, CIT_COMMAND));
+
+	assert_success(chdir(TEST_DATA_PATH));
+	strcpy(lwin.curr_dir, test_data);
+
+	assert_success(exec_commands("find -type d 'dir1'", &lwin, CIT_COMMAND));
+	wait_for_search();
+	assert_true(vle_mode_is(MENU_MODE));
+	(void)vle_keys_exec(WK_ESC);
+}
+
+TEST(builtin_find_rejects_unknown_predicates)
+{
+	assert_success(exec_commands("set findprg=", &lwin, CIT_COMMAND));
+
+	strcpy(lwin.curr_dir, test_data);
+
+	assert_failure(exec_commands("find -perm 644", &lwin, CIT_COMMAND));
+	assert_failure(exec_commands("find -size 1x", &lwin, CIT_COMMAND));
+	assert_true(vle_mode_is(NORMAL_MODE));
+}
+
+/* Waits until built-in search either provides something or closes the menu. */
+static void
+wait_for_search(void)
+{
+	int i;
+	for(i = 0; i < 1000 && vle_mode_is(MENU_MODE); ++i)
+	{
+		if(menu_check_for_updates())
+		{
+			break;
+		}
+		usleep(1000);
+	}
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
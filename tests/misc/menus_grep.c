@@ -0,0 +1,92 @@
+#include <stic.h>
+
+#include <unistd.h> /* chdir() */
+
+#include <string.h> /* strcpy() */
+
+#include "../../src/cfg/config.h"
+#include "../../src/engine/cmds.h"
+#include "../../src/engine/keys.h"
+#include "../../src/engine/mode.h"
+#include "../../src/menus/menus.h"
+#include "../../src/modes/modes.h"
+#include "../../src/modes/wk.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/path.h"
+#include "../../src/cmd_core.h"
+
+#include "utils.h"
+
+static char test_data[PATH_MAX + 1];
+
+SETUP_ONCE()
+{
+	char cwd[PATH_MAX + 1];
+	assert_non_null(get_cwd(cwd, sizeof(cwd)));
+
+	make_abs_path(test_data, sizeof(test_data), TEST_DATA_PATH, "read", cwd);
+}
+
+SETUP()
+{
+	init_modes();
+
+	view_setup(&lwin);
+	view_setup(&rwin);
+
+	curr_view = &lwin;
+	other_view = &rwin;
+
+	opt_handlers_setup();
+
+	init_commands();
+
+	curr_stats.load_stage = -1;
+
+	assert_success(exec_commands("set grepprg=", &lwin, CIT_COMMAND));
+	strcpy(lwin.curr_dir, test_data);
+}
+
+TEARDOWN()
+{
+	opt_handlers_teardown();
+
+	vle_cmds_reset();
+	vle_keys_reset();
+
+	view_teardown(&lwin);
+	view_teardown(&rwin);
+
+	curr_stats.load_stage = 0;
+}
+
+TEST(builtin_grep_fills_menu)
+{
+	assert_success(exec_commands("grep 2n[d]", &lwin, CIT_COMMAND));
+	assert_true(vle_mode_is(MENU_MODE));
+
+	(void)vle_keys_exec(WK_b);
+	assert_true(vle_mode_is(NORMAL_MODE));
+	assert_int_equal(1, lwin.list_rows);
+	assert_string_equal("two-lines", lwin.dir_entry[0].name);
+}
+
+TEST(builtin_grep_with_no_matches_does_not_open_menu)
+{
+	assert_failure(exec_commands("grep -F 2n[d]", &lwin, CIT_COMMAND));
+	assert_true(vle_mode_is(NORMAL_MODE));
+	assert_false(menus_check_for_updates());
+}
+
+TEST(builtin_grep_reports_errors)
+{
+	assert_failure(exec_commands("grep -x pattern", &lwin, CIT_COMMAND));
+	assert_true(vle_mode_is(NORMAL_MODE));
+
+	assert_success(exec_commands("grep (", &lwin, CIT_COMMAND));
+	assert_true(vle_mode_is(NORMAL_MODE));
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -1,7 +1,8 @@
 #include <stic.h>
 
 #include <stdio.h> /* FILE fclose() fopen() */
-#include <string.h> /* strcpy() */
+#include <stdlib.h> /* malloc() */
+#include <string.h> /* strcat() strcpy() strlen() */
 
 #include "../../src/cfg/config.h"
 #include "../../src/compat/fs_limits.h"
@@ -15,10 +16,13 @@
 
 #include "utils.h"
 
+static strlist_t make_lines(const char text[], int count);
+
 SETUP()
 {
 	curr_view = &lwin;
 	other_view = &rwin;
+	cfg.preview_cache_size = 4096;
 
 	opt_handlers_setup();
 }
@@ -97,6 +101,13 @@ TEST(preview_is_closed_on_request)
 	assert_false(curr_stats.preview.on);
 }
 
+TEST(main_loop_is_not_woken_up_without_pending_preview)
+{
+	assert_int_equal(-1, qv_get_check_delay());
+	qv_check_for_updates();
+	assert_int_equal(-1, qv_get_check_delay());
+}
+
 TEST(macros_are_expanded_for_viewer)
 {
 	FILE *fp;
@@ -200,5 +211,74 @@ TEST(can_read_only_specified_number_of_lines)
 	fclose(fp);
 }
 
+TEST(previews_are_cached_until_memory_limit_is_reached)
+{
+	/* Each preview takes a bit more than 40% of the limit. */
+	cfg.preview_cache_size = 16;
+
+	previews_put(TEST_DATA_PATH "/read/two-lines", NULL, make_lines("a", 6500));
+	previews_put(TEST_DATA_PATH "/read/dos-eof", NULL, make_lines("b", 6500));
+	assert_non_null(previews_find(TEST_DATA_PATH "/read/two-lines", NULL));
+	assert_non_null(previews_find(TEST_DATA_PATH "/read/dos-eof", NULL));
+
+	/* Least recently used preview is evicted first. */
+	assert_non_null(previews_find(TEST_DATA_PATH "/read/two-lines", NULL));
+	previews_put(TEST_DATA_PATH "/read/utf8-bom", NULL, make_lines("c", 6500));
+	assert_null(previews_find(TEST_DATA_PATH "/read/dos-eof", NULL));
+	assert_non_null(previews_find(TEST_DATA_PATH "/read/two-lines", NULL));
+	assert_non_null(previews_find(TEST_DATA_PATH "/read/utf8-bom", NULL));
+
+	/* Zero limit drops everything. */
+	cfg.preview_cache_size = 0;
+	previews_put(TEST_DATA_PATH "/read/dos-eof", NULL, make_lines("b", 1));
+	assert_null(previews_find(TEST_DATA_PATH "/read/two-lines", NULL));
+	assert_null(previews_find(TEST_DATA_PATH "/read/utf8-bom", NULL));
+	assert_null(previews_find(TEST_DATA_PATH "/read/dos-eof", NULL));
+}
+
+TEST(cached_previews_depend_on_viewer)
+{
+	previews_put(TEST_DATA_PATH "/read/two-lines", "cat", make_lines("a", 1));
+
+	assert_null(previews_find(TEST_DATA_PATH "/read/two-lines", NULL));
+	assert_null(previews_find(TEST_DATA_PATH "/read/two-lines", "less"));
+
+	strlist_t *const lines = previews_find(TEST_DATA_PATH "/read/two-lines",
+			"cat");
+	assert_non_null(lines);
+	assert_int_equal(1, lines->nitems);
+	assert_string_equal("a", lines->items[0]);
+
+	/* Preview is replaced. */
+	previews_put(TEST_DATA_PATH "/read/two-lines", "cat", make_lines("b", 1));
+	strlist_t *const new_lines = previews_find(TEST_DATA_PATH "/read/two-lines",
+			"cat");
+	assert_non_null(new_lines);
+	assert_string_equal("b", new_lines->items[0]);
+}
+
+TEST(cached_preview_of_missing_file_is_not_used)
+{
+	previews_put(SANDBOX_PATH "/no-such-file", NULL, make_lines("a", 1));
+	assert_null(previews_find(SANDBOX_PATH "/no-such-file", NULL));
+}
+
+/* Makes a single line preview with the line consisting of repeated text.
+ * Returns the lines. */
+static strlist_t
+make_lines(const char text[], int count)
+{
+	char *const line = malloc(strlen(text)*count + 1);
+	line[0] = '\0';
+	while(count-- > 0)
+	{
+		strcat(line, text);
+	}
+
+	strlist_t lines = {};
+	lines.nitems = put_into_string_array(&lines.items, lines.nitems, line);
+	return lines;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -314,6 +314,42 @@ TEST(extensions_of_dot_files_are_sorted_correctly)
 	assert_string_equal(".tmux.conf", lwin.dir_entry[2].name);
 }
 
+TEST(all_keys_are_considered_in_order_of_their_priority)
+{
+	view_teardown(&lwin);
+
+	lwin.list_rows = 5;
+	lwin.dir_entry = dynarray_cextend(NULL,
+			lwin.list_rows*sizeof(*lwin.dir_entry));
+	lwin.dir_entry[0].name = strdup("b");
+	lwin.dir_entry[0].type = FT_REG;
+	lwin.dir_entry[0].mtime = 1;
+	lwin.dir_entry[1].name = strdup("a");
+	lwin.dir_entry[1].type = FT_REG;
+	lwin.dir_entry[1].mtime = 2;
+	lwin.dir_entry[2].name = strdup("dir");
+	lwin.dir_entry[2].type = FT_DIR;
+	lwin.dir_entry[2].mtime = 1;
+	lwin.dir_entry[3].name = strdup("B");
+	lwin.dir_entry[3].type = FT_REG;
+	lwin.dir_entry[3].mtime = 2;
+	lwin.dir_entry[4].name = strdup("c");
+	lwin.dir_entry[4].type = FT_REG;
+	lwin.dir_entry[4].mtime = 2;
+
+	lwin.sort[0] = -SK_BY_TIME_MODIFIED;
+	lwin.sort[1] = -SK_BY_INAME;
+	memset(&lwin.sort[2], SK_NONE, sizeof(lwin.sort) - 2);
+
+	sort_view(&lwin);
+
+	assert_string_equal("dir", lwin.dir_entry[0].name);
+	assert_string_equal("c", lwin.dir_entry[1].name);
+	assert_string_equal("B", lwin.dir_entry[2].name);
+	assert_string_equal("a", lwin.dir_entry[3].name);
+	assert_string_equal("b", lwin.dir_entry[4].name);
+}
+
 TEST(sorting_uses_dcache_for_dirs)
 {
 	view_teardown(&lwin);
@@ -432,6 +468,42 @@ TEST(groups_sorting_works)
 	assert_string_equal("11-todo-publish", lwin.dir_entry[6].name);
 }
 
+TEST(groups_are_recompiled_on_change)
+{
+	view_teardown(&lwin);
+
+	strcpy(lwin.curr_dir, TEST_DATA_PATH);
+	lwin.list_rows = 3;
+	lwin.dir_entry = dynarray_cextend(NULL,
+			lwin.list_rows*sizeof(*lwin.dir_entry));
+	lwin.dir_entry[0].name = strdup("c-x");
+	lwin.dir_entry[0].type = FT_REG;
+	lwin.dir_entry[0].origin = lwin.curr_dir;
+	lwin.dir_entry[1].name = strdup("a-y");
+	lwin.dir_entry[1].type = FT_REG;
+	lwin.dir_entry[1].origin = lwin.curr_dir;
+	lwin.dir_entry[2].name = strdup("b-x");
+	lwin.dir_entry[2].type = FT_REG;
+	lwin.dir_entry[2].origin = lwin.curr_dir;
+
+	lwin.sort[0] = SK_BY_GROUPS;
+	memset(&lwin.sort[1], SK_NONE, sizeof(lwin.sort) - 1);
+
+	update_string(&lwin.sort_groups, "-(.)$,^(.)");
+	sort_view(&lwin);
+	assert_string_equal("b-x", lwin.dir_entry[0].name);
+	assert_string_equal("c-x", lwin.dir_entry[1].name);
+	assert_string_equal("a-y", lwin.dir_entry[2].name);
+
+	update_string(&lwin.sort_groups, "^(.)");
+	sort_view(&lwin);
+	assert_string_equal("a-y", lwin.dir_entry[0].name);
+	assert_string_equal("b-x", lwin.dir_entry[1].name);
+	assert_string_equal("c-x", lwin.dir_entry[2].name);
+
+	update_string(&lwin.sort_groups, NULL);
+}
+
 #ifndef _WIN32
 
 TEST(inode_sorting_works)
@@ -0,0 +1,189 @@
+#include <stic.h>
+
+#include <unistd.h> /* rmdir() */
+
+#include <stdio.h> /* FILE fclose() fopen() remove() snprintf() */
+#include <string.h> /* strcmp() */
+
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/os.h"
+#include "../../src/utils/dirreader.h"
+
+#include "utils.h"
+
+static void create_files(int count);
+static void remove_files(int count);
+
+TEST(nonexistent_directory_is_reported, IF(not_windows))
+{
+	dirreader_t *reader;
+
+	assert_non_null(reader = dirreader_start(SANDBOX_PATH "/no-such-dir", 4));
+	assert_true(dirreader_wait(reader, -1));
+	assert_true(dirreader_sync(reader));
+	assert_true(dirreader_failed(reader));
+
+	dirreader_free(reader);
+}
+
+TEST(empty_directory_has_no_entries, IF(not_windows))
+{
+	dirreader_t *reader;
+	int count;
+
+	assert_non_null(reader = dirreader_start(SANDBOX_PATH, 4));
+	assert_true(dirreader_wait(reader, -1));
+	assert_true(dirreader_sync(reader));
+	assert_false(dirreader_failed(reader));
+
+	(void)dirreader_get(reader, &count);
+	assert_int_equal(0, count);
+
+	dirreader_free(reader);
+}
+
+TEST(all_files_are_read_with_metadata, IF(not_windows))
+{
+	enum { COUNT = 200 };
+
+	dirreader_t *reader;
+	const dirreader_entry_t *entries;
+	int count;
+	int i;
+	int nfiles = 0, ndirs = 0;
+
+	create_files(COUNT);
+	assert_success(os_mkdir(SANDBOX_PATH "/dir", 0700));
+
+	assert_non_null(reader = dirreader_start(SANDBOX_PATH, 4));
+	assert_true(dirreader_wait(reader, -1));
+	assert_true(dirreader_sync(reader));
+
+	entries = dirreader_get(reader, &count);
+	assert_int_equal(COUNT + 1, count);
+	for(i = 0; i < count; ++i)
+	{
+		assert_false(strcmp(entries[i].name, ".") == 0);
+		assert_false(strcmp(entries[i].name, "..") == 0);
+
+		if(S_ISDIR(entries[i].s.st_mode))
+		{
+			assert_string_equal("dir", entries[i].name);
+			++ndirs;
+		}
+		else if(S_ISREG(entries[i].s.st_mode))
+		{
+			assert_int_equal(0, entries[i].s.st_size);
+			++nfiles;
+		}
+	}
+	assert_int_equal(1, ndirs);
+	assert_int_equal(COUNT, nfiles);
+
+	dirreader_free(reader);
+
+	assert_success(rmdir(SANDBOX_PATH "/dir"));
+	remove_files(COUNT);
+}
+
+TEST(single_thread_reads_all_files, IF(not_windows))
+{
+	enum { COUNT = 100 };
+
+	dirreader_t *reader;
+	const dirreader_entry_t *entries;
+	int count;
+	int i;
+
+	create_files(COUNT);
+
+	assert_non_null(reader = dirreader_start(SANDBOX_PATH, 1));
+	assert_true(dirreader_wait(reader, -1));
+	assert_true(dirreader_sync(reader));
+
+	entries = dirreader_get(reader, &count);
+	assert_int_equal(COUNT, count);
+	for(i = 0; i < count; ++i)
+	{
+		assert_true(S_ISREG(entries[i].s.st_mode));
+	}
+
+	dirreader_free(reader);
+
+	remove_files(COUNT);
+}
+
+TEST(reader_can_be_freed_while_running, IF(not_windows))
+{
+	enum { COUNT = 500 };
+
+	create_files(COUNT);
+
+	dirreader_free(dirreader_start(SANDBOX_PATH, 4));
+
+	remove_files(COUNT);
+}
+
+TEST(sync_accumulates_entries, IF(not_windows))
+{
+	enum { COUNT = 300 };
+
+	dirreader_t *reader;
+	int count = 0;
+
+	create_files(COUNT);
+
+	assert_non_null(reader = dirreader_start(SANDBOX_PATH, 4));
+	while(!dirreader_sync(reader))
+	{
+		int new_count;
+		(void)dirreader_get(reader, &new_count);
+		assert_true(new_count >= count);
+		count = new_count;
+	}
+
+	(void)dirreader_get(reader, &count);
+	assert_int_equal(COUNT, count);
+
+	dirreader_free(reader);
+
+	remove_files(COUNT);
+}
+
+TEST(async_reading_is_not_supported_on_windows, IF(windows))
+{
+	assert_null(dirreader_start(SANDBOX_PATH, 4));
+}
+
+/* Creates specified number of empty files in the sandbox. */
+static void
+create_files(int count)
+{
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		char path[PATH_MAX + 1];
+		FILE *f;
+
+		snprintf(path, sizeof(path), "%s/file%d", SANDBOX_PATH, i);
+		f = fopen(path, "w");
+		assert_non_null(f);
+		fclose(f);
+	}
+}
+
+/* Removes files created by create_files(). */
+static void
+remove_files(int count)
+{
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		char path[PATH_MAX + 1];
+		snprintf(path, sizeof(path), "%s/file%d", SANDBOX_PATH, i);
+		assert_success(remove(path));
+	}
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,162 @@
+#include <stic.h>
+
+#include <unistd.h> /* link() rmdir() */
+
+#include <stdio.h> /* FILE fclose() fopen() fputc() remove() snprintf() */
+
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/os.h"
+#include "../../src/utils/cancellation.h"
+#include "../../src/utils/dirsize.h"
+#include "../../src/utils/str.h"
+
+#include "utils.h"
+
+static int cancel_hook(void *arg);
+static int lookup(const char path[], uint64_t *size, void *arg);
+static void report(const char path[], uint64_t size, void *arg);
+static void make_file(const char path[], int size);
+
+/* Directories reported by report() in order. */
+static char reported[16][PATH_MAX + 1];
+/* Sizes reported by report(). */
+static uint64_t reported_sizes[16];
+/* Number of reported directories. */
+static int nreported;
+
+SETUP()
+{
+	nreported = 0;
+
+	assert_success(os_mkdir(SANDBOX_PATH "/top", 0700));
+	assert_success(os_mkdir(SANDBOX_PATH "/top/sub", 0700));
+	assert_success(os_mkdir(SANDBOX_PATH "/top/sub/subsub", 0700));
+	make_file(SANDBOX_PATH "/top/a", 10);
+	make_file(SANDBOX_PATH "/top/sub/b", 20);
+	make_file(SANDBOX_PATH "/top/sub/subsub/c", 30);
+}
+
+TEARDOWN()
+{
+	(void)remove(SANDBOX_PATH "/top/b");
+	assert_success(remove(SANDBOX_PATH "/top/sub/subsub/c"));
+	assert_success(remove(SANDBOX_PATH "/top/sub/b"));
+	assert_success(remove(SANDBOX_PATH "/top/a"));
+	assert_success(rmdir(SANDBOX_PATH "/top/sub/subsub"));
+	assert_success(rmdir(SANDBOX_PATH "/top/sub"));
+	assert_success(rmdir(SANDBOX_PATH "/top"));
+}
+
+TEST(size_of_tree_is_calculated)
+{
+	assert_ulong_equal(60, dirsize_calc(SANDBOX_PATH "/top", 1, NULL, NULL, NULL,
+				&no_cancellation));
+	assert_ulong_equal(60, dirsize_calc(SANDBOX_PATH "/top", 4, NULL, NULL, NULL,
+				&no_cancellation));
+}
+
+TEST(subdirectories_are_reported_before_parents)
+{
+	assert_ulong_equal(60, dirsize_calc(SANDBOX_PATH "/top", 4, NULL, &report,
+				NULL, &no_cancellation));
+
+	assert_int_equal(3, nreported);
+	assert_string_equal(SANDBOX_PATH "/top/sub/subsub", reported[0]);
+	assert_ulong_equal(30, reported_sizes[0]);
+	assert_string_equal(SANDBOX_PATH "/top/sub", reported[1]);
+	assert_ulong_equal(50, reported_sizes[1]);
+	assert_string_equal(SANDBOX_PATH "/top", reported[2]);
+	assert_ulong_equal(60, reported_sizes[2]);
+}
+
+TEST(known_sizes_are_not_recalculated)
+{
+	assert_ulong_equal(110, dirsize_calc(SANDBOX_PATH "/top", 4, &lookup,
+				&report, NULL, &no_cancellation));
+
+	assert_int_equal(1, nreported);
+	assert_string_equal(SANDBOX_PATH "/top", reported[0]);
+}
+
+TEST(hard_links_are_counted_once, IF(not_windows))
+{
+	assert_success(link(SANDBOX_PATH "/top/sub/b", SANDBOX_PATH "/top/b"));
+
+	assert_ulong_equal(60, dirsize_calc(SANDBOX_PATH "/top", 4, NULL, NULL, NULL,
+				&no_cancellation));
+}
+
+TEST(hard_links_do_not_affect_sizes_of_subdirectories, IF(not_windows))
+{
+	assert_success(link(SANDBOX_PATH "/top/sub/b", SANDBOX_PATH "/top/b"));
+
+	assert_ulong_equal(60, dirsize_calc(SANDBOX_PATH "/top", 4, NULL, &report,
+				NULL, &no_cancellation));
+
+	assert_int_equal(3, nreported);
+	assert_ulong_equal(30, reported_sizes[0]);
+	assert_ulong_equal(50, reported_sizes[1]);
+	assert_ulong_equal(60, reported_sizes[2]);
+}
+
+TEST(missing_directory_has_no_size)
+{
+	assert_ulong_equal(0, dirsize_calc(SANDBOX_PATH "/no-such-dir", 4, NULL,
+				&report, NULL, &no_cancellation));
+	assert_int_equal(0, nreported);
+}
+
+TEST(cancellation_stops_calculation)
+{
+	const cancellation_t cancellation = { .hook = &cancel_hook };
+
+	assert_ulong_equal(0, dirsize_calc(SANDBOX_PATH "/top", 4, NULL, &report,
+				NULL, &cancellation));
+	assert_int_equal(0, nreported);
+}
+
+/* Cancellation hook that always requests cancellation.  Returns non-zero. */
+static int
+cancel_hook(void *arg)
+{
+	return 1;
+}
+
+/* dirsize_calc() callback that pretends size of "sub" is known.  Returns zero
+ * if size is known, otherwise non-zero is returned. */
+static int
+lookup(const char path[], uint64_t *size, void *arg)
+{
+	if(ends_with(path, "/sub"))
+	{
+		*size = 100;
+		return 0;
+	}
+	return 1;
+}
+
+/* dirsize_calc() callback that records reported directories. */
+static void
+report(const char path[], uint64_t size, void *arg)
+{
+	/* Tree has a single chain of directories, so calls are serialized. */
+	snprintf(reported[nreported], sizeof(reported[nreported]), "%s", path);
+	reported_sizes[nreported] = size;
+	++nreported;
+}
+
+/* Creates file of specified size. */
+static void
+make_file(const char path[], int size)
+{
+	FILE *const f = fopen(path, "w");
+	assert_non_null(f);
+	while(size-- > 0)
+	{
+		fputc('x', f);
+	}
+	fclose(f);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
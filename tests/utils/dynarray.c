@@ -26,5 +26,29 @@ TEST(shrinked_dynarray_can_be_extended_safely)
 	dynarray_free(darray);
 }
 
+TEST(truncated_dynarray_is_extended_within_its_capacity)
+{
+	void *darray = dynarray_extend(NULL, 1024);
+	const size_t capacity = dynarray_capacity(darray);
+	assert_true(capacity >= 1024);
+
+	dynarray_truncate(darray, 16);
+	darray = dynarray_extend(darray, 1024 - 16);
+	assert_int_equal(capacity, dynarray_capacity(darray));
+
+	/* Truncation doesn't grow the array. */
+	dynarray_truncate(darray, 2048);
+	darray = dynarray_extend(darray, capacity - 1024);
+	assert_int_equal(capacity, dynarray_capacity(darray));
+
+	dynarray_free(darray);
+}
+
+TEST(null_dynarray_has_no_capacity)
+{
+	dynarray_truncate(NULL, 0);
+	assert_int_equal(0, dynarray_capacity(NULL));
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,350 @@
+#include <stic.h>
+
+#include <stdint.h> /* uint64_t */
+#include <stdio.h> /* FILE fclose() fopen() fputs() remove() */
+#include <string.h> /* memcmp() */
+
+#include "../../src/utils/fcache.h"
+
+#include "utils.h"
+
+#define CACHE_FILE SANDBOX_PATH "/cache"
+
+static fcache_key_t make_key(int n);
+
+TEARDOWN()
+{
+	(void)remove(CACHE_FILE);
+}
+
+TEST(missing_file_results_in_empty_cache)
+{
+	uint64_t value;
+	fcache_key_t key = make_key(1);
+
+	fcache_t *const cache = fcache_load(CACHE_FILE, 10);
+	assert_non_null(cache);
+	assert_false(fcache_get(cache, &key, &value));
+	fcache_free(cache);
+}
+
+TEST(unmodified_cache_is_not_written)
+{
+	fcache_t *const cache = fcache_load(CACHE_FILE, 10);
+	assert_success(fcache_save(cache));
+	fcache_free(cache);
+
+	assert_failure(remove(CACHE_FILE));
+}
+
+TEST(values_are_saved_and_loaded)
+{
+	uint64_t value;
+	fcache_key_t key1 = make_key(1), key2 = make_key(2), key3 = make_key(3);
+
+	fcache_t *cache = fcache_load(CACHE_FILE, 10);
+	fcache_put(cache, &key1, 10);
+	fcache_put(cache, &key2, 20);
+	fcache_put(cache, &key1, 11);
+	assert_success(fcache_save(cache));
+	fcache_free(cache);
+
+	cache = fcache_load(CACHE_FILE, 10);
+	assert_true(fcache_get(cache, &key1, &value));
+	assert_ulong_equal(11, value);
+	assert_true(fcache_get(cache, &key2, &value));
+	assert_ulong_equal(20, value);
+	assert_false(fcache_get(cache, &key3, &value));
+	fcache_free(cache);
+}
+
+TEST(many_values_can_be_stored)
+{
+	int i;
+	uint64_t value;
+
+	fcache_t *cache = fcache_load(CACHE_FILE, 10000);
+	for(i = 0; i < 1000; ++i)
+	{
+		fcache_key_t key = make_key(i);
+		fcache_put(cache, &key, i);
+	}
+	assert_success(fcache_save(cache));
+	fcache_free(cache);
+
+	cache = fcache_load(CACHE_FILE, 10000);
+	for(i = 0; i < 1000; ++i)
+	{
+		fcache_key_t key = make_key(i);
+		assert_true(fcache_get(cache, &key, &value));
+		assert_ulong_equal(i, value);
+	}
+	fcache_free(cache);
+}
+
+TEST(number_of_records_is_limited)
+{
+	int i;
+	uint64_t value;
+	int found = 0;
+
+	fcache_t *cache = fcache_load(CACHE_FILE, 2);
+	for(i = 0; i < 3; ++i)
+	{
+		fcache_key_t key = make_key(i);
+		fcache_put(cache, &key, i);
+	}
+	assert_success(fcache_save(cache));
+	fcache_free(cache);
+
+	cache = fcache_load(CACHE_FILE, 2);
+	for(i = 0; i < 3; ++i)
+	{
+		fcache_key_t key = make_key(i);
+		found += fcache_get(cache, &key, &value);
+	}
+	fcache_free(cache);
+
+	assert_int_equal(2, found);
+}
+
+TEST(recently_used_records_are_preferred)
+{
+	uint64_t value;
+	fcache_key_t key1 = make_key(1), key2 = make_key(2), key3 = make_key(3);
+
+	fcache_t *cache = fcache_load(CACHE_FILE, 2);
+	fcache_put(cache, &key1, 1);
+	fcache_put(cache, &key2, 2);
+	assert_success(fcache_save(cache));
+	fcache_free(cache);
+
+	cache = fcache_load(CACHE_FILE, 2);
+	assert_true(fcache_get(cache, &key1, &value));
+	fcache_put(cache, &key3, 3);
+	assert_success(fcache_save(cache));
+	fcache_free(cache);
+
+	cache = fcache_load(CACHE_FILE, 2);
+	assert_true(fcache_get(cache, &key1, &value));
+	assert_false(fcache_get(cache, &key2, &value));
+	assert_true(fcache_get(cache, &key3, &value));
+	fcache_free(cache);
+}
+
+TEST(unused_records_expire)
+{
+	int i;
+	uint64_t value;
+	fcache_key_t key1 = make_key(1), key2 = make_key(2);
+
+	fcache_t *cache = fcache_load(CACHE_FILE, 10);
+	fcache_put(cache, &key1, 1);
+	assert_success(fcache_save(cache));
+	fcache_free(cache);
+
+	for(i = 0; i < 100; ++i)
+	{
+		cache = fcache_load(CACHE_FILE, 10);
+		fcache_put(cache, &key2, i);
+		assert_success(fcache_save(cache));
+		fcache_free(cache);
+	}
+
+	cache = fcache_load(CACHE_FILE, 10);
+	assert_false(fcache_get(cache, &key1, &value));
+	assert_true(fcache_get(cache, &key2, &value));
+	fcache_free(cache);
+}
+
+TEST(pairs_of_values_are_saved_and_loaded)
+{
+	uint64_t first, second;
+	fcache_key_t key = make_key(1);
+
+	fcache_t *cache = fcache_load(CACHE_FILE, 10);
+	fcache_put_pair(cache, &key, 10, 20);
+	assert_success(fcache_save(cache));
+	fcache_free(cache);
+
+	cache = fcache_load(CACHE_FILE, 10);
+	assert_true(fcache_get_pair(cache, &key, &first, &second));
+	assert_ulong_equal(10, first);
+	assert_ulong_equal(20, second);
+	fcache_free(cache);
+}
+
+TEST(flushing_creates_file)
+{
+	uint64_t value;
+	fcache_key_t key = make_key(1);
+
+	fcache_t *cache = fcache_load(CACHE_FILE, 10);
+	fcache_put(cache, &key, 10);
+	assert_success(fcache_flush(cache));
+	fcache_free(cache);
+
+	cache = fcache_load(CACHE_FILE, 10);
+	assert_true(fcache_get(cache, &key, &value));
+	assert_ulong_equal(10, value);
+	fcache_free(cache);
+}
+
+TEST(flushing_appends_new_records)
+{
+	uint64_t value;
+	fcache_key_t key1 = make_key(1), key2 = make_key(2), key3 = make_key(3);
+
+	fcache_t *cache = fcache_load(CACHE_FILE, 10);
+	fcache_put(cache, &key1, 10);
+	assert_success(fcache_save(cache));
+
+	fcache_put(cache, &key2, 20);
+	assert_success(fcache_flush(cache));
+	fcache_put(cache, &key1, 11);
+	fcache_put(cache, &key3, 30);
+	assert_success(fcache_flush(cache));
+	/* Nothing to append. */
+	assert_success(fcache_flush(cache));
+	fcache_free(cache);
+
+	cache = fcache_load(CACHE_FILE, 10);
+	assert_true(fcache_get(cache, &key1, &value));
+	assert_ulong_equal(11, value);
+	assert_true(fcache_get(cache, &key2, &value));
+	assert_ulong_equal(20, value);
+	assert_true(fcache_get(cache, &key3, &value));
+	assert_ulong_equal(30, value);
+	fcache_free(cache);
+}
+
+TEST(sessions_see_records_flushed_by_each_other)
+{
+	uint64_t value;
+	fcache_key_t key1 = make_key(1), key2 = make_key(2);
+
+	fcache_t *cache = fcache_load(CACHE_FILE, 10);
+	fcache_put(cache, &key1, 10);
+	assert_success(fcache_save(cache));
+	fcache_free(cache);
+
+	fcache_t *const cache1 = fcache_load(CACHE_FILE, 10);
+	fcache_t *const cache2 = fcache_load(CACHE_FILE, 10);
+
+	fcache_put(cache1, &key2, 20);
+	assert_success(fcache_flush(cache1));
+
+	cache = fcache_load(CACHE_FILE, 10);
+	assert_true(fcache_get(cache, &key1, &value));
+	assert_true(fcache_get(cache, &key2, &value));
+	assert_ulong_equal(20, value);
+	fcache_free(cache);
+
+	fcache_free(cache1);
+	fcache_free(cache2);
+}
+
+TEST(saving_keeps_records_of_other_sessions)
+{
+	uint64_t value;
+	fcache_key_t key1 = make_key(1), key2 = make_key(2), key3 = make_key(3);
+
+	fcache_t *cache = fcache_load(CACHE_FILE, 10);
+	fcache_put(cache, &key1, 10);
+	assert_success(fcache_save(cache));
+	fcache_free(cache);
+
+	fcache_t *const cache1 = fcache_load(CACHE_FILE, 10);
+	fcache_t *const cache2 = fcache_load(CACHE_FILE, 10);
+
+	fcache_put(cache1, &key2, 20);
+	assert_success(fcache_save(cache1));
+	fcache_put(cache2, &key3, 30);
+	assert_success(fcache_save(cache2));
+
+	fcache_free(cache1);
+	fcache_free(cache2);
+
+	cache = fcache_load(CACHE_FILE, 10);
+	assert_true(fcache_get(cache, &key1, &value));
+	assert_true(fcache_get(cache, &key2, &value));
+	assert_ulong_equal(20, value);
+	assert_true(fcache_get(cache, &key3, &value));
+	assert_ulong_equal(30, value);
+	fcache_free(cache);
+}
+
+TEST(invalid_file_is_ignored)
+{
+	uint64_t value;
+	fcache_key_t key = make_key(1);
+
+	FILE *const fp = fopen(CACHE_FILE, "w");
+	fputs("garbage", fp);
+	fclose(fp);
+
+	fcache_t *const cache = fcache_load(CACHE_FILE, 10);
+	assert_non_null(cache);
+	assert_false(fcache_get(cache, &key, &value));
+	fcache_free(cache);
+}
+
+TEST(key_reflects_file_changes)
+{
+	fcache_key_t key1, key2;
+
+	FILE *fp = fopen(SANDBOX_PATH "/file", "w");
+	fclose(fp);
+
+	assert_success(fcache_key(SANDBOX_PATH "/file", &key1));
+	assert_success(fcache_key(SANDBOX_PATH "/file", &key2));
+	assert_true(memcmp(&key1, &key2, sizeof(key1)) == 0);
+
+	fp = fopen(SANDBOX_PATH "/file", "w");
+	fputs("content", fp);
+	fclose(fp);
+
+	assert_success(fcache_key(SANDBOX_PATH "/file", &key2));
+	assert_false(memcmp(&key1, &key2, sizeof(key1)) == 0);
+
+	assert_success(remove(SANDBOX_PATH "/file"));
+}
+
+TEST(key_of_missing_file_is_not_made)
+{
+	fcache_key_t key;
+	assert_failure(fcache_key(SANDBOX_PATH "/no-file", &key));
+}
+
+TEST(pair_key_does_not_depend_on_order)
+{
+	fcache_key_t ab, ba, ac;
+	const fcache_key_t a = make_key(1), b = make_key(2), c = make_key(3);
+
+	fcache_pair_key(&a, &b, &ab);
+	fcache_pair_key(&b, &a, &ba);
+	fcache_pair_key(&a, &c, &ac);
+
+	assert_true(memcmp(&ab, &ba, sizeof(ab)) == 0);
+	assert_false(memcmp(&ab, &ac, sizeof(ab)) == 0);
+	assert_false(memcmp(&ab, &a, sizeof(ab)) == 0);
+	assert_false(memcmp(&ab, &b, sizeof(ab)) == 0);
+}
+
+/* Makes distinct key for each number.  Returns the key. */
+static fcache_key_t
+make_key(int n)
+{
+	fcache_key_t key = {
+		.path_hash = n*7919,
+		.dev = 1,
+		.inode = n,
+		.size = n*10,
+		.mtime = 1000 + n,
+		.ctime = 2000 + n,
+	};
+	return key;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
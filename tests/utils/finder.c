@@ -0,0 +1,253 @@
+#include <stic.h>
+
+#include <unistd.h> /* rmdir() */
+
+#include <stdio.h> /* FILE fclose() fopen() fputc() remove() */
+#include <stdlib.h> /* free() qsort() */
+#include <string.h> /* strcmp() */
+#include <time.h> /* time() */
+
+#include "../../src/compat/os.h"
+#include "../../src/utils/finder.h"
+#include "../../src/utils/matchers.h"
+#include "../../src/utils/string_array.h"
+
+#include "utils.h"
+
+static void find(char *roots[], int nroots, const finder_criteria_t *criteria,
+		int nthreads);
+static int sorter(const void *first, const void *second);
+static void make_file(const char path[], int size);
+
+/* Results of the last find() call. */
+static char **found;
+/* Number of elements in found. */
+static int nfound;
+/* Criteria that match everything. */
+static finder_criteria_t any;
+
+SETUP()
+{
+	found = NULL;
+	nfound = 0;
+
+	any = (finder_criteria_t){
+		.kind = FK_ANY,
+		.min_size = -1, .max_size = -1,
+		.min_mtime = -1, .max_mtime = -1,
+	};
+
+	assert_success(os_mkdir(SANDBOX_PATH "/top", 0700));
+	assert_success(os_mkdir(SANDBOX_PATH "/top/sub", 0700));
+	assert_success(os_mkdir(SANDBOX_PATH "/top/sub/deep", 0700));
+	make_file(SANDBOX_PATH "/top/a.c", 10);
+	make_file(SANDBOX_PATH "/top/sub/b.h", 20);
+	make_file(SANDBOX_PATH "/top/sub/deep/c.c", 30);
+}
+
+TEARDOWN()
+{
+	free_string_array(found, nfound);
+
+	assert_success(remove(SANDBOX_PATH "/top/sub/deep/c.c"));
+	assert_success(remove(SANDBOX_PATH "/top/sub/b.h"));
+	assert_success(remove(SANDBOX_PATH "/top/a.c"));
+	assert_success(rmdir(SANDBOX_PATH "/top/sub/deep"));
+	assert_success(rmdir(SANDBOX_PATH "/top/sub"));
+	assert_success(rmdir(SANDBOX_PATH "/top"));
+}
+
+TEST(everything_is_found_without_criteria)
+{
+	char *roots[] = { SANDBOX_PATH "/top" };
+	find(roots, 1, &any, 4);
+
+	assert_int_equal(5, nfound);
+	assert_string_equal(SANDBOX_PATH "/top/a.c", found[0]);
+	assert_string_equal(SANDBOX_PATH "/top/sub", found[1]);
+	assert_string_equal(SANDBOX_PATH "/top/sub/b.h", found[2]);
+	assert_string_equal(SANDBOX_PATH "/top/sub/deep", found[3]);
+	assert_string_equal(SANDBOX_PATH "/top/sub/deep/c.c", found[4]);
+}
+
+TEST(single_thread_finds_the_same)
+{
+	char *roots[] = { SANDBOX_PATH "/top" };
+	find(roots, 1, &any, 1);
+	assert_int_equal(5, nfound);
+}
+
+TEST(names_are_matched)
+{
+	char *error;
+	matchers_t *const ms = matchers_alloc("*.c", 1, 1, "", &error);
+	assert_non_null(ms);
+	any.matchers = ms;
+
+	char *roots[] = { SANDBOX_PATH "/top" };
+	find(roots, 1, &any, 4);
+
+	assert_int_equal(2, nfound);
+	assert_string_equal(SANDBOX_PATH "/top/a.c", found[0]);
+	assert_string_equal(SANDBOX_PATH "/top/sub/deep/c.c", found[1]);
+
+	matchers_free(ms);
+}
+
+TEST(kind_of_files_is_checked)
+{
+	char *roots[] = { SANDBOX_PATH "/top" };
+
+	any.kind = FK_DIR;
+	find(roots, 1, &any, 4);
+	assert_int_equal(2, nfound);
+	assert_string_equal(SANDBOX_PATH "/top/sub", found[0]);
+	assert_string_equal(SANDBOX_PATH "/top/sub/deep", found[1]);
+
+	any.kind = FK_FILE;
+	find(roots, 1, &any, 4);
+	assert_int_equal(3, nfound);
+	assert_string_equal(SANDBOX_PATH "/top/a.c", found[0]);
+}
+
+TEST(size_is_checked)
+{
+	char *roots[] = { SANDBOX_PATH "/top" };
+
+	any.kind = FK_FILE;
+	any.min_size = 15;
+	any.max_size = 25;
+	find(roots, 1, &any, 4);
+
+	assert_int_equal(1, nfound);
+	assert_string_equal(SANDBOX_PATH "/top/sub/b.h", found[0]);
+}
+
+TEST(modification_time_is_checked)
+{
+	char *roots[] = { SANDBOX_PATH "/top" };
+
+	any.max_mtime = time(NULL) - 24*60*60;
+	find(roots, 1, &any, 4);
+	assert_int_equal(0, nfound);
+
+	any.max_mtime = -1;
+	any.min_mtime = time(NULL) - 24*60*60;
+	find(roots, 1, &any, 4);
+	assert_int_equal(5, nfound);
+}
+
+TEST(several_roots_are_searched)
+{
+	char *roots[] = {
+		SANDBOX_PATH "/top/sub/deep", SANDBOX_PATH "/top/a.c",
+		SANDBOX_PATH "/top/no-such-file",
+	};
+	find(roots, 3, &any, 4);
+
+	assert_int_equal(2, nfound);
+	assert_string_equal(SANDBOX_PATH "/top/a.c", found[0]);
+	assert_string_equal(SANDBOX_PATH "/top/sub/deep/c.c", found[1]);
+}
+
+TEST(results_can_be_taken_in_parts)
+{
+	char *roots[] = { SANDBOX_PATH "/top" };
+	finder_t *const finder = finder_start(roots, 1, &any, 2);
+	assert_non_null(finder);
+
+	int total = 0;
+	while(1)
+	{
+		char **paths;
+		const int done = finder_is_done(finder);
+		const int npaths = finder_take(finder, &paths);
+		total += npaths;
+		free_string_array(paths, npaths);
+
+		if(done)
+		{
+			break;
+		}
+		(void)finder_wait(finder, -1);
+	}
+	assert_int_equal(5, total);
+
+	finder_free(finder);
+}
+
+TEST(running_finder_can_be_cancelled_and_freed)
+{
+	char *roots[] = { SANDBOX_PATH "/top" };
+	finder_t *finder = finder_start(roots, 1, &any, 4);
+	assert_non_null(finder);
+	finder_cancel(finder);
+	assert_true(finder_wait(finder, -1));
+	finder_free(finder);
+
+	finder = finder_start(roots, 1, &any, 4);
+	assert_non_null(finder);
+	finder_free(finder);
+
+	finder_free(NULL);
+}
+
+/* Runs search to completion and puts sorted results into found and nfound
+ * replacing previous ones. */
+static void
+find(char *roots[], int nroots, const finder_criteria_t *criteria,
+		int nthreads)
+{
+	free_string_array(found, nfound);
+	found = NULL;
+	nfound = 0;
+
+	finder_t *const finder = finder_start(roots, nroots, criteria, nthreads);
+	assert_non_null(finder);
+
+	while(1)
+	{
+		char **paths;
+		const int done = finder_is_done(finder);
+		const int npaths = finder_take(finder, &paths);
+		int i;
+		for(i = 0; i < npaths; ++i)
+		{
+			nfound = put_into_string_array(&found, nfound, paths[i]);
+		}
+		free(paths);
+
+		if(done)
+		{
+			break;
+		}
+		(void)finder_wait(finder, -1);
+	}
+
+	finder_free(finder);
+
+	qsort(found, nfound, sizeof(*found), &sorter);
+}
+
+/* qsort() comparer of strings.  Returns standard -1, 0, 1 for comparisons. */
+static int
+sorter(const void *first, const void *second)
+{
+	return strcmp(*(char *const *)first, *(char *const *)second);
+}
+
+/* Creates file of specified size. */
+static void
+make_file(const char path[], int size)
+{
+	FILE *const f = fopen(path, "w");
+	assert_non_null(f);
+	while(size-- > 0)
+	{
+		fputc('x', f);
+	}
+	fclose(f);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -3,6 +3,8 @@
 #include <unistd.h> /* rmdir() */
 
 #include <stddef.h> /* NULL */
+#include <stdio.h> /* snprintf() */
+#include <string.h> /* strcmp() */
 
 #include "../../src/compat/os.h"
 #include "../../src/utils/fsdata.h"
@@ -16,8 +18,11 @@
 static void visitor(void *data, void *arg);
 static int traverser(const char name[], int valid, const void *parent_data,
 		void *data, void *arg);
+static int order_checker(const char name[], int valid, const void *parent_data,
+		void *data, void *arg);
 
 static int nnodes;
+static char last_name[32];
 
 TEST(freeing_null_fsdata_is_ok)
 {
@@ -273,6 +278,82 @@ TEST(cancellation)
 	fsdata_free(fsd);
 }
 
+TEST(many_siblings_are_found)
+{
+	int i;
+	int data;
+	char path[32];
+	fsdata_t *const fsd = fsdata_create(0, 0);
+
+	/* Add in reverse order to exercise insertion in the middle. */
+	for(i = 99; i >= 0; --i)
+	{
+		snprintf(path, sizeof(path), "/dir/%02d", i);
+		assert_success(fsdata_set(fsd, path, &i, sizeof(i)));
+	}
+
+	for(i = 0; i < 100; ++i)
+	{
+		snprintf(path, sizeof(path), "/dir/%02d", i);
+		assert_success(fsdata_get(fsd, path, &data, sizeof(data)));
+		assert_int_equal(i, data);
+	}
+
+	assert_failure(fsdata_get(fsd, "/dir/100", &data, sizeof(data)));
+	assert_failure(fsdata_get(fsd, "/dir/0", &data, sizeof(data)));
+
+	fsdata_free(fsd);
+}
+
+TEST(siblings_are_traversed_in_sorted_order)
+{
+	int i;
+	int data = 0;
+	char path[32];
+	fsdata_t *const fsd = fsdata_create(0, 0);
+
+	for(i = 0; i < 50; ++i)
+	{
+		snprintf(path, sizeof(path), "/%02d", (i*7)%50);
+		assert_success(fsdata_set(fsd, path, &data, sizeof(data)));
+	}
+
+	last_name[0] = '\0';
+	nnodes = 0;
+	assert_success(fsdata_traverse(fsd, &order_checker, NULL));
+	assert_int_equal(50, nnodes);
+
+	fsdata_free(fsd);
+}
+
+TEST(indexed_node_can_grow)
+{
+	int i;
+	char small_data[1] = { 'a' };
+	char big_data[128] = { 'b' };
+	char data[128];
+	char path[32];
+	fsdata_t *const fsd = fsdata_create(0, 0);
+
+	for(i = 0; i < 20; ++i)
+	{
+		snprintf(path, sizeof(path), "/%02d", i);
+		assert_success(fsdata_set(fsd, path, small_data, sizeof(small_data)));
+	}
+
+	assert_success(fsdata_set(fsd, "/10", big_data, sizeof(big_data)));
+	assert_success(fsdata_set(fsd, "/10/sub", small_data, sizeof(small_data)));
+
+	assert_success(fsdata_get(fsd, "/10", data, sizeof(data)));
+	assert_int_equal('b', data[0]);
+	assert_success(fsdata_get(fsd, "/10/sub", data, sizeof(small_data)));
+	assert_int_equal('a', data[0]);
+	assert_success(fsdata_get(fsd, "/19", data, sizeof(small_data)));
+	assert_int_equal('a', data[0]);
+
+	fsdata_free(fsd);
+}
+
 static void
 visitor(void *data, void *arg)
 {
@@ -287,5 +368,20 @@ traverser(const char name[], int valid, const void *parent_data, void *data,
 	return (++nnodes == 0);
 }
 
+/* fsdata_traverse() callback that checks that siblings are visited in sorted
+ * order.  Returns non-zero on unexpected order. */
+static int
+order_checker(const char name[], int valid, const void *parent_data,
+		void *data, void *arg)
+{
+	++nnodes;
+	if(strcmp(last_name, name) >= 0)
+	{
+		return 1;
+	}
+	snprintf(last_name, sizeof(last_name), "%s", name);
+	return 0;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
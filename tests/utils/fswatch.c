@@ -1,6 +1,12 @@
 #include <stic.h>
 
-#include <stdio.h> /* remove() snprintf() */
+#include <sys/stat.h> /* stat */
+#ifndef _WIN32
+#include <poll.h> /* POLLIN poll() pollfd */
+#endif
+
+#include <stdio.h> /* FILE fclose() fopen() fputs() remove() rename()
+                      snprintf() */
 
 #include "../../src/compat/fs_limits.h"
 #include "../../src/compat/os.h"
@@ -9,6 +15,7 @@
 #include "../../src/utils/path.h"
 
 static int using_inotify(void);
+static int is_readable(int fd);
 
 static char sandbox[PATH_MAX + 1];
 
@@ -155,6 +162,209 @@ TEST(file_recreation_removes_ban, IF(using_inotify))
 	assert_success(remove(SANDBOX_PATH "/testdir"));
 }
 
+TEST(changes_are_reported_per_entry, IF(using_inotify))
+{
+	fswatch_t *watch;
+	int error;
+	const fswatch_event_t *events;
+	int nevents;
+	FILE *f;
+
+	assert_non_null(watch = fswatch_create(sandbox));
+
+	assert_non_null(f = fopen(SANDBOX_PATH "/watched", "w"));
+	fclose(f);
+	assert_non_null(f = fopen(SANDBOX_PATH "/watched", "a"));
+	fputs("text", f);
+	fclose(f);
+	assert_success(rename(SANDBOX_PATH "/watched", SANDBOX_PATH "/renamed"));
+	assert_success(remove(SANDBOX_PATH "/renamed"));
+
+	assert_int_equal(FSWS_EVENTS,
+			fswatch_poll(watch, &error, &events, &nevents));
+	assert_false(error);
+
+	assert_true(nevents >= 4);
+	assert_int_equal(FSWE_CREATED, events[0].type);
+	assert_string_equal("watched", events[0].name);
+	assert_int_equal(FSWE_MODIFIED, events[1].type);
+	assert_string_equal("watched", events[1].name);
+	assert_int_equal(FSWE_DELETED, events[nevents - 3].type);
+	assert_string_equal("watched", events[nevents - 3].name);
+	assert_int_equal(FSWE_CREATED, events[nevents - 2].type);
+	assert_string_equal("renamed", events[nevents - 2].name);
+	assert_int_equal(FSWE_DELETED, events[nevents - 1].type);
+	assert_string_equal("renamed", events[nevents - 1].name);
+
+	assert_int_equal(FSWS_UNCHANGED,
+			fswatch_poll(watch, &error, &events, &nevents));
+	assert_false(error);
+
+	fswatch_free(watch);
+}
+
+TEST(changes_of_directory_itself_are_not_detailed, IF(using_inotify))
+{
+	fswatch_t *watch;
+	int error;
+	const fswatch_event_t *events;
+	int nevents;
+	struct stat st;
+	FILE *f;
+
+	assert_non_null(watch = fswatch_create(sandbox));
+
+	assert_non_null(f = fopen(SANDBOX_PATH "/probe", "w"));
+	fclose(f);
+	assert_success(os_stat(sandbox, &st));
+	assert_success(os_chmod(sandbox, st.st_mode & 07777));
+
+	assert_int_equal(FSWS_CHANGED,
+			fswatch_poll(watch, &error, &events, &nevents));
+	assert_false(error);
+
+	fswatch_free(watch);
+
+	assert_success(remove(SANDBOX_PATH "/probe"));
+}
+
+TEST(several_directories_are_watched_at_once, IF(using_inotify))
+{
+	fswatch_t *watch;
+	int error;
+	const fswatch_event_t *events;
+	int nevents;
+	char sub[PATH_MAX + 1];
+	FILE *f;
+
+	snprintf(sub, sizeof(sub), "%s/sub", sandbox);
+	assert_success(os_mkdir(sub, 0700));
+
+	assert_non_null(watch = fswatch_create(sandbox));
+	assert_success(fswatch_add(watch, sub));
+
+	assert_non_null(f = fopen(SANDBOX_PATH "/sub/nested", "w"));
+	fclose(f);
+
+	assert_int_equal(FSWS_EVENTS,
+			fswatch_poll(watch, &error, &events, &nevents));
+	assert_false(error);
+	assert_true(nevents >= 1);
+	assert_int_equal(FSWE_CREATED, events[0].type);
+	assert_string_equal(sub, events[0].dir);
+	assert_string_equal("nested", events[0].name);
+
+	fswatch_free(watch);
+
+	assert_success(remove(SANDBOX_PATH "/sub/nested"));
+	assert_success(remove(SANDBOX_PATH "/sub"));
+}
+
+TEST(unused_directories_stop_being_watched, IF(using_inotify))
+{
+	fswatch_t *watch;
+	int error;
+	const fswatch_event_t *events;
+	int nevents;
+	char sub1[PATH_MAX + 1], sub2[PATH_MAX + 1];
+	FILE *f;
+
+	snprintf(sub1, sizeof(sub1), "%s/sub1", sandbox);
+	snprintf(sub2, sizeof(sub2), "%s/sub2", sandbox);
+	assert_success(os_mkdir(sub1, 0700));
+	assert_success(os_mkdir(sub2, 0700));
+
+	assert_non_null(watch = fswatch_create(sandbox));
+	assert_success(fswatch_add(watch, sub1));
+	assert_success(fswatch_add(watch, sub2));
+
+	fswatch_mark_unused(watch);
+	assert_success(fswatch_add(watch, sandbox));
+	assert_success(fswatch_add(watch, sub2));
+	fswatch_drop_unused(watch);
+
+	assert_non_null(f = fopen(SANDBOX_PATH "/sub1/nested", "w"));
+	fclose(f);
+	assert_int_equal(FSWS_UNCHANGED,
+			fswatch_poll(watch, &error, &events, &nevents));
+	assert_false(error);
+
+	assert_non_null(f = fopen(SANDBOX_PATH "/sub2/nested", "w"));
+	fclose(f);
+	assert_int_equal(FSWS_EVENTS,
+			fswatch_poll(watch, &error, &events, &nevents));
+	assert_false(error);
+	assert_true(nevents >= 1);
+	assert_string_equal(sub2, events[0].dir);
+
+	fswatch_free(watch);
+
+	assert_success(remove(SANDBOX_PATH "/sub1/nested"));
+	assert_success(remove(SANDBOX_PATH "/sub2/nested"));
+	assert_success(remove(SANDBOX_PATH "/sub1"));
+	assert_success(remove(SANDBOX_PATH "/sub2"));
+}
+
+TEST(removed_directory_can_be_watched_again, IF(using_inotify))
+{
+	fswatch_t *watch;
+	int error;
+	const fswatch_event_t *events;
+	int nevents;
+	char sub[PATH_MAX + 1];
+	FILE *f;
+
+	snprintf(sub, sizeof(sub), "%s/sub", sandbox);
+	assert_success(os_mkdir(sub, 0700));
+
+	assert_non_null(watch = fswatch_create(sandbox));
+	assert_success(fswatch_add(watch, sub));
+
+	assert_success(remove(SANDBOX_PATH "/sub"));
+	assert_int_equal(FSWS_CHANGED,
+			fswatch_poll(watch, &error, &events, &nevents));
+
+	assert_success(os_mkdir(sub, 0700));
+	(void)fswatch_poll(watch, &error, &events, &nevents);
+	assert_success(fswatch_add(watch, sub));
+
+	assert_non_null(f = fopen(SANDBOX_PATH "/sub/nested", "w"));
+	fclose(f);
+	assert_int_equal(FSWS_EVENTS,
+			fswatch_poll(watch, &error, &events, &nevents));
+	assert_false(error);
+	assert_true(nevents >= 1);
+	assert_string_equal(sub, events[0].dir);
+
+	fswatch_free(watch);
+
+	assert_success(remove(SANDBOX_PATH "/sub/nested"));
+	assert_success(remove(SANDBOX_PATH "/sub"));
+}
+
+TEST(descriptor_signals_changes, IF(using_inotify))
+{
+	fswatch_t *watch;
+	int error;
+	FILE *f;
+
+	assert_non_null(watch = fswatch_create(sandbox));
+	assert_true(fswatch_get_fd(watch) >= 0);
+	assert_false(is_readable(fswatch_get_fd(watch)));
+
+	assert_non_null(f = fopen(SANDBOX_PATH "/signal", "w"));
+	fclose(f);
+	assert_true(is_readable(fswatch_get_fd(watch)));
+
+	assert_true(fswatch_changed(watch, &error));
+	assert_false(error);
+	assert_false(is_readable(fswatch_get_fd(watch)));
+
+	fswatch_free(watch);
+
+	assert_success(remove(SANDBOX_PATH "/signal"));
+}
+
 static int
 using_inotify(void)
 {
@@ -165,5 +375,18 @@ using_inotify(void)
 #endif
 }
 
+/* Checks whether there is data to read from the descriptor.  Returns non-zero
+ * if so, otherwise zero is returned. */
+static int
+is_readable(int fd)
+{
+#ifndef _WIN32
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	return (poll(&pfd, 1, 0) == 1 && (pfd.revents & POLLIN));
+#else
+	return 0;
+#endif
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,265 @@
+#include <stic.h>
+
+#include <unistd.h> /* rmdir() */
+
+#include <regex.h> /* REG_ICASE */
+#include <stdio.h> /* FILE fclose() fopen() fprintf() fputc() fputs() fwrite()
+                      remove() */
+#include <stdlib.h> /* free() qsort() */
+#include <string.h> /* strcmp() */
+
+#include "../../src/compat/os.h"
+#include "../../src/utils/grepper.h"
+#include "../../src/utils/str.h"
+#include "../../src/utils/string_array.h"
+
+#include "utils.h"
+
+static void grep(const char pattern[], int cflags, int fixed, int invert);
+static int sorter(const void *first, const void *second);
+static void make_file(const char path[], const char contents[]);
+
+/* Results of the last grep() call. */
+static char **found;
+/* Number of elements in found. */
+static int nfound;
+
+SETUP()
+{
+	found = NULL;
+	nfound = 0;
+
+	assert_success(os_mkdir(SANDBOX_PATH "/top", 0700));
+	assert_success(os_mkdir(SANDBOX_PATH "/top/sub", 0700));
+	make_file(SANDBOX_PATH "/top/a", "bar\nbaar\nxbar\nbr\n");
+	make_file(SANDBOX_PATH "/top/sub/b", "a.c\r\nabc\nBAR");
+}
+
+TEARDOWN()
+{
+	free_string_array(found, nfound);
+
+	assert_success(remove(SANDBOX_PATH "/top/sub/b"));
+	assert_success(remove(SANDBOX_PATH "/top/a"));
+	assert_success(rmdir(SANDBOX_PATH "/top/sub"));
+	assert_success(rmdir(SANDBOX_PATH "/top"));
+}
+
+TEST(literal_is_found)
+{
+	grep("bar", 0, 0, 0);
+
+	assert_int_equal(2, nfound);
+	assert_string_equal(SANDBOX_PATH "/top/a:1:bar", found[0]);
+	assert_string_equal(SANDBOX_PATH "/top/a:3:xbar", found[1]);
+}
+
+TEST(regex_is_checked_after_literal)
+{
+	grep("^ba+r$", 0, 0, 0);
+
+	assert_int_equal(2, nfound);
+	assert_string_equal(SANDBOX_PATH "/top/a:1:bar", found[0]);
+	assert_string_equal(SANDBOX_PATH "/top/a:2:baar", found[1]);
+}
+
+TEST(regex_without_literal_is_matched)
+{
+	grep("^(a|b)r", 0, 0, 0);
+
+	assert_int_equal(1, nfound);
+	assert_string_equal(SANDBOX_PATH "/top/a:4:br", found[0]);
+}
+
+TEST(optional_characters_are_not_required)
+{
+	grep("xb?ar", 0, 0, 0);
+
+	assert_int_equal(1, nfound);
+	assert_string_equal(SANDBOX_PATH "/top/a:3:xbar", found[0]);
+
+	grep("b[a]{2}r", 0, 0, 0);
+
+	assert_int_equal(1, nfound);
+	assert_string_equal(SANDBOX_PATH "/top/a:2:baar", found[0]);
+}
+
+TEST(case_can_be_ignored)
+{
+	grep("^bar", REG_ICASE, 0, 0);
+
+	assert_int_equal(2, nfound);
+	assert_string_equal(SANDBOX_PATH "/top/a:1:bar", found[0]);
+	assert_string_equal(SANDBOX_PATH "/top/sub/b:3:BAR", found[1]);
+}
+
+TEST(fixed_string_is_not_a_regex)
+{
+	grep("a.c", 0, 1, 0);
+
+	assert_int_equal(1, nfound);
+	assert_string_equal(SANDBOX_PATH "/top/sub/b:1:a.c", found[0]);
+}
+
+TEST(matching_can_be_inverted)
+{
+	grep("a", 0, 0, 1);
+
+	assert_int_equal(2, nfound);
+	assert_string_equal(SANDBOX_PATH "/top/a:4:br", found[0]);
+	assert_string_equal(SANDBOX_PATH "/top/sub/b:3:BAR", found[1]);
+}
+
+TEST(binary_files_are_skipped)
+{
+	FILE *const f = fopen(SANDBOX_PATH "/top/bin", "wb");
+	assert_non_null(f);
+	fwrite("bar\0bar\n", 1, 8, f);
+	fclose(f);
+
+	grep("bar", 0, 0, 0);
+	assert_int_equal(2, nfound);
+
+	assert_success(remove(SANDBOX_PATH "/top/bin"));
+}
+
+TEST(large_files_are_searched)
+{
+	int i;
+	FILE *const f = fopen(SANDBOX_PATH "/top/large", "w");
+	assert_non_null(f);
+	for(i = 0; i < 200000; ++i)
+	{
+		fprintf(f, "line number %d\n", i);
+	}
+	fprintf(f, "needle");
+	fclose(f);
+
+	grep("needle", 0, 0, 0);
+	assert_int_equal(1, nfound);
+	assert_string_equal(SANDBOX_PATH "/top/large:200001:needle", found[0]);
+
+	assert_success(remove(SANDBOX_PATH "/top/large"));
+}
+
+TEST(lines_longer_than_a_chunk_are_searched)
+{
+	int i;
+	FILE *const f = fopen(SANDBOX_PATH "/top/long", "w");
+	assert_non_null(f);
+	for(i = 0; i < 100000; ++i)
+	{
+		fprintf(f, "line number %d\n", i);
+	}
+	for(i = 0; i < 600000; ++i)
+	{
+		fputc('x', f);
+	}
+	fputs("end\nNEEDLE\n", f);
+	fclose(f);
+
+	grep("needle", REG_ICASE, 0, 0);
+	assert_int_equal(1, nfound);
+	assert_string_equal(SANDBOX_PATH "/top/long:100002:NEEDLE", found[0]);
+
+	grep("xend$", 0, 0, 0);
+	assert_int_equal(1, nfound);
+	assert_true(starts_with_lit(found[0], SANDBOX_PATH "/top/long:100001:xxx"));
+
+	assert_success(remove(SANDBOX_PATH "/top/long"));
+}
+
+TEST(bad_pattern_is_reported)
+{
+	char *roots[] = { SANDBOX_PATH "/top" };
+	const grepper_criteria_t criteria = { .pattern = "(" };
+	char *error = NULL;
+
+	assert_null(grepper_start(roots, 1, &criteria, 2, &error));
+	assert_non_null(error);
+	free(error);
+}
+
+TEST(running_grepper_can_be_cancelled_and_freed)
+{
+	char *roots[] = { SANDBOX_PATH "/top" };
+	const grepper_criteria_t criteria = { .pattern = "bar" };
+	char *error = NULL;
+
+	grepper_t *grepper = grepper_start(roots, 1, &criteria, 4, &error);
+	assert_non_null(grepper);
+	grepper_cancel(grepper);
+	assert_true(grepper_wait(grepper, -1));
+	grepper_free(grepper);
+
+	grepper = grepper_start(roots, 1, &criteria, 4, &error);
+	assert_non_null(grepper);
+	grepper_free(grepper);
+
+	grepper_free(NULL);
+}
+
+/* Runs search to completion and puts sorted results into found and nfound
+ * replacing previous ones. */
+static void
+grep(const char pattern[], int cflags, int fixed, int invert)
+{
+	char *roots[] = { SANDBOX_PATH "/top" };
+	const grepper_criteria_t criteria = {
+		.pattern = pattern,
+		.cflags = cflags,
+		.fixed = fixed,
+		.invert = invert,
+	};
+	char *error = NULL;
+
+	free_string_array(found, nfound);
+	found = NULL;
+	nfound = 0;
+
+	grepper_t *const grepper = grepper_start(roots, 1, &criteria, 4, &error);
+	assert_non_null(grepper);
+
+	while(1)
+	{
+		char **lines;
+		const int done = grepper_is_done(grepper);
+		const int nlines = grepper_take(grepper, &lines);
+		int i;
+		for(i = 0; i < nlines; ++i)
+		{
+			nfound = put_into_string_array(&found, nfound, lines[i]);
+		}
+		free(lines);
+
+		if(done)
+		{
+			break;
+		}
+		(void)grepper_wait(grepper, -1);
+	}
+
+	grepper_free(grepper);
+
+	qsort(found, nfound, sizeof(*found), &sorter);
+}
+
+/* qsort() comparer of strings.  Returns standard -1, 0, 1 for comparisons. */
+static int
+sorter(const void *first, const void *second)
+{
+	return strcmp(*(char *const *)first, *(char *const *)second);
+}
+
+/* Creates file with specified contents. */
+static void
+make_file(const char path[], const char contents[])
+{
+	FILE *const f = fopen(path, "wb");
+	assert_non_null(f);
+	fputs(contents, f);
+	fclose(f);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
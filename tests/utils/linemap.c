@@ -0,0 +1,375 @@
+#include <stic.h>
+
+#ifndef _WIN32
+#include <sys/stat.h> /* mkfifo() */
+#include <sys/wait.h> /* waitpid() */
+#endif
+#include <unistd.h> /* R_OK _Exit() access() fork() truncate() */
+
+#include <stdio.h> /* FILE fclose() fopen() fprintf() fputs() remove()
+                      sprintf() */
+#include <stdlib.h> /* free() malloc() */
+#include <string.h> /* strdup() strlen() */
+
+#include "../../src/utils/linemap.h"
+#include "../../src/utils/str.h"
+
+#include "utils.h"
+
+static linemap_t * make_numbered(int nlines, size_t *len);
+static void assert_line(linemap_t *lm, int n, const char expected[]);
+static void append_to_file(const char path[], const char text[]);
+static int has_proc(void);
+
+TEST(lines_are_split_at_newlines)
+{
+	linemap_t *const lm = linemap_from_buffer(strdup("a\r\nbb\n\nc"), 8);
+	assert_non_null(lm);
+
+	assert_line(lm, 0, "a");
+	assert_line(lm, 1, "bb");
+	assert_line(lm, 2, "");
+	assert_line(lm, 3, "c");
+	assert_null(linemap_dup(lm, 4));
+	assert_null(linemap_dup(lm, -1));
+
+	linemap_free(lm);
+}
+
+TEST(trailing_newline_does_not_start_a_line)
+{
+	int complete;
+	linemap_t *const lm = linemap_from_buffer(strdup("a\nb\n"), 4);
+	assert_non_null(lm);
+
+	assert_null(linemap_dup(lm, 2));
+	assert_int_equal(2, linemap_count(lm, &complete));
+	assert_true(complete);
+
+	linemap_free(lm);
+}
+
+TEST(bom_is_skipped)
+{
+	linemap_t *const lm = linemap_from_buffer(strdup("\xef\xbb\xbfx\ny"), 6);
+	assert_non_null(lm);
+
+	assert_line(lm, 0, "x");
+	assert_line(lm, 1, "y");
+
+	linemap_free(lm);
+}
+
+TEST(empty_text_has_no_lines)
+{
+	int complete;
+	linemap_t *const lm = linemap_from_buffer(strdup(""), 0);
+	assert_non_null(lm);
+
+	assert_int_equal(0, linemap_count(lm, &complete));
+	assert_true(complete);
+	assert_null(linemap_dup(lm, 0));
+
+	linemap_free(lm);
+}
+
+TEST(text_is_indexed_on_demand)
+{
+	int complete;
+	size_t len;
+	linemap_t *const lm = make_numbered(100000, &len);
+
+	assert_line(lm, 0, "line 0");
+	assert_true(linemap_count(lm, &complete) < 100000);
+	assert_false(complete);
+
+	assert_line(lm, 12345, "line 12345");
+	assert_line(lm, 99999, "line 99999");
+	assert_line(lm, 257, "line 257");
+	assert_null(linemap_dup(lm, 100000));
+	assert_int_equal(100000, linemap_count(lm, &complete));
+	assert_true(complete);
+
+	linemap_free(lm);
+}
+
+TEST(text_is_indexed_in_background)
+{
+	int complete;
+	size_t len;
+	linemap_t *const lm = make_numbered(100000, &len);
+
+	linemap_index_bg(lm);
+	assert_line(lm, 54321, "line 54321");
+	assert_true(linemap_wait(lm, -1));
+	assert_int_equal(100000, linemap_count(lm, &complete));
+	assert_true(complete);
+
+	/* Does nothing once indexing is complete. */
+	linemap_index_bg(lm);
+	assert_true(linemap_wait(lm, 0));
+
+	linemap_free(lm);
+}
+
+TEST(indexing_can_be_interrupted_by_freeing)
+{
+	size_t len;
+	linemap_t *const lm = make_numbered(100000, &len);
+	linemap_index_bg(lm);
+	linemap_free(lm);
+
+	linemap_free(NULL);
+}
+
+TEST(small_file_is_read)
+{
+	FILE *const f = fopen(SANDBOX_PATH "/file", "w");
+	assert_non_null(f);
+	fprintf(f, "first\nsecond\n");
+	fclose(f);
+
+	linemap_t *const lm = linemap_open(SANDBOX_PATH "/file");
+	assert_non_null(lm);
+	assert_line(lm, 0, "first");
+	assert_line(lm, 1, "second");
+	assert_null(linemap_dup(lm, 2));
+	linemap_free(lm);
+
+	assert_success(remove(SANDBOX_PATH "/file"));
+}
+
+TEST(large_file_is_mapped)
+{
+	int i;
+	FILE *const f = fopen(SANDBOX_PATH "/file", "w");
+	assert_non_null(f);
+	for(i = 0; i < 200000; ++i)
+	{
+		fprintf(f, "line %d\n", i);
+	}
+	fclose(f);
+
+	linemap_t *const lm = linemap_open(SANDBOX_PATH "/file");
+	assert_non_null(lm);
+	assert_line(lm, 199999, "line 199999");
+	assert_null(linemap_dup(lm, 200000));
+	linemap_free(lm);
+
+	assert_success(remove(SANDBOX_PATH "/file"));
+}
+
+TEST(truncation_of_mapped_file_is_survived, IF(not_windows))
+{
+	int i;
+	FILE *const f = fopen(SANDBOX_PATH "/file", "w");
+	assert_non_null(f);
+	for(i = 0; i < 200000; ++i)
+	{
+		fprintf(f, "line %d\n", i);
+	}
+	fclose(f);
+
+	linemap_t *const lm = linemap_open(SANDBOX_PATH "/file");
+	assert_non_null(lm);
+	assert_line(lm, 0, "line 0");
+
+	assert_success(truncate(SANDBOX_PATH "/file", 10));
+	assert_false(linemap_is_intact(lm, SANDBOX_PATH "/file"));
+
+	/* Text past the end of the file reads as zeroes, lines that were indexed
+	 * before truncation become empty and the rest are gone. */
+	assert_line(lm, 1, "lin");
+	assert_line(lm, 2, "");
+	assert_null(linemap_dup(lm, 199999));
+	linemap_free(lm);
+
+	assert_success(remove(SANDBOX_PATH "/file"));
+}
+
+TEST(directories_are_not_opened)
+{
+	assert_null(linemap_open(SANDBOX_PATH));
+	assert_null(linemap_open(SANDBOX_PATH "/no-such-file"));
+}
+
+TEST(files_of_zero_size_are_read_until_the_end, IF(has_proc))
+{
+	linemap_t *const lm = linemap_open("/proc/self/status");
+	assert_non_null(lm);
+
+	char *const line = linemap_dup(lm, 0);
+	assert_non_null(line);
+	assert_true(starts_with_lit(line, "Name:"));
+	free(line);
+
+	assert_false(linemap_is_intact(lm, "/proc/self/status"));
+	assert_failure(linemap_extend(lm, "/proc/self/status"));
+	linemap_free(lm);
+}
+
+TEST(appended_lines_are_picked_up)
+{
+	int complete;
+	append_to_file(SANDBOX_PATH "/file", "first\nsec");
+
+	linemap_t *const lm = linemap_open(SANDBOX_PATH "/file");
+	assert_non_null(lm);
+	assert_line(lm, 1, "sec");
+	assert_int_equal(2, linemap_count(lm, &complete));
+	assert_true(complete);
+
+	assert_success(linemap_extend(lm, SANDBOX_PATH "/file"));
+	assert_int_equal(2, linemap_count(lm, &complete));
+
+	append_to_file(SANDBOX_PATH "/file", "ond\nthird\n");
+	assert_success(linemap_extend(lm, SANDBOX_PATH "/file"));
+	assert_line(lm, 0, "first");
+	assert_line(lm, 1, "second");
+	assert_line(lm, 2, "third");
+	assert_null(linemap_dup(lm, 3));
+	assert_int_equal(3, linemap_count(lm, &complete));
+	assert_true(complete);
+
+	linemap_free(lm);
+	assert_success(remove(SANDBOX_PATH "/file"));
+}
+
+TEST(growing_file_gets_mapped)
+{
+	int i;
+	append_to_file(SANDBOX_PATH "/file", "line 0\n");
+
+	linemap_t *const lm = linemap_open(SANDBOX_PATH "/file");
+	assert_non_null(lm);
+	assert_line(lm, 0, "line 0");
+
+	FILE *const f = fopen(SANDBOX_PATH "/file", "a");
+	assert_non_null(f);
+	for(i = 1; i < 200000; ++i)
+	{
+		fprintf(f, "line %d\n", i);
+	}
+	fclose(f);
+
+	linemap_index_bg(lm);
+	assert_success(linemap_extend(lm, SANDBOX_PATH "/file"));
+	assert_line(lm, 199999, "line 199999");
+	assert_line(lm, 256, "line 256");
+	assert_null(linemap_dup(lm, 200000));
+
+	linemap_free(lm);
+	assert_success(remove(SANDBOX_PATH "/file"));
+}
+
+TEST(truncated_or_replaced_file_is_not_extended)
+{
+	append_to_file(SANDBOX_PATH "/file", "abc\n");
+	linemap_t *lm = linemap_open(SANDBOX_PATH "/file");
+	assert_non_null(lm);
+
+	assert_true(linemap_is_intact(lm, SANDBOX_PATH "/file"));
+	FILE *const f = fopen(SANDBOX_PATH "/file", "w");
+	assert_non_null(f);
+	fclose(f);
+	assert_false(linemap_is_intact(lm, SANDBOX_PATH "/file"));
+	assert_failure(linemap_extend(lm, SANDBOX_PATH "/file"));
+	linemap_free(lm);
+
+	lm = linemap_open(SANDBOX_PATH "/file");
+	assert_non_null(lm);
+	assert_success(remove(SANDBOX_PATH "/file"));
+	append_to_file(SANDBOX_PATH "/other", "x");
+	append_to_file(SANDBOX_PATH "/file", "abc\n");
+	assert_false(linemap_is_intact(lm, SANDBOX_PATH "/file"));
+	assert_failure(linemap_extend(lm, SANDBOX_PATH "/file"));
+	linemap_free(lm);
+
+	assert_success(remove(SANDBOX_PATH "/other"));
+	assert_success(remove(SANDBOX_PATH "/file"));
+}
+
+TEST(buffer_is_not_extended)
+{
+	linemap_t *const lm = linemap_from_buffer(strdup("a"), 1);
+	assert_non_null(lm);
+	assert_false(linemap_is_intact(lm, SANDBOX_PATH "/file"));
+	assert_failure(linemap_extend(lm, SANDBOX_PATH "/file"));
+	linemap_free(lm);
+}
+
+#ifndef _WIN32
+
+TEST(fifos_are_read_until_the_end)
+{
+	assert_success(mkfifo(SANDBOX_PATH "/fifo", 0600));
+
+	const pid_t pid = fork();
+	assert_true(pid >= 0);
+	if(pid == 0)
+	{
+		FILE *const f = fopen(SANDBOX_PATH "/fifo", "w");
+		fputs("first\nsecond\n", f);
+		fclose(f);
+		_Exit(0);
+	}
+
+	linemap_t *const lm = linemap_open(SANDBOX_PATH "/fifo");
+	assert_non_null(lm);
+	assert_line(lm, 0, "first");
+	assert_line(lm, 1, "second");
+	assert_null(linemap_dup(lm, 2));
+	linemap_free(lm);
+
+	assert_int_equal(pid, waitpid(pid, NULL, 0));
+	assert_success(remove(SANDBOX_PATH "/fifo"));
+}
+
+#endif
+
+/* Makes line map of text with lines in "line N" format.  Returns the map. */
+static linemap_t *
+make_numbered(int nlines, size_t *len)
+{
+	int i;
+	char *const text = malloc(nlines*16);
+	assert_non_null(text);
+
+	*len = 0U;
+	for(i = 0; i < nlines; ++i)
+	{
+		*len += sprintf(text + *len, "line %d\n", i);
+	}
+
+	linemap_t *const lm = linemap_from_buffer(text, *len);
+	assert_non_null(lm);
+	return lm;
+}
+
+/* Checks contents of a line. */
+static void
+assert_line(linemap_t *lm, int n, const char expected[])
+{
+	char *const line = linemap_dup(lm, n);
+	assert_string_equal(expected, line);
+	free(line);
+}
+
+/* Appends text to a file creating it if necessary. */
+static void
+append_to_file(const char path[], const char text[])
+{
+	FILE *const f = fopen(path, "a");
+	assert_non_null(f);
+	fputs(text, f);
+	fclose(f);
+}
+
+static int
+has_proc(void)
+{
+	return (access("/proc/self/status", R_OK) == 0);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,235 @@
+#include <stic.h>
+
+#include <regex.h> /* REG_EXTENDED REG_ICASE */
+
+#include <stdio.h> /* sprintf() */
+#include <stdlib.h> /* malloc() */
+#include <string.h> /* strdup() strlen() */
+
+#include "../../src/utils/linemap.h"
+#include "../../src/utils/linesearch.h"
+
+static int find(linemap_t *lm, const char pattern[], int from, int backward,
+		int nth);
+static int count(linemap_t *lm, const char pattern[], int cflags);
+static linemap_t * make_text(const char text[]);
+static linemap_t * make_numbered(int nlines);
+static char * remove_escapes(const char line[]);
+
+TEST(matches_are_found_forward)
+{
+	linemap_t *const lm = make_text("abc\nxyz\nabd\nabc\n");
+
+	assert_int_equal(0, find(lm, "ab", 0, 0, 1));
+	assert_int_equal(2, find(lm, "ab", 1, 0, 1));
+	assert_int_equal(3, find(lm, "ab", 1, 0, 2));
+	assert_int_equal(-1, find(lm, "ab", 1, 0, 3));
+	assert_int_equal(2, find(lm, "ab[d]", 0, 0, 1));
+
+	linemap_free(lm);
+}
+
+TEST(matches_are_found_backward)
+{
+	linemap_t *const lm = make_text("abc\nxyz\nabd\nabc");
+
+	assert_int_equal(3, find(lm, "abc", 3, 1, 1));
+	assert_int_equal(0, find(lm, "abc", 2, 1, 1));
+	assert_int_equal(0, find(lm, "ab", 3, 1, 3));
+	assert_int_equal(-1, find(lm, "ab", 3, 1, 4));
+
+	linemap_free(lm);
+}
+
+TEST(searching_outside_of_text_fails)
+{
+	linemap_t *const lm = make_text("abc\n");
+
+	assert_int_equal(-1, find(lm, "abc", 1, 0, 1));
+	assert_int_equal(-1, find(lm, "abc", -1, 1, 1));
+
+	linemap_free(lm);
+}
+
+TEST(invalid_pattern_matches_nothing)
+{
+	linemap_t *const lm = make_text("a(\n");
+
+	assert_int_equal(-1, find(lm, "a(", 0, 0, 1));
+	assert_int_equal(0, count(lm, "a(", REG_EXTENDED));
+
+	linemap_free(lm);
+}
+
+TEST(anchors_apply_to_lines)
+{
+	linemap_t *const lm = make_text("ba\r\nab\r\nb\n");
+
+	assert_int_equal(1, find(lm, "^a", 0, 0, 1));
+	assert_int_equal(0, find(lm, "a$", 0, 0, 1));
+	assert_int_equal(2, count(lm, "b$", REG_EXTENDED));
+	assert_int_equal(1, count(lm, "^b$", REG_EXTENDED));
+
+	linemap_free(lm);
+}
+
+TEST(case_can_be_ignored)
+{
+	linemap_t *const lm = make_text("ABC\nabc\n");
+
+	assert_int_equal(1, count(lm, "abc", REG_EXTENDED));
+	assert_int_equal(2, count(lm, "abc", REG_EXTENDED | REG_ICASE));
+
+	linemap_free(lm);
+}
+
+TEST(escape_sequences_are_removed_before_matching)
+{
+	linemap_t *const lm = make_text("a\033[1mbc\nabc\n\033[0mab\n");
+
+	assert_int_equal(2, count(lm, "abc", REG_EXTENDED));
+	assert_int_equal(3, count(lm, "^ab", REG_EXTENDED));
+
+	linemap_free(lm);
+}
+
+TEST(lines_are_counted_across_chunks)
+{
+	/* Lines take about 1.5 MiB, which is more than a single chunk. */
+	linemap_t *const lm = make_numbered(150000);
+
+	assert_int_equal(15000, count(lm, "7$", REG_EXTENDED));
+	assert_int_equal(15000, count(lm, "[7]$", REG_EXTENDED));
+	assert_int_equal(1, count(lm, "line 149999", REG_EXTENDED));
+
+	assert_int_equal(149999, find(lm, "line 149999", 0, 0, 1));
+	assert_int_equal(17, find(lm, "line 17$", 149999, 1, 1));
+	assert_int_equal(140007, find(lm, "7$", 100000, 0, 4001));
+	assert_int_equal(7, find(lm, "7$", 100000, 1, 10000));
+
+	linemap_free(lm);
+}
+
+TEST(counting_can_start_at_a_line)
+{
+	linemap_t *const lm = make_numbered(150000);
+	linesearch_criteria_t criteria = { .pattern = "7$", .cflags = REG_EXTENDED };
+
+	linesearch_t *ls = linesearch_count(lm, &criteria, 100000);
+	assert_non_null(ls);
+	assert_true(linesearch_wait(ls, -1));
+	assert_int_equal(5000, linesearch_result(ls));
+	linesearch_free(ls);
+
+	ls = linesearch_count(lm, &criteria, 150000);
+	assert_non_null(ls);
+	assert_true(linesearch_wait(ls, -1));
+	assert_int_equal(0, linesearch_result(ls));
+	linesearch_free(ls);
+
+	linemap_free(lm);
+}
+
+TEST(running_search_can_be_freed)
+{
+	linemap_t *const lm = make_numbered(150000);
+	linesearch_criteria_t criteria = { .pattern = "x", .cflags = REG_EXTENDED };
+
+	linesearch_t *ls = linesearch_count(lm, &criteria, 0);
+	assert_non_null(ls);
+	linesearch_free(ls);
+
+	ls = linesearch_find(lm, &criteria, 0, 0, 1);
+	assert_non_null(ls);
+	linesearch_free(ls);
+
+	linesearch_free(NULL);
+
+	linemap_free(lm);
+}
+
+/* Runs search for a match to completion.  Returns its result. */
+static int
+find(linemap_t *lm, const char pattern[], int from, int backward, int nth)
+{
+	linesearch_criteria_t criteria = {
+		.pattern = pattern, .cflags = REG_EXTENDED, .prep = &remove_escapes
+	};
+
+	linesearch_t *const ls = linesearch_find(lm, &criteria, from, backward, nth);
+	assert_non_null(ls);
+	assert_true(linesearch_wait(ls, -1));
+	const int result = linesearch_result(ls);
+	linesearch_free(ls);
+	return result;
+}
+
+/* Runs counting of matches to completion.  Returns its result. */
+static int
+count(linemap_t *lm, const char pattern[], int cflags)
+{
+	linesearch_criteria_t criteria = {
+		.pattern = pattern, .cflags = cflags, .prep = &remove_escapes
+	};
+
+	linesearch_t *const ls = linesearch_count(lm, &criteria, 0);
+	assert_non_null(ls);
+	assert_true(linesearch_wait(ls, -1));
+	const int result = linesearch_result(ls);
+	linesearch_free(ls);
+	return result;
+}
+
+/* Makes line map of a copy of the text.  Returns the map. */
+static linemap_t *
+make_text(const char text[])
+{
+	linemap_t *const lm = linemap_from_buffer(strdup(text), strlen(text));
+	assert_non_null(lm);
+	return lm;
+}
+
+/* Makes line map of text with lines in "line N" format.  Returns the map. */
+static linemap_t *
+make_numbered(int nlines)
+{
+	int i;
+	char *const text = malloc(nlines*16);
+	assert_non_null(text);
+
+	size_t len = 0U;
+	for(i = 0; i < nlines; ++i)
+	{
+		len += sprintf(text + len, "line %d\n", i);
+	}
+
+	linemap_t *const lm = linemap_from_buffer(text, len);
+	assert_non_null(lm);
+	return lm;
+}
+
+/* Removes "\033[...m" sequences.  Returns newly allocated string. */
+static char *
+remove_escapes(const char line[])
+{
+	char *const result = strdup(line);
+	char *out = result;
+	while(*line != '\0')
+	{
+		if(*line == '\033')
+		{
+			while(*line != '\0' && *line != 'm')
+			{
+				++line;
+			}
+			line += (*line == 'm');
+			continue;
+		}
+		*out++ = *line++;
+	}
+	*out = '\0';
+	return result;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
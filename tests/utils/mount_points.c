@@ -0,0 +1,148 @@
+#include <stic.h>
+
+#include <string.h> /* strcmp() */
+
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/mntent.h"
+#include "../../src/compat/pthread.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/utils.h"
+
+#include "utils.h"
+
+static int has_proc(void);
+static int count_traverser(struct mntent *entry, void *arg);
+static int lookup_traverser(struct mntent *entry, void *arg);
+static void * query_mounts(void *arg);
+
+TEST(mount_point_of_root_is_root, IF(has_proc))
+{
+	char mount_point[PATH_MAX + 1];
+	assert_success(get_mount_point("/", sizeof(mount_point), mount_point));
+	assert_string_equal("/", mount_point);
+}
+
+TEST(longest_mount_point_is_found, IF(has_proc))
+{
+	char mount_point[PATH_MAX + 1];
+
+	assert_success(get_mount_point("/proc/self/fd", sizeof(mount_point),
+				mount_point));
+	assert_string_equal("/proc", mount_point);
+
+	assert_success(get_mount_point("/proc/", sizeof(mount_point), mount_point));
+	assert_string_equal("/proc", mount_point);
+
+	/* Prefix of a mount point isn't that mount point. */
+	assert_success(get_mount_point("/procfs", sizeof(mount_point),
+				mount_point));
+	assert_true(strcmp(mount_point, "/proc") != 0);
+}
+
+TEST(relative_path_has_no_mount_point, IF(has_proc))
+{
+	char mount_point[PATH_MAX + 1];
+	assert_failure(get_mount_point("proc", sizeof(mount_point), mount_point));
+}
+
+TEST(file_system_type_is_checked, IF(has_proc))
+{
+	assert_true(is_on_slow_fs("/proc/self", "proc"));
+	assert_true(is_on_slow_fs("/proc/self", "nfs,proc"));
+	assert_false(is_on_slow_fs("/proc/self", "nfs"));
+	assert_true(is_on_slow_fs("/proc/self", "proc"));
+}
+
+TEST(path_prefixes_are_checked, IF(not_windows))
+{
+	assert_true(is_on_slow_fs("/some/slow/path", "/some/slow"));
+	assert_false(is_on_slow_fs("/some/fast/path", "/some/slow"));
+	assert_true(is_on_slow_fs("/any/path", "*"));
+	assert_false(is_on_slow_fs("/any/path", ""));
+}
+
+TEST(all_mounts_are_traversed, IF(has_proc))
+{
+	int count = 0;
+	assert_success(traverse_mount_points(&count_traverser, &count));
+	assert_true(count >= 2);
+}
+
+TEST(traverser_can_query_mounts, IF(has_proc))
+{
+	int count = 0;
+	assert_success(traverse_mount_points(&lookup_traverser, &count));
+	assert_true(count >= 2);
+}
+
+TEST(mounts_can_be_queried_from_several_threads, IF(has_proc))
+{
+	pthread_t threads[4];
+	int failures[4] = {};
+	int i;
+
+	for(i = 0; i < 4; ++i)
+	{
+		assert_success(pthread_create(&threads[i], NULL, &query_mounts,
+					&failures[i]));
+	}
+	for(i = 0; i < 4; ++i)
+	{
+		assert_success(pthread_join(threads[i], NULL));
+		assert_int_equal(0, failures[i]);
+	}
+}
+
+/* Checks whether procfs is mounted at /proc.  Returns non-zero if so,
+ * otherwise zero is returned. */
+static int
+has_proc(void)
+{
+	return is_dir("/proc/self/fd");
+}
+
+/* traverse_mount_points() client that counts mounts.  Returns zero. */
+static int
+count_traverser(struct mntent *entry, void *arg)
+{
+	int *const count = arg;
+	++*count;
+	return 0;
+}
+
+/* traverse_mount_points() client that looks up mount point of every mount.
+ * Returns zero. */
+static int
+lookup_traverser(struct mntent *entry, void *arg)
+{
+	int *const count = arg;
+	char mount_point[PATH_MAX + 1];
+	if(get_mount_point(entry->mnt_dir, sizeof(mount_point), mount_point) == 0)
+	{
+		++*count;
+	}
+	return 0;
+}
+
+/* Queries mounts many times with changing slowfs specifications counting wrong
+ * answers in *arg.  Returns NULL. */
+static void *
+query_mounts(void *arg)
+{
+	int *const failures = arg;
+	char mount_point[PATH_MAX + 1];
+	int i;
+
+	for(i = 0; i < 1000; ++i)
+	{
+		*failures += !is_on_slow_fs("/proc/self", (i%2 == 0) ? "proc" : "nfs,proc");
+		*failures += is_on_slow_fs("/proc/self", (i%2 == 0) ? "nfs" : "ext");
+		*failures += get_mount_point("/proc/self/fd", sizeof(mount_point),
+				mount_point);
+		*failures += (strcmp(mount_point, "/proc") != 0);
+	}
+	return NULL;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,200 @@
+#include <stic.h>
+
+#include <string.h> /* memset() */
+
+#include "../../src/compat/pthread.h"
+#include "../../src/utils/parallel.h"
+
+static void count_calls(int index, void *arg);
+static void record_thread(int index, void *arg);
+
+static int calls[1000];
+static pthread_mutex_t calls_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t threads[1000];
+
+SETUP()
+{
+	memset(calls, 0, sizeof(calls));
+}
+
+TEST(empty_range_is_fine)
+{
+	parallel_for(0, 4, &count_calls, NULL);
+	assert_int_equal(0, calls[0]);
+}
+
+TEST(each_item_is_processed_once)
+{
+	int nthreads;
+	for(nthreads = 1; nthreads <= 8; ++nthreads)
+	{
+		int i;
+
+		memset(calls, 0, sizeof(calls));
+		parallel_for(1000, nthreads, &count_calls, NULL);
+
+		for(i = 0; i < 1000; ++i)
+		{
+			assert_int_equal(1, calls[i]);
+		}
+	}
+}
+
+TEST(more_threads_than_items_is_fine)
+{
+	parallel_for(3, 100, &count_calls, NULL);
+	assert_int_equal(1, calls[0]);
+	assert_int_equal(1, calls[1]);
+	assert_int_equal(1, calls[2]);
+	assert_int_equal(0, calls[3]);
+}
+
+TEST(zero_or_one_thread_processes_items_sequentially)
+{
+	int i;
+	const pthread_t self = pthread_self();
+
+	parallel_for(100, 0, &record_thread, NULL);
+	for(i = 0; i < 100; ++i)
+	{
+		assert_true(pthread_equal(self, threads[i]));
+	}
+
+	parallel_for(100, 1, &record_thread, NULL);
+	for(i = 0; i < 100; ++i)
+	{
+		assert_true(pthread_equal(self, threads[i]));
+	}
+}
+
+TEST(argument_is_passed_through)
+{
+	int i;
+	int values[100];
+
+	parallel_for(100, 4, &record_thread, values);
+	for(i = 0; i < 100; ++i)
+	{
+		assert_int_equal(i*2, values[i]);
+	}
+}
+
+TEST(pool_processes_several_ranges)
+{
+	int round;
+	parallel_pool_t pool;
+
+	parallel_pool_start(&pool, 4);
+	for(round = 1; round <= 10; ++round)
+	{
+		int i;
+
+		parallel_pool_for(&pool, 100*round, &count_calls, NULL);
+		for(i = 0; i < 100*round; ++i)
+		{
+			assert_int_equal(round - i/100, calls[i]);
+		}
+	}
+	parallel_pool_stop(&pool);
+}
+
+TEST(pool_reuses_its_threads)
+{
+	int i, j;
+	pthread_t seen[1000];
+	int nseen = 0;
+	parallel_pool_t pool;
+
+	parallel_pool_start(&pool, 4);
+	for(i = 0; i < 10; ++i)
+	{
+		parallel_pool_for(&pool, 100, &record_thread, NULL);
+		for(j = 0; j < 100; ++j)
+		{
+			int k = 0;
+			while(k < nseen && !pthread_equal(seen[k], threads[j]))
+			{
+				++k;
+			}
+			if(k == nseen)
+			{
+				seen[nseen++] = threads[j];
+			}
+		}
+	}
+	parallel_pool_stop(&pool);
+
+	assert_true(nseen <= 4);
+}
+
+TEST(pool_without_threads_processes_items_sequentially)
+{
+	int i;
+	parallel_pool_t pool;
+
+	parallel_pool_start(&pool, 1);
+	parallel_pool_for(&pool, 100, &record_thread, NULL);
+	parallel_pool_stop(&pool);
+
+	for(i = 0; i < 100; ++i)
+	{
+		assert_true(pthread_equal(pthread_self(), threads[i]));
+	}
+}
+
+TEST(unused_pool_can_be_stopped)
+{
+	parallel_pool_t pool;
+	parallel_pool_start(&pool, 4);
+	parallel_pool_stop(&pool);
+}
+
+TEST(team_threads_get_distinct_indexes)
+{
+	int i;
+	parallel_team_t team;
+
+	const int count = parallel_team_start(&team, 8, &count_calls, NULL);
+	parallel_team_join(&team);
+
+	assert_true(count > 0);
+	for(i = 0; i < count; ++i)
+	{
+		assert_int_equal(1, calls[i]);
+	}
+	assert_int_equal(0, calls[count]);
+}
+
+TEST(team_without_threads_runs_function_on_calling_thread)
+{
+	parallel_team_t team;
+
+	parallel_team_run(&team, 0, &record_thread, NULL);
+	parallel_team_join(&team);
+
+	assert_true(pthread_equal(pthread_self(), threads[0]));
+}
+
+/* Counts number of times each index is processed. */
+static void
+count_calls(int index, void *arg)
+{
+	pthread_mutex_lock(&calls_lock);
+	++calls[index];
+	pthread_mutex_unlock(&calls_lock);
+}
+
+/* Records thread that processed an item and optionally sets an element of
+ * array of ints passed in arg. */
+static void
+record_thread(int index, void *arg)
+{
+	threads[index] = pthread_self();
+	if(arg != NULL)
+	{
+		((int *)arg)[index] = index*2;
+	}
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -1,5 +1,7 @@
 #include <stic.h>
 
+#include <stdlib.h> /* free() */
+
 #include "../../src/utils/regexp.h"
 
 static int not_osx(void);
@@ -44,6 +46,43 @@ TEST(back_reference_substitution)
 	assert_string_equal("f0t0tbaz", regexp_replace("foobaz", "o", "0\\t", 1, 0));
 }
 
+TEST(literal_pattern_is_extracted_exactly)
+{
+	int exact;
+	char *const literal = regexp_extract_literal("foo bar", &exact);
+	assert_string_equal("foo bar", literal);
+	assert_true(exact);
+	free(literal);
+}
+
+TEST(longest_required_literal_is_extracted)
+{
+	int exact;
+	char *literal;
+
+	literal = regexp_extract_literal("ab*cde", &exact);
+	assert_string_equal("cde", literal);
+	assert_false(exact);
+	free(literal);
+
+	literal = regexp_extract_literal("x(abcd)yz", &exact);
+	assert_string_equal("yz", literal);
+	assert_false(exact);
+	free(literal);
+
+	literal = regexp_extract_literal("a\\.bc+", &exact);
+	assert_string_equal("a.bc", literal);
+	assert_false(exact);
+	free(literal);
+}
+
+TEST(no_literal_is_extracted_from_alternatives)
+{
+	int exact;
+	assert_null(regexp_extract_literal("abc|def", &exact));
+	assert_null(regexp_extract_literal("^.*$", &exact));
+}
+
 static int
 not_osx(void)
 {
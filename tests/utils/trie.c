@@ -1,8 +1,9 @@
 #include <stic.h>
 
 #include <stddef.h> /* NULL */
+#include <stdio.h> /* snprintf() */
 #include <stdlib.h> /* free() */
-#include <string.h> /* strdup() */
+#include <string.h> /* memset() strdup() */
 
 #include "../../src/utils/trie.h"
 
@@ -164,5 +165,77 @@ TEST(trie_cloning_works)
 	trie_free(trie);
 }
 
+TEST(many_strings_are_kept)
+{
+	trie_t *const trie = trie_create();
+	char str[32];
+	void *data;
+	int i;
+
+	for(i = 0; i < 10000; ++i)
+	{
+		snprintf(str, sizeof(str), "name%d", i);
+		assert_int_equal(0, trie_set(trie, str, (char *)NULL + i));
+	}
+
+	for(i = 0; i < 10000; ++i)
+	{
+		snprintf(str, sizeof(str), "name%d", i);
+		assert_success(trie_get(trie, str, &data));
+		assert_true(data == (char *)NULL + i);
+	}
+
+	assert_failure(trie_get(trie, "name10000", &data));
+	assert_failure(trie_get(trie, "name", &data));
+
+	trie_free(trie);
+}
+
+TEST(long_strings_are_kept)
+{
+	trie_t *const trie = trie_create();
+	static char str[10000];
+	void *data;
+
+	memset(str, 'x', sizeof(str) - 1);
+	assert_int_equal(0, trie_set(trie, str, trie));
+	assert_int_equal(0, trie_put(trie, "x"));
+
+	assert_success(trie_get(trie, str, &data));
+	assert_true(data == trie);
+
+	str[sizeof(str) - 2] = '\0';
+	assert_failure(trie_get(trie, str, &data));
+
+	trie_free(trie);
+}
+
+TEST(get_from_null_trie_fails)
+{
+	void *data;
+	assert_failure(trie_get(NULL, "str", &data));
+}
+
+TEST(cloned_trie_has_same_data)
+{
+	trie_t *const trie = trie_create();
+	trie_t *clone;
+	void *data;
+	int value;
+
+	assert_int_equal(0, trie_set(trie, "str", &value));
+	assert_int_equal(0, trie_put(trie, ""));
+
+	clone = trie_clone(trie);
+	trie_free(trie);
+
+	assert_success(trie_get(clone, "str", &data));
+	assert_true(data == &value);
+	assert_success(trie_get(clone, "", &data));
+	assert_null(data);
+
+	trie_free(clone);
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
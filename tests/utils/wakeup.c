@@ -0,0 +1,72 @@
+#include <stic.h>
+
+#ifndef _WIN32
+#include <poll.h> /* POLLIN poll() pollfd */
+#endif
+
+#include "../../src/utils/wakeup.h"
+
+#include "utils.h"
+
+static int is_readable(int fd);
+
+TEST(descriptor_is_available, IF(not_windows))
+{
+	assert_true(wakeup_get_fd() >= 0);
+	assert_int_equal(wakeup_get_fd(), wakeup_get_fd());
+}
+
+TEST(descriptor_is_not_readable_without_notification, IF(not_windows))
+{
+	wakeup_drain();
+	assert_false(is_readable(wakeup_get_fd()));
+}
+
+TEST(notification_makes_descriptor_readable, IF(not_windows))
+{
+	wakeup_drain();
+
+	wakeup_notify();
+	assert_true(is_readable(wakeup_get_fd()));
+
+	wakeup_drain();
+	assert_false(is_readable(wakeup_get_fd()));
+}
+
+TEST(all_notifications_are_drained_at_once, IF(not_windows))
+{
+	int i;
+
+	wakeup_drain();
+
+	for(i = 0; i < 1000; ++i)
+	{
+		wakeup_notify();
+	}
+	assert_true(is_readable(wakeup_get_fd()));
+
+	wakeup_drain();
+	assert_false(is_readable(wakeup_get_fd()));
+}
+
+TEST(drain_does_nothing_if_there_is_nothing_to_drain)
+{
+	wakeup_drain();
+	wakeup_drain();
+}
+
+/* Checks whether there is data to read from the descriptor.  Returns non-zero
+ * if so, otherwise zero is returned. */
+static int
+is_readable(int fd)
+{
+#ifndef _WIN32
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	return (poll(&pfd, 1, 0) == 1 && (pfd.revents & POLLIN));
+#else
+	return 0;
+#endif
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */